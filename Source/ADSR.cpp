@@ -12,6 +12,7 @@
 #include "FileStream.h"
 #include "SynthGlobals.h"
 #include "Profiler.h"
+#include <limits>
 
 void ::ADSR::Set(float a, float d, float s, float r, float h /*=-1*/)
 {
@@ -127,34 +128,130 @@ const ::ADSR::EventInfo* ::ADSR::GetEventConst(double time) const
 
 float ::ADSR::Value(double time) const
 {
-   const EventInfo* e = GetEventConst(time);
+   //PROFILER(ADSR_Value);
+   
+   Segment segment;
+   GetSegment(time, segment);
+   return segment.Evaluate(time);
+}
 
-   //if (mStartTime < 0)
-   //   return 0;
+void ::ADSR::RenderBlock(double time, float* out, int bufferSize) const
+{
+   int pos = 0;
+   while (pos < bufferSize)
+   {
+      double segmentTime = time + pos * gInvSampleRateMs;
+      Segment segment;
+      GetSegment(segmentTime, segment);
+      
+      //the first sample at or past the end of the segment, where we look things up again
+      int end = bufferSize;
+      if (segment.mEndTime < time + bufferSize * gInvSampleRateMs)
+      {
+         end = MAX(pos + 1, (int)ceil((segment.mEndTime - time) * gSampleRateMs));
+         while (end > pos + 1 && time + (end - 1) * gInvSampleRateMs >= segment.mEndTime)
+            --end;
+         while (end < bufferSize && time + end * gInvSampleRateMs < segment.mEndTime)
+            ++end;
+      }
+      
+      float value = segment.Evaluate(segmentTime);
+      out[pos] = value;
+      if (segment.mCurve == 0)
+      {
+         float increment = 0;
+         if (segment.mLength > 0)
+            increment = (segment.mEndValue - segment.mStartValue) * gInvSampleRateMs / segment.mLength;
+         for (int i=pos+1; i<end; ++i)
+         {
+            value += increment;
+            out[i] = value;
+         }
+      }
+      else
+      {
+         float lerp = (segmentTime - segment.mStartTime) / segment.mLength;
+         float lerpIncrement = gInvSampleRateMs / segment.mLength;
+         for (int i=pos+1; i<end; ++i)
+         {
+            lerp += lerpIncrement;
+            out[i] = ofLerp(segment.mStartValue, segment.mEndValue, MathUtils::Curve(MIN(lerp, 1.0f), segment.mCurve));
+         }
+      }
+      
+      pos = end;
+   }
+}
+
+void ::ADSR::GetSegment(double time, Segment& segment) const
+{
+   const EventInfo* e = GetEventConst(time);
    
-   //PROFILER(ADSR_Value);
+   segment.mEndTime = std::numeric_limits<double>::max();
+   for (const auto& event : mEvents)
+   {
+      if (event.mStartTime >= time && event.mStartTime < segment.mEndTime)
+         segment.mEndTime = event.mStartTime;   //a start that's coming up
+   }
    
-   float stageStartValue;
    double stageStartTime;
    int stage = GetStage(time, stageStartTime);
+   segment.mStartTime = stageStartTime;
+   segment.mLength = 0;
+   segment.mCurve = 0;
+   
    if (stage == mNumStages)  //done
-      return mStages[stage-1].target;
+   {
+      segment.mStartValue = mStages[stage-1].target;
+      segment.mEndValue = segment.mStartValue;
+      return;
+   }
    
+   float stageStartValue;
    if (stage == 0)
       stageStartValue = e->mStartBlendFromValue;
    else if (mHasSustainStage && stage == mSustainStage + 1)
       stageStartValue = e->mStopBlendFromValue;
    else
       stageStartValue = mStages[stage-1].target * e->mMult;
+   float target = mStages[stage].target * e->mMult;
+   
+   if (mHasSustainStage && stage <= mSustainStage && e->mStopTime > e->mStartTime)
+      segment.mEndTime = MIN(segment.mEndTime, e->mStopTime);
    
    if (mHasSustainStage && stage == mSustainStage && time > stageStartTime + mStages[mSustainStage].time)
-      return mStages[mSustainStage].target * e->mMult;
+   {
+      segment.mStartValue = target;   //sustaining
+      segment.mEndValue = target;
+      return;
+   }
+   
+   if (time < stageStartTime)
+   {
+      segment.mStartValue = stageStartValue;   //scheduled, but not started yet
+      segment.mEndValue = stageStartValue;
+      segment.mEndTime = MIN(segment.mEndTime, stageStartTime);
+      return;
+   }
    
-   float lerp = ofClamp((time - stageStartTime) / mStages[stage].time, 0, 1);
+   segment.mStartValue = stageStartValue;
+   segment.mEndValue = target;
+   segment.mLength = mStages[stage].time;
+   segment.mEndTime = MIN(segment.mEndTime, stageStartTime + mStages[stage].time);
    if (mStages[stage].curve != 0)
-      lerp = MathUtils::Curve(lerp, mStages[stage].curve * ((stageStartValue < mStages[stage].target*e->mMult) ? 1 : -1));
+      segment.mCurve = mStages[stage].curve * ((stageStartValue < target) ? 1 : -1);
+}
+
+float ::ADSR::Segment::Evaluate(double time) const
+{
+   if (mLength <= 0)
+      return mEndValue;
+   
+   float lerp = ofClamp((time - mStartTime) / mLength, 0, 1);
+   if (mCurve != 0)
+      lerp = MathUtils::Curve(lerp, mCurve);
    
-   return ofLerp(stageStartValue, mStages[stage].target * e->mMult, lerp);
+   return ofLerp(mStartValue, mEndValue, lerp);
 }
 
 int ::ADSR::GetStage(double time, double& stageStartTimeOut) const
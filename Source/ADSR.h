@@ -35,6 +35,7 @@ public:
    void Start(double time, float target, const ADSR& adsr);
    void Stop(double time, bool warn = true);
    float Value(double time) const;
+   void RenderBlock(double time, float* out, int bufferSize) const;   //Value() for every sample of a block, but only looks up where it is at stage changes
    void Set(float a, float d, float s, float r, float h = -1);
    void Set(const ADSR& other);
    void Clear() { for (auto& e : mEvents) { e.Reset(); } }
@@ -75,8 +76,21 @@ private:
       double mStopTime;
    };
 
+   //the stretch of the envelope around a time that's a single curve, up until something (a stage change, a stop, a new start) happens
+   struct Segment
+   {
+      float Evaluate(double time) const;
+      float mStartValue;
+      float mEndValue;
+      double mStartTime;
+      float mLength;   //0 for a constant value
+      float mCurve;
+      double mEndTime;
+   };
+
    EventInfo* GetEvent(double time);
    const EventInfo* GetEventConst(double time) const;
+   void GetSegment(double time, Segment& segment) const;
    
    std::array<EventInfo, 5> mEvents;
    int mNextEventPointer;
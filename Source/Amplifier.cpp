@@ -39,16 +39,20 @@ void Amplifier::Process(double time)
    
    if (GetTarget())
    {
+      ComputeSliderBlocks(bufferSize);
+      
+      ScratchArena::Scope scratch;
+      float* workBuffer = scratch.Alloc(bufferSize);
       ChannelBuffer* out = GetTarget()->GetBuffer();
       for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
       {
-         for (int i=0; i<bufferSize; ++i)
-         {
-            ComputeSliders(i);
-            gWorkBuffer[i] = GetBuffer()->GetChannel(ch)[i] * mGain;
-         }
-         Add(out->GetChannel(ch), gWorkBuffer, GetBuffer()->BufferSize());
-         GetVizBuffer()->WriteChunk(gWorkBuffer, GetBuffer()->BufferSize(), ch);
+         BufferCopy(workBuffer, GetBuffer()->GetChannel(ch), bufferSize);
+         if (mGainSlider->IsBlockModulated())
+            Mult(workBuffer, mGainSlider->GetBlockValues(), bufferSize);
+         else
+            Mult(workBuffer, mGain, bufferSize);
+         Add(out->GetChannel(ch), workBuffer, GetBuffer()->BufferSize());
+         GetVizBuffer()->WriteChunk(workBuffer, GetBuffer()->BufferSize(), ch);
       }
    }
    
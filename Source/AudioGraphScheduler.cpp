@@ -0,0 +1,347 @@
+/*
+  ==============================================================================
+
+    AudioGraphScheduler.cpp
+    Created: 18 Oct 2026 10:02:11am
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "AudioGraphScheduler.h"
+#include "IAudioSource.h"
+#include "IAudioReceiver.h"
+#include "IDrawableModule.h"
+#include "IModulator.h"
+#include "INoteSource.h"
+#include "IPulseReceiver.h"
+#include "Profiler.h"
+#include <chrono>
+
+namespace
+{
+   //waiting on other threads is usually over within a few spins, after that give the core back
+   const int kSpinsBeforeYield = 64;
+
+   void Backoff(int& spins)
+   {
+      if (++spins >= kSpinsBeforeYield)
+         juce::Thread::yield();
+   }
+}
+
+AudioGraphScheduler::AudioGraphScheduler()
+: mGraph(nullptr)
+, mReadyWriteIndex(0)
+, mReadState(0)
+, mNumCompleted(0)
+, mBlockTime(0)
+, mMeasureNodeCosts(false)
+, mAudioThreadScratch(ScratchArena::kDefaultCapacityFloats)
+{
+}
+
+AudioGraphScheduler::~AudioGraphScheduler()
+{
+   StopWorkers();
+}
+
+void AudioGraphScheduler::SetNumWorkers(int numWorkers)
+{
+   numWorkers = MAX(0, numWorkers);
+   if (numWorkers == (int)mWorkers.size())
+      return;
+
+   StopWorkers();
+   for (int i=0; i<numWorkers; ++i)
+   {
+      Worker* worker = new Worker(this, i);
+      worker->startThread(juce::Thread::realtimeAudioPriority);   //the audio thread waits on these every block
+      mWorkers.push_back(worker);
+   }
+}
+
+void AudioGraphScheduler::StopWorkers()
+{
+   for (auto* worker : mWorkers)
+   {
+      worker->signalThreadShouldExit();
+      worker->Wake();
+   }
+   for (auto* worker : mWorkers)
+   {
+      worker->stopThread(1000);
+      delete worker;
+   }
+   mWorkers.clear();
+}
+
+void AudioGraphScheduler::Rebuild(const vector<IAudioSource*>& sources)
+{
+   Graph* graph = new Graph();
+   map<IAudioReceiver*, int> receiverNodes;
+   for (int i=0; i<sources.size(); ++i)
+   {
+      graph->mNodes.push_back(Node(sources[i]));
+      IAudioReceiver* receiver = dynamic_cast<IAudioReceiver*>(sources[i]);
+      if (receiver)
+         receiverNodes[receiver] = i;
+   }
+
+   map<IAudioReceiver*, int> lastWriter;
+   for (int i=0; i<sources.size(); ++i)
+   {
+      for (int k=0; k<sources[i]->GetNumTargets(); ++k)
+      {
+         IAudioReceiver* target = sources[i]->GetTarget(k);
+         if (target == nullptr)
+            continue;
+
+         //the receiver has to see this source's output in the same order it would serially.
+         //edges always point forward in the serial order, so feedback loops can't deadlock us.
+         auto receiverNode = receiverNodes.find(target);
+         if (receiverNode != receiverNodes.end() && receiverNode->second != i)
+            graph->AddEdge(MIN(i, receiverNode->second), MAX(i, receiverNode->second));
+
+         //writers into the same buffer get chained, to keep the summing order identical
+         auto writer = lastWriter.find(target);
+         if (writer != lastWriter.end() && writer->second != i)
+            graph->AddEdge(writer->second, i);
+         lastWriter[target] = i;
+      }
+   }
+
+   //barriers split the serial order into sections: each barrier waits on everything in the section
+   //before it, and everything in the section after it waits on the barrier
+   int lastBarrier = -1;
+   vector<int> sinceBarrier;
+   for (int i=0; i<sources.size(); ++i)
+   {
+      if (graph->mNodes[i].mIsBarrier)
+      {
+         for (int node : sinceBarrier)
+            graph->AddEdge(node, i);
+         if (sinceBarrier.empty() && lastBarrier != -1)
+            graph->AddEdge(lastBarrier, i);
+         sinceBarrier.clear();
+         lastBarrier = i;
+      }
+      else
+      {
+         if (lastBarrier != -1)
+            graph->AddEdge(lastBarrier, i);
+         sinceBarrier.push_back(i);
+      }
+   }
+
+   int numNodes = (int)graph->mNodes.size();
+   graph->mPendingPredecessors.reset(new std::atomic<int>[MAX(1, numNodes)]);
+   graph->mReadyQueue.reset(new std::atomic<int>[MAX(1, numNodes)]);
+   graph->mNodeCosts.reset(new std::atomic<uint64_t>[MAX(1, numNodes)]);
+   for (int i=0; i<numNodes; ++i)
+   {
+      graph->mPendingPredecessors[i].store(0);
+      graph->mReadyQueue[i].store(-1);
+      graph->mNodeCosts[i].store(0);
+   }
+   
+   mGraphs.Publish(graph);
+}
+
+AudioGraphScheduler::Node::Node(IAudioSource* source)
+: mSource(source)
+, mModule(dynamic_cast<IDrawableModule*>(source))
+, mNumPredecessors(0)
+, mIsBarrier(IsBarrier(source))
+{
+}
+
+//static
+bool AudioGraphScheduler::IsBarrier(IAudioSource* source)
+{
+   //other modules react to these from inside Process(), on whatever thread is running it
+   return dynamic_cast<INoteSource*>(source) != nullptr ||
+          dynamic_cast<IPulseSource*>(source) != nullptr ||
+          dynamic_cast<IModulator*>(source) != nullptr ||
+          source->ProcessHasSideEffects();
+}
+
+void AudioGraphScheduler::Graph::AddEdge(int from, int to)
+{
+   if (VectorContains(to, mNodes[from].mSuccessors))
+      return;
+   mNodes[from].mSuccessors.push_back(to);
+   ++mNodes[to].mNumPredecessors;
+}
+
+void AudioGraphScheduler::ResetScratch()
+{
+   ScratchArena::BindToThisThread(&mAudioThreadScratch);
+   mAudioThreadScratch.Reset();
+   for (auto* worker : mWorkers)
+      worker->GetScratch().Reset(); //workers are idle between blocks
+}
+
+void AudioGraphScheduler::Process(double time)
+{
+   mGraph = mGraphs.Acquire();
+   if (mGraph == nullptr)
+      return;
+   
+   vector<Node>& nodes = mGraph->mNodes;
+   int numNodes = (int)nodes.size();
+   if (mWorkers.empty() || numNodes < 2)
+   {
+      for (int i=0; i<numNodes; ++i)
+         ProcessNode(nodes[i], i, time);
+      return;
+   }
+
+   //set up while the epoch is still even, nobody can claim from the queue until it goes odd
+   uint32_t epoch = EpochOf(mReadState.load(std::memory_order_relaxed)) + 1;
+   mBlockTime = time;
+   for (int i=0; i<numNodes; ++i)
+   {
+      mGraph->mPendingPredecessors[i].store(nodes[i].mNumPredecessors, std::memory_order_relaxed);
+      mGraph->mReadyQueue[i].store(-1, std::memory_order_relaxed);
+   }
+   mReadyWriteIndex.store(0, std::memory_order_relaxed);
+   mNumCompleted.store(0, std::memory_order_relaxed);
+
+   for (int i=0; i<numNodes; ++i)
+   {
+      if (nodes[i].mNumPredecessors == 0)
+         PushReady(i);
+   }
+
+   mReadState.store(uint64_t(epoch) << 32, std::memory_order_release);
+   for (auto* worker : mWorkers)
+      worker->Wake();
+
+   int spins = 0;
+   while (!IsBlockComplete())
+   {
+      if (RunAvailableNodes(epoch))
+         spins = 0;
+      else
+         Backoff(spins);
+   }
+
+   //close the block. workers still spinning on it see the epoch move and go back to sleep on their own
+   mReadState.store(uint64_t(epoch + 1) << 32, std::memory_order_release);
+}
+
+void AudioGraphScheduler::PushReady(int nodeIndex)
+{
+   int slot = mReadyWriteIndex.fetch_add(1, std::memory_order_acq_rel);
+   mGraph->mReadyQueue[slot].store(nodeIndex, std::memory_order_release);
+}
+
+//returns whether it found anything to run
+bool AudioGraphScheduler::RunAvailableNodes(uint32_t epoch)
+{
+   bool ranNode = false;
+   uint64_t readState = mReadState.load(std::memory_order_acquire);
+   while (EpochOf(readState) == epoch && ReadIndexOf(readState) < mReadyWriteIndex.load(std::memory_order_acquire))
+   {
+      //claim the slot before looking in it. a claimed node hasn't run yet, so the block and its graph are still live
+      if (!mReadState.compare_exchange_weak(readState, readState + 1, std::memory_order_acq_rel))
+         continue;
+      
+      std::atomic<int>& slot = mGraph->mReadyQueue[ReadIndexOf(readState)];
+      int nodeIndex;
+      while ((nodeIndex = slot.load(std::memory_order_acquire)) == -1)
+         ;  //pushed but not filled in yet, the pusher is between the two steps of PushReady()
+      RunNode(nodeIndex);
+      ranNode = true;
+      readState = mReadState.load(std::memory_order_acquire);
+   }
+   return ranNode;
+}
+
+void AudioGraphScheduler::RunNode(int nodeIndex)
+{
+   while (nodeIndex != -1)
+   {
+      const Node& node = mGraph->mNodes[nodeIndex];
+      ProcessNode(node, nodeIndex, mBlockTime);
+
+      int next = -1;
+      for (int successor : node.mSuccessors)
+      {
+         if (mGraph->mPendingPredecessors[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+         {
+            if (next == -1)
+               next = successor;   //keep following the chain on this thread, it's hot in cache
+            else
+               PushReady(successor);
+         }
+      }
+
+      mNumCompleted.fetch_add(1, std::memory_order_release);
+      nodeIndex = next;
+   }
+}
+
+void AudioGraphScheduler::ProcessNode(const Node& node, int nodeIndex, double time)
+{
+   Profiler::ModuleScope profilerScope(node.mModule);
+   if (mMeasureNodeCosts)
+   {
+      auto start = std::chrono::steady_clock::now();
+      node.mSource->Process(time);
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      mGraph->mNodeCosts[nodeIndex].fetch_add(elapsed.count(), std::memory_order_relaxed);
+   }
+   else
+   {
+      node.mSource->Process(time);
+   }
+}
+
+void AudioGraphScheduler::TakeNodeCosts(vector<pair<IAudioSource*, uint64_t> >& costs)
+{
+   costs.clear();
+   if (mGraph == nullptr)
+      return;
+   for (int i=0; i<mGraph->mNodes.size(); ++i)
+      costs.push_back(std::make_pair(mGraph->mNodes[i].mSource, mGraph->mNodeCosts[i].exchange(0)));
+}
+
+bool AudioGraphScheduler::IsBlockComplete() const
+{
+   return mNumCompleted.load(std::memory_order_acquire) == (int)mGraph->mNodes.size();
+}
+
+AudioGraphScheduler::Worker::Worker(AudioGraphScheduler* owner, int index)
+: juce::Thread("audio worker "+juce::String(index))
+, mOwner(owner)
+, mScratch(ScratchArena::kDefaultCapacityFloats)
+{
+}
+
+void AudioGraphScheduler::Worker::run()
+{
+   juce::ScopedNoDenormals noDenormals;
+   ScratchArena::BindToThisThread(&mScratch);
+
+   while (!threadShouldExit())
+   {
+      if (!mWakeEvent.wait(100))
+         continue;
+
+      //only ever help with the block that was running when we woke up
+      uint32_t epoch = EpochOf(mOwner->mReadState.load(std::memory_order_acquire));
+      if (!IsRunning(epoch))
+         continue;
+      
+      int spins = 0;
+      while (mOwner->IsEpochCurrent(epoch))
+      {
+         if (mOwner->RunAvailableNodes(epoch))
+            spins = 0;
+         else
+            Backoff(spins);
+      }
+   }
+}
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    AudioGraphScheduler.h
+    Created: 18 Oct 2026 10:02:11am
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include "ScratchArena.h"
+#include "SnapshotPublisher.h"
+#include <atomic>
+#include <memory>
+
+class IAudioSource;
+class IDrawableModule;
+
+//runs the audio sources as a dependency graph, spread across a pool of worker threads.
+//sources that write into the same receiver are chained in their serial order, so the
+//output is sample-identical to processing mSources one after the other.
+//sources whose Process() has effects beyond their audio (playing notes, firing pulses, feeding
+//a modulator other modules read from, changing the transport) run as barriers: everything before
+//them in the serial order finishes first, and nothing after them starts until they're done.
+//the graph is rebuilt on the ui thread and handed over as a snapshot, so editing it never
+//makes the audio thread wait.
+class AudioGraphScheduler
+{
+public:
+   AudioGraphScheduler();
+   ~AudioGraphScheduler();
+
+   //0 workers means everything runs serially on the audio thread. call with the audio mutex held.
+   void SetNumWorkers(int numWorkers);
+   int GetNumWorkers() const { return (int)mWorkers.size(); }
+
+   //ui thread. sources must already be in dependency order. the audio thread picks the new graph up next block.
+   void Rebuild(const vector<IAudioSource*>& sources);
+   //ui thread. frees graphs the audio thread is done with
+   void ReclaimRetiredGraphs() { mGraphs.Reclaim(); }
+   //call from the audio thread at the start of each block, before anything asks for scratch memory
+   void ResetScratch();
+   void Process(double time);
+   
+   //times every source's Process() while enabled, for the benchmark harness
+   void SetMeasureNodeCosts(bool measure) { mMeasureNodeCosts = measure; }
+   //call while the audio thread is idle. nanoseconds spent in each source since the last call.
+   void TakeNodeCosts(vector<pair<IAudioSource*, uint64_t> >& costs);
+
+private:
+   class Worker : public juce::Thread
+   {
+   public:
+      Worker(AudioGraphScheduler* owner, int index);
+      void run() override;
+      void Wake() { mWakeEvent.signal(); }
+      ScratchArena& GetScratch() { return mScratch; }
+   private:
+      AudioGraphScheduler* mOwner;
+      juce::WaitableEvent mWakeEvent;
+      ScratchArena mScratch;
+   };
+
+   struct Node
+   {
+      Node(IAudioSource* source);
+      IAudioSource* mSource;
+      IDrawableModule* mModule;   //for attributing profiler time
+      vector<int> mSuccessors;
+      int mNumPredecessors;
+      bool mIsBarrier;
+   };
+
+   struct Graph
+   {
+      void AddEdge(int from, int to);
+      vector<Node> mNodes;
+      //per-block bookkeeping, only touched while this graph is being processed
+      std::unique_ptr<std::atomic<int>[]> mPendingPredecessors;
+      std::unique_ptr<std::atomic<int>[]> mReadyQueue;
+      std::unique_ptr<std::atomic<uint64_t>[]> mNodeCosts;
+   };
+
+   static bool IsBarrier(IAudioSource* source);
+   static uint32_t EpochOf(uint64_t readState) { return uint32_t(readState >> 32); }
+   static int ReadIndexOf(uint64_t readState) { return int(readState & 0xffffffff); }
+   static bool IsRunning(uint32_t epoch) { return (epoch & 1) != 0; }
+   void StopWorkers();
+   bool RunAvailableNodes(uint32_t epoch);
+   void RunNode(int nodeIndex);
+   void ProcessNode(const Node& node, int nodeIndex, double time);
+   void PushReady(int nodeIndex);
+   bool IsBlockComplete() const;
+   bool IsEpochCurrent(uint32_t epoch) const { return EpochOf(mReadState.load(std::memory_order_acquire)) == epoch; }
+
+   SnapshotPublisher<Graph> mGraphs;
+   Graph* mGraph;   //the graph being processed this block
+   std::atomic<int> mReadyWriteIndex;
+   //block epoch in the high half, next ready slot to take in the low half. the epoch is odd while a
+   //block runs and goes even when it's done, so a worker that shows up late fails to claim anything
+   //and leaves without touching the queue or the graph
+   std::atomic<uint64_t> mReadState;
+   std::atomic<int> mNumCompleted;
+   double mBlockTime;
+   bool mMeasureNodeCosts;
+   ScratchArena mAudioThreadScratch;
+
+   vector<Worker*> mWorkers;
+};
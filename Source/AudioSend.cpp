@@ -57,8 +57,9 @@ void AudioSend::Process(double time)
    SyncBuffers();
    mVizBuffer2.SetNumChannels(GetBuffer()->NumActiveChannels());
    
-   float* amountBuffer = gWorkBuffer;
-   float* dryAmountBuffer = gWorkBuffer+gBufferSize;
+   ScratchArena::Scope scratch;
+   float* amountBuffer = scratch.Alloc(gBufferSize);
+   float* dryAmountBuffer = scratch.Alloc(gBufferSize);
    for (int i=0; i<gBufferSize; ++i)
    {
       ComputeSliders(i);
@@ -68,14 +69,15 @@ void AudioSend::Process(double time)
    
    if (GetTarget(0))
    {
-      gWorkChannelBuffer.CopyFrom(GetBuffer(), GetBuffer()->BufferSize());
+      ChannelBuffer dryBuffer(scratch, GetBuffer()->BufferSize());
+      dryBuffer.CopyFrom(GetBuffer(), GetBuffer()->BufferSize());
       for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
       {
          ChannelBuffer* out = GetTarget(0)->GetBuffer();
          if (mCrossfade)
-            Mult(gWorkChannelBuffer.GetChannel(ch), dryAmountBuffer, GetBuffer()->BufferSize());
-         Add(out->GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize());
-         GetVizBuffer()->WriteChunk(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
+            Mult(dryBuffer.GetChannel(ch), dryAmountBuffer, GetBuffer()->BufferSize());
+         Add(out->GetChannel(ch), dryBuffer.GetChannel(ch), GetBuffer()->BufferSize());
+         GetVizBuffer()->WriteChunk(dryBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
       }
    }
    
@@ -10,6 +10,7 @@
 #include "ModularSynth.h"
 #include "Profiler.h"
 #include "UIControlMacros.h"
+#include "ScratchArena.h"
 
 BandVocoder::BandVocoder()
 : IAudioProcessor(gBufferSize)
@@ -34,13 +35,12 @@ BandVocoder::BandVocoder()
 , mMaxBand(.3f)
 , mMaxBandSlider(nullptr)
 , mSpacingStyle(0)
+, mInputBands(VOCODER_MAX_BANDS)
+, mCarrierBands(VOCODER_MAX_BANDS)
 {
    mCarrierInputBuffer = new float[GetBuffer()->BufferSize()];
    Clear(mCarrierInputBuffer, GetBuffer()->BufferSize());
    
-   mWorkBuffer = new float[GetBuffer()->BufferSize()];
-   Clear(mWorkBuffer, GetBuffer()->BufferSize());
-   
    mOutBuffer = new float[GetBuffer()->BufferSize()];
    Clear(mOutBuffer, GetBuffer()->BufferSize());
    
@@ -77,7 +77,7 @@ void BandVocoder::CreateUIControls()
 BandVocoder::~BandVocoder()
 {
    delete[] mCarrierInputBuffer;
-   delete[] mWorkBuffer;
+   delete[] mOutBuffer;
 }
 
 void BandVocoder::SetCarrierBuffer(float *carrier, int bufferSize)
@@ -107,33 +107,49 @@ void BandVocoder::Process(double time)
    Mult(GetBuffer()->GetChannel(0), inputPreampSq, bufferSize);
    Mult(mCarrierInputBuffer, carrierPreampSq, bufferSize);
    
-   for (int i=0; i<mNumBands; ++i)
+   //the bands are worked through a lane at a time, staying interleaved until they're summed
+   const int kLanes = BiquadFilterBank::kLanes;
+   ScratchArena::Scope scratch;
+   float* inputBands = scratch.Alloc(bufferSize * kLanes);
+   float* carrierBands = scratch.Alloc(bufferSize * kLanes);
+   float* laneSums = scratch.Alloc(bufferSize * kLanes);
+   Clear(laneSums, bufferSize * kLanes);
+   
+   for (int lane=0; lane<mInputBands.GetNumLanes(); ++lane)
    {
-      //get modulator band
-      BufferCopy(mWorkBuffer,GetBuffer()->GetChannel(0), bufferSize);
-      mBiquadCarrier[i].Filter(mWorkBuffer, bufferSize);
-      
-      float oldPeak = mPeaks[i].GetPeak();
-      
-      //calculate modulator band level
-      mPeaks[i].Process(mWorkBuffer, bufferSize);
+      int first = lane * kLanes;
       
-      //get carrier band
-      BufferCopy(mWorkBuffer,mCarrierInputBuffer, bufferSize);
-      mBiquadOut[i].Filter(mWorkBuffer, bufferSize);
-      
-      //multiply carrier band by modulator band level
-      //Mult(mWorkBuffer, mPeaks[i].GetPeak(), bufferSize);
-      for (int j=0; j<bufferSize; ++j)
-         mWorkBuffer[j] *= ofMap(j,0,bufferSize,oldPeak,mPeaks[i].GetPeak());
-      
-      //don't allow a band to go crazy
-      /*mOutputPeaks[i].Process(mWorkBuffer, bufferSize);
-      if (mOutputPeaks[i].GetPeak() > mMaxBand)
-         Mult(mWorkBuffer, 1/mOutputPeaks[i].GetPeak(), bufferSize);*/
+      //get modulator bands, and calculate their levels
+      mInputBands.FilterLane(lane, GetBuffer()->GetChannel(0), inputBands, bufferSize);
+      float level[kLanes];
+      float levelInc[kLanes];
+      for (int k=0; k<kLanes; ++k)
+         level[k] = mPeaks[first+k].GetPeak();
+      PeakTracker::ProcessInterleaved<kLanes>(mPeaks + first, inputBands, bufferSize);
+      for (int k=0; k<kLanes; ++k)
+      {
+         levelInc[k] = (mPeaks[first+k].GetPeak() - level[k]) / bufferSize;
+         if (first + k >= mNumBands)   //past the last band
+         {
+            level[k] = 0;
+            levelInc[k] = 0;
+         }
+      }
       
-      //accumulate output band into total output
-      Add(mOutBuffer, mWorkBuffer, bufferSize);
+      //get carrier bands, and multiply them by modulator band levels
+      mCarrierBands.FilterLane(lane, mCarrierInputBuffer, carrierBands, bufferSize);
+      for (int i=0; i<bufferSize; ++i)
+      {
+         for (int k=0; k<kLanes; ++k)
+            laneSums[i*kLanes+k] += carrierBands[i*kLanes+k] * (level[k] + levelInc[k] * i);
+      }
+   }
+   
+   //accumulate output bands into total output
+   for (int i=0; i<bufferSize; ++i)
+   {
+      for (int k=0; k<kLanes; ++k)
+         mOutBuffer[i] += laneSums[i*kLanes+k];
    }
 
    Mult(GetBuffer()->GetChannel(0), (1-mDryWet)/inputPreampSq * volSq, bufferSize);
@@ -171,7 +187,7 @@ void BandVocoder::DrawModule()
    ofSetColor(0,255,0);
    for (int i=0; i<mNumBands; ++i)
    {
-      float x = PosForFreq(mBiquadCarrier[i].mF) * w;
+      float x = PosForFreq(mBiquad[i].mF) * w;
       ofLine(x,h,x,h-mPeaks[i].GetPeak()*200);
    }
 
@@ -187,7 +203,7 @@ void BandVocoder::DrawModule()
          float freq = FreqForPos(x / w);
          if (freq < gSampleRate / 2)
          {
-            float response = mBiquadCarrier[i].GetMagnitudeResponseAt(freq);
+            float response = mBiquad[i].GetMagnitudeResponseAt(freq);
             ofVertex(x, (.5f - .666f * log10(response)) * h);
          }
       }
@@ -210,22 +226,21 @@ void BandVocoder::CalcFilters()
       else
          f = ofLerp(fExp, fBass, -mSpacingStyle);
       
-      mBiquadCarrier[i].SetFilterType(kFilterType_Bandpass);
-      mBiquadOut[i].SetFilterType(kFilterType_Bandpass);
-      mBiquadCarrier[i].SetFilterParams(f, mQ);
-      mBiquadOut[i].CopyCoeffFrom(mBiquadCarrier[i]);
+      mBiquad[i].SetFilterType(kFilterType_Bandpass);
+      mBiquad[i].SetFilterParams(f, mQ);
+      mInputBands.SetCoefficients(i, mBiquad[i]);
+      mCarrierBands.SetCoefficients(i, mBiquad[i]);
    }
+   mInputBands.SetNumFilters(mNumBands);
+   mCarrierBands.SetNumFilters(mNumBands);
 }
 
 void BandVocoder::CheckboxUpdated(Checkbox* checkbox)
 {
    if (checkbox == mEnabledCheckbox)
    {
-      for (int i = 0; i < VOCODER_MAX_BANDS; ++i)
-      {
-         mBiquadCarrier[i].Clear();
-         mBiquadOut[i].Clear();
-      }
+      mInputBands.Clear();
+      mCarrierBands.Clear();
    }
 }
 
@@ -16,10 +16,11 @@
 #include "RollingBuffer.h"
 #include "Slider.h"
 #include "BiquadFilterEffect.h"
+#include "BiquadFilterBank.h"
 #include "VocoderCarrierInput.h"
 #include "PeakTracker.h"
 
-#define VOCODER_MAX_BANDS 64
+#define VOCODER_MAX_BANDS 64   //a whole number of BiquadFilterBank lanes
 
 class BandVocoder : public IAudioProcessor, public IDrawableModule, public IFloatSliderListener, public VocoderBase, public IIntSliderListener
 {
@@ -59,7 +60,6 @@ private:
    
    float* mCarrierInputBuffer;
    
-   float* mWorkBuffer;
    float* mOutBuffer;
    
    float mInputPreamp;
@@ -85,8 +85,9 @@ private:
    float mSpacingStyle;
    FloatSlider* mSpacingStyleSlider;
    
-   BiquadFilter mBiquadCarrier[VOCODER_MAX_BANDS];
-   BiquadFilter mBiquadOut[VOCODER_MAX_BANDS];
+   BiquadFilter mBiquad[VOCODER_MAX_BANDS];   //band shapes, for the banks' coefficients and for drawing
+   BiquadFilterBank mInputBands;
+   BiquadFilterBank mCarrierBands;
    PeakTracker mPeaks[VOCODER_MAX_BANDS];
    PeakTracker mOutputPeaks[VOCODER_MAX_BANDS];
 };
@@ -244,8 +244,9 @@ void BeatColumn::Process(double time, float* buffer, int bufferSize)
       beat->SetRate(speed);
       
       //TODO(Ryan) multichannel
-      gWorkChannelBuffer.SetNumActiveChannels(1);
-      if (beat->ConsumeData(time, &gWorkChannelBuffer, bufferSize, true))
+      ScratchArena::Scope scratch;
+      ChannelBuffer beatBuffer(scratch, bufferSize);
+      if (beat->ConsumeData(time, &beatBuffer, bufferSize, true))
       {
          mFilterRamp.Start(time,mFilter,time+10);
          
@@ -262,7 +263,7 @@ void BeatColumn::Process(double time, float* buffer, int bufferSize)
             float lowAmount = ofClamp(-filter/crossfade,0,1);
             float highAmount = ofClamp(filter/crossfade,0,1);
             
-            float normal = gWorkChannelBuffer.GetChannel(0)[i];
+            float normal = beatBuffer.GetChannel(0)[i];
             float lowPassed = mLowpass.Filter(normal);
             float highPassed = mHighpass.Filter(normal);
             float sample = normal * normalAmount + lowPassed * lowAmount + highPassed * highAmount;
@@ -281,7 +282,7 @@ void BeatColumn::Draw(int x, int y)
    {
       ofPushMatrix();
       ofTranslate(x, y);
-      DrawAudioBuffer(100, 35, mBeatData.mBeat->Data(), 0, mBeatData.mBeat->LengthInSamples(), mBeatData.mBeat->GetPlayPosition());
+      mBeatData.mBeat->Draw(100, 35, 0, mBeatData.mBeat->LengthInSamples(), mBeatData.mBeat->GetPlayPosition());
       ofPopMatrix();
    }
    mFilterSlider->SetPosition(x,y+40);
@@ -0,0 +1,336 @@
+/*
+  ==============================================================================
+
+    BenchmarkRunner.cpp
+    Created: 18 Oct 2026 10:41:52pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "BenchmarkRunner.h"
+#include "AudioGraphScheduler.h"
+#include "IAudioSource.h"
+#include "INoteReceiver.h"
+#include "IUIControl.h"
+#include "Sample.h"
+#include "SingleOscillatorVoice.h"
+#include <chrono>
+#include <iostream>
+#if BESPOKE_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+   const double kWarmUpSeconds = 1;   //let lazily-sized buffers settle before counting allocations
+   
+   const char* kLayoutHeader = R"({"modules":[
+      {"type":"transport","name":"transport","position":[0,0]},
+      {"type":"scale","name":"scale","position":[0,0]},
+      {"type":"output","name":"output 1","position":[0,400],"channel":1},
+      {"type":"output","name":"output 2","position":[100,400],"channel":2},)";
+   const char* kLayoutFooter = "]}";
+   
+   void SetControl(string path, float value)
+   {
+      IUIControl* control = TheSynth->FindUIControl(path);
+      if (control != nullptr)
+         control->SetValue(value);
+   }
+   
+   void PlayChord(string receiverName, int numNotes)
+   {
+      INoteReceiver* receiver = TheSynth->FindNoteReceiver(receiverName);
+      for (int i=0; i<numNotes; ++i)
+         receiver->PlayNote(gTime, 36 + i * 3, 100);
+   }
+   
+   //something to granulate that isn't silence, a few seconds of decaying noise bursts
+   void DropTestSample(string moduleName)
+   {
+      Sample sample;
+      int length = gSampleRate * 4;
+      sample.Create(length);
+      float* data = sample.Data()->GetChannel(0);
+      for (int i=0; i<length; ++i)
+      {
+         float decay = 1 - float(i % (gSampleRate / 2)) / (gSampleRate / 2);
+         data[i] = ofRandom(-1, 1) * decay * decay;
+      }
+      TheSynth->FindModule(moduleName)->SampleDropped(0, 0, &sample);
+   }
+}
+
+BenchmarkRunner::Settings::Settings()
+: mSeconds(10)
+, mSampleRate(44100)
+, mBufferSize(256)
+{
+}
+
+//static
+bool BenchmarkRunner::IsBenchmarkCommandLine(const juce::StringArray& args)
+{
+   return args.contains("--benchmark");
+}
+
+//static
+int BenchmarkRunner::RunFromCommandLine(const juce::StringArray& args)
+{
+   Settings settings;
+   string error;
+   if (!ParseCommandLine(args, settings, error))
+   {
+      ofLog() << error;
+      ofLog() << "usage: --benchmark [--seconds 10] [--samplerate 44100] [--buffersize 256] [--workload name] [--output results.json]";
+      return 1;
+   }
+   
+   BenchmarkRunner runner(settings);
+   ofxJSONElement results;
+   if (!runner.Run(results, error))
+   {
+      ofLog() << "benchmark failed: " << error;
+      return 1;
+   }
+   
+   if (settings.mOutputPath.empty())
+      std::cout << results.getRawString(true) << std::endl;
+   else if (!results.save(settings.mOutputPath, true))
+      return 1;
+   return 0;
+}
+
+//static
+bool BenchmarkRunner::ParseCommandLine(const juce::StringArray& args, Settings& settings, string& error)
+{
+   for (int i=args.indexOf("--benchmark")+1; i<args.size(); i += 2)
+   {
+      if (i + 1 >= args.size())
+      {
+         error = args[i].toStdString() + " needs a value";
+         return false;
+      }
+      
+      juce::String value = args[i + 1];
+      if (args[i] == "--seconds")
+         settings.mSeconds = value.getDoubleValue();
+      else if (args[i] == "--samplerate")
+         settings.mSampleRate = value.getIntValue();
+      else if (args[i] == "--buffersize")
+         settings.mBufferSize = value.getIntValue();
+      else if (args[i] == "--workload")
+         settings.mWorkload = value.toStdString();
+      else if (args[i] == "--output")
+         settings.mOutputPath = juce::File::getCurrentWorkingDirectory().getChildFile(value).getFullPathName().toStdString();
+      else
+      {
+         error = "unknown option " + args[i].toStdString();
+         return false;
+      }
+   }
+   
+   if (settings.mSeconds <= 0)
+      error = "bad length";
+   else if (settings.mSampleRate <= 0)
+      error = "bad sample rate";
+   else if (settings.mBufferSize <= 0 || settings.mBufferSize > kWorkBufferSize)
+      error = "buffer size has to be between 1 and " + ofToString(kWorkBufferSize);
+   return error.empty();
+}
+
+//static
+vector<BenchmarkRunner::Workload> BenchmarkRunner::GetWorkloads()
+{
+   vector<Workload> workloads;
+   
+   workloads.push_back({ "fmsynth_16_voices", R"(
+      {"type":"fmsynth","name":"fmsynth","position":[0,100],"target":"output 1"})",
+      [] { PlayChord("fmsynth", 16); } });
+   
+   workloads.push_back({ "oscillator_max_unison", R"(
+      {"type":"oscillator","name":"oscillator","position":[0,100],"target":"output 1"})",
+      []
+      {
+         SetControl("oscillator~unison", SingleOscillatorVoice::kMaxUnison);
+         SetControl("oscillator~width", 1);
+         PlayChord("oscillator", 8);
+      } });
+   
+   workloads.push_back({ "vocoder", R"(
+      {"type":"oscillator","name":"modulator","position":[0,100],"target":"vocoder"},
+      {"type":"oscillator","name":"carrier","position":[200,100],"target":"carrier input"},
+      {"type":"vocodercarrier","name":"carrier input","position":[200,200],"vocoder":"vocoder"},
+      {"type":"vocoder","name":"vocoder","position":[0,250],"target":"output 1"})",
+      []
+      {
+         SetControl("carrier~osc", kOsc_Saw);
+         PlayChord("modulator", 1);
+         PlayChord("carrier", 4);
+      } });
+   
+   workloads.push_back({ "freeverb", R"(
+      {"type":"oscillator","name":"oscillator","position":[0,100],"target":"reverb"},
+      {"type":"effectchain","name":"reverb","position":[0,250],"target":"output 1","effects":[{"type":"freeverb"}]})",
+      [] { PlayChord("oscillator", 4); } });
+   
+   workloads.push_back({ "looper_granular", R"(
+      {"type":"looper","name":"looper","position":[0,100],"target":"output 1"})",
+      []
+      {
+         DropTestSample("looper");
+         SetControl("looper~g on", 1);
+      } });
+   
+   workloads.push_back({ "seaofgrain", R"(
+      {"type":"seaofgrain","name":"seaofgrain","position":[0,100],"target":"output 1"})",
+      []
+      {
+         DropTestSample("seaofgrain");
+         for (int i=1; i<=4; ++i)
+            SetControl("seaofgrain~gain "+ofToString(i), 1);
+         PlayChord("seaofgrain", 16);
+      } });
+   
+   workloads.push_back({ "effectchain_6_effects", R"(
+      {"type":"oscillator","name":"oscillator","position":[0,100],"target":"effects"},
+      {"type":"effectchain","name":"effects","position":[0,250],"target":"output 1","effects":[
+         {"type":"eq"},{"type":"distortion"},{"type":"biquad"},{"type":"compressor"},{"type":"delay"},{"type":"freeverb"}]})",
+      []
+      {
+         SetControl("oscillator~osc", kOsc_Saw);
+         PlayChord("oscillator", 4);
+      } });
+   
+   return workloads;
+}
+
+//static
+long BenchmarkRunner::GetPeakResidentKilobytes()
+{
+#if BESPOKE_WINDOWS
+   PROCESS_MEMORY_COUNTERS counters;
+   if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+      return long(counters.PeakWorkingSetSize / 1024);
+   return -1;
+#else
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return -1;
+#if BESPOKE_MAC
+   return long(usage.ru_maxrss / 1024);   //bytes on mac, kilobytes everywhere else
+#else
+   return long(usage.ru_maxrss);
+#endif
+#endif
+}
+
+BenchmarkRunner::BenchmarkRunner(const Settings& settings)
+: mSettings(settings)
+{
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+}
+
+bool BenchmarkRunner::Run(ofxJSONElement& results, string& error)
+{
+   mSynth.Setup(&mGlobalManagers, nullptr);
+   mSynth.SetRenderingOffline(true);
+   SetGlobalSampleRate(mSettings.mSampleRate);
+   SetGlobalBufferSize(mSettings.mBufferSize);
+   mSynth.SetIOBufferSize(mSettings.mBufferSize);
+   
+   results["samplerate"] = gSampleRate;
+   results["buffersize"] = gBufferSize;
+   results["seconds"] = mSettings.mSeconds;
+   results["audio_worker_threads"] = mSynth.GetAudioGraph()->GetNumWorkers();
+   
+   int numRun = 0;
+   for (const auto& workload : GetWorkloads())
+   {
+      if (!mSettings.mWorkload.empty() && workload.mName != mSettings.mWorkload)
+         continue;
+      
+      ofLog() << "benchmarking " << workload.mName;
+      ofxJSONElement result;
+      RunWorkload(workload, result);
+      results["workloads"].append(result);
+      ++numRun;
+   }
+   
+   if (numRun == 0)
+   {
+      error = "no workload called " + mSettings.mWorkload;
+      return false;
+   }
+   
+   results["peak_rss_kb"] = (int)GetPeakResidentKilobytes();
+   return true;
+}
+
+void BenchmarkRunner::RunWorkload(const Workload& workload, ofxJSONElement& result)
+{
+   srand(0);   //same random choices every run
+   mSynth.LoadLayoutFromString(kLayoutHeader + workload.mLayout + kLayoutFooter);
+   if (workload.mSetUp)
+      workload.mSetUp();
+   mSynth.Poll();   //publish what the set up changed
+   
+   const int kNumChannels = 2;
+   juce::AudioSampleBuffer block(kNumChannels, gBufferSize);
+   int numWarmUpBlocks = int(kWarmUpSeconds * gSampleRate / gBufferSize);
+   int numBlocks = MAX(1, int(mSettings.mSeconds * gSampleRate / gBufferSize));
+   
+   for (int i=0; i<numWarmUpBlocks; ++i)
+   {
+      mSynth.AudioOut(block.getArrayOfWritePointers(), gBufferSize, kNumChannels);
+      mSynth.Poll();
+   }
+   
+   AudioGraphScheduler* graph = mSynth.GetAudioGraph();
+   vector<pair<IAudioSource*, uint64_t> > nodeCosts;
+   graph->TakeNodeCosts(nodeCosts);   //throw away whatever the warm-up left
+   graph->SetMeasureNodeCosts(true);
+   uint64_t allocationsBefore = GetAllocationCount();
+   SetAllocationCountingEnabled(true);
+   
+   double elapsedNs = 0;
+   for (int i=0; i<numBlocks; ++i)
+   {
+      auto start = std::chrono::steady_clock::now();
+      mSynth.AudioOut(block.getArrayOfWritePointers(), gBufferSize, kNumChannels);
+      elapsedNs += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+      
+      //the ui thread's share isn't part of what we're measuring
+      SetAllocationCountingEnabled(false);
+      mSynth.Poll();
+      SetAllocationCountingEnabled(true);
+   }
+   
+   SetAllocationCountingEnabled(false);
+   graph->SetMeasureNodeCosts(false);
+   graph->TakeNodeCosts(nodeCosts);
+   
+   double numSamples = double(numBlocks) * gBufferSize;
+   result["name"] = workload.mName;
+   result["ns_per_sample"] = elapsedNs / numSamples;
+   result["realtime_factor"] = (numSamples / gSampleRate * 1e9) / MAX(elapsedNs, 1.0);
+   result["allocations_per_block"] = double(GetAllocationCount() - allocationsBefore) / numBlocks;
+   result["peak_rss_kb"] = (int)GetPeakResidentKilobytes();
+   for (const auto& cost : nodeCosts)
+   {
+      IDrawableModule* module = dynamic_cast<IDrawableModule*>(cost.first);
+      ofxJSONElement moduleResult;
+      moduleResult["name"] = module ? module->Name() : "unknown";
+      moduleResult["type"] = module ? module->GetTypeName() : "unknown";
+      moduleResult["ns_per_sample"] = cost.second / numSamples;
+      result["modules"].append(moduleResult);
+   }
+}
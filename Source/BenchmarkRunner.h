@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    BenchmarkRunner.h
+    Created: 18 Oct 2026 10:41:52pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include "SynthGlobals.h"
+#include "ModularSynth.h"
+#include "ofxJSONElement.h"
+#include <functional>
+
+//runs a fixed set of representative patches without a window or audio device, and reports
+//how long each module took per sample, how many allocations happened per block, and peak memory, as json.
+//  BespokeSynth --benchmark [--seconds 10] [--samplerate 44100] [--buffersize 256] [--workload name] [--output results.json]
+//results go to stdout without --output. compare the files between commits to catch regressions.
+class BenchmarkRunner
+{
+public:
+   struct Settings
+   {
+      Settings();
+      double mSeconds;
+      int mSampleRate;
+      int mBufferSize;
+      string mWorkload;   //empty runs all of them
+      string mOutputPath;
+   };
+
+   static bool IsBenchmarkCommandLine(const juce::StringArray& args);
+   //returns the process exit code
+   static int RunFromCommandLine(const juce::StringArray& args);
+
+   BenchmarkRunner(const Settings& settings);
+   ~BenchmarkRunner();
+
+   bool Run(ofxJSONElement& results, string& error);
+
+private:
+   struct Workload
+   {
+      string mName;
+      string mLayout;   //same format as a layout file
+      std::function<void()> mSetUp;   //whatever the layout can't express: notes, samples, control values
+   };
+
+   static bool ParseCommandLine(const juce::StringArray& args, Settings& settings, string& error);
+   static vector<Workload> GetWorkloads();
+   static long GetPeakResidentKilobytes();
+   void RunWorkload(const Workload& workload, ofxJSONElement& result);
+
+   Settings mSettings;
+   GlobalManagers mGlobalManagers;
+   ModularSynth mSynth;
+};
@@ -49,6 +49,8 @@ public:
    FilterType mType;
    
 private:
+   friend class BiquadFilterBank;
+
    double mA0;
    double mA1;
    double mA2;
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    BiquadFilterBank.cpp
+    Created: 18 Oct 2026 11:58:12pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "BiquadFilterBank.h"
+#include "SynthGlobals.h"
+#include "ScratchArena.h"
+
+BiquadFilterBank::BiquadFilterBank(int maxFilters)
+: mMaxFilters(maxFilters)
+, mNumFilters(0)
+{
+   int paddedSize = (maxFilters + kLanes - 1) / kLanes * kLanes;
+   mA0 = new double[paddedSize];
+   mA1 = new double[paddedSize];
+   mA2 = new double[paddedSize];
+   mB1 = new double[paddedSize];
+   mB2 = new double[paddedSize];
+   mZ1 = new double[paddedSize];
+   mZ2 = new double[paddedSize];
+   mFlat = new bool[paddedSize];
+
+   //padding lanes pass nothing through, so they can be run along with the real filters
+   for (int i=0; i<paddedSize; ++i)
+   {
+      mA0[i] = 0;
+      mA1[i] = 0;
+      mA2[i] = 0;
+      mB1[i] = 0;
+      mB2[i] = 0;
+      mZ1[i] = 0;
+      mZ2[i] = 0;
+      mFlat[i] = false;
+   }
+}
+
+BiquadFilterBank::~BiquadFilterBank()
+{
+   delete[] mA0;
+   delete[] mA1;
+   delete[] mA2;
+   delete[] mB1;
+   delete[] mB2;
+   delete[] mZ1;
+   delete[] mZ2;
+   delete[] mFlat;
+}
+
+void BiquadFilterBank::SetNumFilters(int numFilters)
+{
+   numFilters = MIN(numFilters, mMaxFilters);
+   for (int i=mNumFilters; i<numFilters; ++i)
+      ClearFilter(i);
+   mNumFilters = numFilters;
+}
+
+void BiquadFilterBank::SetCoefficients(int idx, const BiquadFilter& filter)
+{
+   mA0[idx] = filter.mA0;
+   mA1[idx] = filter.mA1;
+   mA2[idx] = filter.mA2;
+   mB1[idx] = filter.mB1;
+   mB2[idx] = filter.mB2;
+
+   //zeros right on top of the poles, like a peak or shelf at 0db
+   const double kEpsilon = 1e-7;
+   mFlat[idx] = fabs(filter.mA0 - 1) < kEpsilon &&
+                fabs(filter.mA1 - filter.mB1) < kEpsilon &&
+                fabs(filter.mA2 - filter.mB2) < kEpsilon;
+   if (mFlat[idx])
+      ClearFilter(idx);   //where a flat filter's state settles anyway, so it can pick back up cleanly
+}
+
+void BiquadFilterBank::Clear()
+{
+   for (int i=0; i<mMaxFilters; ++i)
+      ClearFilter(i);
+}
+
+void BiquadFilterBank::ClearFilter(int idx)
+{
+   mZ1[idx] = 0;
+   mZ2[idx] = 0;
+}
+
+void BiquadFilterBank::FilterParallel(const float* input, float** outputs, int bufferSize)
+{
+   ScratchArena::Scope scratch;
+   float* laneOut = scratch.Alloc(bufferSize * kLanes);
+
+   for (int lane=0; lane<GetNumLanes(); ++lane)
+   {
+      FilterLane(lane, input, laneOut, bufferSize);
+
+      int first = lane * kLanes;
+      int numFilters = MIN(kLanes, mNumFilters - first);
+      for (int k=0; k<numFilters; ++k)
+      {
+         float* output = outputs[first+k];
+         for (int i=0; i<bufferSize; ++i)
+            output[i] = laneOut[i * kLanes + k];
+      }
+   }
+}
+
+void BiquadFilterBank::FilterLane(int lane, const float* input, float* output, int bufferSize)
+{
+   //the lane's filters are held in locals across the whole block
+   int j = lane * kLanes;
+   double a0[kLanes], a1[kLanes], a2[kLanes], b1[kLanes], b2[kLanes], z1[kLanes], z2[kLanes];
+   for (int k=0; k<kLanes; ++k)
+   {
+      a0[k] = mA0[j+k];
+      a1[k] = mA1[j+k];
+      a2[k] = mA2[j+k];
+      b1[k] = mB1[j+k];
+      b2[k] = mB2[j+k];
+      z1[k] = mZ1[j+k];
+      z2[k] = mZ2[j+k];
+   }
+   for (int i=0; i<bufferSize; ++i)
+   {
+      double in = input[i];
+      float* out = output + i * kLanes;
+      for (int k=0; k<kLanes; ++k)
+      {
+         double y = in * a0[k] + z1[k];
+         z1[k] = in * a1[k] + z2[k] - b1[k] * y;
+         z2[k] = in * a2[k] - b2[k] * y;
+         out[k] = y;
+      }
+   }
+   for (int k=0; k<kLanes; ++k)
+   {
+      mZ1[j+k] = z1[k];
+      mZ2[j+k] = z2[k];
+   }
+}
+
+void BiquadFilterBank::FilterSeries(float* buffer, int bufferSize)
+{
+   //each filter needs the one before it, so there's nothing to spread over lanes here
+   for (int j=0; j<mNumFilters; ++j)
+   {
+      if (mFlat[j])
+         continue;
+
+      double a0 = mA0[j], a1 = mA1[j], a2 = mA2[j], b1 = mB1[j], b2 = mB2[j];
+      double z1 = mZ1[j], z2 = mZ2[j];
+      for (int i=0; i<bufferSize; ++i)
+      {
+         double in = buffer[i];
+         double out = in * a0 + z1;
+         z1 = in * a1 + z2 - b1 * out;
+         z2 = in * a2 - b2 * out;
+         buffer[i] = out;
+      }
+      mZ1[j] = z1;
+      mZ2[j] = z2;
+   }
+}
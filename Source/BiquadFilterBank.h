@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    BiquadFilterBank.h
+    Created: 18 Oct 2026 11:58:12pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BiquadFilter.h"
+
+//a set of biquads processed together. coefficients and state are kept in structure-of-arrays form and
+//padded out to whole lanes, so when every filter sees the same input, each step of the recursion runs a
+//whole lane of filters at once.
+//
+//the coefficients are copied out of regular BiquadFilters, so the bank only has to be told when a filter's
+//parameters change. like BiquadFilter it works in doubles: narrow bands down low need the precision.
+class BiquadFilterBank
+{
+public:
+   BiquadFilterBank(int maxFilters);
+   ~BiquadFilterBank();
+
+   int GetMaxFilters() const { return mMaxFilters; }
+   int GetNumFilters() const { return mNumFilters; }
+   void SetNumFilters(int numFilters);   //filters coming back into use start from silence
+   void SetCoefficients(int idx, const BiquadFilter& filter);
+   void Clear();
+
+   //runs every filter over the same input, filter i writes to outputs[i]
+   void FilterParallel(const float* input, float** outputs, int bufferSize);
+   //runs the lane of filters [lane*kLanes, lane*kLanes+kLanes) over the input, leaving their outputs interleaved:
+   //sample i of the lane's filter k goes in output[i*kLanes+k]. cheaper than FilterParallel() for anything
+   //that can carry on working a lane at a time.
+   void FilterLane(int lane, const float* input, float* output, int bufferSize);
+   int GetNumLanes() const { return (mNumFilters + kLanes - 1) / kLanes; }
+   //runs the buffer through each filter in turn, like calling Filter() on each. flat filters are skipped.
+   void FilterSeries(float* buffer, int bufferSize);
+
+   static const int kLanes = 8;
+
+private:
+   void ClearFilter(int idx);
+
+   int mMaxFilters;
+   int mNumFilters;
+
+   double* mA0;
+   double* mA1;
+   double* mA2;
+   double* mB1;
+   double* mB2;
+   double* mZ1;
+   double* mZ2;
+   bool* mFlat;
+};
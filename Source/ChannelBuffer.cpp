@@ -33,6 +33,21 @@ ChannelBuffer::ChannelBuffer(float* data, int bufferSize)
    mBufferSize = bufferSize;
 }
 
+ChannelBuffer::ChannelBuffer(ScratchArena::Scope& scratch, int bufferSize)
+{
+   //temporary working buffer for the audio thread, doesn't touch the heap
+   
+   mActiveChannels = 1;
+   mNumChannels = kMaxNumChannels;
+   mRecentActiveChannels = 1;
+   mOwnsBuffers = false;
+   
+   mBuffers = mScratchBuffers;
+   mBufferSize = bufferSize;
+   for (int i=0; i<mNumChannels; ++i)
+      mBuffers[i] = scratch.Alloc(bufferSize);
+}
+
 ChannelBuffer::~ChannelBuffer()
 {
    if (mOwnsBuffers)
@@ -40,7 +55,8 @@ ChannelBuffer::~ChannelBuffer()
       for (int i=0; i<mNumChannels; ++i)
          delete[] mBuffers[i];
    }
-   delete[] mBuffers;
+   if (mBuffers != mScratchBuffers)
+      delete[] mBuffers;
 }
 
 void ChannelBuffer::Setup(int bufferSize)
@@ -69,6 +85,41 @@ float* ChannelBuffer::GetChannel(int channel)
    return ret;
 }
 
+bool ChannelBuffer::IsAllocated() const
+{
+   for (int i=0; i<mNumChannels; ++i)
+   {
+      if (mBuffers[i] != nullptr)
+         return true;
+   }
+   return false;
+}
+
+bool ChannelBuffer::IsFullyAllocated() const
+{
+   for (int i=0; i<mNumChannels; ++i)
+   {
+      if (mBuffers[i] == nullptr)
+         return false;
+   }
+   return true;
+}
+
+void ChannelBuffer::AllocateChannels()
+{
+   assert(mOwnsBuffers);
+   for (int i=0; i<mNumChannels; ++i)
+   {
+      if (mBuffers[i] == nullptr)
+      {
+         //zeroed before it's visible, so a reader on another thread sees either nothing or silence
+         float* data = new float[mBufferSize];
+         ::Clear(data, mBufferSize);
+         mBuffers[i] = data;
+      }
+   }
+}
+
 void ChannelBuffer::Clear() const
 {
    for (int i=0; i<mNumChannels; ++i)
@@ -80,6 +131,8 @@ void ChannelBuffer::Clear() const
 
 void ChannelBuffer::SetMaxAllowedChannels(int channels)
 {
+   assert(mOwnsBuffers);
+   
    float** newBuffers = new float*[channels];
    for (int i=0; i<channels; ++i)
    {
@@ -118,11 +171,32 @@ void ChannelBuffer::CopyFrom(ChannelBuffer* src, int length /*= -1*/)
          }
          BufferCopy(mBuffers[i], src->mBuffers[i], length);
       }
-      else
+      else if (mOwnsBuffers)
       {
-         delete mBuffers[i];
+         delete[] mBuffers[i];
          mBuffers[i] = nullptr;
       }
+      else
+      {
+         ::Clear(mBuffers[i], length);
+      }
+   }
+}
+
+void ChannelBuffer::CopyFromInPlace(ChannelBuffer* src, int length)
+{
+   //only into channels that are already there. where src has nothing, ours gets zeroed rather than freed
+   assert(length <= mBufferSize);
+   assert(length <= src->mBufferSize);
+   mActiveChannels = MIN(mNumChannels, src->mActiveChannels);
+   for (int i=0; i<mActiveChannels; ++i)
+   {
+      if (mBuffers[i] == nullptr)
+         continue;
+      if (src->mBuffers[i])
+         BufferCopy(mBuffers[i], src->mBuffers[i], length);
+      else
+         ::Clear(mBuffers[i], length);
    }
 }
 
@@ -173,7 +247,7 @@ void ChannelBuffer::Load(FileStreamIn& in, int& readLength, bool setBufferSize)
    if (setBufferSize)
       Setup(readLength);
    else
-      assert(readLength == mBufferSize);
+      assert(readLength <= mBufferSize);
    in >> mActiveChannels;
    for (int i = 0; i < mActiveChannels; ++i)
    {
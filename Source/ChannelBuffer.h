@@ -11,15 +11,21 @@
 #pragma once
 #include "SynthGlobals.h"
 #include "FileStream.h"
+#include "ScratchArena.h"
 
 class ChannelBuffer
 {
 public:
    ChannelBuffer(int bufferSize);
    ChannelBuffer(float* data, int bufferSize);  //intended as a temporary holder for passing raw data to methods that want a ChannelBuffer
+   ChannelBuffer(ScratchArena::Scope& scratch, int bufferSize);  //temporary working buffer, lives as long as the scope
    ~ChannelBuffer();
    
    float* GetChannel(int channel);
+   bool IsChannelAllocated(int channel) const { return mBuffers[MIN(channel, mActiveChannels-1)] != nullptr; }  //GetChannel() would allocate if not
+   bool IsAllocated() const;
+   bool IsFullyAllocated() const;
+   void AllocateChannels();   //every channel that isn't yet, zeroed
    
    void Clear() const;
    
@@ -30,6 +36,7 @@ public:
    int NumTotalChannels() const { return mNumChannels; }
    int BufferSize() const { return mBufferSize; }
    void CopyFrom(ChannelBuffer* src, int length = -1);
+   void CopyFromInPlace(ChannelBuffer* src, int length);   //CopyFrom() that never allocates or frees, for the audio thread
    void SetChannelPointer(float* data, int channel, bool deleteOldData);
    void Reset() { Clear(); mRecentActiveChannels = mActiveChannels; SetNumActiveChannels(1); }
    void Resize(int bufferSize);
@@ -46,6 +53,7 @@ private:
    int mNumChannels;
    int mBufferSize;
    float** mBuffers;
+   float* mScratchBuffers[kMaxNumChannels];
    int mRecentActiveChannels;
    bool mOwnsBuffers;
 };
@@ -69,17 +69,19 @@ void ClipLauncher::Process(double time)
       sample->SetRate(speed);
    }
    
+   ScratchArena::Scope scratch;
+   ChannelBuffer sampleBuffer(scratch, bufferSize);
    if (sample)
    {
-      gWorkChannelBuffer.SetNumActiveChannels(1);
-      sample->ConsumeData(time, &gWorkChannelBuffer, bufferSize, true);
+      if (!sample->ConsumeData(time, &sampleBuffer, bufferSize, true))
+         sampleBuffer.Clear();
    }
    
    for (int i=0; i<bufferSize; ++i)
    {
       float samp = 0;
       if (sample)
-         samp = gWorkChannelBuffer.GetChannel(0)[i] * volSq;
+         samp = sampleBuffer.GetChannel(0)[i] * volSq;
       samp = mJumpBlender.Process(samp, i);
       out[i] += samp;
       GetVizBuffer()->Write(samp, 0);
@@ -78,6 +78,7 @@ void CodeEntry::Poll()
 
             if (!GetVisibleCode().empty())
             {
+               py::gil_scoped_acquire gil;
                try
                {
                   string prefix = ScriptModule::GetBootstrapImportString() + "; import me\n";
@@ -624,6 +625,7 @@ void CodeEntry::OnCodeUpdated()
 {
    if (mDoSyntaxHighlighting)
    {
+      py::gil_scoped_acquire gil;
       try
       {
          py::globals()["syntax_highlight_code"] = GetVisibleCode();
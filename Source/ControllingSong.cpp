@@ -181,12 +181,13 @@ void ControllingSong::Process(double time)
          TheTransport->SetMeasurePos(measurePos);
       }
       
-      gWorkChannelBuffer.SetNumActiveChannels(1);
-      if (mSample.ConsumeData(time, &gWorkChannelBuffer, bufferSize, true))
+      ScratchArena::Scope scratch;
+      ChannelBuffer songBuffer(scratch, bufferSize);
+      if (mSample.ConsumeData(time, &songBuffer, bufferSize, true))
       {
          for (int i=0; i<bufferSize; ++i)
          {
-            float sample = gWorkChannelBuffer.GetChannel(0)[i] * volSq;
+            float sample = songBuffer.GetChannel(0)[i] * volSq;
             if (mMute)
                sample = 0;
             out[i] += sample;
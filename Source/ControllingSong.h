@@ -38,6 +38,7 @@ public:
    
    //IAudioSource
    void Process(double time) override;
+   bool ProcessHasSideEffects() override { return true; }   //drives the transport tempo
    void SetEnabled(bool enabled) override { mEnabled = enabled; }
    
    void DropdownUpdated(DropdownList* list, int oldVal) override;
@@ -242,7 +242,7 @@ void DrumPlayer::LoadKit(int kit)
       LoadSampleLock();
       for (int i=0; i<NUM_DRUM_HITS; ++i)
       {
-         mDrumHits[i].mSample.Read(mKits[kit].mSampleFiles[i].c_str());
+         mDrumHits[i].mSample.Read(mKits[kit].mSampleFiles[i].c_str(), false, Sample::ReadType::Stream);
          mDrumHits[i].mLinkId = mKits[kit].mLinkIds[i];
          mDrumHits[i].mVol = mKits[kit].mVols[i];
          mDrumHits[i].mSpeed = mKits[kit].mSpeeds[i];
@@ -333,11 +333,13 @@ void DrumPlayer::Process(double time)
    {
       mLoadSamplesAudioMutex.lock();
       mLoadingSamples = true;
+      ScratchArena::Scope scratch;
+      ChannelBuffer hitBuffer(scratch, bufferSize);
+      hitBuffer.SetNumActiveChannels(numChannels);
       for (int i=0; i<NUM_DRUM_HITS; ++i)
       {
          int individualOutputIndex = GetIndividualOutputIndex(i);
-         gWorkChannelBuffer.SetNumActiveChannels(numChannels);
-         if (mDrumHits[i].Process(time, mSpeed, volSq, &gWorkChannelBuffer, bufferSize))
+         if (mDrumHits[i].Process(time, mSpeed, volSq, &hitBuffer, bufferSize))
          {
             for (int ch=0; ch<numChannels; ++ch)
             {
@@ -345,12 +347,12 @@ void DrumPlayer::Process(double time)
                {
                   int targetIndex = individualOutputIndex + 1;
                   if (GetTarget(targetIndex))
-                     Add(GetTarget(targetIndex)->GetBuffer()->GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), bufferSize);
-                  mIndividualOutputs[individualOutputIndex]->mVizBuffer->WriteChunk(gWorkChannelBuffer.GetChannel(ch), bufferSize, ch);
+                     Add(GetTarget(targetIndex)->GetBuffer()->GetChannel(ch), hitBuffer.GetChannel(ch), bufferSize);
+                  mIndividualOutputs[individualOutputIndex]->mVizBuffer->WriteChunk(hitBuffer.GetChannel(ch), bufferSize, ch);
                }
                else
                {
-                  Add(mOutputBuffer.GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), bufferSize);
+                  Add(mOutputBuffer.GetChannel(ch), hitBuffer.GetChannel(ch), bufferSize);
                }
             }
          }
@@ -418,15 +420,40 @@ float DrumPlayer::DrumHit::GetPlayProgress(double time)
       }
    }
 
-   if (startTime != -1 && mSample.Data() != nullptr)
+   if (startTime != -1 && mSample.LengthInSamples() > 0)
       return mPlayheads[playheadIdx].mOffset / mSample.LengthInSamples();
    return 1;
 }
 
 bool DrumPlayer::DrumHit::Process(double time, float speed, float vol, ChannelBuffer* out, int bufferSize)
 {
-   ChannelBuffer* sampleData = mSample.Data();
    speed *= mSpeed;
+   
+   //a streamed hit pulls the stretch of file each playhead can reach this block out up front
+   ScratchArena::Scope scratch;
+   bool streaming = mSample.IsStreaming();
+   ChannelBuffer* sampleData = streaming ? nullptr : mSample.Data();
+   int numDataChannels = streaming ? mSample.NumChannels() : sampleData->NumActiveChannels();
+   const float* window[kNumPlayheads][ChannelBuffer::kMaxNumChannels];
+   int windowStart[kNumPlayheads];
+   int windowLength[kNumPlayheads];
+   if (streaming)
+   {
+      for (size_t playhead = 0; playhead < mPlayheads.size(); ++playhead)
+      {
+         if (mPlayheads[playhead].mStartTime == -1 || mPlayheads[playhead].mOffset >= mSample.LengthInSamples())
+            continue;
+         double offset = mPlayheads[playhead].mOffset;
+         double lastOffset = offset + speed * mPlayheads[playhead].mSpeedTweak * mSample.GetSampleRateRatio() * (mPitchBend ? 2 : 1) * bufferSize;
+         windowStart[playhead] = (int)floor(MIN(offset, lastOffset));
+         windowLength[playhead] = MIN((int)ceil(MAX(offset, lastOffset)) - windowStart[playhead] + 2, Sample::kMaxStreamWindow);
+         ChannelBuffer windowBuffer(scratch, windowLength[playhead]);   //the memory belongs to the scope, not to this
+         windowBuffer.SetNumActiveChannels(numDataChannels);
+         mSample.ReadStreamedFrames(windowStart[playhead], &windowBuffer);
+         for (int ch = 0; ch < numDataChannels; ++ch)
+            window[playhead][ch] = windowBuffer.GetChannel(ch);
+      }
+   }
 
    for (int i = 0; i < bufferSize; ++i)
    {
@@ -434,8 +461,9 @@ bool DrumPlayer::DrumHit::Process(double time, float speed, float vol, ChannelBu
       if (mPitchBend != nullptr)
          sampleSpeed *= ofMap(mPitchBend->GetValue(i), -.5f, .5f, 0, 2);
 
+      float channelSamples[ChannelBuffer::kMaxNumChannels];
       for (int ch = 0; ch < out->NumActiveChannels(); ++ch)
-         gWorkBuffer[ch] = 0;
+         channelSamples[ch] = 0;
 
       for (size_t playhead = 0; playhead < mPlayheads.size(); ++playhead)
       {
@@ -443,8 +471,20 @@ bool DrumPlayer::DrumHit::Process(double time, float speed, float vol, ChannelBu
          {
             for (int ch = 0; ch < out->NumActiveChannels(); ++ch)
             {
-               int dataChannel = MIN(ch, sampleData->NumActiveChannels() - 1);
-               float sample = GetInterpolatedSample(mPlayheads[playhead].mOffset, sampleData->GetChannel(dataChannel), mSample.LengthInSamples());
+               int dataChannel = MIN(ch, numDataChannels - 1);
+               float sample;
+               if (streaming)
+               {
+                  double windowPos = ofClamp(mPlayheads[playhead].mOffset - windowStart[playhead], 0, windowLength[playhead] - 2);
+                  int pos = int(windowPos);
+                  float a = windowPos - pos;
+                  const float* data = window[playhead][dataChannel];
+                  sample = (1-a)*data[pos] + a*data[pos+1];
+               }
+               else
+               {
+                  sample = GetInterpolatedSample(mPlayheads[playhead].mOffset, sampleData->GetChannel(dataChannel), mSample.LengthInSamples());
+               }
                sample *= mVelocity * vol * mVol * mVol;
                if (mUseEnvelope)
                   sample *= mEnvelope.Value(mPlayheads[playhead].mRunningTime);
@@ -457,7 +497,7 @@ bool DrumPlayer::DrumHit::Process(double time, float speed, float vol, ChannelBu
                      mPlayheads[playhead].mStartTime = -1;
                }
 
-               gWorkBuffer[ch] += sample;
+               channelSamples[ch] += sample;
             }
 
             mPlayheads[playhead].mOffset += sampleSpeed * mPlayheads[playhead].mSpeedTweak * mSample.GetSampleRateRatio();
@@ -467,8 +507,8 @@ bool DrumPlayer::DrumHit::Process(double time, float speed, float vol, ChannelBu
       }
 
       int secondChannel = out->NumActiveChannels() == 1 ? 0 : 1;
-      float left = gWorkBuffer[0];
-      float right = gWorkBuffer[secondChannel];
+      float left = channelSamples[0];
+      float right = channelSamples[secondChannel];
 
       if (mPan + mPanInput != 0 && mOwner->mMonoOutput == false)
       {
@@ -581,7 +621,7 @@ void DrumPlayer::FilesDropped(vector<string> files, int x, int y)
             if (sampleIdx != -1)
             {
                LoadSampleLock();
-               mDrumHits[sampleIdx].mSample.Read(files[i].c_str());
+               mDrumHits[sampleIdx].mSample.Read(files[i].c_str(), false, Sample::ReadType::Stream);
                LoadSampleUnlock();
                mDrumHits[sampleIdx].mLinkId = -1;
                mDrumHits[sampleIdx].mVol = 1;
@@ -795,7 +835,7 @@ void DrumPlayer::DrumHit::DrawUIControls()
    if (!mOwner->mLoadingSamples)
    {
       mOwner->mLoadSamplesDrawMutex.lock();
-      DrawAudioBuffer(135, 100, mSample.Data(), 0, displayLength, mSample.GetPlayPosition());
+      mSample.Draw(135, 100, 0, displayLength, mSample.GetPlayPosition());
       mOwner->mLoadSamplesDrawMutex.unlock();
    }
    ofPopMatrix();
@@ -960,7 +1000,7 @@ void DrumPlayer::FloatSliderUpdated(FloatSlider* slider, float oldVal)
          if (mAuditionPadIdx >= 0 && mAuditionPadIdx < NUM_DRUM_HITS)
          {
             LoadSampleLock();
-            mDrumHits[mAuditionPadIdx].mSample.Read(file.c_str());
+            mDrumHits[mAuditionPadIdx].mSample.Read(file.c_str(), false, Sample::ReadType::Stream);
             LoadSampleUnlock();
             mDrumHits[mAuditionPadIdx].StartPlayhead(gTime);
             mDrumHits[mAuditionPadIdx].mVelocity = .5f;
@@ -1050,7 +1090,7 @@ void DrumPlayer::DrumHit::LoadRandomSample()
       string file = files[rand() % files.size()].getFullPathName().toStdString();
       
       mOwner->LoadSampleLock();
-      mSample.Read(file.c_str());
+      mSample.Read(file.c_str(), false, Sample::ReadType::Stream);
       mOwner->LoadSampleUnlock();
       //mSample.Play(gTime, mSpeed, 0);
       //mVelocity = .5f;
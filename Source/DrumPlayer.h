@@ -255,7 +255,8 @@ private:
       RollingBuffer mWidenerBuffer;
       int mSamplesRemainingToProcess;
 
-      array<Playhead,2> mPlayheads;
+      static const int kNumPlayheads = 2;
+      array<Playhead,kNumPlayheads> mPlayheads;
       int mCurrentPlayheadIndex;
    };
    
@@ -18,14 +18,14 @@ EQEffect::EQEffect()
 {
    SetEnabled(true);
    
-   for (int ch=0; ch<ChannelBuffer::kMaxNumChannels; ++ch)
+   for (int i=0; i<NUM_EQ_FILTERS; ++i)
    {
-      for (int i=0; i<NUM_EQ_FILTERS; ++i)
-      {
-         mBanks[ch].mBiquad[i].SetFilterType(kFilterType_Peak);
-         mBanks[ch].mBiquad[i].SetFilterParams(40 * powf(2.2f,i), .1f);
-      }
+      mBiquad[i].SetFilterType(kFilterType_Peak);
+      mBiquad[i].SetFilterParams(40 * powf(2.2f,i), .1f);
+      UpdateFilter(i);
    }
+   for (int ch=0; ch<ChannelBuffer::kMaxNumChannels; ++ch)
+      mBanks[ch].mFilters.SetNumFilters(mNumFilters);
 }
 
 void EQEffect::CreateUIControls()
@@ -63,10 +63,7 @@ void EQEffect::ProcessAudio(double time, ChannelBuffer* buffer)
    ComputeSliders(0);
    
    for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
-   {
-      for (int i=0; i<mNumFilters; ++i)
-         mBanks[ch].mBiquad[i].Filter(buffer->GetChannel(ch),bufferSize);
-   }
+      mBanks[ch].mFilters.FilterSeries(buffer->GetChannel(ch),bufferSize);
 }
 
 void EQEffect::DrawModule()
@@ -108,10 +105,7 @@ void EQEffect::CheckboxUpdated(Checkbox* checkbox)
    if (checkbox == mEnabledCheckbox)
    {
       for (int ch=0; ch<ChannelBuffer::kMaxNumChannels; ++ch)
-      {
-         for (int i=0; i<NUM_EQ_FILTERS; ++i)
-            mBanks[ch].mBiquad[i].Clear();
-      }
+         mBanks[ch].mFilters.Clear();
    }
 }
 
@@ -123,32 +117,27 @@ void EQEffect::ButtonClicked(ClickButton* button)
 {
    if (button == mEvenButton)
    {
-      for (int ch=0; ch<ChannelBuffer::kMaxNumChannels; ++ch)
+      for (int i=0; i<NUM_EQ_FILTERS; ++i)
       {
-         for (int i=0; i<NUM_EQ_FILTERS; ++i)
-         {
-            mMultiSlider->SetVal(i, 0, .5f);
-            mBanks[ch].mBiquad[i].mDbGain = 0;
-            if (ch == 0)
-               mBanks[0].mBiquad[i].UpdateFilterCoeff();
-            else
-               mBanks[ch].mBiquad[i].CopyCoeffFrom(mBanks[0].mBiquad[i]);
-         }
+         mMultiSlider->SetVal(i, 0, .5f);
+         mBiquad[i].mDbGain = 0;
+         UpdateFilter(i);
       }
    }
 }
 
 void EQEffect::GridUpdated(UIGrid* grid, int col, int row, float value, float oldValue)
 {
+   //each column is one filter, so only that one needs new coefficients
+   if (col < 0 || col >= mNumFilters)
+      return;
+   mBiquad[col].mDbGain = ofMap(mMultiSlider->GetVal(col,0),0,1,-12,12);
+   UpdateFilter(col);
+}
+
+void EQEffect::UpdateFilter(int idx)
+{
+   mBiquad[idx].UpdateFilterCoeff();
    for (int ch=0; ch<ChannelBuffer::kMaxNumChannels; ++ch)
-   {
-      for (int i=0; i<mNumFilters; ++i)
-      {
-         mBanks[ch].mBiquad[i].mDbGain = ofMap(mMultiSlider->GetVal(i,0),0,1,-12,12);
-         if (ch == 0)
-            mBanks[0].mBiquad[i].UpdateFilterCoeff();
-         else
-            mBanks[ch].mBiquad[i].CopyCoeffFrom(mBanks[0].mBiquad[i]);
-      }
-   }
+      mBanks[ch].mFilters.SetCoefficients(idx, mBiquad[idx]);
 }
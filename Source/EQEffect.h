@@ -14,7 +14,7 @@
 #include "Checkbox.h"
 #include "Slider.h"
 #include "Transport.h"
-#include "BiquadFilter.h"
+#include "BiquadFilterBank.h"
 #include "RadioButton.h"
 #include "UIGrid.h"
 #include "ClickButton.h"
@@ -53,11 +53,15 @@ private:
    void DrawModule() override;
    bool Enabled() const override { return mEnabled; }
 
+   void UpdateFilter(int idx);
+   
    struct FilterBank
    {
-      BiquadFilter mBiquad[NUM_EQ_FILTERS];
+      FilterBank() : mFilters(NUM_EQ_FILTERS) {}
+      BiquadFilterBank mFilters;
    };
    
+   BiquadFilter mBiquad[NUM_EQ_FILTERS];   //shared by every channel's bank
    FilterBank mBanks[ChannelBuffer::kMaxNumChannels];
    int mNumFilters;
    
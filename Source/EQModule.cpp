@@ -25,10 +25,8 @@ EQModule::EQModule()
    , mNeedToUpdateFrequencyResponseGraph(true)
    , mDrawGain(1)
 {
-   // Generate a window with a single raised cosine from N/4 to 3N/4
-   mWindower = new float[kNumFFTBins];
-   for (int i = 0; i < kNumFFTBins; ++i)
-      mWindower[i] = -.5f*cos(FTWO_PI*i / kNumFFTBins) + .5f;
+   // Single raised cosine from N/4 to 3N/4, shared by every FFT of this size
+   mWindower = mFFT.GetHannWindow();
    mSmoother = new float[kNumFFTBins / 2 + 1 - kBinIgnore];
    for (int i = 0; i < kNumFFTBins / 2 + 1 - kBinIgnore; ++i)
       mSmoother[i] = 0;
@@ -83,7 +81,6 @@ void EQModule::CreateUIControls()
 
 EQModule::~EQModule()
 {
-   delete[] mWindower;
    delete[] mSmoother;
 }
 
@@ -110,29 +107,32 @@ void EQModule::Process(double time)
 
    if (mEnabled)
    {
-      Clear(gWorkBuffer, GetBuffer()->BufferSize());
+      ScratchArena::Scope scratch;
+      float* monoBuffer = scratch.Alloc(GetBuffer()->BufferSize());
+      Clear(monoBuffer, GetBuffer()->BufferSize());
 
       ChannelBuffer* out = GetTarget()->GetBuffer();
-      gWorkChannelBuffer.SetNumActiveChannels(out->NumActiveChannels());
+      ChannelBuffer filteredBuffer(scratch, GetBuffer()->BufferSize());
+      filteredBuffer.SetNumActiveChannels(out->NumActiveChannels());
 
       for (int ch = 0; ch < GetBuffer()->NumActiveChannels(); ++ch)
       {
-         BufferCopy(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+         BufferCopy(filteredBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
          for (auto& filter : mFilters)
          {
             if (filter.mEnabled)
-               filter.mFilter[ch].Filter(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize());
+               filter.mFilter[ch].Filter(filteredBuffer.GetChannel(ch), GetBuffer()->BufferSize());
          }
-         //Add(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+         //Add(filteredBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
 
-         Add(out->GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize());
-         GetVizBuffer()->WriteChunk(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
+         Add(out->GetChannel(ch), filteredBuffer.GetChannel(ch), GetBuffer()->BufferSize());
+         GetVizBuffer()->WriteChunk(filteredBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
       }
 
       for (int ch = 0; ch < GetBuffer()->NumActiveChannels(); ++ch)
-         Add(gWorkBuffer, gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize());
+         Add(monoBuffer, filteredBuffer.GetChannel(ch), GetBuffer()->BufferSize());
 
-      mRollingInputBuffer.WriteChunk(gWorkBuffer, GetBuffer()->BufferSize(), 0);
+      mRollingInputBuffer.WriteChunk(monoBuffer, GetBuffer()->BufferSize(), 0);
 
       //copy rolling input buffer into working buffer and window it
       mRollingInputBuffer.ReadChunk(mFFTData.mTimeDomain, kNumFFTBins, 0, 0);
@@ -65,7 +65,7 @@ private:
    float mWidth;
    float mHeight;
 
-   float* mWindower;
+   const float* mWindower;
    float* mSmoother;
 
    ::FFT mFFT;
@@ -104,29 +104,31 @@ void EffectChain::Process(double time)
    if (GetTarget() == nullptr)
       return;
 
-   ComputeSliders(0);
    SyncBuffers();
    mDryBuffer.SetNumActiveChannels(GetBuffer()->NumActiveChannels());
    
    int bufferSize = GetBuffer()->BufferSize();
+   ComputeSliderBlocks(bufferSize);
    
    if (mEnabled)
    {
       mEffectMutex.lock();
       
+      ScratchArena::Scope scratch;
+      float* dryWetBuffer = scratch.Alloc(bufferSize);
+      float* invDryWetBuffer = scratch.Alloc(bufferSize);
+      
       for (int i=0; i<mEffects.size(); ++i)
       {
          mDryBuffer.CopyFrom(GetBuffer());
          
          mEffects[i]->ProcessAudio(time,GetBuffer());
        
-         float* dryWetBuffer = gWorkBuffer;
-         float* invDryWetBuffer = gWorkBuffer + bufferSize;
+         const float* modulatedDryWet = mDryWetSliders[i]->IsBlockModulated() ? mDryWetSliders[i]->GetBlockValues() : nullptr;
          for (int j = 0; j < bufferSize; ++j)
          {
-            ComputeSliders(j);
-            dryWetBuffer[j] = mDryWetLevels[i];
-            invDryWetBuffer[j] = 1.0f - mDryWetLevels[i];
+            dryWetBuffer[j] = modulatedDryWet ? modulatedDryWet[j] : mDryWetLevels[i];
+            invDryWetBuffer[j] = 1.0f - dryWetBuffer[j];
          }
 
          for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
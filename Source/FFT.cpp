@@ -8,19 +8,269 @@
 
 #include "FFT.h"
 
+namespace
+{
+   CriticalSection sPlanCacheLock;
+   std::map<int, FFTPlan*> sPlanCache;
+}
+
+//static
+const FFTPlan* FFTPlan::Get(int nfft)
+{
+   ScopedLock lock(sPlanCacheLock);
+   FFTPlan*& plan = sPlanCache[nfft];
+   if (plan == nullptr)
+      plan = new FFTPlan(nfft);   //lives until exit, modules come and go but the sizes they use don't
+   return plan;
+}
+
+FFTPlan::FFTPlan(int nfft)
+: mNfft(nfft)
+, mComplexSize(nfft / 2)
+{
+   assert(nfft >= 4 && (nfft & (nfft - 1)) == 0);
+   
+   for (int n = mComplexSize, stride = 1; n > 1; )
+   {
+      Stage stage;
+      stage.mRadix = (n >= 4) ? 4 : 2;
+      stage.mNumGroups = n / stage.mRadix;
+      stage.mStride = stride;
+      stage.mTwiddles.resize(6 * stage.mNumGroups);
+      for (int p=0; p<stage.mNumGroups; ++p)
+      {
+         for (int k=1; k<=3; ++k)
+         {
+            double angle = -2 * M_PI * p * k / n;
+            stage.mTwiddles[(2*k-2) * stage.mNumGroups + p] = cos(angle);
+            stage.mTwiddles[(2*k-1) * stage.mNumGroups + p] = sin(angle);
+         }
+      }
+      mStages.push_back(stage);
+      n /= stage.mRadix;
+      stride *= stage.mRadix;
+   }
+   
+   mSplitRe.resize(mComplexSize + 1);
+   mSplitIm.resize(mComplexSize + 1);
+   for (int k=0; k<=mComplexSize; ++k)
+   {
+      mSplitRe[k] = cos(-2 * M_PI * k / nfft);
+      mSplitIm[k] = sin(-2 * M_PI * k / nfft);
+   }
+   
+   // single raised cosine, what every spectral module was building for itself
+   mHannWindow.resize(nfft);
+   for (int i=0; i<nfft; ++i)
+      mHannWindow[i] = -.5*cos(FTWO_PI*i/nfft)+.5;
+}
+
+// Stockham autosort, so there's no bit reversal pass and every inner loop walks memory in order
+void FFTPlan::ComplexForward(float* re, float* im, float* workRe, float* workIm) const
+{
+   float* xr = re;
+   float* xi = im;
+   float* yr = workRe;
+   float* yi = workIm;
+   
+   for (const Stage& stage : mStages)
+   {
+      const int m = stage.mNumGroups;
+      const int s = stage.mStride;
+      if (stage.mRadix == 4)
+      {
+         const float* w1r = &stage.mTwiddles[0];
+         const float* w1i = w1r + m;
+         const float* w2r = w1i + m;
+         const float* w2i = w2r + m;
+         const float* w3r = w2i + m;
+         const float* w3i = w3r + m;
+         if (s == 1)
+         {
+            // first pass, where the groups are the long run. same butterfly, loops swapped so it vectorizes
+            for (int p=0; p<m; ++p)
+            {
+               float apcR = xr[p] + xr[p + 2*m];
+               float apcI = xi[p] + xi[p + 2*m];
+               float amcR = xr[p] - xr[p + 2*m];
+               float amcI = xi[p] - xi[p + 2*m];
+               float bpdR = xr[p + m] + xr[p + 3*m];
+               float bpdI = xi[p + m] + xi[p + 3*m];
+               float jbmdR = xi[p + m] - xi[p + 3*m];
+               float jbmdI = xr[p + 3*m] - xr[p + m];
+               
+               yr[4*p] = apcR + bpdR;
+               yi[4*p] = apcI + bpdI;
+               
+               float t1R = amcR + jbmdR;
+               float t1I = amcI + jbmdI;
+               yr[4*p+1] = t1R * w1r[p] - t1I * w1i[p];
+               yi[4*p+1] = t1R * w1i[p] + t1I * w1r[p];
+               
+               float t2R = apcR - bpdR;
+               float t2I = apcI - bpdI;
+               yr[4*p+2] = t2R * w2r[p] - t2I * w2i[p];
+               yi[4*p+2] = t2R * w2i[p] + t2I * w2r[p];
+               
+               float t3R = amcR - jbmdR;
+               float t3I = amcI - jbmdI;
+               yr[4*p+3] = t3R * w3r[p] - t3I * w3i[p];
+               yi[4*p+3] = t3R * w3i[p] + t3I * w3r[p];
+            }
+         }
+         else
+         {
+            for (int p=0; p<m; ++p)
+            {
+               const float* ar = xr + s*p;
+               const float* ai = xi + s*p;
+               const float* br = ar + s*m;
+               const float* bi = ai + s*m;
+               const float* cr = br + s*m;
+               const float* ci = bi + s*m;
+               const float* dr = cr + s*m;
+               const float* di = ci + s*m;
+               float* y0r = yr + s*4*p;
+               float* y0i = yi + s*4*p;
+               float* y1r = y0r + s;
+               float* y1i = y0i + s;
+               float* y2r = y1r + s;
+               float* y2i = y1i + s;
+               float* y3r = y2r + s;
+               float* y3i = y2i + s;
+               for (int q=0; q<s; ++q)
+               {
+                  float apcR = ar[q] + cr[q];
+                  float apcI = ai[q] + ci[q];
+                  float amcR = ar[q] - cr[q];
+                  float amcI = ai[q] - ci[q];
+                  float bpdR = br[q] + dr[q];
+                  float bpdI = bi[q] + di[q];
+                  float jbmdR = bi[q] - di[q];      // -i * (b - d)
+                  float jbmdI = dr[q] - br[q];
+                  
+                  y0r[q] = apcR + bpdR;
+                  y0i[q] = apcI + bpdI;
+                  
+                  float t1R = amcR + jbmdR;
+                  float t1I = amcI + jbmdI;
+                  y1r[q] = t1R * w1r[p] - t1I * w1i[p];
+                  y1i[q] = t1R * w1i[p] + t1I * w1r[p];
+                  
+                  float t2R = apcR - bpdR;
+                  float t2I = apcI - bpdI;
+                  y2r[q] = t2R * w2r[p] - t2I * w2i[p];
+                  y2i[q] = t2R * w2i[p] + t2I * w2r[p];
+                  
+                  float t3R = amcR - jbmdR;
+                  float t3I = amcI - jbmdI;
+                  y3r[q] = t3R * w3r[p] - t3I * w3i[p];
+                  y3i[q] = t3R * w3i[p] + t3I * w3r[p];
+               }
+            }
+         }
+      }
+      else
+      {
+         // only ever the last pass, where there's a single group and no twiddles
+         assert(m == 1);
+         for (int q=0; q<s; ++q)
+         {
+            float aR = xr[q];
+            float aI = xi[q];
+            float bR = xr[q + s];
+            float bI = xi[q + s];
+            yr[q] = aR + bR;
+            yi[q] = aI + bI;
+            yr[q + s] = aR - bR;
+            yi[q + s] = aI - bI;
+         }
+      }
+      std::swap(xr, yr);
+      std::swap(xi, yi);
+   }
+   
+   if (xr != re)
+   {
+      BufferCopy(re, xr, mComplexSize);
+      BufferCopy(im, xi, mComplexSize);
+   }
+}
+
+void FFTPlan::RealForward(const float* input, float* re, float* im, float* scratch) const
+{
+   const int M = mComplexSize;
+   
+   // pack even samples as real and odd samples as imaginary, and do half the work
+   float* zr = scratch;
+   float* zi = scratch + M;
+   for (int m=0; m<M; ++m)
+   {
+      zr[m] = input[2*m];
+      zi[m] = input[2*m+1];
+   }
+   ComplexForward(zr, zi, re, im);
+   
+   re[0] = zr[0] + zi[0];
+   im[0] = 0;
+   re[M] = zr[0] - zi[0];
+   im[M] = 0;
+   for (int k=1; k<M; ++k)
+   {
+      float evenR = .5f * (zr[k] + zr[M-k]);
+      float evenI = .5f * (zi[k] - zi[M-k]);
+      float oddR = .5f * (zi[k] + zi[M-k]);
+      float oddI = .5f * (zr[M-k] - zr[k]);
+      re[k] = evenR + oddR * mSplitRe[k] - oddI * mSplitIm[k];
+      im[k] = evenI + oddR * mSplitIm[k] + oddI * mSplitRe[k];
+   }
+}
+
+void FFTPlan::RealInverse(const float* re, const float* im, float* output, float* scratch) const
+{
+   const int M = mComplexSize;
+   
+   // rebuild the half-size spectrum of (even + i*odd), conjugated so the forward pass runs it backwards
+   float* zr = scratch;
+   float* zi = scratch + M;
+   for (int k=0; k<M; ++k)
+   {
+      float evenR = re[k] + re[M-k];
+      float evenI = im[k] - im[M-k];
+      float diffR = re[k] - re[M-k];
+      float diffI = im[k] + im[M-k];
+      float oddR = diffR * mSplitRe[k] + diffI * mSplitIm[k];   // times conj(w^k)
+      float oddI = diffI * mSplitRe[k] - diffR * mSplitIm[k];
+      zr[k] = evenR - oddI;
+      zi[k] = -(evenI + oddR);
+   }
+   ComplexForward(zr, zi, output, output + M);
+   
+   for (int m=0; m<M; ++m)
+   {
+      output[2*m] = zr[m];
+      output[2*m+1] = -zi[m];
+   }
+}
+
 // Constructor for FFT routine
 FFT::FFT(int nfft)
 {
    mNfft = nfft;
    mNumfreqs = nfft/2 + 1;
-
-   mFft_data = (float*) calloc(nfft, sizeof(float));
+   
+   mPlan = FFTPlan::Get(nfft);
+   mSpectrumRe = new float[mNumfreqs];
+   mSpectrumIm = new float[mNumfreqs];
+   mScratch = new float[nfft * 2];
 }
 
 // Destructor for FFT routine
 FFT::~FFT()
 {
-   free(mFft_data);
+   delete[] mSpectrumRe;
+   delete[] mSpectrumIm;
+   delete[] mScratch;
 }
 
 // Perform forward FFT of real data
@@ -30,22 +280,21 @@ FFT::~FFT()
 //     size nfft/2 + 1
 //   output_im - pointer to an array of the imaginary part of the output,
 //     size nfft/2 + 1
+// The output keeps the layout the mayer_realfft version had, since the spectral
+// modules are tuned around it: output_im[k] holds -Im(bin k+1).
 void FFT::Forward(float* input, float* output_re, float* output_im)
 {
    int hnfft = mNfft/2;
-
-   for (int ti=0; ti<mNfft; ti++) {
-      mFft_data[ti] = input[ti];
+   
+   mPlan->RealForward(input, mSpectrumRe, mSpectrumIm, mScratch);
+   
+   for (int ti=0; ti<=hnfft; ti++) {
+      output_re[ti] = mSpectrumRe[ti];
    }
-
-   mayer_realfft(mNfft, mFft_data);
-
-   output_im[0] = 0;
-   for (int ti=0; ti<hnfft; ti++) {
-      output_re[ti] = mFft_data[ti];
-      output_im[ti] = mFft_data[mNfft-1-ti];
+   for (int ti=0; ti<hnfft-1; ti++) {
+      output_im[ti] = -mSpectrumIm[ti+1];
    }
-   output_re[hnfft] = mFft_data[hnfft];
+   output_im[hnfft-1] = mSpectrumRe[hnfft];
    output_im[hnfft] = 0;
 }
 
@@ -56,25 +305,70 @@ void FFT::Forward(float* input, float* output_re, float* output_im)
 //   input_im - pointer to an array of the imaginary part of the output,
 //     size nfft/2 + 1
 //   output - pointer to an array of (real) input values, size nfft
+// Unnormalized, like mayer_realifft: Inverse(Forward(x)) == x * nfft
 void FFT::Inverse(float* input_re, float* input_im, float* output)
 {
-   int hnfft;
-
-   hnfft = mNfft/2;
-
-   for (int ti=0; ti<hnfft; ti++) {
-      mFft_data[ti] = input_re[ti];
-      mFft_data[mNfft-1-ti] = input_im[ti];
+   int hnfft = mNfft/2;
+   
+   mSpectrumRe[0] = input_re[0];
+   mSpectrumIm[0] = 0;
+   for (int ti=1; ti<hnfft; ti++) {
+      mSpectrumRe[ti] = input_re[ti];
+      mSpectrumIm[ti] = -input_im[ti-1];
    }
-   mFft_data[hnfft] = input_re[hnfft];
+   mSpectrumRe[hnfft] = input_re[hnfft];
+   mSpectrumIm[hnfft] = 0;
+   
+   mPlan->RealInverse(mSpectrumRe, mSpectrumIm, output, mScratch);
+}
 
-   mayer_realifft(mNfft, mFft_data);
+void FFT::Forward(int numChannels, float* const* inputs, float* const* outputs_re, float* const* outputs_im)
+{
+   for (int ch=0; ch<numChannels; ++ch)
+      Forward(inputs[ch], outputs_re[ch], outputs_im[ch]);
+}
 
-   for (int ti=0; ti<mNfft; ti++) {
-      output[ti] = mFft_data[ti];
-   }
+void FFT::Inverse(int numChannels, float* const* inputs_re, float* const* inputs_im, float* const* outputs)
+{
+   for (int ch=0; ch<numChannels; ++ch)
+      Inverse(inputs_re[ch], inputs_im[ch], outputs[ch]);
 }
 
+//static
+void FFT::RunBenchmark(vector<string>& results)
+{
+   const int kIterations = 2000;
+   for (int size = 256; size <= 8192; size *= 2)
+   {
+      vector<float> input(size);
+      vector<float> work(size);
+      vector<float> re(size/2+1);
+      vector<float> im(size/2+1);
+      for (int i=0; i<size; ++i)
+         input[i] = ofRandom(-1,1);
+      
+      FFT fft(size);
+      
+      double start = Time::getMillisecondCounterHiRes();
+      for (int i=0; i<kIterations; ++i)
+      {
+         BufferCopy(work.data(), input.data(), size);
+         mayer_realfft(size, work.data());
+         mayer_realifft(size, work.data());
+      }
+      double mayerMs = Time::getMillisecondCounterHiRes() - start;
+      
+      start = Time::getMillisecondCounterHiRes();
+      for (int i=0; i<kIterations; ++i)
+      {
+         fft.Forward(input.data(), re.data(), im.data());
+         fft.Inverse(re.data(), im.data(), work.data());
+      }
+      double planMs = Time::getMillisecondCounterHiRes() - start;
+      
+      results.push_back("fft " + ofToString(size) + ": mayer " + ofToString(mayerMs * 1000 / kIterations, 2) + "us, planned " + ofToString(planMs * 1000 / kIterations, 2) + "us (" + ofToString(mayerMs / planMs, 2) + "x)");
+   }
+}
 
 
 
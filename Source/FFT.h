@@ -12,6 +12,40 @@
 #include <iostream>
 #include "SynthGlobals.h"
 
+// Twiddle factors and window for one transform size. Built once, then shared read-only by every FFT of that size.
+class FFTPlan
+{
+public:
+   static const FFTPlan* Get(int nfft);   // builds the plan the first time a size is asked for
+   
+   int GetSize() const { return mNfft; }
+   const float* GetHannWindow() const { return mHannWindow.data(); }
+   
+   // unnormalized real transforms over the full spectrum, bins 0 to nfft/2.
+   // scratch needs 2*nfft floats, so the plan itself can be used from several threads at once.
+   void RealForward(const float* input, float* re, float* im, float* scratch) const;
+   void RealInverse(const float* re, const float* im, float* output, float* scratch) const;
+   
+private:
+   FFTPlan(int nfft);
+   void ComplexForward(float* re, float* im, float* workRe, float* workIm) const;
+   
+   struct Stage   // one radix-4 (or a final radix-2) pass of a Stockham autosort FFT
+   {
+      int mRadix;
+      int mNumGroups;      // butterflies per pass, each with its own twiddles
+      int mStride;         // distance between butterfly inputs belonging to the same group
+      vector<float> mTwiddles;   // w^1, w^2, w^3 for each group, as re and im runs of mNumGroups
+   };
+   
+   int mNfft;
+   int mComplexSize;   // real transforms run as a complex transform of half the size
+   vector<Stage> mStages;
+   vector<float> mSplitRe;   // e^(-2*pi*i*k/nfft), to split the half-size result into the real spectrum
+   vector<float> mSplitIm;
+   vector<float> mHannWindow;
+};
+
 // Variables for FFT routine
 class FFT
 {
@@ -20,10 +54,20 @@ public:
    ~FFT();
    void Forward(float* input, float* output_re, float* output_im);
    void Inverse(float* input_re, float* input_im, float* output);
+   // transforms several channels with the same plan, eg both sides of a stereo effect. the channels run one
+   // after another: every pass already walks long contiguous runs, so interleaving them wasn't any faster.
+   void Forward(int numChannels, float* const* inputs, float* const* outputs_re, float* const* outputs_im);
+   void Inverse(int numChannels, float* const* inputs_re, float* const* inputs_im, float* const* outputs);
+   const float* GetHannWindow() const { return mPlan->GetHannWindow(); }
+   
+   static void RunBenchmark(vector<string>& results);   // compares against the old mayer_realfft path
 private:
    int mNfft;        // size of FFT
    int mNumfreqs;    // number of frequencies represented (nfft/2 + 1)
-   float* mFft_data; // array for writing/reading to/from FFT function
+   const FFTPlan* mPlan;
+   float* mSpectrumRe;
+   float* mSpectrumIm;
+   float* mScratch;
 };
 
 struct FFTData
@@ -18,6 +18,7 @@
 #include "Slider.h"
 #include "GateEffect.h"
 #include "BiquadFilterEffect.h"
+#include "OscillatorBank.h"
 
 #define VIZ_WIDTH 1000
 #define RAZOR_HISTORY 100
@@ -50,7 +51,6 @@ public:
 private:
 
    void DrawViz();
-   float SinSample(float phase);
 
    //IDrawableModule
    void DrawModule() override;
@@ -59,7 +59,7 @@ private:
 
    FFTData mFFTData;
    
-   float* mWindower;
+   const float* mWindower;
 
    ::FFT mFFT;
    RollingBuffer mRollingInputBuffer;
@@ -83,6 +83,7 @@ private:
    float mPeakHistory[RAZOR_HISTORY][VIZ_WIDTH+1];
    int mHistoryPtr;
    float* mPhaseInc;
+   OscillatorBank mBank;
 };
 
 #endif /* defined(__modularSynth__FFTtoAdditive__) */
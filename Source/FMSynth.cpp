@@ -233,6 +233,9 @@ void FMSynth::FloatSliderUpdated(FloatSlider* slider, float oldVal)
 void FMSynth::LoadLayout(const ofxJSONElement& moduleInfo)
 {
    mModuleSaveData.LoadString("target", moduleInfo);
+   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kMaxPolyphony);
+   EnumMap voiceStealMap = PolyphonyMgr::GetVoiceStealMap();
+   mModuleSaveData.LoadEnum<VoiceStealPolicy>("voicesteal", moduleInfo, kVoiceSteal_Oldest, nullptr, &voiceStealMap);
 
    SetUpFromSaveData();
 }
@@ -240,6 +243,10 @@ void FMSynth::LoadLayout(const ofxJSONElement& moduleInfo)
 void FMSynth::SetUpFromSaveData()
 {
    SetTarget(TheSynth->FindModule(mModuleSaveData.GetString("target")));
+   int voiceLimit = mModuleSaveData.GetInt("voicelimit");
+   if (voiceLimit > 0)
+      mPolyMgr.SetVoiceLimit(voiceLimit);
+   mPolyMgr.SetStealPolicy(mModuleSaveData.GetEnum<VoiceStealPolicy>("voicesteal"));
 }
 
 
@@ -39,35 +39,48 @@ bool FMVoice::Process(double time, ChannelBuffer* out)
 
    if (IsDone(time))
       return false;
+   
+   int bufferSize = out->BufferSize();
+   ScratchArena::Scope scratch;
+   float* oscEnv = scratch.Alloc(bufferSize);
+   float* harmEnv = scratch.Alloc(bufferSize);
+   float* harmEnv2 = scratch.Alloc(bufferSize);
+   float* modIdxEnv = scratch.Alloc(bufferSize);
+   float* modIdxEnv2 = scratch.Alloc(bufferSize);
+   mOsc.GetADSR()->RenderBlock(time, oscEnv, bufferSize);
+   mHarm.GetADSR()->RenderBlock(time, harmEnv, bufferSize);
+   mHarm2.GetADSR()->RenderBlock(time, harmEnv2, bufferSize);
+   mModIdx.RenderBlock(time, modIdxEnv, bufferSize);
+   mModIdx2.RenderBlock(time, modIdxEnv2, bufferSize);
 
-   for (int pos=0; pos<out->BufferSize(); ++pos)
+   for (int pos=0; pos<bufferSize; ++pos)
    {
       if (mOwner)
          mOwner->ComputeSliders(pos);
       
       float oscFreq = TheScale->PitchToFreq(GetPitch(pos));
-      float harmFreq = oscFreq * mHarm.GetADSR()->Value(time) * mVoiceParams->mHarmRatio;
-      float harmFreq2 = harmFreq * mHarm2.GetADSR()->Value(time) * mVoiceParams->mHarmRatio2;
+      float harmFreq = oscFreq * harmEnv[pos] * mVoiceParams->mHarmRatio;
+      float harmFreq2 = harmFreq * harmEnv2[pos] * mVoiceParams->mHarmRatio2;
       
       float harmPhaseInc2 = GetPhaseInc(harmFreq2);
       
       mHarmPhase2 += harmPhaseInc2;
       while (mHarmPhase2 > FTWO_PI) { mHarmPhase2 -= FTWO_PI; }
       
-      float modHarmFreq = harmFreq + mHarm2.Audio(time, mHarmPhase2 + mVoiceParams->mPhaseOffset2) * harmFreq2 * mModIdx2.Value(time) * mVoiceParams->mModIdx2;
+      float modHarmFreq = harmFreq + mHarm2.mOsc.Value(mHarmPhase2 + mVoiceParams->mPhaseOffset2) * harmEnv2[pos] * harmFreq2 * modIdxEnv2[pos] * mVoiceParams->mModIdx2;
       
       float harmPhaseInc = GetPhaseInc(modHarmFreq);
       
       mHarmPhase += harmPhaseInc;
       while (mHarmPhase > FTWO_PI) { mHarmPhase -= FTWO_PI; }
 
-      float modOscFreq = oscFreq + mHarm.Audio(time, mHarmPhase + mVoiceParams->mPhaseOffset1) * harmFreq * mModIdx.Value(time) * mVoiceParams->mModIdx;
+      float modOscFreq = oscFreq + mHarm.mOsc.Value(mHarmPhase + mVoiceParams->mPhaseOffset1) * harmEnv[pos] * harmFreq * modIdxEnv[pos] * mVoiceParams->mModIdx;
       float oscPhaseInc = GetPhaseInc(modOscFreq);
 
       mOscPhase += oscPhaseInc;
       while (mOscPhase > FTWO_PI) { mOscPhase -= FTWO_PI; }
 
-      float sample = mOsc.Audio(time, mOscPhase + mVoiceParams->mPhaseOffset0) * mVoiceParams->mVol/20.0f;
+      float sample = mOsc.mOsc.Value(mOscPhase + mVoiceParams->mPhaseOffset0) * oscEnv[pos] * mVoiceParams->mVol/20.0f;
       if (out->NumActiveChannels() == 1)
       {
          out->GetChannel(0)[pos] += sample;
@@ -77,8 +90,6 @@ bool FMVoice::Process(double time, ChannelBuffer* out)
          out->GetChannel(0)[pos] += sample * GetLeftPanGain(GetPan());
          out->GetChannel(1)[pos] += sample * GetRightPanGain(GetPan());
       }
-
-      time += gInvSampleRateMs;
    }
    
    return true;
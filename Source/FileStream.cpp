@@ -9,17 +9,33 @@
 #include "FileStream.h"
 #include "ModularSynth.h"
 #include "SynthGlobals.h"
+#include "StateSnapshot.h"
 
 FileStreamOut::FileStreamOut(const char* file)
-: mStream(File(file))
+: mStream(new FileOutputStream(File(file)))
+, mSnapshot(nullptr)
+{
+   mStream->setPosition(0);
+   mStream->truncate();
+}
+
+FileStreamOut::FileStreamOut(StateSnapshot* snapshot)
+: mSnapshot(snapshot)
 {
-   mStream.setPosition(0);
-   mStream.truncate();
 }
 
 FileStreamOut::~FileStreamOut()
 {
-   mStream.flush();
+   if (mStream)
+      mStream->flush();
+}
+
+void FileStreamOut::WriteBytes(const void* buffer, size_t size)
+{
+   if (mSnapshot)
+      mSnapshot->Append(buffer, size);
+   else
+      mStream->write(buffer, size);
 }
 
 FileStreamIn::FileStreamIn(const char* file)
@@ -29,57 +45,56 @@ FileStreamIn::FileStreamIn(const char* file)
 
 FileStreamOut& FileStreamOut::operator<<(const int &var)
 {
-   mStream.write((const void*)&var, sizeof(int));
+   WriteBytes((const void*)&var, sizeof(int));
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const uint32_t &var)
 {
-   mStream.write((const void*)&var, sizeof(uint32_t));
+   WriteBytes((const void*)&var, sizeof(uint32_t));
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const bool &var)
 {
-   mStream.write((const void*)&var, sizeof(bool));
+   WriteBytes((const void*)&var, sizeof(bool));
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const float &var)
 {
-   mStream.write((const void*)&var, sizeof(float));
+   WriteBytes((const void*)&var, sizeof(float));
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const double &var)
 {
-   mStream.write((const void*)&var, sizeof(double));
+   WriteBytes((const void*)&var, sizeof(double));
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const string &var)
 {
    size_t len = var.length();
-   mStream.write((const void*)&len, sizeof(size_t));
-   for (int i=0; i<len; ++i)
-      mStream.write((const void*)&var[i], sizeof(char));
+   WriteBytes((const void*)&len, sizeof(size_t));
+   WriteBytes((const void*)var.data(), len);
    return *this;
 }
 
 FileStreamOut& FileStreamOut::operator<<(const char &var)
 {
-   mStream.write(&var, sizeof(char));
+   WriteBytes(&var, sizeof(char));
    return *this;
 }
 
 void FileStreamOut::Write(const float* buffer, int size)
 {
-   mStream.write((const void*)buffer, sizeof(float)*size);
+   WriteBytes((const void*)buffer, sizeof(float)*size);
 }
 
 void FileStreamOut::WriteGeneric(const void* buffer, int size)
 {
-   mStream.write((const void*)buffer, size);
+   WriteBytes((const void*)buffer, size);
 }
 
 FileStreamIn& FileStreamIn::operator>>(int &var)
@@ -11,11 +11,16 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "OpenFrameworksPort.h"
+#include <memory>
+
+class StateSnapshot;
 
 class FileStreamOut
 {
 public:
    FileStreamOut(const char* file);
+   //records into memory instead of a file, see ModularSynth::SaveState()
+   FileStreamOut(StateSnapshot* snapshot);
    ~FileStreamOut();
    FileStreamOut& operator<<(const int& var);
    FileStreamOut& operator<<(const uint32_t &var);
@@ -27,7 +32,10 @@ public:
    void Write(const float* buffer, int size);
    void WriteGeneric(const void* buffer, int size);
 private:
-   FileOutputStream mStream;
+   void WriteBytes(const void* buffer, size_t size);
+   
+   std::unique_ptr<FileOutputStream> mStream;
+   StateSnapshot* mSnapshot;
 };
 
 class FileStreamIn
@@ -82,12 +82,12 @@ void FormantFilterEffect::ProcessAudio(double time, ChannelBuffer* buffer)
    //TODO(Ryan)
    /*for (int i=0; i<NUM_FORMANT_BANDS; ++i)
    {
-      BufferCopy(gWorkBuffer, audio, bufferSize);
-      mBiquads[i].Filter(gWorkBuffer, bufferSize);
-      Add(mOutputBuffer, gWorkBuffer, bufferSize);
+      BufferCopy(filterBuffer, audio, bufferSize);
+      mBiquads[i].Filter(filterBuffer, bufferSize);
+      Add(mOutputBuffer, filterBuffer, bufferSize);
    }
    
-   BufferCopy(audio, gWorkBuffer, bufferSize);*/
+   BufferCopy(audio, filterBuffer, bufferSize);*/
 }
 
 void FormantFilterEffect::DrawModule()
@@ -36,10 +36,8 @@ FreqDomainBoilerplate::FreqDomainBoilerplate()
 , mPhaseOffset(0)
 , mPhaseOffsetSlider(nullptr)
 {
-   // Generate a window with a single raised cosine from N/4 to 3N/4
-   mWindower = new float[fftWindowSize];
-   for (int i=0; i<fftWindowSize; ++i)
-      mWindower[i] = -.5*cos(FTWO_PI*i/fftWindowSize)+.5;
+   // Single raised cosine from N/4 to 3N/4, shared by every FFT of this size
+   mWindower = mFFT.GetHannWindow();
 }
 
 void FreqDomainBoilerplate::CreateUIControls()
@@ -56,7 +54,6 @@ void FreqDomainBoilerplate::CreateUIControls()
 
 FreqDomainBoilerplate::~FreqDomainBoilerplate()
 {
-   delete[] mWindower;
 }
 
 void FreqDomainBoilerplate::Process(double time)
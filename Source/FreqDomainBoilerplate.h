@@ -51,7 +51,7 @@ private:
 
    FFTData mFFTData;
    
-   float* mWindower;
+   const float* mWindower;
 
    ::FFT mFFT;
    RollingBuffer mRollingInputBuffer;
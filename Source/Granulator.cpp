@@ -11,12 +11,44 @@
 #include "Profiler.h"
 #include "ChannelBuffer.h"
 
+namespace
+{
+   const int kWindowTableSize = 1024;
+   const double kSampleEpsilon = .001;   //slop for turning grain times back into sample positions
+   const float kDenseOverlap = 32;
+   
+   struct WindowTable
+   {
+      WindowTable()
+      {
+         for (int i=0; i<=kWindowTableSize; ++i)
+            mValues[i] = .5f * (1 - cosf(i * TWO_PI / kWindowTableSize));
+      }
+      
+      float Lookup(float phase) const
+      {
+         float pos = ofClamp(phase, 0, 1) * kWindowTableSize;
+         int index = MIN(int(pos), kWindowTableSize-1);
+         float a = pos - index;
+         return mValues[index] + a * (mValues[index+1] - mValues[index]);
+      }
+      
+      float mValues[kWindowTableSize+1];
+   };
+   
+   const WindowTable sWindow;
+}
+
 Granulator::Granulator()
 : mNextGrainIdx(0)
 , mLastGrainSpawnMs(0)
+, mNextSpacing(1)
+, mNumActiveGrains(0)
 , mLiveMode(false)
 , mOctaves(false)
 {
+   for (int i=0; i<MAX_GRAINS; ++i)
+      mGrainActive[i] = false;
    Reset();
 }
 
@@ -31,24 +63,65 @@ void Granulator::Reset()
    mOctaves = false;
 }
 
-void Granulator::Process(double time, ChannelBuffer* buffer, int bufferLength, double offset, float* output)
+void Granulator::ProcessBlock(double time, ChannelBuffer* buffer, int bufferLength, double offset, float offsetIncrement, float** output, int numSamples)
 {
-   if (time >= mLastGrainSpawnMs+mGrainLengthMs*1/mGrainOverlap*ofRandom(1-mSpacingRandomize/2,1+mSpacingRandomize/2))
+   bool stereo = buffer->NumActiveChannels() == 2;
+   float gain = GetOverlapGain();
+   
+   //work out this block's spawns up front. one that lands on a grain that's still playing cuts that grain off,
+   //so render what it had left up to there first
+   double spacingMs = mGrainLengthMs / mGrainOverlap;
+   int minSpawnSample = 0;
+   while (true)
    {
-      mLastGrainSpawnMs = time;
-      SpawnGrain(time, offset, buffer->NumActiveChannels() == 2);
+      double spawnTime = mLastGrainSpawnMs + spacingMs * mNextSpacing;
+      double spawnSample = MAX(minSpawnSample, ceil((spawnTime - time) / gInvSampleRateMs - kSampleEpsilon));
+      if (spawnSample >= numSamples)
+         break;
+      
+      int spawnIdx = int(spawnSample);
+      int grainIdx = mNextGrainIdx;
+      if (mGrainActive[grainIdx])
+      {
+         mGrains[grainIdx].Render(time, 0, spawnIdx, buffer, bufferLength, gain, output);
+      }
+      else
+      {
+         mGrainActive[grainIdx] = true;
+         mActiveGrains[mNumActiveGrains++] = grainIdx;
+      }
+      
+      mLastGrainSpawnMs = time + spawnIdx * gInvSampleRateMs;
+      mNextSpacing = ofRandom(1-mSpacingRandomize/2,1+mSpacingRandomize/2);
+      SpawnGrain(mLastGrainSpawnMs, offset + spawnIdx * offsetIncrement, stereo);
+      minSpawnSample = spawnIdx + 1;   //one per sample at most
    }
    
-   for (int i=0; i<MAX_GRAINS; ++i)
-      mGrains[i].Process(time, buffer, bufferLength, output);
-   
-   if (mGrainOverlap > 4)
+   for (int i=0; i<mNumActiveGrains; )
    {
-      for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
-         output[ch] *= ofMap(mGrainOverlap,MAX_GRAINS,4,.5f,1);   //lower volume on dense granulation, starting at 4 overlap
+      int grainIdx = mActiveGrains[i];
+      if (mGrains[grainIdx].Render(time, 0, numSamples, buffer, bufferLength, gain, output))
+      {
+         ++i;
+      }
+      else
+      {
+         mGrainActive[grainIdx] = false;
+         mActiveGrains[i] = mActiveGrains[--mNumActiveGrains];
+      }
    }
 }
 
+float Granulator::GetOverlapGain() const
+{
+   //lower volume on dense granulation, starting at 4 overlap
+   if (mGrainOverlap <= 4)
+      return 1;
+   if (mGrainOverlap <= kDenseOverlap)
+      return ofMap(mGrainOverlap,kDenseOverlap,4,.5f,1);
+   return .5f * sqrtf(kDenseOverlap / mGrainOverlap);   //past that, fall off the way uncorrelated grains add up
+}
+
 void Granulator::SpawnGrain(double time, double offset, bool stereo)
 {
    if (mLiveMode)
@@ -91,7 +164,11 @@ void Granulator::Draw(float x, float y, float w, float h, int bufferStart, int b
 void Granulator::ClearGrains()
 {
    for (int i=0; i<MAX_GRAINS; ++i)
+   {
       mGrains[i].Clear();
+      mGrainActive[i] = false;
+   }
+   mNumActiveGrains = 0;
 }
 
 void Grain::Spawn(double time, double pos, float speed, float lengthInMs, float vol, bool stereo)
@@ -105,25 +182,53 @@ void Grain::Spawn(double time, double pos, float speed, float lengthInMs, float
    mDrawPos = ofRandom(1);
 }
 
-void Grain::Process(double time, ChannelBuffer* buffer, int bufferLength, float* output)
+bool Grain::Render(double time, int startSample, int endSample, ChannelBuffer* buffer, int bufferLength, float gain, float** output)
 {
-   if (time >= mStartTime && time <= mEndTime && mVol != 0)
+   if (mVol == 0)
+      return false;
+   
+   //only touch the samples that land inside the grain
+   double firstSample = ceil((mStartTime - time) / gInvSampleRateMs - kSampleEpsilon);
+   double endOfGrain = floor((mEndTime - time) / gInvSampleRateMs + kSampleEpsilon) + 1;
+   int first = int(MAX(startSample, firstSample));
+   int last = int(MIN(endSample, endOfGrain));
+   bool playsOn = endOfGrain > endSample;
+   if (first >= last)
+      return playsOn;
+   
+   int count = last - first;
+   ScratchArena::Scope scratch;
+   float* grain = scratch.Alloc(count);
+   float* window = scratch.Alloc(count);
+   
+   double length = mEndTime - mStartTime;
+   float phase = (time + first * gInvSampleRateMs - mStartTime) / length;
+   float phaseIncrement = gInvSampleRateMs / length;
+   for (int i=0; i<count; ++i)
+      window[i] = sWindow.Lookup(phase + i * phaseIncrement);
+   
+   GetInterpolatedSamples(mPos, mSpeed, buffer->GetChannel(0), bufferLength, grain, count);
+   if (buffer->NumActiveChannels() == 2 && mStereoPosition != 0)
    {
-      float sample = GetInterpolatedSample(mPos, buffer, bufferLength, mStereoPosition);
-      mPos += mSpeed;
-      float window = GetWindow(time);
-      for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
-         output[ch] += sample * window * mVol * (ch == 0 ? (1-mStereoPosition) : mStereoPosition);
+      //blend toward the second channel, like GetInterpolatedSample() does
+      float* other = scratch.Alloc(count);
+      GetInterpolatedSamples(mPos, mSpeed, buffer->GetChannel(1), bufferLength, other, count);
+      Mult(grain, 1-mStereoPosition, count);
+      AddScaled(grain, other, mStereoPosition, count);
    }
+   mPos += mSpeed * (double)count;
+   
+   Mult(grain, window, count);
+   for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
+      AddScaled(output[ch] + first, grain, gain * mVol * (ch == 0 ? (1-mStereoPosition) : mStereoPosition), count);
+   
+   return playsOn;
 }
 
 double Grain::GetWindow(double time)
 {
    if (time > mStartTime && time < mEndTime)
-   {
-      double phase = (time-mStartTime)/(mEndTime-mStartTime);
-      return .5 * (1 - cos(phase * TWO_PI));
-   }
+      return sWindow.Lookup((time-mStartTime)/(mEndTime-mStartTime));
    return 0;
 }
 
@@ -138,6 +243,6 @@ void Grain::DrawGrain(int idx, float x, float y, float w, float h, int bufferSta
    ofFill();
    float alpha = GetWindow(gTime);
    ofSetColor(255,0,0,alpha*alpha*255*.5);
-   ofRect(x+a*w, y+mDrawPos*h, MAX(1,w/100), h/MAX_GRAINS);
+   ofRect(x+a*w, y+mDrawPos*h, MAX(1,w/100), MAX(1,h/100));
    ofPopStyle();
 }
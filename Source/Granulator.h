@@ -12,7 +12,7 @@
 #include <iostream>
 #include "Ramp.h"
 
-#define MAX_GRAINS 32
+#define MAX_GRAINS 256
 
 class ChannelBuffer;
 
@@ -21,7 +21,9 @@ class Grain
 public:
    Grain() : mPos(0), mSpeed(0), mStartTime(0), mEndTime(0), mVol(0), mStereoPosition(0) {}
    void Spawn(double time, double pos, float speed, float lengthInMs, float vol, bool stereo);
-   void Process(double time, ChannelBuffer* buffer, int bufferLength, float* output);
+   //adds the part of [startSample,endSample) of the block starting at time that this grain plays in.
+   //returns false once the grain is over.
+   bool Render(double time, int startSample, int endSample, ChannelBuffer* buffer, int bufferLength, float gain, float** output);
    void DrawGrain(int idx, float x, float y, float w, float h, int bufferStart, int bufferLength, bool wrapAround);
    void Clear() { mVol = 0; }
 private:
@@ -39,7 +41,9 @@ class Granulator
 {
 public:
    Granulator();
-   void Process(double time, ChannelBuffer* buffer, int bufferLength, double offset, float* output);
+   //adds numSamples of grains into output, one channel for each of buffer's. new grains start reading at offset,
+   //which moves by offsetIncrement every sample. the parameters are read once per call.
+   void ProcessBlock(double time, ChannelBuffer* buffer, int bufferLength, double offset, float offsetIncrement, float** output, int numSamples);
    void Draw(float x, float y, float w, float h, int bufferStart, int bufferLength, bool wrapAround = true);
    void Reset();
    void ClearGrains();
@@ -55,10 +59,15 @@ public:
    
 private:
    void SpawnGrain(double time, double offset, bool stereo);
+   float GetOverlapGain() const;
    
    double mLastGrainSpawnMs;
+   float mNextSpacing;
    int mNextGrainIdx;
    Grain mGrains[MAX_GRAINS];
+   bool mGrainActive[MAX_GRAINS];
+   int mActiveGrains[MAX_GRAINS];   //only these get rendered
+   int mNumActiveGrains;
    bool mLiveMode;
 };
 
@@ -70,7 +70,7 @@ void GridModule::OnGridButton(int x, int y, float velocity, IGridController* gri
    if (y < GetRows() && x < GetCols())
    {
       for (auto listener : mScriptListeners)
-         listener->RunCode(gTime, "on_grid_button("+ofToString(x)+", "+ofToString(GetRows() - 1 - y)+", "+ofToString(velocity)+")");
+         listener->OnGridButton(x, GetRows() - 1 - y, velocity);
    }
    
    UpdateLights();
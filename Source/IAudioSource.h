@@ -25,6 +25,9 @@ public:
    virtual void Process(double time) = 0;
    IAudioReceiver* GetTarget(int index=0);
    virtual int GetNumTargets() { return 1; }
+   //true if Process() reaches into state outside this module and its audio targets, like the transport.
+   //sources that play notes, fire pulses or drive modulators are already treated this way.
+   virtual bool ProcessHasSideEffects() { return false; }
    RollingBuffer* GetVizBuffer() { return &mVizBuffer; }
 protected:
    void SyncOutputBuffer(int numChannels);
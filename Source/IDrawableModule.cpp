@@ -43,6 +43,7 @@ IDrawableModule::IDrawableModule()
 , mEnabled(true)
 , mEnabledCheckbox(nullptr)
 , mUIControlsCreated(false)
+, mUIControlIndexDirty(true)
 , mInitialized(false)
 , mMainPatchCableSource(nullptr)
 , mOwningContainer(nullptr)
@@ -315,8 +316,14 @@ void IDrawableModule::DrawFrame(float w, float h, bool drawModule, float& titleB
       DrawModuleUnclipped();
    }
    
-   ofSetColor(color * (1-GetBeaconAmount()) + ofColor::yellow * GetBeaconAmount(), gModuleDrawAlpha);
-   DrawTextBold(GetTitleLabel(),5+enableToggleOffset,10-titleBarHeight,16);
+   string titleLabel = GetTitleLabel();
+   float beaconAmount = GetBeaconAmount();
+   if (beaconAmount > 0 ||
+       !TheSynth->GetModuleLayers().DrawTitle(this, titleLabel, color, int(5+enableToggleOffset), int(10-titleBarHeight), 16, gModuleDrawAlpha / 255.0f))
+   {
+      ofSetColor(color * (1-beaconAmount) + ofColor::yellow * beaconAmount, gModuleDrawAlpha);
+      DrawTextBold(titleLabel,5+enableToggleOffset,10-titleBarHeight,16);
+   }
    
    if (Enabled() && mShouldDrawOutline)
    {
@@ -642,10 +649,27 @@ IUIControl* IDrawableModule::FindUIControl(const char* name, bool fail /*=true*/
 {
    if (name != 0)
    {
+      const juce::ScopedLock lock(mUIControlIndexLock);
+      
+      if (mUIControlIndexDirty)
+      {
+         mUIControlIndex.clear();
+         for (auto* control : mUIControls)
+            mUIControlIndex.emplace(control->Name(), control);   //buttons can share a name, first one wins
+         mUIControlIndexDirty = false;
+      }
+      
+      auto iter = mUIControlIndex.find(name);
+      if (iter != mUIControlIndex.end() && strcmp(iter->second->Name(),name) == 0)
+         return iter->second;
+      
       for (int i=0; i<mUIControls.size(); ++i)
       {
          if (strcmp(mUIControls[i]->Name(),name) == 0)
+         {
+            mUIControlIndexDirty = true;   //renamed since the index was built
             return mUIControls[i];
+         }
       }
    }
    if (fail)
@@ -782,11 +806,16 @@ void IDrawableModule::AddUIControl(IUIControl* control)
    }
    
    mUIControls.push_back(control);
+   {
+      const juce::ScopedLock lock(mUIControlIndexLock);
+      mUIControlIndexDirty = true;
+   }
    FloatSlider* slider = dynamic_cast<FloatSlider*>(control);
    if (slider)
    {
       mSliderMutex.lock();
       mFloatSliders.push_back(slider);
+      mBlockModulatedSliders.reserve(mFloatSliders.size());
       mSliderMutex.unlock();
    }
 }
@@ -794,11 +823,16 @@ void IDrawableModule::AddUIControl(IUIControl* control)
 void IDrawableModule::RemoveUIControl(IUIControl* control)
 {
    RemoveFromVector(control, mUIControls, K(fail));
+   {
+      const juce::ScopedLock lock(mUIControlIndexLock);
+      mUIControlIndexDirty = true;
+   }
    FloatSlider* slider = dynamic_cast<FloatSlider*>(control);
    if (slider)
    {
       mSliderMutex.lock();
       RemoveFromVector(slider, mFloatSliders, K(fail));
+      RemoveFromVector(slider, mBlockModulatedSliders);
       mSliderMutex.unlock();
    }
 }
@@ -811,6 +845,23 @@ void IDrawableModule::ComputeSliders(int samplesIn)
    //mSliderMutex.unlock();
 }
 
+void IDrawableModule::ComputeSliderBlocks(int bufferSize)
+{
+   mBlockModulatedSliders.clear();
+   for (auto* slider : mFloatSliders)
+   {
+      slider->ComputeBlock(bufferSize);
+      if (slider->IsBlockModulated())
+         mBlockModulatedSliders.push_back(slider);
+   }
+}
+
+void IDrawableModule::ApplySliderBlockValues(int samplesIn)
+{
+   for (auto* slider : mBlockModulatedSliders)
+      slider->ApplyBlockValue(samplesIn);
+}
+
 PatchCableOld IDrawableModule::GetPatchCableOld(IClickable* target)
 {
    float wThis,hThis,xThis,yThis,wThat,hThat,xThat,yThat;
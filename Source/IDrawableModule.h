@@ -15,6 +15,7 @@
 #include "Checkbox.h"
 #include "FileStream.h"
 #include "IPatchable.h"
+#include <unordered_map>
 
 class IUIControl;
 class FloatSlider;
@@ -100,6 +101,10 @@ public:
    ModuleType GetModuleType() const { return mModuleType; }
    virtual bool IsSingleton() const { return false; }
    void ComputeSliders(int samplesIn);
+   //block-rate alternative to calling ComputeSliders() every sample: fill the modulated sliders' buffers once
+   //per block, then ApplySliderBlockValues() per sample only touches those. unmodulated sliders cost nothing.
+   void ComputeSliderBlocks(int bufferSize);
+   void ApplySliderBlockValues(int samplesIn);
    void SetOwningContainer(ModuleContainer* container) { mOwningContainer = container; }
    ModuleContainer* GetOwningContainer() const { return mOwningContainer; }
    virtual ModuleContainer* GetContainer() { return nullptr; }
@@ -108,6 +113,8 @@ public:
    void MarkAsDeleted() { mDeleted = true; }
    bool IsDeleted() const { return mDeleted; }
    virtual bool ShouldClipContents() { return true; }
+   //modules that draw outside their bounds (connection lines and the like) have to be drawn even when they're offscreen
+   virtual bool ShouldCullWhenOffscreen() { return ShouldClipContents(); }
    bool CanReceiveAudio() { return mCanReceiveAudio; }
    bool CanReceiveNotes() { return mCanReceiveNotes; }
    bool CanReceivePulses() { return mCanReceivePulses; }
@@ -163,8 +170,14 @@ private:
    PatchCableOld GetPatchCableOld(IClickable* target);
 
    vector<IUIControl*> mUIControls;
+   //name -> mUIControls for FindUIControl(), rebuilt lazily. like ModuleContainer's module index,
+   //a hit is only trusted if the control still has that name.
+   mutable std::unordered_map<string, IUIControl*> mUIControlIndex;
+   mutable bool mUIControlIndexDirty;
+   mutable juce::CriticalSection mUIControlIndexLock;
    vector<IDrawableModule*> mChildren;
    vector<FloatSlider*> mFloatSliders;
+   vector<FloatSlider*> mBlockModulatedSliders;   //capacity kept at mFloatSliders.size(), so filling it never allocates
    static const int mTitleBarHeight = 12;
    string mTypeName;
    static const int sResizeCornerSize = 8;
@@ -13,15 +13,59 @@
 #include "PatchCable.h"
 #include "Push2Control.h"
 #include "TextEntry.h"
+#include <unordered_map>
+
+namespace
+{
+   struct HandleRegistry
+   {
+      std::unordered_map<int, IUIControl*> mControls;
+      int mNextHandle = IUIControl::kInvalidHandle + 1;
+      juce::CriticalSection mLock;
+   };
+   
+   HandleRegistry& GetHandleRegistry()
+   {
+      static HandleRegistry sRegistry;   //function static, in case a control gets built during static init
+      return sRegistry;
+   }
+}
+
+IUIControl::IUIControl()
+: mRemoteControlCount(0)
+, mNoHover(false)
+, mShouldSaveState(true)
+{
+   HandleRegistry& registry = GetHandleRegistry();
+   const juce::ScopedLock lock(registry.mLock);
+   mHandle = registry.mNextHandle++;
+   registry.mControls[mHandle] = this;
+}
 
 IUIControl::~IUIControl()
 {
+   {
+      HandleRegistry& registry = GetHandleRegistry();
+      const juce::ScopedLock lock(registry.mLock);
+      registry.mControls.erase(mHandle);
+   }
    if (gHoveredUIControl == this)
       gHoveredUIControl = nullptr;
    if (gBindToUIControl == this)
       gBindToUIControl = nullptr;
 }
 
+//static
+IUIControl* IUIControl::FromHandle(int handle)
+{
+   HandleRegistry& registry = GetHandleRegistry();
+   const juce::ScopedLock lock(registry.mLock);
+   auto iter = registry.mControls.find(handle);
+   if (iter != registry.mControls.end())
+      return iter->second;
+   return nullptr;
+}
+
 bool IUIControl::IsPreset()
 {
    return VectorContains(this, Presets::sPresetHighlightControls);
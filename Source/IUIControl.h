@@ -28,7 +28,7 @@ enum AnchorDirection
 class IUIControl : public IClickable
 {
 public:
-   IUIControl() : mRemoteControlCount(0), mNoHover(false), mShouldSaveState(true) {}
+   IUIControl();
    void Delete() { delete this; }
    void AddRemoteController() { ++mRemoteControlCount; }
    void RemoveRemoteController() { --mRemoteControlCount; }
@@ -68,6 +68,12 @@ public:
    virtual bool IsMouseDown() const { return false; }
    virtual bool IsTextEntry() const { return false; }
    
+   //stable id that's never reused, for callers that resolve a path once and hang onto the result.
+   //FromHandle() gives back nullptr once the control is gone, instead of a dangling pointer.
+   int GetHandle() const { return mHandle; }
+   static IUIControl* FromHandle(int handle);
+   static const int kInvalidHandle = 0;
+   
    virtual void SaveState(FileStreamOut& out) = 0;
    virtual void LoadState(FileStreamIn& in, bool shouldSetValue = true) = 0;
 protected:
@@ -76,6 +82,9 @@ protected:
    int mRemoteControlCount;
    bool mNoHover;
    bool mShouldSaveState;
+   
+private:
+   int mHandle;
 };
 
 #endif
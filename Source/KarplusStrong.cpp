@@ -156,7 +156,9 @@ void KarplusStrong::FloatSliderUpdated(FloatSlider* slider, float oldVal)
 void KarplusStrong::LoadLayout(const ofxJSONElement& moduleInfo)
 {
    mModuleSaveData.LoadString("target", moduleInfo);
-   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kNumVoices);
+   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kMaxPolyphony);
+   EnumMap voiceStealMap = PolyphonyMgr::GetVoiceStealMap();
+   mModuleSaveData.LoadEnum<VoiceStealPolicy>("voicesteal", moduleInfo, kVoiceSteal_Oldest, nullptr, &voiceStealMap);
 
    SetUpFromSaveData();
 }
@@ -167,6 +169,7 @@ void KarplusStrong::SetUpFromSaveData()
    int voiceLimit = mModuleSaveData.GetInt("voicelimit");
    if (voiceLimit > 0)
       mPolyMgr.SetVoiceLimit(voiceLimit);
+   mPolyMgr.SetStealPolicy(mModuleSaveData.GetEnum<VoiceStealPolicy>("voicesteal"));
 }
 
 
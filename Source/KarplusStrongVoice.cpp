@@ -57,6 +57,9 @@ bool KarplusStrongVoice::Process(double time, ChannelBuffer* out)
    
    int renderSize = bufferSize/renderRatio;
    
+   ScratchArena::Scope scratch;
+   float* renderBuffer = scratch.Alloc(renderSize);
+   
    for (int pos=0; pos<renderSize; ++pos)
    {
       if (mOwner)
@@ -124,7 +127,7 @@ bool KarplusStrongVoice::Process(double time, ChannelBuffer* out)
       float output = sample * mVoiceParams->mVol/10.0f * (1 + GetPressure(pos*renderRatio));
       AssertIfDenormal(output);
       
-      gWorkBuffer[pos] = output;
+      renderBuffer[pos] = output;
       
    }
    
@@ -137,7 +140,7 @@ bool KarplusStrongVoice::Process(double time, ChannelBuffer* out)
       }
       else if (i%2 == 1)*/
       {
-         sample = gWorkBuffer[int(i/renderRatio)];
+         sample = renderBuffer[int(i/renderRatio)];
       }
       /*else
       {
@@ -155,7 +158,7 @@ bool KarplusStrongVoice::Process(double time, ChannelBuffer* out)
       }
    }
       
-   mLastBufferSample = gWorkBuffer[renderSize-1];
+   mLastBufferSample = renderBuffer[renderSize-1];
    
    return true;
 }
@@ -271,6 +271,7 @@ void KompleteKontrol::OnKontrolButton(int control, bool on)
          c.mChannel = 1;
          c.mControl = control;
          c.mValue = on ? 127 : 0;
+         c.mTime = -1;
          mController->OnMidiControl(c);
       }
    }
@@ -285,6 +286,7 @@ void KompleteKontrol::OnKontrolEncoder(int control, float change)
       c.mChannel = 1;
       c.mControl = control+100;
       c.mValue = change > 0 ? 127 : 0;
+      c.mTime = -1;
       mController->OnMidiControl(c);
    }
 }
@@ -37,6 +37,7 @@ private:
    //IDrawableModule
    void DrawModule() override;
    void DrawModuleUnclipped() override;
+   bool ShouldCullWhenOffscreen() override { return false; }   //draws connections to other modules
    void GetModuleDimensions(float& width, float& height) override { width = 80; height = 0; }
    bool Enabled() const override { return true; }
 
@@ -45,6 +45,30 @@ public:
       mHYm4 = mHYm3;	mHYm3 = mHYm2;	mHYm2 = mHYm1; mHYm1 = highOut;// high
    }
    
+   //a block at a time, with the history held in locals. in can be the same buffer as lowOut or highOut.
+   void Process(const float* in, float* lowOut, float* highOut, int bufferSize)
+   {
+      double xm1 = mXm1, xm2 = mXm2, xm3 = mXm3, xm4 = mXm4;
+      double lym1 = mLYm1, lym2 = mLYm2, lym3 = mLYm3, lym4 = mLYm4;
+      double hym1 = mHYm1, hym2 = mHYm2, hym3 = mHYm3, hym4 = mHYm4;
+      for (int i=0; i<bufferSize; ++i)
+      {
+         double smp = in[i];
+         double low = mL_A0 * smp + mL_A1 * xm1 + mL_A2 * xm2 + mL_A3 * xm3 + mL_A4 * xm4
+         - mB1 * lym1 - mB2 * lym2 - mB3 * lym3 - mB4 * lym4;
+         double high = mH_A0 * smp + mH_A1 * xm1 + mH_A2 * xm2 + mH_A3 * xm3 + mH_A4 * xm4
+         - mB1 * hym1 - mB2 * hym2 - mB3 * hym3 - mB4 * hym4;
+         xm4 = xm3;	xm3 = xm2;	xm2 = xm1;	xm1 = smp;
+         lym4 = lym3;	lym3 = lym2;	lym2 = lym1;	lym1 = low;
+         hym4 = hym3;	hym3 = hym2;	hym2 = hym1;	hym1 = high;
+         lowOut[i] = low;
+         highOut[i] = high;
+      }
+      mXm1 = xm1;	mXm2 = xm2;	mXm3 = xm3;	mXm4 = xm4;
+      mLYm1 = lym1;	mLYm2 = lym2;	mLYm3 = lym3;	mLYm4 = lym4;
+      mHYm1 = hym1;	mHYm2 = hym2;	mHYm3 = hym3;	mHYm4 = hym4;
+   }
+   
 private:
    void CalculateCoefficients()
    {
@@ -79,45 +79,59 @@ void LiveGranulator::ProcessAudio(double time, ChannelBuffer* buffer)
 {
    PROFILER(LiveGranulator);
    
-   float bufferSize = buffer->BufferSize();
+   int bufferSize = buffer->BufferSize();
    mBuffer.SetNumChannels(buffer->NumActiveChannels());
 
-   for (int i=0; i<bufferSize; ++i)
+   ComputeSliders(0);
+   mGranulator.SetLiveMode(!mFreeze);
+   
+   //grains play from just behind the write position, which moves along with the input unless we're frozen
+   double offset = mBuffer.GetRawBufferOffset(0) - mFreezeExtraSamples + mPos;
+   float offsetIncrement = 1;
+   if (!mFreeze)
    {
-      ComputeSliders(i);
-      
-      mGranulator.SetLiveMode(!mFreeze);
-      if (!mFreeze)
+      for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
+         mBuffer.WriteChunk(buffer->GetChannel(ch), bufferSize, ch);
+   }
+   else
+   {
+      int extraSamples = MIN(bufferSize, FREEZE_EXTRA_SAMPLES_COUNT - mFreezeExtraSamples);
+      if (extraSamples > 0)
       {
+         mFreezeExtraSamples += extraSamples;
          for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
-            mBuffer.Write(buffer->GetChannel(ch)[i], ch);
+            mBuffer.WriteChunk(buffer->GetChannel(ch), extraSamples, ch);
       }
-      else if (mFreezeExtraSamples < FREEZE_EXTRA_SAMPLES_COUNT)
+      offset -= 1;
+      offsetIncrement = 0;
+   }
+   
+   if (mEnabled)
+   {
+      ScratchArena::Scope scratch;
+      float* grains[ChannelBuffer::kMaxNumChannels];
+      for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
       {
-         ++mFreezeExtraSamples;
-         for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
-            mBuffer.Write(buffer->GetChannel(ch)[i], ch);
+         grains[ch] = scratch.Alloc(bufferSize);
+         Clear(grains[ch], bufferSize);
       }
+      mGranulator.ProcessBlock(time, mBuffer.GetRawBuffer(), mBufferLength, offset, offsetIncrement, grains, bufferSize);
       
-      if (mEnabled)
+      for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
       {
-         float sample[ChannelBuffer::kMaxNumChannels];
-         Clear(sample, ChannelBuffer::kMaxNumChannels);
-         mGranulator.Process(time, mBuffer.GetRawBuffer(), mBufferLength, mBuffer.GetRawBufferOffset(0)-mFreezeExtraSamples-1+mPos, sample);
-         for (int ch=0; ch<buffer->NumActiveChannels(); ++ch)
+         float* out = buffer->GetChannel(ch);
+         for (int i=0; i<bufferSize; ++i)
          {
-            sample[ch] -= mDCEstimate[ch];
-         
+            float sample = grains[ch][i] - mDCEstimate[ch];
+            
             if (mAdd)
-               buffer->GetChannel(ch)[i] += sample[ch];
+               out[i] += sample;
             else
-               buffer->GetChannel(ch)[i] = sample[ch];
+               out[i] = sample;
             
-            mDCEstimate[ch] = .999f*mDCEstimate[ch] + .001f*buffer->GetChannel(ch)[i]; //rolling average
+            mDCEstimate[ch] = .999f*mDCEstimate[ch] + .001f*out[i]; //rolling average
          }
       }
-      
-      time += gInvSampleRateMs;
    }
 }
 
@@ -85,5 +85,66 @@ private:
     Atomic<Node*> divider, last;
 };
 
+/**
+ * The ring buffer version: fixed capacity, but neither side ever blocks or touches the
+ * allocator, so it's safe to use from the audio thread. Single producer & consumer only.
+ */
+template<typename T>
+class LockFreeRingQueue
+{
+public:
+    explicit LockFreeRingQueue (int capacity)
+        : size (capacity + 1) // one slot is always left empty, to tell full from empty
+    {
+        items = new T[size];
+        readIndex.set (0);
+        writeIndex.set (0);
+    }
+    
+    ~LockFreeRingQueue()
+    {
+        delete[] items;
+    }
+    
+    /**
+     * Add an item to the queue. Returns false, and drops the item, if the queue is full.
+     */
+    bool produce (const T& t)
+    {
+        int write = writeIndex.get();
+        int next = (write + 1) % size;
+        
+        if (next == readIndex.get() )
+            return false;
+        
+        items[write] = t;
+        writeIndex.set (next);             // publish it after it's written
+        return true;
+    }
+    
+    /**
+     * Consume an item in the queue. Returns false if no items left to consume.
+     */
+    bool consume (T& result)
+    {
+        int read = readIndex.get();
+        
+        if (read == writeIndex.get() )
+            return false;
+        
+        result = items[read];
+        readIndex.set ((read + 1) % size); // hand the slot back to the producer
+        return true;
+    }
+    
+private:
+    LockFreeRingQueue (const LockFreeRingQueue&) = delete;
+    LockFreeRingQueue& operator= (const LockFreeRingQueue&) = delete;
+    
+    const int size;
+    T* items;
+    Atomic<int> readIndex, writeIndex;
+};
+
 
 #endif  // LOCKFREEQUEUE_H_INCLUDED
@@ -18,12 +18,19 @@
 #include "Rewriter.h"
 #include "FillSaveDropdown.h"
 
+#include <algorithm>
+
 float Looper::mBeatwheelPosRight = 0;
 float Looper::mBeatwheelDepthRight = 0;
 float Looper::mBeatwheelPosLeft = 0;
 float Looper::mBeatwheelDepthLeft = 0;
 bool Looper::mBeatwheelSingleMeasure = 0;
 
+namespace
+{
+   const int kLoopPageSize = 1 << 15;   //loop storage grows in steps of this many samples
+}
+
 Looper::Looper()
 : IAudioProcessor(gBufferSize)
 , mLoopLength(4 * 60.0f / gDefaultTempo * gSampleRate)
@@ -109,17 +116,20 @@ Looper::Looper()
 , mWantHalfShift(false)
 , mWorkBuffer(gBufferSize)
 , mQueuedNewBuffer(nullptr)
+, mBlocksStarted(0)
+, mWantStorage(false)
+, mWantLoopLength(0)
 {
-   //TODO(Ryan) buffer sizes
-   mBuffer = new ChannelBuffer(MAX_BUFFER_SIZE);
-   mUndoBuffer = new ChannelBuffer(MAX_BUFFER_SIZE);
+   //sized to the loop rather than to MAX_BUFFER_SIZE, and channels only get allocated once something is written
+   mBuffer = new ChannelBuffer(GetCapacityForLength(mLoopLength));
+   mUndoBuffer = new ChannelBuffer(GetCapacityForLength(mLoopLength));
    Clear();
    
    mMuteRamp.SetValue(1);
    
    for (int i=0; i<ChannelBuffer::kMaxNumChannels; ++i)
    {
-      mPitchShifter[i] = new PitchShifter(1024);
+      mPitchShifter[i] = nullptr;
       mLastInputSample[i] = 0;
    }
 }
@@ -222,6 +232,8 @@ Looper::~Looper()
 {
    delete mBuffer;
    delete mUndoBuffer;
+   for (auto& retired : mRetiredBuffers)
+      delete retired.mBuffer;
    for (int i=0; i<ChannelBuffer::kMaxNumChannels; ++i)
       delete mPitchShifter[i];
 }
@@ -274,11 +286,118 @@ void Looper::Poll()
    mMergeButton->SetShowing(mRecorder != nullptr);
    mWriteInputCheckbox->SetShowing(mRecorder == nullptr);
    mQueueCaptureButton->SetShowing(mRecorder == nullptr);
+   
+   if (mPitchShift != 1 && mPitchShifter[0] == nullptr)
+   {
+      //Process() checks the first one, so publish it last
+      for (int i=ChannelBuffer::kMaxNumChannels-1; i>=0; --i)
+         mPitchShifter[i] = new PitchShifter(1024);
+   }
+   
+   //grow ahead of the recorder, so a commit at its current length never has to wait on us
+   if (mRecorder)
+   {
+      int sampsPerBar = abs(int(TheTransport->MsPerBar() / 1000 * gSampleRate));
+      EnsureCapacity(MIN(sampsPerBar * mRecorder->NumBars(), MAX_BUFFER_SIZE-1));
+   }
+   int wantLength = mWantLoopLength;
+   if (wantLength > 0)
+   {
+      EnsureCapacity(wantLength);
+      if (mWantLoopLength.compare_exchange_strong(wantLength, 0))
+         SetLoopLength(wantLength);
+   }
+   
+   if (mWantStorage.exchange(false))
+      AllocateStorage();
+   
+   //a block that started after a buffer was retired can't still be holding it
+   int blocksStarted = mBlocksStarted;
+   for (auto iter = mRetiredBuffers.begin(); iter != mRetiredBuffers.end(); )
+   {
+      if (blocksStarted - iter->mRetiredAtBlock > 0)
+      {
+         delete iter->mBuffer;
+         iter = mRetiredBuffers.erase(iter);
+      }
+      else
+      {
+         ++iter;
+      }
+   }
+}
+
+int Looper::GetCapacityForLength(int length)
+{
+   return MAX(1, (length + kLoopPageSize - 1) / kLoopPageSize) * kLoopPageSize;
+}
+
+void Looper::EnsureCapacity(int length)
+{
+   assert(juce::MessageManager::existsAndIsCurrentThread());
+   
+   //grow into copies instead of in place, whatever is playing the old buffers keeps going until it picks up the new ones
+   ChannelBuffer* buffer = mBuffer;
+   if (buffer->BufferSize() < length)
+   {
+      buffer = new ChannelBuffer(GetCapacityForLength(length));
+      buffer->CopyFrom(mBuffer, mBuffer->BufferSize());
+   }
+   ChannelBuffer* undoBuffer = mUndoBuffer;
+   if (undoBuffer->BufferSize() < length)
+   {
+      undoBuffer = new ChannelBuffer(GetCapacityForLength(length));
+      undoBuffer->CopyFrom(mUndoBuffer, mUndoBuffer->BufferSize());
+   }
+   
+   if (buffer == mBuffer && undoBuffer == mUndoBuffer)
+      return;
+   
+   mBufferMutex.lock();
+   if (buffer != mBuffer)
+   {
+      RetireBuffer(mBuffer);
+      mBuffer = buffer;
+   }
+   if (undoBuffer != mUndoBuffer)
+   {
+      RetireBuffer(mUndoBuffer);
+      mUndoBuffer = undoBuffer;
+   }
+   mBufferMutex.unlock();
+}
+
+void Looper::RetireBuffer(ChannelBuffer* buffer)
+{
+   RetiredBuffer retired;
+   retired.mBuffer = buffer;
+   retired.mRetiredAtBlock = mBlocksStarted;
+   mRetiredBuffers.push_back(retired);
+}
+
+void Looper::AllocateStorage()
+{
+   assert(juce::MessageManager::existsAndIsCurrentThread());
+   mBuffer->AllocateChannels();
+   mUndoBuffer->AllocateChannels();
+}
+
+bool Looper::HasStorage() const
+{
+   return mBuffer->IsFullyAllocated() && mUndoBuffer->IsFullyAllocated() && mWantLoopLength == 0;
+}
+
+void Looper::SaveUndo()
+{
+   //copies into whatever undo storage is already there, so this is safe from the audio thread
+   mUndoBuffer->CopyFromInPlace(mBuffer, mLoopLength);
 }
 
 void Looper::Process(double time)
 {
    PROFILER(Looper);
+   
+   ++mBlocksStarted;
 
    if (!mEnabled || GetTarget() == nullptr)
       return;
@@ -337,7 +456,10 @@ void Looper::Process(double time)
    {
       mBufferMutex.lock();
       for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
-         mJumpBlender[ch].CaptureForJump(mLoopPos, mBuffer->GetChannel(ch), mLoopLength, 0);
+      {
+         if (mBuffer->IsChannelAllocated(ch))
+            mJumpBlender[ch].CaptureForJump(mLoopPos, mBuffer->GetChannel(ch), mLoopLength, 0);
+      }
       mBuffer = mQueuedNewBuffer;
       mBufferMutex.unlock();
       mQueuedNewBuffer = nullptr;
@@ -345,9 +467,36 @@ void Looper::Process(double time)
    
    if (mKeepPitch)
       mPitchShift = 1/mSpeed;
+   //until Poll() has created the shifters, play unshifted
+   bool pitchShift = mPitchShift != 1 && mPitchShifter[0] != nullptr;
    int latencyOffset = 0;
-   if (mPitchShift != 1)
+   if (pitchShift)
       latencyOffset = mPitchShifter[0]->GetLatency();
+   
+   //nothing here allocates. a loop that only has some of its channels plays silence until Poll() fills in the rest
+   bool hasAudio = true;
+   for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
+      hasAudio = hasAudio && mBuffer->IsChannelAllocated(ch);
+   if (!hasAudio && mBuffer->IsAllocated())
+      mWantStorage = true;
+   bool canWrite = HasStorage();
+   if (!canWrite && (mWriteInput || mCaptureQueued || mCommitBuffer))
+      mWantStorage = true;
+
+   ScratchArena::Scope scratch;
+   float* granularOutput[ChannelBuffer::kMaxNumChannels];
+   bool granular = mGranular && hasAudio;
+   if (granular)
+   {
+      //grains get rendered for the whole block up front, spawning from where the loop is at the start of it
+      for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
+      {
+         granularOutput[ch] = scratch.Alloc(bufferSize);
+         ::Clear(granularOutput[ch], bufferSize);
+      }
+      mLoopPosOffsetSlider->Compute(0);
+      ProcessGranular(time, mLoopPos+mLoopPosOffset+latencyOffset, granularOutput, bufferSize);
+   }
 
    for (int i=0; i<bufferSize; ++i)
    {
@@ -370,18 +519,22 @@ void Looper::Process(double time)
       float output[ChannelBuffer::kMaxNumChannels];
       ::Clear(output, ChannelBuffer::kMaxNumChannels);
       
-      if (mGranular)
-         ProcessGranular(time, offset, output);
+      if (granular)
+      {
+         for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
+            output[ch] = granularOutput[ch][i];
+      }
       
       for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
       {
          if (!mGranular)
          {
-            output[ch] = GetInterpolatedSample(offset, mBuffer->GetChannel(ch), mLoopLength);
+            if (hasAudio)
+               output[ch] = GetInterpolatedSample(offset, mBuffer->GetChannel(ch), mLoopLength);
             output[ch] = mJumpBlender[ch].Process(output[ch],i);
          }
          
-         if (mFourTet > 0 && mFourTet < 1)   //fourtet wet/dry
+         if (mFourTet > 0 && mFourTet < 1 && hasAudio)   //fourtet wet/dry
          {
             output[ch] *= mFourTet;
             float normalOffset = mLoopPos+i*mSpeed;
@@ -390,7 +543,7 @@ void Looper::Process(double time)
          
          //write one sample the past so we don't end up feeding into the next output
          float writeAmount = mWriteInputRamp.Value(time);
-         if (writeAmount > 0)
+         if (writeAmount > 0 && canWrite)
             WriteInterpolatedSample(offset-1, mBuffer->GetChannel(ch), mLoopLength, mLastInputSample[ch] * writeAmount);
          mLastInputSample[ch] = GetBuffer()->GetChannel(ch)[i];
 
@@ -404,7 +557,7 @@ void Looper::Process(double time)
       time += gInvSampleRateMs;
    }
    
-   if (mPitchShift != 1)
+   if (pitchShift)
    {
       for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
       {
@@ -421,7 +574,8 @@ void Looper::Process(double time)
    
    GetBuffer()->Reset();
    
-   if (mCommitBuffer && !mClearCommitBuffer && !mWantRewrite)
+   //the recording keeps rolling along with the loop, so a commit that waits on storage still lines up
+   if (mCommitBuffer && !mClearCommitBuffer && !mWantRewrite && canWrite)
       DoCommit();
    if (mWantShiftMeasure)
       DoShiftMeasure();
@@ -450,7 +604,7 @@ void Looper::DoCommit()
 
    {
       PROFILER(Looper_DoCommit_undo);
-      mUndoBuffer->CopyFrom(mBuffer, mLoopLength);
+      SaveUndo();
    }
 
    if (mReplaceOnCommit)
@@ -494,9 +648,11 @@ void Looper::Fill(ChannelBuffer* buffer, int length)
 
 void Looper::DoUndo()
 {
+   mBufferMutex.lock();
    ChannelBuffer* swap = mUndoBuffer;
    mUndoBuffer = mBuffer;
    mBuffer = swap;
+   mBufferMutex.unlock();
    mWantUndo = false;
 }
 
@@ -577,7 +733,10 @@ void Looper::ProcessBeatwheel(double time, int sampleIdx)
    if (lastSlice != slice) //on new slices
    {
       for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
-         mJumpBlender[ch].CaptureForJump(int(GetActualLoopPos(sampleIdx))%loopLength, mBuffer->GetChannel(ch), loopLength, sampleIdx);
+      {
+         if (mBuffer->IsChannelAllocated(ch))
+            mJumpBlender[ch].CaptureForJump(int(GetActualLoopPos(sampleIdx))%loopLength, mBuffer->GetChannel(ch), loopLength, sampleIdx);
+      }
       
       if (noneHeld)
       {
@@ -628,9 +787,9 @@ int Looper::GetMeasureSliceIndex(double time, int sampleIdx, int slicesPerBar)
    return slice;
 }
 
-void Looper::ProcessGranular(double time, float bufferOffset, float* output)
+void Looper::ProcessGranular(double time, float bufferOffset, float** output, int bufferSize)
 {
-   mGranulator.Process(time, mBuffer, mLoopLength, bufferOffset, output);
+   mGranulator.ProcessBlock(time, mBuffer, mLoopLength, bufferOffset, mSpeed, output, bufferSize);
 }
 
 void Looper::ResampleForNewSpeed()
@@ -642,6 +801,8 @@ void Looper::ResampleForNewSpeed()
       mLoopPos += mLoopLength;
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
    {
+      if (!mBuffer->IsChannelAllocated(ch))
+         continue;
       float* oldBuffer = new float[oldLoopLength];
       BufferCopy(oldBuffer, mBuffer->GetChannel(ch), oldLoopLength);
       for (int i=0; i<mLoopLength; ++i)
@@ -848,7 +1009,10 @@ void Looper::DrawBeatwheel()
       for (j=0; j<samplesPerPixel && position+j < loopLength-1; ++j)
       {
          for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
-            mag += mBuffer->GetChannel(ch)[position+j];
+         {
+            if (mBuffer->IsChannelAllocated(ch))
+               mag += mBuffer->GetChannel(ch)[position+j];
+         }
       }
       mag /= j;
       mag = sqrtf(mag);
@@ -905,6 +1069,7 @@ void Looper::DrawBeatwheel()
 
 void Looper::Clear()
 {
+   //zeroed in place, this gets called from the audio thread on a replacing commit
    mBuffer->Clear();
    mLastCommitTime = gTime;
    mVol = 1;
@@ -921,9 +1086,12 @@ void Looper::SetNumBars(int numBars)
 
 void Looper::BakeVolume()
 {
-   mUndoBuffer->CopyFrom(mBuffer);
+   SaveUndo();
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
-      Mult(mBuffer->GetChannel(ch), mVol*mVol, mLoopLength);
+   {
+      if (mBuffer->IsChannelAllocated(ch))
+         Mult(mBuffer->GetChannel(ch), mVol*mVol, mLoopLength);
+   }
    mVol = 1;
    mSmoothedVol = 1;
    mWantBakeVolume = false;
@@ -944,7 +1112,10 @@ void Looper::UpdateNumBars(int oldNumBars)
       for (int i=1; i<mNumBars/oldNumBars; ++i)
       {
          for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
-            BufferCopy(mBuffer->GetChannel(ch)+oldLoopLength*i, mBuffer->GetChannel(ch), oldLoopLength);
+         {
+            if (mBuffer->IsChannelAllocated(ch) && oldLoopLength*(i+1) <= mBuffer->BufferSize())
+               BufferCopy(mBuffer->GetChannel(ch)+oldLoopLength*i, mBuffer->GetChannel(ch), oldLoopLength);
+         }
       }
    }
 }
@@ -952,6 +1123,21 @@ void Looper::UpdateNumBars(int oldNumBars)
 void Looper::SetLoopLength(int length)
 {
    assert(length > 0);
+   if (juce::MessageManager::existsAndIsCurrentThread())
+   {
+      EnsureCapacity(length);
+      mWantLoopLength = 0;
+   }
+   else if (length > mBuffer->BufferSize() || length > mUndoBuffer->BufferSize())
+   {
+      //no growing from the audio thread. play what fits, Poll() grows us and commits wait until it has
+      mWantLoopLength = length;
+      length = MIN(mBuffer->BufferSize(), mUndoBuffer->BufferSize());
+   }
+   else
+   {
+      mWantLoopLength = 0;
+   }
    mLoopLength = length;
    mLoopPosOffsetSlider->SetExtents(0, length);
    mPosSlider->SetExtents(0, length);
@@ -1005,8 +1191,8 @@ void Looper::SwapBuffers(Looper* otherLooper)
 void Looper::CopyBuffer(Looper* sourceLooper)
 {
    assert(sourceLooper);
-   mBuffer->CopyFrom(sourceLooper->mBuffer);
    SetLoopLength(sourceLooper->mLoopLength);
+   mBuffer->CopyFrom(sourceLooper->mBuffer, mLoopLength);
    mNumBars = sourceLooper->mNumBars;
 }
 
@@ -1105,7 +1291,7 @@ void Looper::ButtonClicked(ClickButton* button)
 {
    if (button == mClearButton)
    {
-      mUndoBuffer->CopyFrom(mBuffer);
+      SaveUndo();
       Clear();
    }
    if (button == mMergeButton && mRecorder)
@@ -1257,12 +1443,12 @@ void Looper::DoShiftMeasure()
    int measureSize = int(TheTransport->MsPerBar() * gSampleRate / 1000);
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
    {
-      float* newBuffer = new float[MAX_BUFFER_SIZE];
-      BufferCopy(newBuffer, mBuffer->GetChannel(ch)+measureSize, mLoopLength-measureSize);
-      BufferCopy(newBuffer+mLoopLength-measureSize, mBuffer->GetChannel(ch), measureSize);
-      mBufferMutex.lock();
-      mBuffer->SetChannelPointer(newBuffer, ch, true);
-      mBufferMutex.unlock();
+      //rotated in place, the shifts run on the audio thread
+      if (mBuffer->IsChannelAllocated(ch))
+      {
+         float* data = mBuffer->GetChannel(ch);
+         std::rotate(data, data+measureSize, data+mLoopLength);
+      }
    }
    mWantShiftMeasure = false;
 }
@@ -1272,42 +1458,39 @@ void Looper::DoHalfShift()
    int halfMeasureSize = int(TheTransport->MsPerBar() * gSampleRate / 1000 / 2);
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
    {
-      float* newBuffer = new float[MAX_BUFFER_SIZE];
-      BufferCopy(newBuffer, mBuffer->GetChannel(ch)+halfMeasureSize, mLoopLength-halfMeasureSize);
-      BufferCopy(newBuffer+mLoopLength-halfMeasureSize, mBuffer->GetChannel(ch), halfMeasureSize);
-      mBufferMutex.lock();
-      mBuffer->SetChannelPointer(newBuffer, ch, true);
-      mBufferMutex.unlock();
+      if (mBuffer->IsChannelAllocated(ch))
+      {
+         float* data = mBuffer->GetChannel(ch);
+         std::rotate(data, data+halfMeasureSize, data+mLoopLength);
+      }
    }
    mWantHalfShift = false;
 }
 
 void Looper::DoShiftDownbeat()
 {
-   float* newBuffer = new float[MAX_BUFFER_SIZE];
    int shift = int(mLoopPos);
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
    {
-      BufferCopy(newBuffer, mBuffer->GetChannel(ch)+shift, mLoopLength-shift);
-      BufferCopy(newBuffer+mLoopLength-shift, mBuffer->GetChannel(ch), shift);
-      mBufferMutex.lock();
-      mBuffer->SetChannelPointer(newBuffer, ch, true);
-      mBufferMutex.unlock();
+      if (mBuffer->IsChannelAllocated(ch))
+      {
+         float* data = mBuffer->GetChannel(ch);
+         std::rotate(data, data+shift, data+mLoopLength);
+      }
    }
    mWantShiftDownbeat = false;
 }
 
 void Looper::DoShiftOffset()
 {
-   float* newBuffer = new float[MAX_BUFFER_SIZE];
    int shift = int(mLoopPosOffset);
    for (int ch=0; ch<mBuffer->NumActiveChannels(); ++ch)
    {
-      BufferCopy(newBuffer, mBuffer->GetChannel(ch)+shift, mLoopLength-shift);
-      BufferCopy(newBuffer+mLoopLength-shift, mBuffer->GetChannel(ch), shift);
-      mBufferMutex.lock();
-      mBuffer->SetChannelPointer(newBuffer, ch, true);
-      mBufferMutex.unlock();
+      if (mBuffer->IsChannelAllocated(ch))
+      {
+         float* data = mBuffer->GetChannel(ch);
+         std::rotate(data, data+shift, data+mLoopLength);
+      }
    }
    mWantShiftOffset = false;
    mLoopPosOffset = 0;
@@ -1387,7 +1570,9 @@ void Looper::LoadState(FileStreamIn& in)
    in >> rev;
    LoadStateValidate(rev == kSaveStateRev);
    
-   in >> mLoopLength;
+   int loopLength;
+   in >> loopLength;
+   SetLoopLength(loopLength);
    int readLength;
    mBuffer->Load(in, readLength, false);
    assert(mLoopLength == readLength);
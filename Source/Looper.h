@@ -10,6 +10,7 @@
 #define __modularSynth__Looper__
 
 #include <iostream>
+#include <atomic>
 #include "IAudioProcessor.h"
 #include "IDrawableModule.h"
 #include "RollingBuffer.h"
@@ -110,12 +111,18 @@ private:
    void DoUndo();
    void ProcessFourTet(double time, int sampleIdx);
    void ProcessScratch();
-   void ProcessGranular(double time, float bufferOffset, float* output);
+   void ProcessGranular(double time, float bufferOffset, float** output, int bufferSize);
    void ProcessBeatwheel(double time, int sampleIdx);
    int GetMeasureSliceIndex(double time, int sampleIdx, int slicesPerBar);
    void DrawBeatwheel();
    float GetActualLoopPos(int samplesIn) const;
    int GetBeatwheelDepthLevel() const;
+   void EnsureCapacity(int length);
+   void RetireBuffer(ChannelBuffer* buffer);
+   void AllocateStorage();
+   bool HasStorage() const;
+   void SaveUndo();
+   static int GetCapacityForLength(int length);
    
    //IDrawableModule
    void DrawModule() override;
@@ -186,6 +193,15 @@ private:
    bool mWantRewrite;
    int mLoopCount;
    ChannelBuffer* mQueuedNewBuffer;
+   struct RetiredBuffer
+   {
+      ChannelBuffer* mBuffer;
+      int mRetiredAtBlock;
+   };
+   vector<RetiredBuffer> mRetiredBuffers;   //swapped out while the audio thread might still be reading them, freed from Poll()
+   std::atomic<int> mBlocksStarted;   //bumped at the top of every Process(), a retired buffer is free once this moves past it
+   std::atomic<bool> mWantStorage;   //the audio thread needs writable loop storage, Poll() allocates it
+   std::atomic<int> mWantLoopLength;   //a length the audio thread couldn't fit, Poll() grows to it
    float mDecay;
    FloatSlider* mDecaySlider;
    bool mWriteInput;
@@ -227,7 +243,7 @@ private:
    Checkbox* mBeatwheelSingleMeasureCheckbox;
 
    //pitch shifter
-   PitchShifter* mPitchShifter[ChannelBuffer::kMaxNumChannels];
+   PitchShifter* mPitchShifter[ChannelBuffer::kMaxNumChannels];   //created by Poll() once they're needed
    float mPitchShift;
    FloatSlider* mPitchShiftSlider;
    bool mKeepPitch;
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    MPMCRingQueue.h
+    Created: 18 Oct 2026 9:58:03pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//bounded queue that never allocates after construction, where any number of threads can push and pop,
+//so the audio thread can sit on either end. LockFreeRingQueue in LockFreeQueue.h is cheaper when there's
+//only one producer and one consumer. each slot carries a sequence number that says whose turn it is.
+template <class T>
+class MPMCRingQueue
+{
+public:
+   //capacity gets rounded up to a power of two
+   explicit MPMCRingQueue(int capacity)
+   : mEnqueuePos(0)
+   , mDequeuePos(0)
+   {
+      size_t size = 2;
+      while (size < (size_t)capacity)
+         size <<= 1;
+      mCells.reset(new Cell[size]);
+      mMask = size - 1;
+      for (size_t i=0; i<size; ++i)
+         mCells[i].mSequence.store(i, std::memory_order_relaxed);
+   }
+   
+   //false if the queue is full
+   bool Push(const T& item)
+   {
+      size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+      while (true)
+      {
+         Cell& cell = mCells[pos & mMask];
+         size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+         intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+         if (diff == 0)
+         {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               cell.mItem = item;
+               cell.mSequence.store(pos + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (diff < 0)
+         {
+            return false;
+         }
+         else
+         {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+         }
+      }
+   }
+   
+   //false if the queue is empty
+   bool Pop(T& item)
+   {
+      size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+      while (true)
+      {
+         Cell& cell = mCells[pos & mMask];
+         size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+         intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+         if (diff == 0)
+         {
+            if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               item = cell.mItem;
+               cell.mSequence.store(pos + mMask + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (diff < 0)
+         {
+            return false;
+         }
+         else
+         {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+         }
+      }
+   }
+   
+   bool IsEmpty() const { return mEnqueuePos.load(std::memory_order_acquire) == mDequeuePos.load(std::memory_order_acquire); }
+   
+private:
+   struct Cell
+   {
+      std::atomic<size_t> mSequence;
+      T mItem;
+   };
+   
+   std::unique_ptr<Cell[]> mCells;
+   size_t mMask;
+   alignas(64) std::atomic<size_t> mEnqueuePos;
+   alignas(64) std::atomic<size_t> mDequeuePos;
+};
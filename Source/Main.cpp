@@ -9,6 +9,8 @@
  */
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "OfflineRenderer.h"
+#include "BenchmarkRunner.h"
 
 Component* createMainContentComponent();
 
@@ -28,6 +30,21 @@ public:
    {
       // This method is where you should put your application's initialisation code..
       
+      if (OfflineRenderer::IsRenderCommandLine(getCommandLineParameterArray()))
+      {
+         //headless batch render, no window or audio device
+         setApplicationReturnValue(OfflineRenderer::RunFromCommandLine(getCommandLineParameterArray()));
+         quit();
+         return;
+      }
+      
+      if (BenchmarkRunner::IsBenchmarkCommandLine(getCommandLineParameterArray()))
+      {
+         setApplicationReturnValue(BenchmarkRunner::RunFromCommandLine(getCommandLineParameterArray()));
+         quit();
+         return;
+      }
+      
       mainWindow = new MainWindow (getApplicationName());
    }
    
@@ -270,6 +270,7 @@ public:
    
    void shutdown() override
    {
+      mSynth.ReleaseModuleLayers();
       nvgDeleteGLES2(mVG);
       nvgDeleteGLES2(mFontBoundsVG);
    }
@@ -290,6 +291,8 @@ public:
       
       static float kMotionTrails = .4f;
       
+      mSynth.RenderModuleLayers(mVG);
+      
       ofVec3f bgColor(.09f,.09f,.09f);
       glViewport(0, 0, width*mPixelRatio, height*mPixelRatio);
       glClearColor(bgColor.x,bgColor.y,bgColor.z,0);
@@ -29,10 +29,14 @@ namespace
    const int kLayoutControlsY = 100;
    const int kLayoutButtonsX = 250;
    const int kLayoutButtonsY = 10;
+   const int kMaxQueuedMessages = 1024;
 }
 
 MidiController::MidiController()
 : mDevice(this)
+, mQueuedMessages(kMaxQueuedMessages)
+, mLastDrainTimeMs(0)
+, mLastDrainGTime(0)
 , mUseNegativeEdge(false)
 , mSlidersDefaultToIncremental(false)
 , mBindMode(false)
@@ -67,6 +71,7 @@ MidiController::MidiController()
 , mLayoutHeight(0)
 {
    mListeners.resize(MAX_MIDI_PAGES);
+   mFutureMessages.reserve(kMaxQueuedMessages);
    
    SetIsNoteOrigin(true);
    
@@ -269,44 +274,103 @@ void MidiController::OnTransportAdvanced(float amount)
 {
    PROFILER(MidiController);
    
-   mQueuedMessageMutex.lock();
+   double now = Time::getMillisecondCounterHiRes();
    
-   for (auto note = mQueuedNotes.begin(); note != mQueuedNotes.end(); ++note)
+   //messages held from earlier blocks go first, they were queued before anything still in the queue
+   size_t numHeld = 0;
+   for (size_t i = 0; i < mFutureMessages.size(); ++i)
    {
+      int sampleOffset = int((mFutureMessages[i].mTime - gTime) * gSampleRateMs + .5);   //round, so exact times don't slip back a sample
+      if (sampleOffset < gBufferSize)
+         DeliverMessage(mFutureMessages[i], gTime + MAX(0, sampleOffset) * gInvSampleRateMs);
+      else
+         mFutureMessages[numHeld++] = mFutureMessages[i];
+   }
+   mFutureMessages.resize(numHeld);
+   
+   QueuedMessage message;
+   while (mQueuedMessages.Pop(message))
+   {
+      int sampleOffset = int((message.mTime - gTime) * gSampleRateMs + .5);
+      if (sampleOffset >= gBufferSize && mFutureMessages.size() < mFutureMessages.capacity())
+      {
+         mFutureMessages.push_back(message);   //for a later block, hold onto it until then
+         continue;
+      }
+      sampleOffset = ofClamp(sampleOffset, 0, gBufferSize-1);
+      DeliverMessage(message, gTime + sampleOffset * gInvSampleRateMs);
+   }
+   
+   mLastDrainTimeMs = now;
+   mLastDrainGTime = gTime;
+}
+
+//audio thread. time is where in this block the message lands, and is what listeners see in its mTime
+void MidiController::DeliverMessage(QueuedMessage& message, double time)
+{
+   if (message.mType == kMidiMessage_Note)
+   {
+      MidiNote& note = message.mNote;
+      note.mTime = time;
       int voiceIdx = -1;
       
       if (mUseChannelAsVoice)
-         voiceIdx = note->mChannel - 1;
+      {
+         voiceIdx = note.mChannel - 1;
+         if (note.mVelocity > 0)
+            mModulation.GetPitchBend(voiceIdx)->SetValue(0, time);
+      }
       
-      PlayNoteOutput(gTime, note->mPitch + mNoteOffset, MIN(127,note->mVelocity*mVelocityMult), voiceIdx, ModulationParameters(mModulation.GetPitchBend(voiceIdx), mModulation.GetModWheel(voiceIdx), mModulation.GetPressure(voiceIdx), 0));
+      PlayNoteOutput(time, note.mPitch + mNoteOffset, MIN(127,note.mVelocity*mVelocityMult), voiceIdx, ModulationParameters(mModulation.GetPitchBend(voiceIdx), mModulation.GetModWheel(voiceIdx), mModulation.GetPressure(voiceIdx), 0));
       
       for (auto i = mListeners[mControllerPage].begin(); i != mListeners[mControllerPage].end(); ++i)
-         (*i)->OnMidiNote(*note);
+         (*i)->OnMidiNote(note);
    }
-   mQueuedNotes.clear();
-   
-   for (auto note = mQueuedControls.begin(); note != mQueuedControls.end(); ++note)
+   else if (message.mType == kMidiMessage_Control)
    {
+      MidiControl& control = message.mControl;
+      control.mTime = time;
+      if (control.mControl == mModwheelCC)
+      {
+         int voiceIdx = mUseChannelAsVoice ? control.mChannel - 1 : -1;
+         mModulation.GetModWheel(voiceIdx)->SetValue(control.mValue / 127.0f, time);
+      }
+      
       for (auto i = mListeners[mControllerPage].begin(); i != mListeners[mControllerPage].end(); ++i)
-         (*i)->OnMidiControl(*note);
+         (*i)->OnMidiControl(control);
    }
-   mQueuedControls.clear();
-   
-   for (auto note = mQueuedProgramChanges.begin(); note != mQueuedProgramChanges.end(); ++note)
+   else if (message.mType == kMidiMessage_Program)
    {
+      message.mProgramChange.mTime = time;
       for (auto i = mListeners[mControllerPage].begin(); i != mListeners[mControllerPage].end(); ++i)
-         (*i)->OnMidiProgramChange(*note);
+         (*i)->OnMidiProgramChange(message.mProgramChange);
    }
-   mQueuedProgramChanges.clear();
-   
-   for (auto note = mQueuedPitchBends.begin(); note != mQueuedPitchBends.end(); ++note)
+   else if (message.mType == kMidiMessage_PitchBend)
    {
+      MidiPitchBend& pitchBend = message.mPitchBend;
+      pitchBend.mTime = time;
+      int voiceIdx = mUseChannelAsVoice ? pitchBend.mChannel - 1 : -1;
+      float amount = (pitchBend.mValue - 8192.0f) / (8192.0f/mPitchBendRange);
+      mModulation.GetPitchBend(voiceIdx)->SetValue(amount, time);
+      
       for (auto i = mListeners[mControllerPage].begin(); i != mListeners[mControllerPage].end(); ++i)
-         (*i)->OnMidiPitchBend(*note);
+         (*i)->OnMidiPitchBend(pitchBend);
    }
-   mQueuedPitchBends.clear();
-   
-   mQueuedMessageMutex.unlock();
+}
+
+void MidiController::QueueMessage(QueuedMessage& message, double time)
+{
+   //called from the device's thread, so no locking and no allocating. if the audio thread has stalled long enough
+   //to fill the queue, dropping input is the least bad option.
+   if (time < 0)
+   {
+      //live input: whatever came in since the last block gets spread over the next one, at the same offsets it
+      //arrived at. that's a block of latency, but no jitter.
+      double sinceDrainMs = Time::getMillisecondCounterHiRes() - mLastDrainTimeMs.load();
+      time = mLastDrainGTime.load() + gBufferSize * gInvSampleRateMs + sinceDrainMs;
+   }
+   message.mTime = time;
+   mQueuedMessages.Push(message);
 }
 
 void MidiController::OnMidiNote(MidiNote& note)
@@ -314,17 +378,12 @@ void MidiController::OnMidiNote(MidiNote& note)
    if (!mEnabled || (mChannelFilter != ChannelFilter::kAny && note.mChannel != (int)mChannelFilter))
       return;
 
-   if (mUseChannelAsVoice && note.mVelocity > 0)
-   {
-      int voiceIdx = note.mChannel - 1;
-      mModulation.GetPitchBend(voiceIdx)->SetValue(0);
-   }
-   
    MidiReceived(kMidiMessage_Note, note.mPitch, note.mVelocity/127.0f, note.mChannel);
    
-   mQueuedMessageMutex.lock();
-   mQueuedNotes.push_back(note);
-   mQueuedMessageMutex.unlock();
+   QueuedMessage message;
+   message.mType = kMidiMessage_Note;
+   message.mNote = note;
+   QueueMessage(message, note.mTime);
    
    if (mPrintInput)
       ofLog() << Name() << " note: " << note.mPitch << ", " << note.mVelocity;
@@ -335,24 +394,13 @@ void MidiController::OnMidiControl(MidiControl& control)
    if (!mEnabled || (mChannelFilter != ChannelFilter::kAny && control.mChannel != (int)mChannelFilter))
       return;
    
-   int voiceIdx = -1;
-   
-   if (mUseChannelAsVoice)
-      voiceIdx = control.mChannel - 1;
-   
-   if (control.mControl == mModwheelCC)
-   {
-      //if (mModwheelCC == 74) //MPE
-      //   mModulation.GetModWheel(voiceIdx)->SetValue((control.mValue-63) / 127.0f * 2);
-      //else
-      mModulation.GetModWheel(voiceIdx)->SetValue(control.mValue / 127.0f);
-   }
-   
+   //the modwheel gets applied when the audio thread drains this, at the same time as the notes around it
    MidiReceived(kMidiMessage_Control, control.mControl, control.mValue/127.0f, control.mChannel);
    
-   mQueuedMessageMutex.lock();
-   mQueuedControls.push_back(control);
-   mQueuedMessageMutex.unlock();
+   QueuedMessage message;
+   message.mType = kMidiMessage_Control;
+   message.mControl = control;
+   QueueMessage(message, control.mTime);
    
    if (mPrintInput)
       ofLog() << Name() << " control: " << control.mControl << ", " << control.mValue;
@@ -380,9 +428,10 @@ void MidiController::OnMidiProgramChange(MidiProgramChange& program)
    
    MidiReceived(kMidiMessage_Program, program.mProgram, program.mChannel);
    
-   mQueuedMessageMutex.lock();
-   mQueuedProgramChanges.push_back(program);
-   mQueuedMessageMutex.unlock();
+   QueuedMessage message;
+   message.mType = kMidiMessage_Program;
+   message.mProgramChange = program;
+   QueueMessage(message, program.mTime);
    
    if (mPrintInput)
       ofLog() << Name() << " program change: " << program.mProgram;
@@ -393,22 +442,17 @@ void MidiController::OnMidiPitchBend(MidiPitchBend& pitchBend)
    if (!mEnabled || (mChannelFilter != ChannelFilter::kAny && pitchBend.mChannel != (int)mChannelFilter))
       return;
    
-   int voiceIdx = -1;
-   
    float amount = (pitchBend.mValue - 8192.0f) / (8192.0f/mPitchBendRange);
-   
-   if (mUseChannelAsVoice)
-      voiceIdx = pitchBend.mChannel - 1;
-   else
+   if (!mUseChannelAsVoice)
       mCurrentPitchBend = amount;
-   
-   mModulation.GetPitchBend(voiceIdx)->SetValue(amount);
+   //the bend itself gets applied when the audio thread drains this, at the same time as the notes around it
    
    MidiReceived(kMidiMessage_PitchBend, MIDI_PITCH_BEND_CONTROL_NUM, pitchBend.mValue/16383.0f, pitchBend.mChannel);   //16383 = max pitch bend
  
-   mQueuedMessageMutex.lock();
-   mQueuedPitchBends.push_back(pitchBend);
-   mQueuedMessageMutex.unlock();
+   QueuedMessage message;
+   message.mType = kMidiMessage_PitchBend;
+   message.mPitchBend = pitchBend;
+   QueueMessage(message, pitchBend.mTime);
    
    if (mPrintInput)
       ofLog() << Name() << " pitch bend: " << pitchBend.mValue;
@@ -22,6 +22,7 @@
 #include "TextEntry.h"
 #include "ModulationChain.h"
 #include "INoteSource.h"
+#include "MPMCRingQueue.h"
 
 #define MIDI_PITCH_BEND_CONTROL_NUM 999
 #define MIDI_PAGE_WIDTH 1000
@@ -349,10 +350,6 @@ private:
    Checkbox* mBindCheckbox;
    bool mTwoWay;
    ClickButton* mAddConnectionButton;
-   std::list<MidiNote> mQueuedNotes;
-   std::list<MidiControl> mQueuedControls;
-   std::list<MidiProgramChange> mQueuedProgramChanges;
-   std::list<MidiPitchBend> mQueuedPitchBends;
    DropdownList* mControllerList;
    Checkbox* mDrawCablesCheckbox;
    MappingDisplayMode mMappingDisplayMode;
@@ -382,7 +379,26 @@ private:
    int mLayoutHeight;
    vector<GridLayout*> mGrids;
    
-   ofMutex mQueuedMessageMutex;
+   //input waiting for the audio thread, stamped with the gTime it should be played at
+   struct QueuedMessage
+   {
+      MidiMessageType mType;
+      double mTime;
+      union
+      {
+         MidiNote mNote;
+         MidiControl mControl;
+         MidiProgramChange mProgramChange;
+         MidiPitchBend mPitchBend;
+      };
+   };
+   void QueueMessage(QueuedMessage& message, double time);
+   void DeliverMessage(QueuedMessage& message, double time);
+   MPMCRingQueue<QueuedMessage> mQueuedMessages;
+   vector<QueuedMessage> mFutureMessages;   //drained but stamped past the current block. audio thread only, reserved up front
+   //wall clock and gTime at the last drain, for placing live input that didn't come with a time
+   std::atomic<double> mLastDrainTimeMs;
+   std::atomic<double> mLastDrainGTime;
 };
 
 #endif /* defined(__modularSynth__MidiController__) */
@@ -225,7 +225,7 @@ void MidiDevice::handleIncomingMidiMessage(MidiInput* source, const MidiMessage&
 }
 
 //static
-void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* deviceName, const MidiMessage& message)
+void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* deviceName, const MidiMessage& message, double time /*= -1*/)
 {
    listener->OnMidi(message);
    
@@ -239,6 +239,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       else
          note.mVelocity = 0;
       note.mChannel = message.getChannel();
+      note.mTime = time;
       listener->OnMidiNote(note);
    }
    if (message.isController())
@@ -248,6 +249,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       control.mControl = message.getControllerNumber();
       control.mValue = message.getControllerValue();
       control.mChannel = message.getChannel();
+      control.mTime = time;
       listener->OnMidiControl(control);
    }
    if (message.isProgramChange())
@@ -256,6 +258,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       program.mDeviceName = deviceName;
       program.mProgram = message.getProgramChangeNumber();
       program.mChannel = message.getChannel();
+      program.mTime = time;
       listener->OnMidiProgramChange(program);
    }
    if (message.isPitchWheel())
@@ -264,6 +267,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       pitchBend.mDeviceName = deviceName;
       pitchBend.mValue = message.getPitchWheelValue();
       pitchBend.mChannel = message.getChannel();
+      pitchBend.mTime = time;
       listener->OnMidiPitchBend(pitchBend);
    }
    if (message.isChannelPressure())
@@ -274,6 +278,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       pressure.mPitch = message.getNoteNumber();
       pressure.mPressure = message.getChannelPressureValue();
       pressure.mChannel = message.getChannel();
+      pressure.mTime = time;
       listener->OnMidiPressure(pressure);
    }
    if (message.isAftertouch())
@@ -283,6 +288,7 @@ void MidiDevice::SendMidiMessage(MidiDeviceListener* listener, const char* devic
       pressure.mPitch = -1;
       pressure.mPressure = message.getAfterTouchValue();
       pressure.mChannel = message.getChannel();
+      pressure.mTime = time;
       listener->OnMidiPressure(pressure);
    }
 }
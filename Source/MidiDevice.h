@@ -12,12 +12,14 @@
 #include "OpenFrameworksPort.h"
 #include "ModularSynth.h"
 
+//mTime on these is the gTime the message should land at, or -1 to place it by when it arrived
 struct MidiNote
 {
    const char* mDeviceName;
    int mPitch;
    float mVelocity; //0-127
    int mChannel;
+   double mTime;
 };
 
 struct MidiControl
@@ -26,6 +28,7 @@ struct MidiControl
    int mControl;
    float mValue;
    int mChannel;
+   double mTime;
 };
 
 struct MidiProgramChange
@@ -33,6 +36,7 @@ struct MidiProgramChange
    const char* mDeviceName;
    int mProgram;
    int mChannel;
+   double mTime;
 };
 
 struct MidiPitchBend
@@ -40,6 +44,7 @@ struct MidiPitchBend
    const char* mDeviceName;
    float mValue;
    int mChannel;
+   double mTime;
 };
 
 struct MidiPressure
@@ -48,6 +53,7 @@ struct MidiPressure
    int mPitch;
    float mPressure;
    int mChannel;
+   double mTime;
 };
 
 class MidiDeviceListener
@@ -88,7 +94,7 @@ public:
    void SendPitchBend(int bend, int channel = -1);
    void SendData(unsigned char a, unsigned char b, unsigned char c);
    
-   static void SendMidiMessage(MidiDeviceListener* listener, const char* deviceName, const MidiMessage& message);
+   static void SendMidiMessage(MidiDeviceListener* listener, const char* deviceName, const MidiMessage& message, double time = -1);
    
 private:
    void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
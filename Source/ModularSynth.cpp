@@ -32,6 +32,7 @@
 #include "DrumPlayer.h"
 #include "VSTPlugin.h"
 #include "Prefab.h"
+#include "FFT.h"
 
 ModularSynth* TheSynth = nullptr;
 
@@ -71,6 +72,8 @@ ModularSynth::ModularSynth()
 , mScrollMultiplierHorizontal(1)
 , mScrollMultiplierVertical(1)
 , mPixelRatio(1)
+, mRenderingOffline(false)
+, mAudioGraphDirty(false)
 {
    mConsoleText[0] = 0;
    assert(TheSynth == nullptr);
@@ -118,6 +121,9 @@ void ModularSynth::Setup(GlobalManagers* globalManagers, juce::Component* mainCo
       if (!mUserPrefs["scroll_multiplier_vertical"].isNull())
          mScrollMultiplierVertical = mUserPrefs["scroll_multiplier_vertical"].asDouble();
 
+      if (!mUserPrefs["audio_worker_threads"].isNull())
+         mAudioGraph.SetNumWorkers(mUserPrefs["audio_worker_threads"].asInt());
+
       juce::File(ofToDataPath("savestate")).createDirectory();
       juce::File(ofToDataPath("savestate/autosave")).createDirectory();
       juce::File(ofToDataPath("recordings")).createDirectory();
@@ -185,7 +191,7 @@ string ModularSynth::GetUserPrefsPath(bool relative)
 static int sFrameCount = 0;
 void ModularSynth::Poll()
 {
-   if (!mInitialized && sFrameCount > 3) //let some frames render before blocking for a load
+   if (!mInitialized && sFrameCount > 3 && !mRenderingOffline) //let some frames render before blocking for a load
    {
       LoadLayoutFromFile(ofToDataPath(mUserPrefs["layout"].asString()));
       mInitialized = true;
@@ -199,6 +205,11 @@ void ModularSynth::Poll()
    
    mZoomer.Update();
    
+   if (mAudioGraphDirty.exchange(false))
+      ArrangeAudioSourceDependencies();
+   mAudioGraph.ReclaimRetiredGraphs();
+   TheTransport->PublishChanges();
+   
    if (!mIsLoadingState)
    {
       for (auto p : mExtraPollers)
@@ -250,7 +261,7 @@ void ModularSynth::Poll()
          desiredCursor = MouseCursor::NormalCursor;
       }
 
-      if (desiredCursor != sCurrentCursor)
+      if (desiredCursor != sCurrentCursor && mMainComponent != nullptr)
       {
          sCurrentCursor = desiredCursor;
          mMainComponent->setMouseCursor(desiredCursor);
@@ -818,7 +829,7 @@ void ModularSynth::MouseDragged(int intX, int intY, int button)
       mResizeModule->Resize(newWidth, newHeight);
    }
 
-   mModuleContainer.MouseMoved(x, y);
+   mModuleContainer.MouseMoved(x, y, K(allModules));   //whatever is being dragged needs to hear about it, wherever the mouse is
 }
 
 void ModularSynth::MousePressed(int intX, int intY, int button)
@@ -1074,8 +1085,8 @@ void ModularSynth::OnModuleDeleted(IDrawableModule* module)
    
    mDeletedModules.push_back(module);
    
-   mAudioThreadMutex.Lock("delete");
-   
+   //the module itself stays alive in mDeletedModules, so the audio thread can keep running whatever graph
+   //it has until it picks up the one we publish here
    list<PatchCable*> cablesToRemove;
    for (auto* cable : mPatchCables)
    {
@@ -1086,6 +1097,7 @@ void ModularSynth::OnModuleDeleted(IDrawableModule* module)
       RemoveFromVector(cable, mPatchCables);
    
    RemoveFromVector(dynamic_cast<IAudioSource*>(module),mSources);
+   RebuildAudioGraph();
    RemoveFromVector(module,mLissajousDrawers);
    TheTransport->RemoveAudioPoller(dynamic_cast<IAudioPoller*>(module));
    //delete module; TODO(Ryan) deleting is hard... need to clear out everything with a reference to this, or switch to smart pointers
@@ -1108,8 +1120,6 @@ void ModularSynth::OnModuleDeleted(IDrawableModule* module)
       if (module == mOutput[i])
          mOutput[i] = nullptr;
    }
-   
-   mAudioThreadMutex.Unlock();
 }
 
 void ModularSynth::MouseReleased(int intX, int intY, int button)
@@ -1176,9 +1186,13 @@ void ModularSynth::MouseReleased(int intX, int intY, int button)
 
 void ModularSynth::AudioOut(float** output, int bufferSize, int nChannels)
 {
+   Profiler::CallbackScope callbackScope;
    PROFILER(audioOut_total);
    
-   if (mAudioPaused)
+   //graph edits go through mAudioGraph's snapshots and don't take the audio mutex. what still does (loading
+   //and clearing the layout, loading state, creating a module) can take as long as it likes, so never wait
+   //on it here, play silence for the block instead.
+   if (mAudioPaused || !mAudioThreadMutex.TryLock("audioOut()"))
    {
       for (int ch=0; ch<nChannels; ++ch)
       {
@@ -1188,10 +1202,14 @@ void ModularSynth::AudioOut(float** output, int bufferSize, int nChannels)
       return;
    }
    
-   ScopedMutex mutex(&mAudioThreadMutex, "audioOut()");
-   
    assert(nChannels <= MAX_OUTPUT_CHANNELS);
    
+   //OnModuleDeleted() clears these without the mutex, so only read them once
+   OutputChannel* outputs[MAX_OUTPUT_CHANNELS];
+   for (int i=0; i<MAX_OUTPUT_CHANNELS; ++i)
+      outputs[i] = mOutput[i];
+   VinylTempoControl* vinylTempoControl = TheVinylTempoControl;
+   
    /////////// AUDIO PROCESSING STARTS HERE /////////////
    float* outBuffer[MAX_OUTPUT_CHANNELS];
    assert(bufferSize == mIOBufferSize);
@@ -1199,19 +1217,20 @@ void ModularSynth::AudioOut(float** output, int bufferSize, int nChannels)
                                           //if we want these different, need to fix outBuffer here, and also fix audioIn()
    for (int ioOffset = 0; ioOffset < mIOBufferSize; ioOffset += gBufferSize)
    {
-      if (TheVinylTempoControl &&
-          mInput[TheVinylTempoControl->GetLeftChannel()-1] &&
-          mInput[TheVinylTempoControl->GetRightChannel()-1])
+      if (vinylTempoControl)
       {
-         TheVinylTempoControl->SetVinylControlInput(
-               mInput[TheVinylTempoControl->GetLeftChannel()-1]->GetBuffer()->GetChannel(0),
-               mInput[TheVinylTempoControl->GetRightChannel()-1]->GetBuffer()->GetChannel(0), gBufferSize);
+         InputChannel* left = mInput[vinylTempoControl->GetLeftChannel()-1];
+         InputChannel* right = mInput[vinylTempoControl->GetRightChannel()-1];
+         if (left && right)
+            vinylTempoControl->SetVinylControlInput(left->GetBuffer()->GetChannel(0), right->GetBuffer()->GetChannel(0), gBufferSize);
       }
 
+      mAudioGraph.ResetScratch();
+      
       for (int i=0; i<nChannels; ++i)
       {
-         if (mOutput[i])
-            mOutput[i]->ClearBuffer();
+         if (outputs[i])
+            outputs[i]->ClearBuffer();
       }
       
       double elapsed = gInvSampleRateMs * gBufferSize;
@@ -1219,18 +1238,17 @@ void ModularSynth::AudioOut(float** output, int bufferSize, int nChannels)
       TheTransport->Advance(elapsed);
       
       //get audio from sources
-      for (int i=0; i<mSources.size(); ++i)
-         mSources[i]->Process(gTime);
+      mAudioGraph.Process(gTime);
       
       //put it into speakers
       for (int i=0; i<MAX_OUTPUT_CHANNELS; ++i)
          outBuffer[i] = gZeroBuffer;
       for (int i=0; i<nChannels; ++i)
       {
-         if (mOutput[i])
+         if (outputs[i])
          {
-            mOutput[i]->Process();
-            outBuffer[i] = mOutput[i]->GetBuffer()->GetChannel(0);
+            outputs[i]->Process();
+            outBuffer[i] = outputs[i]->GetBuffer()->GetChannel(0);
          }
       }
       
@@ -1260,24 +1278,27 @@ void ModularSynth::AudioOut(float** output, int bufferSize, int nChannels)
    mRecordingLength += bufferSize;
    mRecordingLength = MIN(mRecordingLength, RECORDING_LENGTH);
    
+   mAudioThreadMutex.Unlock();
+   
    Profiler::PrintCounters();
 }
 
 void ModularSynth::AudioIn(const float** input, int bufferSize, int nChannels)
 {
-   if (mAudioPaused)
+   if (mAudioPaused || !mAudioThreadMutex.TryLock("audioIn()"))
       return;
-   
-   ScopedMutex mutex(&mAudioThreadMutex, "audioIn()");
 
    assert(bufferSize == mIOBufferSize);
    assert(nChannels <= MAX_INPUT_CHANNELS);
    
    for (int i=0; i<nChannels; ++i)
    {
-      if (mInput[i])
-         BufferCopy(mInput[i]->GetBuffer()->GetChannel(0), input[i], bufferSize);
+      InputChannel* inputChannel = mInput[i];
+      if (inputChannel)
+         BufferCopy(inputChannel->GetBuffer()->GetChannel(0), input[i], bufferSize);
    }
+   
+   mAudioThreadMutex.Unlock();
 }
 
 void ModularSynth::TriggerClapboard()
@@ -1313,6 +1334,14 @@ struct SourceDepInfo
 
 void ModularSynth::ArrangeAudioSourceDependencies()
 {
+   //AudioRouter, Rewriter and retargeting a patch cable can get here from midi and audio thread callbacks.
+   //the graph is only ever published from the ui thread, so leave it for the next Poll()
+   if (!juce::MessageManager::existsAndIsCurrentThread())
+   {
+      mAudioGraphDirty = true;
+      return;
+   }
+   
    //ofLog() << "Calculating audio source dependencies:";
    
    vector<SourceDepInfo> deps;
@@ -1386,6 +1415,23 @@ void ModularSynth::ArrangeAudioSourceDependencies()
    /*ofLog() << "new ordering:";
    for (int i=0; i<mSources.size(); ++i)
       ofLog() << dynamic_cast<IDrawableModule*>(mSources[i])->Name();*/
+   
+   RebuildAudioGraph();
+}
+
+void ModularSynth::RebuildAudioGraph()
+{
+   if (juce::MessageManager::existsAndIsCurrentThread())
+      mAudioGraph.Rebuild(mSources);
+   else
+      mAudioGraphDirty = true;
+}
+
+void ModularSynth::SetNumAudioWorkerThreads(int numWorkers)
+{
+   ScopedMutex mutex(&mAudioThreadMutex, "SetNumAudioWorkerThreads()");
+   mAudioGraph.SetNumWorkers(numWorkers);
+   mAudioGraph.Rebuild(mSources);
 }
 
 void ModularSynth::ResetLayout()
@@ -1402,6 +1448,7 @@ void ModularSynth::ResetLayout()
 
    mDeletedModules.clear();
    mSources.clear();
+   mAudioGraph.Rebuild(mSources);
    mLissajousDrawers.clear();
    mMoveModule = nullptr;
    LFOPool::Shutdown();
@@ -1448,6 +1495,10 @@ void ModularSynth::ResetLayout()
    
    mDrawOffset.set(0,0);
    mZoomer.Init();
+   
+   //the deleted modules took themselves out of the transport, but the audio thread's snapshots still point
+   //at them. we're under the audio mutex here, so swap those out before it gets to run again.
+   TheTransport->PublishChanges();
 }
 
 bool ModularSynth::SetInputChannel(int channel, InputChannel* input)
@@ -1640,7 +1691,10 @@ void ModularSynth::OnModuleAdded(IDrawableModule* module)
 {
    IAudioSource* source = dynamic_cast<IAudioSource*>(module);
    if (source)
+   {
       mSources.push_back(source);
+      RebuildAudioGraph();
+   }
 }
 
 void ModularSynth::AddDynamicModule(IDrawableModule* module)
@@ -1690,6 +1744,18 @@ IUIControl* ModularSynth::FindUIControl(string path)
    return mModuleContainer.FindUIControl(path);
 }
 
+IUIControl* ModularSynth::FindUIControl(const string& path, int& handle)
+{
+   //building the path back up is a lot cheaper than finding it, and catches renames and moves
+   IUIControl* control = IUIControl::FromHandle(handle);
+   if (control && control->Path(K(ignoreContext)) == path)
+      return control;
+   
+   control = FindUIControl(path);
+   handle = control ? control->GetHandle() : IUIControl::kInvalidHandle;
+   return control;
+}
+
 void ModularSynth::GrabSample(ChannelBuffer* data, bool window, int numBars)
 {
    delete mHeldSample;
@@ -1828,19 +1894,23 @@ void ModularSynth::LoadStatePopupImp()
 
 void ModularSynth::SaveState(string file)
 {
-   mAudioThreadMutex.Lock("SaveState()");
+   //the audio thread only waits for one module at a time to serialize into memory, the disk write happens in the background
+   std::shared_ptr<StateSnapshot> snapshot = std::make_shared<StateSnapshot>();
    
-   FileStreamOut out(ofToDataPath(file).c_str());
-   
-   out << GetLayout().getRawString(true);
-   mModuleContainer.SaveState(out);
+   {
+      FileStreamOut out(snapshot.get());
+      out << GetLayout().getRawString(true);
+      mModuleContainer.SaveState(out, &mAudioThreadMutex);
+   }
    
-   mAudioThreadMutex.Unlock();
+   mStateWriter.Enqueue(snapshot, ofToDataPath(file));
 }
 
 void ModularSynth::LoadState(string file)
 {
    ofLog() << "LoadState() " << ofToDataPath(file);
+   
+   mStateWriter.WaitUntilIdle();   //in case we're loading something that's still being saved
 
    if (!juce::File(ofToDataPath(file)).existsAsFile())
    {
@@ -1971,6 +2041,41 @@ void ModularSynth::OnConsoleInput()
       {
          Profiler::ToggleProfiler();
       }
+      else if (tokens[0] == "profiletrace")
+      {
+         if (tokens.size() >= 2)
+         {
+            if (Profiler::ExportTrace(tokens[1]))
+               ofLog() << "wrote profiler trace to " << ofToDataPath(tokens[1]);
+            else
+               ofLog() << "couldn't write profiler trace to " << tokens[1];
+         }
+         else
+         {
+            Profiler::StartTrace();
+            ofLog() << "recording profiler trace, \"profiletrace <path>\" to stop and save it (.json for chrome tracing)";
+         }
+      }
+      else if (tokens[0] == "deadlines")
+      {
+         int numCallbacks, numMisses;
+         long worstNanoseconds;
+         Profiler::GetDeadlineStats(numCallbacks, numMisses, worstNanoseconds);
+         ofLog() << numMisses << " of " << numCallbacks << " audio callbacks missed their deadline, worst took " << worstNanoseconds / 1000 << " us";
+      }
+      else if (tokens[0] == "audiothreads")
+      {
+         if (tokens.size() >= 2)
+            SetNumAudioWorkerThreads(atoi(tokens[1].c_str()));
+         ofLog() << "audio worker threads: " << mAudioGraph.GetNumWorkers();
+      }
+      else if (tokens[0] == "fftbenchmark")
+      {
+         vector<string> results;
+         FFT::RunBenchmark(results);
+         for (const auto& line : results)
+            ofLog() << line;
+      }
       else if (tokens[0] == "clear")
       {
          mErrors.clear();
@@ -2149,6 +2254,7 @@ IDrawableModule* ModularSynth::SpawnModuleOnTheFly(string moduleName, float x, f
    IDrawableModule* module = nullptr;
    try
    {
+      //setting up a module touches transport listeners and other state the audio thread still reads directly
       ScopedMutex mutex(&mAudioThreadMutex, "CreateModule");
       module = CreateModule(dummy);
       if (module != nullptr)
@@ -2206,26 +2312,31 @@ void ModularSynth::ReconnectMidiDevices()
 
 void ModularSynth::SaveOutput()
 {
-   ScopedMutex mutex(&mAudioThreadMutex, "SaveOutput()");
-
    string filename = ofGetTimestampString("recordings/recording_%Y-%m-%d_%H-%M.wav");
    //string filenamePos = ofGetTimestampString("recordings/pos_%Y-%m-%d_%H-%M.wav");
 
-   assert(mRecordingLength <= RECORDING_LENGTH);
-   
-   for (int i=0; i<mRecordingLength; ++i)
+   int recordingLength;
    {
-      mSaveOutputBuffer[0][i] = mOutputBuffer.GetSample((int)mRecordingLength-i-1, 0);
-      mSaveOutputBuffer[1][i] = mOutputBuffer.GetSample((int)mRecordingLength-i-1, 1);
+      //only hold the audio thread up for the copy, not the disk write
+      ScopedMutex mutex(&mAudioThreadMutex, "SaveOutput()");
+      
+      assert(mRecordingLength <= RECORDING_LENGTH);
+      
+      recordingLength = (int)mRecordingLength;
+      for (int i=0; i<recordingLength; ++i)
+      {
+         mSaveOutputBuffer[0][i] = mOutputBuffer.GetSample(recordingLength-i-1, 0);
+         mSaveOutputBuffer[1][i] = mOutputBuffer.GetSample(recordingLength-i-1, 1);
+      }
+      
+      mOutputBuffer.ClearBuffer();
+      mRecordingLength = 0;
    }
 
-   Sample::WriteDataToFile(filename.c_str(), mSaveOutputBuffer, (int)mRecordingLength, 2);
+   Sample::WriteDataToFile(filename.c_str(), mSaveOutputBuffer, recordingLength, 2);
    
    //mOutputBufferMeasurePos.ReadChunk(mSaveOutputBuffer, mRecordingLength);
    //Sample::WriteDataToFile(filenamePos.c_str(), mSaveOutputBuffer, mRecordingLength, 1);
-   
-   mOutputBuffer.ClearBuffer();
-   mRecordingLength = 0;
 }
 
 void ConsoleListener::TextEntryActivated(TextEntry* entry)
@@ -16,8 +16,12 @@
 #include "LocationZoomer.h"
 #include "EffectFactory.h"
 #include "ModuleContainer.h"
+#include "AudioGraphScheduler.h"
+#include "StateSnapshot.h"
+#include "ModuleLayerCache.h"
 #ifdef BESPOKE_LINUX
 #include <climits>
+#include <atomic>
 #endif
 
 class IAudioSource;
@@ -65,6 +69,10 @@ public:
    void Poll();
    void Draw(void* vg);
    void PostRender();
+   //gl thread, before the main frame starts
+   void RenderModuleLayers(void* vg) { mModuleLayers.RenderDirtyLayers((NVGcontext*)vg, mPixelRatio); }
+   void ReleaseModuleLayers() { mModuleLayers.Clear(); }
+   ModuleLayerCache& GetModuleLayers() { return mModuleLayers; }
    
    void Exit();
    
@@ -83,6 +91,7 @@ public:
    
    void AudioOut(float** output, int bufferSize, int nChannels);
    void AudioIn(const float** input, int bufferSize, int nChannels);
+   void SetIOBufferSize(int size) { mIOBufferSize = size; }
 
    void OnConsoleInput();
    void ClearConsoleInput();
@@ -91,6 +100,8 @@ public:
    
    void AddMidiDevice(MidiDevice* device);
    void ArrangeAudioSourceDependencies();
+   void SetNumAudioWorkerThreads(int numWorkers);
+   AudioGraphScheduler* GetAudioGraph() { return &mAudioGraph; }
    IDrawableModule* SpawnModuleOnTheFly(string moduleName, float x, float y, bool addToContainer = true);
    void SetMoveModule(IDrawableModule* module, float offsetX, float offsetY);
    
@@ -101,6 +112,8 @@ public:
    IAudioReceiver* FindAudioReceiver(string name, bool fail = true);
    INoteReceiver* FindNoteReceiver(string name, bool fail = true);
    IUIControl* FindUIControl(string path);
+   //for repeat lookups of the same path. handle starts out as IUIControl::kInvalidHandle and is kept up to date.
+   IUIControl* FindUIControl(const string& path, int& handle);
    MidiController* FindMidiController(string name, bool fail = true);
    void MoveToFront(IDrawableModule* module);
    IDrawableModule* GetModuleAt(int x, int y);
@@ -172,6 +185,8 @@ public:
    
    bool IsLoadingState() const { return mIsLoadingState; }
    bool IsLoadingModule() const { return mIsLoadingModule; }
+   void SetRenderingOffline(bool offline) { mRenderingOffline = offline; }
+   bool IsRenderingOffline() const { return mRenderingOffline; }   //no window, no audio device, and no message loop
    
    static string GetUserPrefsPath(bool relative);
    
@@ -202,11 +217,14 @@ private:
    void DeleteAllModules();
    void TriggerClapboard();
    void DoAutosave();
+   void RebuildAudioGraph();
    
    ofSoundStream mSoundStream;
    int mIOBufferSize;
    
    vector<IAudioSource*> mSources;
+   AudioGraphScheduler mAudioGraph;
+   std::atomic<bool> mAudioGraphDirty;   //edited off the ui thread, rebuilt in the next Poll()
    InputChannel* mInput[MAX_INPUT_CHANNELS];
    OutputChannel* mOutput[MAX_OUTPUT_CHANNELS];
    vector<IDrawableModule*> mLissajousDrawers;
@@ -247,6 +265,7 @@ private:
    ofVec2f mDrawOffset;
    
    NamedMutex mAudioThreadMutex;
+   StateSnapshotWriter mStateWriter;
    
    bool mAudioPaused;
    bool mIsLoadingState;
@@ -293,6 +312,7 @@ private:
    float mFrameRate;
    
    ModuleContainer mModuleContainer;
+   ModuleLayerCache mModuleLayers;
    
    ADSRDisplay* mScheduledEnvelopeEditorSpawnDisplay;
    
@@ -308,6 +328,7 @@ private:
    float mScrollMultiplierVertical;
 
    double mPixelRatio;
+   bool mRenderingOffline;
 };
 
 extern ModularSynth* TheSynth;
@@ -46,7 +46,12 @@ float ModulationChain::GetIndividualValue(int samplesIn) const
 
 void ModulationChain::SetValue(float value)
 {
-   mRamp.Start(gTime, value, gTime + gInvSampleRateMs*gBufferSize);
+   SetValue(value, gTime);
+}
+
+void ModulationChain::SetValue(float value, double time)
+{
+   mRamp.Start(time, value, time + gInvSampleRateMs*gBufferSize);
 }
 
 void ModulationChain::RampValue(double time, float from, float to, double length)
@@ -19,6 +19,7 @@ public:
    float GetValue(int samplesIn) const;
    float GetIndividualValue(int samplesIn) const;
    void SetValue(float value);
+   void SetValue(float value, double time);   //lands at time instead of at the start of the block
    void RampValue(double time, float from, float to, double length);
    void SetLFO(NoteInterval interval, float amount);
    void AppendTo(ModulationChain* chain);
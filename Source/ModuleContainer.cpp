@@ -18,8 +18,19 @@
 #include "SynthGlobals.h"
 #include "QuickSpawnMenu.h"
 
+namespace
+{
+   const float kSpatialCellSize = 256;
+   const float kModuleMargin = 40;   //patch cable sources and beacons stick out past a module's rect
+   const float kCablePickMargin = 5;   //PatchCable's hover distance
+}
+
 ModuleContainer::ModuleContainer()
 : mOwner(nullptr)
+, mModuleGrid(kSpatialCellSize)
+, mCableEndGrid(kSpatialCellSize)
+, mSpatialIndexDirty(true)
+, mNameIndexDirty(true)
 {
    
 }
@@ -41,18 +52,97 @@ void ModuleContainer::GetAllModules(vector<IDrawableModule*>& out)
    }
 }
 
+void ModuleContainer::UpdateSpatialIndex()
+{
+   if (!mSpatialIndexDirty)
+      return;
+   mSpatialIndexDirty = false;
+   
+   mModuleGrid.Clear();
+   mCableEndGrid.Clear();
+   mUnculledModules.clear();
+   for (int i=0; i<mModules.size(); ++i)
+   {
+      IDrawableModule* module = mModules[i];
+      float x,y,w,h;
+      module->GetPosition(x, y);
+      module->GetDimensions(w, h);
+      float titleBarHeight = module->HasTitleBar() ? IDrawableModule::TitleBarHeight() : 0;
+      mModuleGrid.Insert(i, ofRectangle(x - kModuleMargin, y - titleBarHeight - kModuleMargin, w + kModuleMargin * 2, h + titleBarHeight + kModuleMargin * 2));
+      
+      if (!module->ShouldCullWhenOffscreen())
+         mUnculledModules.push_back(i);
+      
+      //cables get grabbed by the plug end, which is over by the target
+      for (auto* source : module->GetPatchCableSources())
+      {
+         for (auto* cable : source->GetPatchCables())
+         {
+            PatchCablePos pos = cable->GetPatchCablePos();
+            ofRectangle plugRect(MIN(pos.plug.x, pos.end.x) - kCablePickMargin,
+                                 MIN(pos.plug.y, pos.end.y) - kCablePickMargin,
+                                 fabsf(pos.end.x - pos.plug.x) + kCablePickMargin * 2,
+                                 fabsf(pos.end.y - pos.plug.y) + kCablePickMargin * 2);
+            mCableEndGrid.Insert(i, plugRect);
+         }
+      }
+   }
+}
+
+void ModuleContainer::GetModulesToDraw(vector<int>& indices)
+{
+   if (mOwner != nullptr)
+   {
+      indices.resize(mModules.size());
+      for (int i=0; i<mModules.size(); ++i)
+         indices[i] = i;
+      return;
+   }
+   
+   //modules move and resize all the time, rebuilding once a frame is cheaper than keeping track of all that
+   mSpatialIndexDirty = true;
+   UpdateSpatialIndex();
+   
+   mModuleGrid.Query(TheSynth->GetDrawRect(), indices);
+   if (!mUnculledModules.empty())
+   {
+      indices.insert(indices.end(), mUnculledModules.begin(), mUnculledModules.end());
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+   }
+}
+
+void ModuleContainer::GetModulesNear(float x, float y, vector<int>& indices)
+{
+   UpdateSpatialIndex();
+   
+   mModuleGrid.Query(x, y, indices);
+   mCableEndGrid.Query(x, y, mCableQueryResult);
+   if (!mCableQueryResult.empty())
+   {
+      indices.insert(indices.end(), mCableQueryResult.begin(), mCableQueryResult.end());
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+   }
+}
+
 void ModuleContainer::Draw()
 {
-   for (int i = (int)mModules.size()-1; i >= 0; --i)
+   vector<int> indices;
+   GetModulesToDraw(indices);
+   
+   for (int k = (int)indices.size()-1; k >= 0; --k)
    {
-      if (!mModules[i]->AlwaysOnTop())
-         mModules[i]->Draw();
+      IDrawableModule* module = mModules[indices[k]];
+      if (!module->AlwaysOnTop())
+         module->Draw();
    }
    
-   for (int i = (int)mModules.size()-1; i >= 0; --i)
+   for (int k = (int)indices.size()-1; k >= 0; --k)
    {
-      if (mModules[i]->AlwaysOnTop())
-         mModules[i]->Draw();
+      IDrawableModule* module = mModules[indices[k]];
+      if (module->AlwaysOnTop())
+         module->Draw();
    }
 }
 
@@ -98,6 +188,9 @@ void ModuleContainer::Clear()
          DeleteModule(module);
    }
    mModules.clear();
+   mMouseMovedModules.clear();
+   mSpatialIndexDirty = true;
+   InvalidateNameIndex();
 }
 
 void ModuleContainer::Exit()
@@ -130,18 +223,48 @@ void ModuleContainer::KeyReleased(int key)
    }
 }
 
-void ModuleContainer::MouseMoved(float x, float y)
+void ModuleContainer::MouseMoved(float x, float y, bool allModules /*= false*/)
 {
    if (mOwner != nullptr) return;
    
-   for (int i=(int)mModules.size()-1; i>=0; --i)  //run this backwards so that we can figure out the top hover control
+   if (allModules)
+      mSpatialIndexDirty = true;   //probably dragging things around
+   
+   //besides the modules under the mouse, tell the ones it was over last time, so they can drop their hover state
+   vector<int>& indices = mQueryResult;
+   GetModulesNear(x, y, indices);
+   size_t numNear = indices.size();
+   for (auto* module : mMouseMovedModules)
    {
-      ModuleContainer* subcontainer = mModules[i]->GetContainer();
+      auto iter = std::find(mModules.begin(), mModules.end(), module);
+      if (iter != mModules.end())
+         indices.push_back(int(iter - mModules.begin()));
+   }
+   mMouseMovedModules.clear();
+   for (size_t k=0; k<numNear; ++k)
+      mMouseMovedModules.push_back(mModules[indices[k]]);
+   
+   if (allModules)
+   {
+      indices.resize(mModules.size());
+      for (int i=0; i<mModules.size(); ++i)
+         indices[i] = i;
+   }
+   else
+   {
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+   }
+   
+   for (int k=(int)indices.size()-1; k>=0; --k)  //run this backwards so that we can figure out the top hover control
+   {
+      IDrawableModule* module = mModules[indices[k]];
+      ModuleContainer* subcontainer = module->GetContainer();
       if (subcontainer)
       {
          subcontainer->MouseMoved(x - subcontainer->GetOwnerPosition().x, y - subcontainer->GetOwnerPosition().y);
       }
-      mModules[i]->NotifyMouseMoved(x,y);
+      module->NotifyMouseMoved(x,y);
    }
 }
 
@@ -160,7 +283,19 @@ void ModuleContainer::MouseReleased()
 
 IDrawableModule* ModuleContainer::GetModuleAt(float x, float y)
 {
-   for (int i=0; i<mModules.size(); ++i)
+   vector<int> indices;
+   if (mOwner == nullptr)
+   {
+      GetModulesNear(x, y, indices);
+   }
+   else
+   {
+      indices.resize(mModules.size());
+      for (int i=0; i<mModules.size(); ++i)
+         indices[i] = i;
+   }
+   
+   for (int i : indices)
    {
       if (mModules[i]->AlwaysOnTop() && mModules[i]->TestClick(x,y,false,true))
       {
@@ -174,7 +309,7 @@ IDrawableModule* ModuleContainer::GetModuleAt(float x, float y)
          return mModules[i];
       }
    }
-   for (int i=0; i<mModules.size(); ++i)
+   for (int i : indices)
    {
       if (!mModules[i]->AlwaysOnTop() && mModules[i]->TestClick(x,y,false,true))
       {
@@ -213,6 +348,8 @@ void ModuleContainer::MoveToFront(IDrawableModule* module)
          for (int j=i; j>0; --j)
             mModules[j] = mModules[j-1];
          mModules[0] = module;
+         mSpatialIndexDirty = true;
+         InvalidateNameIndex();
          
          break;
       }
@@ -236,6 +373,9 @@ void ModuleContainer::TakeModule(IDrawableModule* module)
    if (module->GetOwningContainer()->mOwner)
       module->GetOwningContainer()->mOwner->RemoveChild(module);
    RemoveFromVector(module, module->GetOwningContainer()->mModules);
+   RemoveFromVector(module, module->GetOwningContainer()->mMouseMovedModules);
+   module->GetOwningContainer()->mSpatialIndexDirty = true;
+   module->GetOwningContainer()->InvalidateNameIndex();
    
    mModules.push_back(module);
    MoveToFront(module);
@@ -260,6 +400,9 @@ void ModuleContainer::DeleteModule(IDrawableModule* module)
       return;
    
    RemoveFromVector(module, mModules, K(fail));
+   RemoveFromVector(module, mMouseMovedModules);
+   mSpatialIndexDirty = true;
+   InvalidateNameIndex();
    for (auto iter : mModules)
    {
       if (iter->GetPatchCableSource())
@@ -293,31 +436,36 @@ IDrawableModule* ModuleContainer::FindModule(string name, bool fail)
    if (name == "")
       return nullptr;
    
-   for (int i=0; i<mModules.size(); ++i)
+   //"prefab~module" or "module~child"
+   size_t separator = name.find('~');
+   if (separator == string::npos)
    {
-      if (name == mModules[i]->Name())
-         return mModules[i];
-      vector<string> tokens = ofSplitString(name, "~");
-      if (mModules[i]->GetContainer())
-      {
-         if (tokens[0] == mModules[i]->Name())
-         {
-            ofStringReplace(name, tokens[0]+"~", "", true);
-            return mModules[i]->GetContainer()->FindModule(name, fail);
-         }
-      }
-      if (tokens.size() == 2 && tokens[0] == mModules[i]->Name())
+      IDrawableModule* module = LookUpModule(name);
+      if (module)
+         return module;
+   }
+   else
+   {
+      IDrawableModule* module = LookUpModule(name.substr(0, separator));
+      if (module)
       {
-         IDrawableModule* child = nullptr;
-         try
-         {
-            child = mModules[i]->FindChild(tokens[1].c_str());
-         }
-         catch (UnknownModuleException& e)
+         string rest = name.substr(separator + 1);
+         if (module->GetContainer())
+            return module->GetContainer()->FindModule(rest, fail);
+         
+         if (rest.find('~') == string::npos)
          {
+            IDrawableModule* child = nullptr;
+            try
+            {
+               child = module->FindChild(rest.c_str());
+            }
+            catch (UnknownModuleException& e)
+            {
+            }
+            if (child)
+               return child;
          }
-         if (child)
-            return child;
       }
    }
    
@@ -326,6 +474,40 @@ IDrawableModule* ModuleContainer::FindModule(string name, bool fail)
    return nullptr;
 }
 
+IDrawableModule* ModuleContainer::LookUpModule(const string& name)
+{
+   const juce::ScopedLock lock(mNameIndexLock);
+   
+   if (mNameIndexDirty)
+   {
+      mNameIndex.clear();
+      for (auto* module : mModules)
+         mNameIndex.emplace(module->Name(), module);   //first one wins, same as a front to back search
+      mNameIndexDirty = false;
+   }
+   
+   auto iter = mNameIndex.find(name);
+   if (iter != mNameIndex.end() && name == iter->second->Name())
+      return iter->second;
+   
+   //stale or missing, somebody may have been renamed. if the slow way turns it up, rebuild next time.
+   for (auto* module : mModules)
+   {
+      if (name == module->Name())
+      {
+         mNameIndexDirty = true;
+         return module;
+      }
+   }
+   return nullptr;
+}
+
+void ModuleContainer::InvalidateNameIndex()
+{
+   const juce::ScopedLock lock(mNameIndexLock);
+   mNameIndexDirty = true;
+}
+
 IUIControl* ModuleContainer::FindUIControl(string path)
 {
    /*string ownerPath = "";
@@ -339,9 +521,9 @@ IUIControl* ModuleContainer::FindUIControl(string path)
    if (path == "")
       return nullptr;
    
-   vector<string> tokens = ofSplitString(path,"~");
-   string control = tokens[tokens.size()-1];
-   string modulePath = path.substr(0, path.length() - (control.length() + 1));
+   size_t separator = path.rfind('~');
+   string control = (separator == string::npos) ? path : path.substr(separator + 1);
+   string modulePath = (separator == string::npos) ? path : path.substr(0, separator);
    IDrawableModule* module = FindModule(modulePath, false);
    
    if (module)
@@ -488,7 +670,7 @@ namespace
    const int kSaveStateRev = 420;
 }
 
-void ModuleContainer::SaveState(FileStreamOut& out)
+void ModuleContainer::SaveState(FileStreamOut& out, NamedMutex* moduleLock /*= nullptr*/)
 {
    out << kSaveStateRev;
    
@@ -507,7 +689,16 @@ void ModuleContainer::SaveState(FileStreamOut& out)
       {
          //ofLog() << "Saving " << module->Name();
          out << string(module->Name());
-         module->SaveState(out);
+         if (moduleLock)
+         {
+            //only hold the lock for one module at a time, so the audio thread never waits on the whole save
+            ScopedMutex mutex(moduleLock, "ModuleContainer::SaveState()");
+            module->SaveState(out);
+         }
+         else
+         {
+            module->SaveState(out);
+         }
          for (int i=0; i<GetModuleSeparatorLength(); ++i)
             out << GetModuleSeparator()[i];
       }
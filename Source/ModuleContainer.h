@@ -14,6 +14,10 @@
 #include "OpenFrameworksPort.h"
 #include "IDrawableModule.h"
 #include "ofxJSONElement.h"
+#include "SpatialGrid.h"
+#include <unordered_map>
+
+class NamedMutex;
 
 class ModuleContainer
 {
@@ -32,7 +36,7 @@ public:
    
    void KeyPressed(int key, bool isRepeat);
    void KeyReleased(int key);
-   void MouseMoved(float x, float y);
+   void MouseMoved(float x, float y, bool allModules = false);
    void MouseReleased();
    IDrawableModule* GetModuleAt(float x, float y);
    void GetModulesWithinRect(ofRectangle rect, vector<IDrawableModule*>& output);
@@ -58,7 +62,7 @@ public:
    
    void LoadModules(const ofxJSONElement& modules);
    ofxJSONElement WriteModules();
-   void SaveState(FileStreamOut& out);
+   void SaveState(FileStreamOut& out, NamedMutex* moduleLock = nullptr);
    void LoadState(FileStreamIn& in);
    
    static constexpr int GetModuleSeparatorLength() { return 13; }
@@ -67,9 +71,30 @@ public:
    
 private:
    ofVec2f GetOwnerPosition() const;
+   void UpdateSpatialIndex();
+   void GetModulesNear(float x, float y, vector<int>& indices);
+   void GetModulesToDraw(vector<int>& indices);
+   IDrawableModule* LookUpModule(const string& name);
+   void InvalidateNameIndex();
    
    vector<IDrawableModule*> mModules;
    IDrawableModule* mOwner;
+   
+   //indices into mModules, by area. only the root container uses these, it's the one that
+   //gets drawn and moused over directly.
+   SpatialGrid mModuleGrid;
+   SpatialGrid mCableEndGrid;
+   bool mSpatialIndexDirty;
+   vector<int> mUnculledModules;
+   vector<int> mQueryResult;
+   vector<int> mCableQueryResult;
+   vector<IDrawableModule*> mMouseMovedModules;
+   
+   //top level names -> mModules, rebuilt lazily. names can change without us hearing about it
+   //(the save panel edits them in place), so a hit only counts if the module still has that name.
+   std::unordered_map<string, IDrawableModule*> mNameIndex;
+   bool mNameIndexDirty;
+   juce::CriticalSection mNameIndexLock;
 };
 
 #endif  // MODULECONTAINER_H_INCLUDED
@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    ModuleLayerCache.cpp
+    Created: 18 Oct 2026 10:06:31pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#ifdef BESPOKE_WINDOWS
+#include <GL/glew.h>
+#endif
+
+#include "ModuleLayerCache.h"
+#include "SynthGlobals.h"
+#include "nanovg/nanovg.h"
+#include "nanovg/nanovg_gl_utils.h"
+
+namespace
+{
+   const int kMaxRendersPerFrame = 16;   //don't stall a frame when a big patch scrolls into view
+   const int kFramesToKeepUnused = 300;
+}
+
+ModuleLayerCache::Layer::Layer()
+: mSize(0)
+, mScale(0)
+, mWidth(0)
+, mHeight(0)
+, mFramebuffer(nullptr)
+, mFramebufferWidth(0)
+, mFramebufferHeight(0)
+, mWanted(false)
+, mWantedSize(0)
+, mLastUsedFrame(0)
+{
+}
+
+bool ModuleLayerCache::Layer::Matches(const string& label, const ofColor& color, float size, float scale) const
+{
+   return mFramebuffer != nullptr &&
+          mScale == scale &&
+          mSize == size &&
+          mColor.r == color.r && mColor.g == color.g && mColor.b == color.b &&
+          mLabel == label;
+}
+
+ModuleLayerCache::ModuleLayerCache()
+: mContext(nullptr)
+, mPixelRatio(0)
+, mLastScale(0)
+, mFrame(0)
+{
+}
+
+bool ModuleLayerCache::DrawTitle(IDrawableModule* module, const string& label, const ofColor& color, float x, float y, float size, float alpha)
+{
+   if (gNanoVG != mContext || ofIsStringInString(label, "\n"))
+      return false;   //another context (push 2 display), or text our layer box isn't sized for
+
+   Layer& layer = mLayers[module];
+   layer.mLastUsedFrame = mFrame;
+
+   if (!layer.Matches(label, color, size, gDrawScale))
+   {
+      layer.mWanted = true;
+      layer.mWantedLabel = label;
+      layer.mWantedColor = color;
+      layer.mWantedSize = size;
+      return false;
+   }
+
+   float padding = GetPadding(size);
+   float left = x - padding;
+   float top = y - size;
+   NVGpaint paint = nvgImagePattern(gNanoVG, left, top, layer.mWidth, layer.mHeight, 0, layer.mFramebuffer->image, alpha);
+   nvgBeginPath(gNanoVG);
+   nvgRect(gNanoVG, left, top, layer.mWidth, layer.mHeight);
+   nvgFillPaint(gNanoVG, paint);
+   nvgFill(gNanoVG);
+   return true;
+}
+
+void ModuleLayerCache::RenderDirtyLayers(NVGcontext* vg, float pixelRatio)
+{
+   if (vg != mContext || pixelRatio != mPixelRatio)
+      Clear();
+   mContext = vg;
+   mPixelRatio = pixelRatio;
+
+   ++mFrame;
+
+   //don't bother while zooming, the layers would be stale again next frame
+   bool scaleSettled = (gDrawScale == mLastScale);
+   mLastScale = gDrawScale;
+
+   int numRendered = 0;
+   for (auto iter = mLayers.begin(); iter != mLayers.end(); )
+   {
+      Layer& layer = iter->second;
+      if (mFrame - layer.mLastUsedFrame > kFramesToKeepUnused)
+      {
+         nvgluDeleteFramebuffer(layer.mFramebuffer);
+         iter = mLayers.erase(iter);
+         continue;
+      }
+
+      if (layer.mWanted && scaleSettled && numRendered < kMaxRendersPerFrame)
+      {
+         Render(vg, layer, pixelRatio);
+         ++numRendered;
+      }
+      ++iter;
+   }
+}
+
+void ModuleLayerCache::Render(NVGcontext* vg, Layer& layer, float pixelRatio)
+{
+   layer.mWanted = false;
+
+   NVGcontext* mainVG = gNanoVG;
+   gNanoVG = vg;
+
+   float size = layer.mWantedSize;
+   float padding = GetPadding(size);
+   float width = gFontBold.GetStringWidth(layer.mWantedLabel, size, K(isRenderThread)) + padding * 2;
+   float height = size * 1.5f;
+   float scale = gDrawScale * pixelRatio;
+   int framebufferWidth = MAX(1, (int)ceilf(width * scale));
+   int framebufferHeight = MAX(1, (int)ceilf(height * scale));
+
+   if (layer.mFramebuffer == nullptr ||
+       framebufferWidth > layer.mFramebufferWidth || framebufferHeight > layer.mFramebufferHeight ||
+       framebufferWidth * 2 < layer.mFramebufferWidth || framebufferHeight * 2 < layer.mFramebufferHeight)
+   {
+      nvgluDeleteFramebuffer(layer.mFramebuffer);
+      layer.mFramebuffer = nvgluCreateFramebuffer(vg, framebufferWidth, framebufferHeight, 0);
+      layer.mFramebufferWidth = framebufferWidth;
+      layer.mFramebufferHeight = framebufferHeight;
+      if (layer.mFramebuffer == nullptr)
+      {
+         gNanoVG = mainVG;
+         return;
+      }
+   }
+
+   //the image gets stretched over mWidth x mHeight when it's drawn, so size those to the whole framebuffer
+   layer.mWidth = layer.mFramebufferWidth / scale;
+   layer.mHeight = layer.mFramebufferHeight / scale;
+
+   GLint previousFramebuffer;
+   glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+   glBindFramebuffer(GL_FRAMEBUFFER, layer.mFramebuffer->fbo);
+   glViewport(0, 0, layer.mFramebufferWidth, layer.mFramebufferHeight);
+   glClearColor(0, 0, 0, 0);
+   glClear(GL_COLOR_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+   nvgBeginFrame(vg, layer.mFramebufferWidth, layer.mFramebufferHeight, 1);
+
+   nvgScale(vg, scale, scale);
+   nvgTextLetterSpacing(vg, -.3f);   //same as the main frame
+   ofSetColor(layer.mWantedColor, 255);
+   DrawTextBold(layer.mWantedLabel, padding, size, size);
+
+   nvgEndFrame(vg);
+   glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+   gNanoVG = mainVG;
+
+   layer.mLabel = layer.mWantedLabel;
+   layer.mColor = layer.mWantedColor;
+   layer.mSize = size;
+   layer.mScale = gDrawScale;
+}
+
+void ModuleLayerCache::Clear()
+{
+   for (auto& layer : mLayers)
+      nvgluDeleteFramebuffer(layer.second.mFramebuffer);
+   mLayers.clear();
+}
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    ModuleLayerCache.h
+    Created: 18 Oct 2026 10:06:31pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include <unordered_map>
+
+struct NVGcontext;
+struct NVGLUframebuffer;
+class IDrawableModule;
+
+//module title labels pre-rendered into nanovg framebuffers. text is the priciest part of a module's
+//frame to draw and the label hardly ever changes, so most repaints just stamp the cached image.
+//a layer is redrawn when what it was drawn from (label, color, zoom) no longer matches.
+class ModuleLayerCache
+{
+public:
+   ModuleLayerCache();
+
+   //inside the main frame. returns false if there's no up to date layer yet, in which case the
+   //caller draws the text itself and the layer gets rendered before the next frame.
+   bool DrawTitle(IDrawableModule* module, const string& label, const ofColor& color, float x, float y, float size, float alpha);
+
+   //gl thread, outside of any nanovg frame. renders what DrawTitle() asked for and frees layers nobody has drawn in a while.
+   void RenderDirtyLayers(NVGcontext* vg, float pixelRatio);
+   //gl thread, while the context is still alive
+   void Clear();
+
+private:
+   struct Layer
+   {
+      Layer();
+      bool Matches(const string& label, const ofColor& color, float size, float scale) const;
+
+      string mLabel;
+      ofColor mColor;
+      float mSize;
+      float mScale;
+      float mWidth;
+      float mHeight;
+      NVGLUframebuffer* mFramebuffer;
+      int mFramebufferWidth;
+      int mFramebufferHeight;
+
+      bool mWanted;
+      string mWantedLabel;
+      ofColor mWantedColor;
+      float mWantedSize;
+      int mLastUsedFrame;
+   };
+
+   void Render(NVGcontext* vg, Layer& layer, float pixelRatio);
+   static float GetPadding(float size) { return size * .25f; }
+
+   std::unordered_map<IDrawableModule*, Layer> mLayers;
+   NVGcontext* mContext;
+   float mPixelRatio;
+   float mLastScale;
+   int mFrame;
+};
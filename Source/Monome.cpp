@@ -137,6 +137,7 @@ void Monome::oscMessageReceived(const OSCMessage& msg)
       note.mVelocity = val * 127.0f;
       note.mChannel = 0;
       note.mDeviceName = "monome";
+      note.mTime = -1;
       mListener->OnMidiNote(note);
    }
    else if (label == "/monome/tilt")
@@ -9,6 +9,7 @@
 #include "MultibandCompressor.h"
 #include "ModularSynth.h"
 #include "Profiler.h"
+#include "ScratchArena.h"
 
 MultibandCompressor::MultibandCompressor()
 : IAudioProcessor(gBufferSize)
@@ -67,19 +68,21 @@ void MultibandCompressor::Process(double time)
    {
       Clear(mOutBuffer, bufferSize);
       
-      for (int i=0; i<bufferSize; ++i)
+      ScratchArena::Scope scratch;
+      float* highLeftover = scratch.Alloc(bufferSize);
+      float* peaks = scratch.Alloc(bufferSize);
+      BufferCopy(highLeftover, GetBuffer()->GetChannel(0), bufferSize);
+      
+      //each band splits off the bottom of what the band before it left over, so they have to go in order,
+      //but each one can get through the whole block at once
+      for (int j=0; j<mNumBands; ++j)
       {
-         float lower;
-         float highLeftover = GetBuffer()->GetChannel(0)[i];
-         for (int j=0; j<mNumBands; ++j)
-         {
-            mFilters[j].ProcessSample(highLeftover, lower, highLeftover);
-            mPeaks[j].Process(&lower, 1);
-            float compress = ofClamp(1/mPeaks[i].GetPeak(), 0, 10);
-            mOutBuffer[i] += lower * compress;
-         }
-         mOutBuffer[i] += highLeftover;
+         mFilters[j].Process(highLeftover, mWorkBuffer, highLeftover, bufferSize);
+         mPeaks[j].Process(mWorkBuffer, bufferSize, peaks);
+         for (int i=0; i<bufferSize; ++i)
+            mOutBuffer[i] += mWorkBuffer[i] * ofClamp(1/peaks[i], 0, 10);
       }
+      Add(mOutBuffer, highLeftover, bufferSize);
       
       /*for (int i=0; i<mNumBands; ++i)
       {
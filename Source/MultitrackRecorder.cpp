@@ -34,17 +34,14 @@ MultitrackRecorder::MultitrackRecorder()
 , mSelectedMeasureStart(-1)
 , mSelectedMeasureEnd(-1)
 , mMergeBufferIdx(-1)
-, mUndoBuffer(nullptr)
 , mUndoRecordButton(nullptr)
 {
    TheMultitrackRecorder = this;
    
-   mMeasurePos = new float[mRecordingLength];
-   bzero(mMeasurePos, sizeof(float)*mRecordingLength);
+   mStore.Poll(mRecordingLength);
+   mMeasurePos = mStore.CreateChannel();
    AddRecordBuffer();
    
-   mUndoBuffer = new RecordBuffer(mRecordingLength);
-   
    for (int i=0; i<NUM_CLIP_ARRANGERS; ++i)
       AddChild(&mClipArranger[i]);
 }
@@ -65,12 +62,10 @@ void MultitrackRecorder::CreateUIControls()
 
 MultitrackRecorder::~MultitrackRecorder()
 {
-   TheMultitrackRecorder = nullptr;
-   
    for (int i=0; i<mRecordBuffers.size(); ++i)
-      delete mRecordBuffers[i];
+      delete mRecordBuffers[i];   //before clearing TheMultitrackRecorder, they hand their channels back through it
    
-   delete mUndoBuffer;
+   TheMultitrackRecorder = nullptr;
 }
 
 void MultitrackRecorder::Poll()
@@ -86,38 +81,17 @@ void MultitrackRecorder::Poll()
    if (mRecording &&
        ArrangementMaster::mPlayhead > mRecordingLength - reallocDist)  //we're a second from the end
    {
-      int newChunk = RECORD_CHUNK_SIZE;
-      int newLength = mRecordingLength + newChunk;
-      
-      float* newLeft = new float[newLength];
-      float* newRight = new float[newLength];
-      float* newMeasurePos = new float[newLength];
-      float* oldLeft = mRecordBuffers[mRecordIdx]->mLeft;
-      float* oldRight = mRecordBuffers[mRecordIdx]->mRight;
-      float* oldMeasurePos = mMeasurePos;
-      
-      BufferCopy(newLeft, oldLeft, mRecordingLength-reallocDist);
-      BufferCopy(newRight, oldRight, mRecordingLength-reallocDist);
-      BufferCopy(newMeasurePos, mMeasurePos, mRecordingLength-reallocDist);
-      Clear(newLeft+mRecordingLength, newChunk);
-      Clear(newRight+mRecordingLength, newChunk);
-      Clear(newMeasurePos+mRecordingLength, newChunk);
+      //growing is just bookkeeping now, the store hands out chunks as the recording reaches them
+      int newLength = mRecordingLength + RECORD_CHUNK_SIZE;
+      mStore.Poll(newLength);
       
       mMutex.Lock("main thread");
-      BufferCopy(newLeft+(mRecordingLength-reallocDist), oldLeft+(mRecordingLength-reallocDist), reallocDist);
-      BufferCopy(newRight+(mRecordingLength-reallocDist), oldRight+(mRecordingLength-reallocDist), reallocDist);
-      BufferCopy(newMeasurePos+(mRecordingLength-reallocDist), mMeasurePos+(mRecordingLength-reallocDist), reallocDist);
-      mRecordBuffers[mRecordIdx]->mLeft = newLeft;
-      mRecordBuffers[mRecordIdx]->mRight = newRight;
       mRecordBuffers[mRecordIdx]->mLength = newLength;
-      mMeasurePos = newMeasurePos;
       mRecordingLength = newLength;
       mMutex.Unlock();
-      
-      delete[] oldLeft;
-      delete[] oldRight;
-      delete[] oldMeasurePos;
    }
+   
+   mStore.Poll(mRecordingLength);
 }
 
 void MultitrackRecorder::Process(double time, float* left, float* right, int bufferSize)
@@ -131,6 +105,8 @@ void MultitrackRecorder::Process(double time, float* left, float* right, int buf
    
    mMutex.Lock("audio thread");
    
+   mStore.Update(ArrangementMaster::mPlayhead);
+   
    if (mRecording || ArrangementMaster::mPlay)
    {
       for (int i=0; i<bufferSize; ++i)
@@ -144,8 +120,8 @@ void MultitrackRecorder::Process(double time, float* left, float* right, int buf
          
          if (mRecording)
          {
-            mRecordBuffers[recordIdx]->mLeft[ArrangementMaster::mPlayhead] = left[i];
-            mRecordBuffers[recordIdx]->mRight[ArrangementMaster::mPlayhead] = right[i];
+            mRecordBuffers[recordIdx]->mLeft->Write(ArrangementMaster::mPlayhead, left[i]);
+            mRecordBuffers[recordIdx]->mRight->Write(ArrangementMaster::mPlayhead, right[i]);
          }
          
          for (int j=0; j<mRecordBuffers.size(); ++j)
@@ -155,8 +131,8 @@ void MultitrackRecorder::Process(double time, float* left, float* right, int buf
                 ArrangementMaster::mPlayhead < mRecordBuffers[j]->mLength)
             {
                float volSq = mRecordBuffers[j]->mControls.mVol * mRecordBuffers[j]->mControls.mVol;
-               left[i] += mRecordBuffers[j]->mLeft[ArrangementMaster::mPlayhead] * volSq;
-               right[i] += mRecordBuffers[j]->mRight[ArrangementMaster::mPlayhead] * volSq;
+               left[i] += mRecordBuffers[j]->mLeft->Read(ArrangementMaster::mPlayhead) * volSq;
+               right[i] += mRecordBuffers[j]->mRight->Read(ArrangementMaster::mPlayhead) * volSq;
             }
          }
          
@@ -189,9 +165,9 @@ void MultitrackRecorder::DrawModule()
    for (int i=0; i<mRecordBuffers.size(); ++i)
    {
       ofPushMatrix();
-      DrawAudioBuffer(mBufferWidth * mRecordBuffers[i]->mLength/mRecordingLength,mBufferHeight*.45f,mRecordBuffers[i]->mLeft,0,mRecordBuffers[i]->mLength,ArrangementMaster::mPlayhead);
+      DrawChannel(mRecordBuffers[i]->mLeft,mBufferWidth * mRecordBuffers[i]->mLength/mRecordingLength,mBufferHeight*.45f,mRecordBuffers[i]->mLength);
       ofTranslate(0,mBufferHeight*.47f);
-      DrawAudioBuffer(mBufferWidth * mRecordBuffers[i]->mLength/mRecordingLength,mBufferHeight*.45f,mRecordBuffers[i]->mRight,0,mRecordBuffers[i]->mLength,ArrangementMaster::mPlayhead);
+      DrawChannel(mRecordBuffers[i]->mRight,mBufferWidth * mRecordBuffers[i]->mLength/mRecordingLength,mBufferHeight*.45f,mRecordBuffers[i]->mLength);
       ofTranslate(0,mBufferHeight*.53f);
       ofPopMatrix();
       
@@ -257,6 +233,50 @@ void MultitrackRecorder::DrawModule()
       mClipArranger[i].Draw();
 }
 
+//same look as DrawAudioBuffer(), but from the channel's peak summaries. most of a long recording isn't in memory.
+void MultitrackRecorder::DrawChannel(RecordingChannel* channel, float width, float height, int length)
+{
+   ofPushStyle();
+   
+   ofSetLineWidth(1);
+   ofFill();
+   ofSetColor(255,255,255,50);
+   ofRect(0, 0, width, height);
+   
+   if (length > 0)
+   {
+      float step = 3;
+      float samplesPerStep = length / width * step;
+      
+      for (float i = 0; i < width; i+=step)
+      {
+         int position = ofMap(i, 0, width, 0, length-1, true);
+         float mag = channel->GetPeak(position, MIN(position + (int)samplesPerStep + 1, length));
+         mag = sqrt(mag);
+         mag = sqrt(mag);
+         mag *= height/2;
+         if (mag > height/2)
+         {
+            ofSetColor(255,0,0);
+            mag = height/2;
+         }
+         else
+         {
+            ofSetColor(ofColor::black);
+         }
+         if (mag == 0)
+            mag = .1f;
+         ofLine(i, height/2-mag, i, height/2+mag);
+      }
+      
+      ofSetColor(0,255,0);
+      int position = ofMap(ArrangementMaster::mPlayhead, 0, length, 0, width, true);
+      ofLine(position,0,position,height);
+   }
+   
+   ofPopStyle();
+}
+
 bool MultitrackRecorder::IsRecordingStructure()
 {
    return mRecording && ArrangementMaster::mPlayhead > mMaxRecordedLength;
@@ -264,10 +284,11 @@ bool MultitrackRecorder::IsRecordingStructure()
 
 void MultitrackRecorder::RecordStructure(int offset)
 {
-   mMeasurePos[ArrangementMaster::mPlayhead] = TheTransport->GetMeasurePos(gTime + offset * gInvSampleRateMs);
+   float measurePos = TheTransport->GetMeasurePos(gTime + offset * gInvSampleRateMs);
+   mMeasurePos->Write(ArrangementMaster::mPlayhead, measurePos);
    mMaxRecordedLength = MAX(ArrangementMaster::mPlayhead, mMaxRecordedLength);
    
-   if (ArrangementMaster::mPlayhead == 0 || mMeasurePos[ArrangementMaster::mPlayhead-1] > mMeasurePos[ArrangementMaster::mPlayhead])
+   if (ArrangementMaster::mPlayhead == 0 || mMeasurePos->Read(ArrangementMaster::mPlayhead-1) > measurePos)
    {
       mMeasures[mNumMeasures] = ArrangementMaster::mPlayhead;
       ++mNumMeasures;
@@ -310,8 +331,9 @@ void MultitrackRecorder::RecordStructure(int offset)
 
 void MultitrackRecorder::ApplyStructure()
 {
-   if (mMeasurePos[ArrangementMaster::mPlayhead] != 0)
-      TheTransport->SetMeasurePos(mMeasurePos[ArrangementMaster::mPlayhead]);
+   float measurePos = mMeasurePos->Read(ArrangementMaster::mPlayhead);
+   if (measurePos != 0)
+      TheTransport->SetMeasurePos(measurePos);
    
    if (mStructureInfoPoints.empty())
       return;
@@ -387,16 +409,13 @@ void MultitrackRecorder::FilesDropped(vector<string> files, int x, int y)
       sample.Read(files[0].c_str());
       
       mRecordingLength = sample.LengthInSamples();
+      mStore.Poll(mRecordingLength);
       RecordBuffer* buffer = new RecordBuffer(mRecordingLength);
       Mult(sample.Data()->GetChannel(0), .5f, mRecordingLength);
-      BufferCopy(buffer->mLeft, sample.Data()->GetChannel(0), mRecordingLength);
-      BufferCopy(buffer->mRight, sample.Data()->GetChannel(0), mRecordingLength);
+      buffer->mLeft->Write(0, mRecordingLength, sample.Data()->GetChannel(0));
+      buffer->mRight->Write(0, mRecordingLength, sample.Data()->GetChannel(0));
       mRecordBuffers.push_back(buffer);
       
-      delete[] mMeasurePos;
-      mMeasurePos = new float[mRecordingLength];
-      bzero(mMeasurePos, sizeof(float)*mRecordingLength);
-      
       mMutex.Unlock();
    }
 }
@@ -415,7 +434,11 @@ void MultitrackRecorder::ResetAll()
    for (int i=0; i<mRecordBuffers.size(); ++i)
       delete mRecordBuffers[i];
    mRecordBuffers.clear();
+   mStore.DeleteAllChannels();
+   mUndo.mValid = false;   //pointed into the old spill file
    mRecordingLength = RECORD_CHUNK_SIZE;
+   mStore.Poll(mRecordingLength);
+   mMeasurePos = mStore.CreateChannel();
    mMaxRecordedLength = -1;
    mNumMeasures = 0;
    mRecording = false;
@@ -471,8 +494,7 @@ void MultitrackRecorder::OnClicked(int x, int y, bool right)
          {
             mMutex.Lock("main thread");
             FixLengths();
-            Add(mRecordBuffers[clickedIdx]->mLeft, mRecordBuffers[mMergeBufferIdx]->mLeft, mRecordingLength);
-            Add(mRecordBuffers[clickedIdx]->mRight, mRecordBuffers[mMergeBufferIdx]->mRight, mRecordingLength);
+            MergeBuffer(mRecordBuffers[clickedIdx], mRecordBuffers[mMergeBufferIdx]);
             DeleteBuffer(mMergeBufferIdx);
             mMutex.Unlock();
          }
@@ -519,26 +541,9 @@ void MultitrackRecorder::FixLengths()
    mMutex.Lock("main thread");
    for (int i=0; i<mRecordBuffers.size(); ++i)
    {
+      //anything that was never written reads back as silence, so there's nothing to copy
       if (mRecordBuffers[i]->mLength < mRecordingLength)
-      {
-         float* newLeft = new float[mRecordingLength];
-         float* newRight = new float[mRecordingLength];
-         float* oldLeft = mRecordBuffers[i]->mLeft;
-         float* oldRight = mRecordBuffers[i]->mRight;
-         int oldLength = mRecordBuffers[i]->mLength;
-         
-         BufferCopy(newLeft, oldLeft, oldLength);
-         BufferCopy(newRight, oldRight, oldLength);
-         Clear(newLeft+oldLength, mRecordingLength-oldLength);
-         Clear(newRight+oldLength, mRecordingLength-oldLength);
-         
-         mRecordBuffers[i]->mLeft = newLeft;
-         mRecordBuffers[i]->mRight = newRight;
          mRecordBuffers[i]->mLength = mRecordingLength;
-         
-         delete[] oldLeft;
-         delete[] oldRight;
-      }
    }
    mMutex.Unlock();
 }
@@ -554,19 +559,25 @@ void MultitrackRecorder::DeleteBuffer(int idx)
    mMutex.Unlock();
 }
 
-void MultitrackRecorder::CopyRecordBufferContents(RecordBuffer* dst, RecordBuffer* src)
+void MultitrackRecorder::MergeBuffer(RecordBuffer* dst, RecordBuffer* src)
 {
-   if (dst->mLength != src->mLength)
+   //a chunk at a time, the whole thing might not fit in memory
+   const int kMergeChunk = RecordingChannel::kChunkSize;
+   vector<float> dstData(kMergeChunk);
+   vector<float> srcData(kMergeChunk);
+   RecordingChannel* dstChannels[] = { dst->mLeft, dst->mRight };
+   RecordingChannel* srcChannels[] = { src->mLeft, src->mRight };
+   for (int ch=0; ch<2; ++ch)
    {
-      delete[] dst->mLeft;
-      delete[] dst->mRight;
-      dst->mLeft = new float[src->mLength];
-      dst->mRight = new float[src->mLength];
-      dst->mLength = src->mLength;
+      for (int pos=0; pos<mRecordingLength; pos+=kMergeChunk)
+      {
+         int length = MIN(kMergeChunk, mRecordingLength - pos);
+         dstChannels[ch]->Read(pos, length, dstData.data());
+         srcChannels[ch]->Read(pos, length, srcData.data());
+         Add(dstData.data(), srcData.data(), length);
+         dstChannels[ch]->Write(pos, length, dstData.data());
+      }
    }
-   
-   BufferCopy(dst->mLeft, src->mLeft, src->mLength);
-   BufferCopy(dst->mRight, src->mRight, src->mLength);
 }
 
 void MultitrackRecorder::FloatSliderUpdated(FloatSlider* slider, float oldVal)
@@ -584,7 +595,15 @@ void MultitrackRecorder::ButtonClicked(ClickButton* button)
    if (button == mUndoRecordButton)
    {
       mRecording = false;
-      CopyRecordBufferContents(mRecordBuffers[mRecordIdx], mUndoBuffer);
+      if (mUndo.mValid)
+      {
+         mMutex.Lock("main thread");
+         RecordBuffer* buffer = mRecordBuffers[mRecordIdx];
+         buffer->mLeft->RestoreSnapshot(mUndo.mLeft);
+         buffer->mRight->RestoreSnapshot(mUndo.mRight);
+         buffer->mLength = mUndo.mLength;
+         mMutex.Unlock();
+      }
    }
 }
 
@@ -594,7 +613,13 @@ void MultitrackRecorder::CheckboxUpdated(Checkbox* checkbox)
    {
       if (mRecordIdx == 0 && ArrangementMaster::mPlayhead == 0)
          TheTransport->Reset();
-      CopyRecordBufferContents(mUndoBuffer, mRecordBuffers[mRecordIdx]);
+      mMutex.Lock("main thread");
+      RecordBuffer* buffer = mRecordBuffers[mRecordIdx];
+      buffer->mLeft->TakeSnapshot(mUndo.mLeft);
+      buffer->mRight->TakeSnapshot(mUndo.mRight);
+      mUndo.mLength = buffer->mLength;
+      mUndo.mValid = true;
+      mMutex.Unlock();
    }
 }
 
@@ -610,18 +635,16 @@ void MultitrackRecorder::SetUpFromSaveData()
 MultitrackRecorder::RecordBuffer::RecordBuffer(int length)
 : mLength(length)
 {
-   mLeft = new float[length];
-   mRight = new float[length];
-   bzero(mLeft, sizeof(float)*length);
-   bzero(mRight, sizeof(float)*length);
+   mLeft = TheMultitrackRecorder->mStore.CreateChannel();
+   mRight = TheMultitrackRecorder->mStore.CreateChannel();
    mControls.mVolSlider = new FloatSlider(TheMultitrackRecorder,"vol",0,0,90,15,&mControls.mVol,0,2);
    mControls.mMuteCheckbox = new Checkbox(TheMultitrackRecorder,"mute",0,0,&mControls.mMute);
 }
 
 MultitrackRecorder::RecordBuffer::~RecordBuffer()
 {
-   delete[] mLeft;
-   delete[] mRight;
+   TheMultitrackRecorder->mStore.DeleteChannel(mLeft);
+   TheMultitrackRecorder->mStore.DeleteChannel(mRight);
 }
 
 MultitrackRecorder::BufferControls::BufferControls()
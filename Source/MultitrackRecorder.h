@@ -19,6 +19,7 @@
 #include "Checkbox.h"
 #include "NamedMutex.h"
 #include "ClipArranger.h"
+#include "RecordingStore.h"
 
 #define RECORD_CHUNK_SIZE 10*gSampleRate
 #define MAX_NUM_MEASURES 1000
@@ -74,12 +75,21 @@ private:
       RecordBuffer(int length);
       ~RecordBuffer();
       
-      float* mLeft;
-      float* mRight;
+      RecordingChannel* mLeft;
+      RecordingChannel* mRight;
       int mLength;
       BufferControls mControls;
    };
    
+   struct UndoSnapshot
+   {
+      UndoSnapshot() : mLength(0), mValid(false) {}
+      RecordingChannel::Snapshot mLeft;
+      RecordingChannel::Snapshot mRight;
+      int mLength;
+      bool mValid;
+   };
+   
    void AddRecordBuffer();
    int GetRecordIdx();
    bool IsRecordingStructure();
@@ -88,7 +98,8 @@ private:
    void ResetAll();
    void FixLengths();
    void DeleteBuffer(int idx);
-   void CopyRecordBufferContents(RecordBuffer* dst, RecordBuffer* src);
+   void MergeBuffer(RecordBuffer* dst, RecordBuffer* src);
+   void DrawChannel(RecordingChannel* channel, float width, float height, int length);
    
    float MeasureToPos(int measure);
    int PosToMeasure(float pos);
@@ -111,10 +122,11 @@ private:
    int mNumMeasures;
    ClickButton* mUndoRecordButton;
    
+   RecordingStore mStore;
    vector<RecordBuffer*> mRecordBuffers;
-   RecordBuffer* mUndoBuffer;
+   UndoSnapshot mUndo;
    
-   float* mMeasurePos;
+   RecordingChannel* mMeasurePos;
    struct StructureInfo
    {
       int mSample;
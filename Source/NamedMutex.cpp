@@ -8,9 +8,9 @@
 
 #include "NamedMutex.h"
 
-void NamedMutex::Lock(string locker)
+void NamedMutex::Lock(const char* locker)
 {
-   if (mLocker == locker)
+   if (strcmp(mLocker.load(), locker) == 0)
    {
       ++mExtraLockCount;
       return;
@@ -19,6 +19,19 @@ void NamedMutex::Lock(string locker)
    mLocker = locker;
 }
 
+bool NamedMutex::TryLock(const char* locker)
+{
+   if (strcmp(mLocker.load(), locker) == 0)
+   {
+      ++mExtraLockCount;
+      return true;
+   }
+   if (!mMutex.tryLock())
+      return false;
+   mLocker = locker;
+   return true;
+}
+
 void NamedMutex::Unlock()
 {
    if (mExtraLockCount == 0)
@@ -32,7 +45,7 @@ void NamedMutex::Unlock()
    }
 }
 
-ScopedMutex::ScopedMutex(NamedMutex* mutex, string locker)
+ScopedMutex::ScopedMutex(NamedMutex* mutex, const char* locker)
 : mMutex(mutex)
 {
    mMutex->Lock(locker);
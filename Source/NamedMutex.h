@@ -10,23 +10,26 @@
 #define __modularSynth__NamedMutex__
 
 #include "OpenFrameworksPort.h"
+#include <atomic>
 
 class NamedMutex
 {
 public:
    NamedMutex() : mLocker("<none>"), mExtraLockCount(0) {}
-   void Lock(string locker);
+   //lockers are string literals, so the audio thread can lock without allocating
+   void Lock(const char* locker);
+   bool TryLock(const char* locker);
    void Unlock();
 private:
    ofMutex mMutex;
-   string mLocker;
+   std::atomic<const char*> mLocker;   //read by threads that don't hold the lock
    int mExtraLockCount;
 };
 
 class ScopedMutex
 {
 public:
-   ScopedMutex(NamedMutex* mutex, string locker);
+   ScopedMutex(NamedMutex* mutex, const char* locker);
    ~ScopedMutex();
 private:
    NamedMutex* mMutex;
@@ -40,6 +40,7 @@ private:
    //IDrawableModule
    void DrawModule() override;
    void DrawModuleUnclipped() override;
+   bool ShouldCullWhenOffscreen() override { return false; }   //draws connections to other modules
    void GetModuleDimensions(float& width, float& height) override;
    bool Enabled() const override { return true; }
 
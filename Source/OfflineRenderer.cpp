@@ -0,0 +1,273 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Created: 18 Oct 2026 9:20:37pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "MidiController.h"
+#include "MidiDevice.h"
+#include "Transport.h"
+#include "Profiler.h"
+
+namespace
+{
+   const double kMidiTailSeconds = 2;
+   
+   //ofToDataPath() would put relative paths under data/, but on the command line they're relative to where we ran from
+   string AbsolutePath(const juce::String& path)
+   {
+      return juce::File::getCurrentWorkingDirectory().getChildFile(path).getFullPathName().toStdString();
+   }
+}
+
+OfflineRenderer::Settings::Settings()
+: mMidiTarget("midicontroller")
+, mSeconds(0)
+, mSampleRate(44100)
+, mBufferSize(256)
+, mNumChannels(2)
+, mSeed(0)
+{
+}
+
+//static
+bool OfflineRenderer::IsRenderCommandLine(const juce::StringArray& args)
+{
+   return args.contains("--render");
+}
+
+//static
+int OfflineRenderer::RunFromCommandLine(const juce::StringArray& args)
+{
+   Settings settings;
+   string error;
+   if (!ParseCommandLine(args, settings, error))
+   {
+      ofLog() << error;
+      ofLog() << "usage: --render <state.bsk> <output.wav> [--seconds 10] [--samplerate 44100] [--buffersize 256] [--channels 2] [--midi automation.mid] [--miditarget midicontroller] [--seed 0]";
+      return 1;
+   }
+   
+   OfflineRenderer renderer(settings);
+   if (!renderer.Render(error))
+   {
+      ofLog() << "render failed: " << error;
+      return 1;
+   }
+   return 0;
+}
+
+//static
+bool OfflineRenderer::ParseCommandLine(const juce::StringArray& args, Settings& settings, string& error)
+{
+   int renderIndex = args.indexOf("--render");
+   if (renderIndex == -1 || renderIndex + 2 >= args.size())
+   {
+      error = "--render needs a state file and an output file";
+      return false;
+   }
+   settings.mStatePath = AbsolutePath(args[renderIndex + 1]);
+   settings.mOutputPath = AbsolutePath(args[renderIndex + 2]);
+   
+   for (int i=0; i<args.size(); ++i)
+   {
+      if (i >= renderIndex && i <= renderIndex + 2)
+         continue;
+      
+      if (!args[i].startsWith("--"))
+      {
+         error = "unexpected argument " + args[i].toStdString();
+         return false;
+      }
+      if (i + 1 >= args.size())
+      {
+         error = args[i].toStdString() + " needs a value";
+         return false;
+      }
+      
+      juce::String value = args[i + 1];
+      if (args[i] == "--seconds")
+         settings.mSeconds = value.getDoubleValue();
+      else if (args[i] == "--samplerate")
+         settings.mSampleRate = value.getIntValue();
+      else if (args[i] == "--buffersize")
+         settings.mBufferSize = value.getIntValue();
+      else if (args[i] == "--channels")
+         settings.mNumChannels = value.getIntValue();
+      else if (args[i] == "--midi")
+         settings.mMidiPath = AbsolutePath(value);
+      else if (args[i] == "--miditarget")
+         settings.mMidiTarget = value.toStdString();
+      else if (args[i] == "--seed")
+         settings.mSeed = value.getIntValue();
+      else
+      {
+         error = "unknown option " + args[i].toStdString();
+         return false;
+      }
+      ++i;
+   }
+   
+   if (settings.mSampleRate <= 0)
+      error = "bad sample rate";
+   else if (settings.mBufferSize <= 0 || settings.mBufferSize > kWorkBufferSize)
+      error = "buffer size has to be between 1 and " + ofToString(kWorkBufferSize);
+   else if (settings.mNumChannels <= 0 || settings.mNumChannels > MAX_OUTPUT_CHANNELS)
+      error = "channel count has to be between 1 and " + ofToString(MAX_OUTPUT_CHANNELS);
+   return error.empty();
+}
+
+OfflineRenderer::OfflineRenderer(const Settings& settings)
+: mSettings(settings)
+, mNextAutomationEvent(0)
+, mMidiTarget(nullptr)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+bool OfflineRenderer::Render(string& error)
+{
+   if (!juce::File(mSettings.mStatePath).existsAsFile())
+   {
+      error = "couldn't find " + mSettings.mStatePath;
+      return false;
+   }
+   
+   mSynth.Setup(&mGlobalManagers, nullptr);
+   mSynth.SetRenderingOffline(true);   //samples in the state load synchronously
+   
+   //everything after Setup() sees our format instead of the one in userprefs
+   SetGlobalSampleRate(mSettings.mSampleRate);
+   SetGlobalBufferSize(mSettings.mBufferSize);
+   mSynth.SetIOBufferSize(mSettings.mBufferSize);
+   //so renders of the same state come out the same. worker threads would call ofRandom() in whatever order they get scheduled
+   srand(mSettings.mSeed);
+   mSynth.SetNumAudioWorkerThreads(0);
+   
+   mSynth.LoadState(mSettings.mStatePath);
+   
+   if (!LoadAutomation(error))
+      return false;
+   
+   double seconds = mSettings.mSeconds;
+   if (seconds <= 0)
+      seconds = mAutomation.getNumEvents() > 0 ? mAutomation.getEndTime() + kMidiTailSeconds : 10;
+   juce::int64 totalSamples = juce::int64(seconds * gSampleRate);
+   
+   juce::File outputFile(mSettings.mOutputPath);
+   outputFile.deleteFile();
+   std::unique_ptr<juce::FileOutputStream> outputStream(outputFile.createOutputStream());
+   if (outputStream == nullptr)
+   {
+      error = "couldn't write to " + mSettings.mOutputPath;
+      return false;
+   }
+   juce::WavAudioFormat wavFormat;
+   std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream.get(), gSampleRate, mSettings.mNumChannels, 24, juce::StringPairArray(), 0));
+   if (writer == nullptr)
+   {
+      error = "couldn't create a wav writer for " + mSettings.mOutputPath;
+      return false;
+   }
+   outputStream.release();   //the writer owns it now
+   
+   ofLog() << "rendering " << seconds << "s of " << mSettings.mStatePath << " at " << gSampleRate << "Hz, " << gBufferSize << " sample blocks";
+   
+   juce::AudioSampleBuffer block(mSettings.mNumChannels, gBufferSize);
+   int numCallbacksBefore, numMissesBefore;
+   long worstNanoseconds;
+   Profiler::GetDeadlineStats(numCallbacksBefore, numMissesBefore, worstNanoseconds);
+   double startMs = juce::Time::getMillisecondCounterHiRes();
+   int lastReportedPercent = 0;
+   
+   for (juce::int64 rendered = 0; rendered < totalSamples; rendered += gBufferSize)
+   {
+      DispatchAutomation(rendered);
+      
+      block.clear();
+      mSynth.AudioOut(block.getArrayOfWritePointers(), gBufferSize, mSettings.mNumChannels);
+      writer->writeFromAudioSampleBuffer(block, 0, (int)MIN(juce::int64(gBufferSize), totalSamples - rendered));
+      
+      //the ui thread's housekeeping: reclaiming retired graphs and buffers, refilling pools, publishing listener changes
+      mSynth.Poll();
+      
+      int percent = int((rendered + gBufferSize) * 100 / totalSamples);
+      if (percent / 10 > lastReportedPercent / 10)
+      {
+         ofLog() << MIN(percent, 100) << "%";
+         lastReportedPercent = percent;
+      }
+   }
+   writer.reset();
+   
+   double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000;
+   int numCallbacks, numMisses;
+   Profiler::GetDeadlineStats(numCallbacks, numMisses, worstNanoseconds);
+   ofLog() << "rendered " << seconds << "s in " << elapsedSeconds << "s (" << seconds / MAX(elapsedSeconds, .001) << "x realtime), "
+           << (numMisses - numMissesBefore) << " of " << (numCallbacks - numCallbacksBefore) << " blocks over the realtime deadline, slowest " << worstNanoseconds / 1000 << "us";
+   ofLog() << "wrote " << mSettings.mOutputPath;
+   return true;
+}
+
+bool OfflineRenderer::LoadAutomation(string& error)
+{
+   if (mSettings.mMidiPath.empty())
+      return true;
+   
+   juce::FileInputStream stream(juce::File(mSettings.mMidiPath));
+   juce::MidiFile midiFile;
+   if (!stream.openedOk() || !midiFile.readFrom(stream))
+   {
+      error = "couldn't read midi file " + mSettings.mMidiPath;
+      return false;
+   }
+   midiFile.convertTimestampTicksToSeconds();
+   for (int i=0; i<midiFile.getNumTracks(); ++i)
+      mAutomation.addSequence(*midiFile.getTrack(i), 0);
+   mAutomation.sort();
+   
+   mMidiTarget = mSynth.FindMidiController(mSettings.mMidiTarget, false);
+   if (mMidiTarget == nullptr)
+      ofLog() << "no midicontroller named " << mSettings.mMidiTarget << " in the state, only using tempo and time signature events";
+   
+   return true;
+}
+
+void OfflineRenderer::DispatchAutomation(juce::int64 blockStart)
+{
+   //sends everything due in the block starting at sample blockStart. midicontrollers get the exact time each
+   //message is due, so it lands on the same sample no matter how fast we render.
+   double blockStartSeconds = blockStart / double(gSampleRate);
+   double untilSeconds = (blockStart + gBufferSize) / double(gSampleRate);
+   double blockStartTime = gTime + gBufferSize * gInvSampleRateMs;   //what gTime will be during the block
+   for (; mNextAutomationEvent < mAutomation.getNumEvents(); ++mNextAutomationEvent)
+   {
+      const juce::MidiMessage& message = mAutomation.getEventPointer(mNextAutomationEvent)->message;
+      if (message.getTimeStamp() >= untilSeconds)
+         break;
+      
+      int timeSigTop, timeSigBottom;
+      if (message.isTempoMetaEvent())
+      {
+         TheTransport->SetTempo(float(60 / message.getTempoSecondsPerQuarterNote()));
+      }
+      else if (message.isTimeSignatureMetaEvent())
+      {
+         message.getTimeSignatureInfo(timeSigTop, timeSigBottom);
+         TheTransport->SetTimeSignature(timeSigTop, timeSigBottom);
+      }
+      else if (!message.isMetaEvent() && mMidiTarget != nullptr)
+      {
+         double time = blockStartTime + (message.getTimeStamp() - blockStartSeconds) * 1000;
+         MidiDevice::SendMidiMessage(mMidiTarget, "offline render", message, time);
+      }
+   }
+}
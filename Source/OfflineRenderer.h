@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Created: 18 Oct 2026 9:20:37pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include "SynthGlobals.h"
+#include "ModularSynth.h"
+
+class MidiController;
+
+//renders a saved state to a wav file as fast as the cpu allows, with no audio device and no window.
+//  BespokeSynth --render <state.bsk> <output.wav> [--seconds 10] [--samplerate 44100] [--buffersize 256]
+//               [--channels 2] [--midi automation.mid] [--miditarget midicontroller] [--seed 0]
+//tempo and time signature events in the midi file drive the transport. everything else in it is fed to the
+//named midicontroller as if it came from a device. without --seconds, it renders the midi file plus a couple
+//seconds of tail, or 10 seconds if there's no midi file.
+class OfflineRenderer
+{
+public:
+   struct Settings
+   {
+      Settings();
+      string mStatePath;
+      string mOutputPath;
+      string mMidiPath;
+      string mMidiTarget;
+      double mSeconds;   //<= 0 means work it out from the midi file
+      int mSampleRate;
+      int mBufferSize;
+      int mNumChannels;
+      int mSeed;
+   };
+
+   static bool IsRenderCommandLine(const juce::StringArray& args);
+   //returns the process exit code
+   static int RunFromCommandLine(const juce::StringArray& args);
+
+   OfflineRenderer(const Settings& settings);
+   ~OfflineRenderer();
+
+   bool Render(string& error);
+
+private:
+   static bool ParseCommandLine(const juce::StringArray& args, Settings& settings, string& error);
+   bool LoadAutomation(string& error);
+   void DispatchAutomation(juce::int64 blockStart);
+
+   Settings mSettings;
+   GlobalManagers mGlobalManagers;
+   ModularSynth mSynth;
+   juce::MidiMessageSequence mAutomation;
+   int mNextAutomationEvent;
+   MidiController* mMidiTarget;
+};
@@ -421,11 +421,15 @@ unsigned long long ofGetSystemTimeNanos()
 
 float ofGetWidth()
 {
+   if (TheSynth->GetMainComponent() == nullptr)
+      return 800;   //rendering offline, no window
    return TheSynth->GetMainComponent()->getWidth();
 }
 
 float ofGetHeight()
 {
+   if (TheSynth->GetMainComponent() == nullptr)
+      return 400;
    return TheSynth->GetMainComponent()->getHeight();
 }
 
@@ -136,6 +136,10 @@ public:
    {
       mCritSec.enter();
    }
+   bool tryLock()
+   {
+      return mCritSec.tryEnter();
+   }
    void unlock()
    {
       mCritSec.exit();
@@ -85,6 +85,7 @@ void OscController::oscMessageReceived(const OSCMessage& msg)
             control.mControl = mOscMap[i].mControl;
             control.mValue = mOscMap[i].mValue * 127;
             control.mDeviceName = "osccontroller";
+            control.mTime = -1;
             mListener->OnMidiControl(control);
          }
       }
@@ -27,6 +27,18 @@ public:
    void SetShuffle(float shuffle) { mShuffle = MIN(shuffle, .999f); }
    float GetSoften() const { return mSoften; }
    void SetSoften(float soften) { mSoften = ofClamp(soften,0,1); }
+   
+   //polynomial sin() for phases above -5pi, accurate to about 1e-6. no branches or compares, so loops over it vectorize.
+   static float FastSin(float phase)
+   {
+      const float kPi = FTWO_PI * .5f;
+      phase -= FTWO_PI * (int(phase * (1 / FTWO_PI) + 2.5f) - 2);   //wrap to [-pi, pi]
+      float t = fabsf(phase) - kPi * .5f;                         //sin(|x|) == cos(|x| - pi/2)
+      float t2 = t * t;
+      float c = 1 + t2 * (-1/2.0f + t2 * (1/24.0f + t2 * (-1/720.0f + t2 * (1/40320.0f + t2 * (-1/3628800.0f)))));
+      return copysignf(c, phase);
+   }
+   
    OscillatorType mType;
 private:
    float SawSample(float phase) const;
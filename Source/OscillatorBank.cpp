@@ -0,0 +1,341 @@
+/*
+  ==============================================================================
+
+    OscillatorBank.cpp
+    Created: 18 Oct 2026 11:52:40pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "OscillatorBank.h"
+#include "SynthGlobals.h"
+#include "FFT.h"
+#include "ScratchArena.h"
+#include "ADSR.h"
+
+namespace
+{
+   const int kFrameSize = 1024;
+   const int kHopSize = kFrameSize / 4;
+   const float kOverlapGain = float(kHopSize * 2) / kFrameSize;   //hann frames at a quarter hop sum to 2
+   const int kLobeBins = 4;   //how far each partial spreads either side of its bin
+   const int kLobeOversample = 64;
+
+   //spectrum of a zero phase hann window, scaled so an unnormalized inverse gives back the window.
+   //it's real and symmetric, so only the positive side is kept.
+   struct WindowSpectrum
+   {
+      WindowSpectrum()
+      {
+         for (int i=0; i<=kLobeBins * kLobeOversample; ++i)
+         {
+            double x = double(i) / kLobeOversample;
+            double sum = 0;
+            for (int n=-kFrameSize/2; n<kFrameSize/2; ++n)
+               sum += (.5 + .5 * cos(TWO_PI * n / kFrameSize)) * cos(TWO_PI * x * n / kFrameSize);
+            mValues[i] = float(sum / kFrameSize);
+         }
+      }
+
+      float Lookup(float binOffset) const
+      {
+         float pos = fabsf(binOffset) * kLobeOversample;
+         if (pos >= kLobeBins * kLobeOversample)
+            return 0;
+         int index = int(pos);
+         float a = pos - index;
+         return mValues[index] + a * (mValues[index+1] - mValues[index]);
+      }
+
+      float mValues[kLobeBins * kLobeOversample + 1];
+   };
+
+   const WindowSpectrum& GetWindowSpectrum()
+   {
+      static const WindowSpectrum sSpectrum;
+      return sSpectrum;
+   }
+}
+
+OscillatorBank::OscillatorBank(int maxPartials)
+: mMaxPartials(maxPartials)
+, mNumPartials(0)
+, mMode(kMode_Oscillators)
+, mEnvelopes(nullptr)
+, mEnvelopeTime(0)
+, mOverlapAddPos(0)
+, mHopCounter(0)
+{
+   mPhaseInc = new float[maxPartials];
+   mAmp = new float[maxPartials];
+   mCos = new float[maxPartials];
+   mSin = new float[maxPartials];
+   mAudible = new int[maxPartials];
+   Clear(mPhaseInc, maxPartials);
+   Clear(mAmp, maxPartials);
+   ResetPhases();
+
+   //allocated up front so switching modes never allocates
+   mPlan = FFTPlan::Get(kFrameSize);
+   mSpectrumRe = new float[kFrameSize/2+1];
+   mSpectrumIm = new float[kFrameSize/2+1];
+   mFrame = new float[kFrameSize];
+   mFFTScratch = new float[kFrameSize*2];
+   mOverlapAdd = new float[kFrameSize];
+   Clear(mOverlapAdd, kFrameSize);
+   GetWindowSpectrum();
+}
+
+OscillatorBank::~OscillatorBank()
+{
+   delete[] mPhaseInc;
+   delete[] mAmp;
+   delete[] mCos;
+   delete[] mSin;
+   delete[] mAudible;
+   delete[] mSpectrumRe;
+   delete[] mSpectrumIm;
+   delete[] mFrame;
+   delete[] mFFTScratch;
+   delete[] mOverlapAdd;
+}
+
+void OscillatorBank::SetMode(Mode mode)
+{
+   if (mode == mMode)
+      return;
+   mMode = mode;
+   Clear(mOverlapAdd, kFrameSize);
+   mOverlapAddPos = 0;
+   mHopCounter = 0;
+}
+
+double OscillatorBank::GetLatencyMs() const
+{
+   if (mMode == kMode_InverseFFT)
+      return kFrameSize / 2 * gInvSampleRateMs;   //a frame's center is half a frame past where it starts playing
+   return 0;
+}
+
+void OscillatorBank::SetPhase(int idx, float phase)
+{
+   mCos[idx] = cosf(phase);
+   mSin[idx] = sinf(phase);
+}
+
+void OscillatorBank::ResetPhases()
+{
+   for (int i=0; i<mMaxPartials; ++i)
+   {
+      mCos[i] = 1;
+      mSin[i] = 0;
+   }
+}
+
+void OscillatorBank::Process(float* out, int bufferSize)
+{
+   if (mMode == kMode_InverseFFT)
+      ProcessInverseFFT(out, bufferSize);
+   else
+      ProcessOscillators(out, bufferSize);
+}
+
+int OscillatorBank::GatherAudiblePartials()
+{
+   float limit = GetPhaseInc(gNyquistLimit);
+   int count = 0;
+   for (int i=0; i<mNumPartials; ++i)
+   {
+      if (fabsf(mPhaseInc[i]) < limit)
+         mAudible[count++] = i;
+   }
+   return count;
+}
+
+void OscillatorBank::ProcessOscillators(float* out, int bufferSize)
+{
+   int count = GatherAudiblePartials();
+   if (count == 0)
+      return;
+   int paddedCount = (count + kLanes - 1) / kLanes * kLanes;
+
+   //pack the audible partials together so every lane does useful work
+   ScratchArena::Scope scratch;
+   float* cosine = scratch.Alloc(paddedCount);
+   float* sine = scratch.Alloc(paddedCount);
+   float* rotCos = scratch.Alloc(paddedCount);
+   float* rotSin = scratch.Alloc(paddedCount);
+   float* amp = scratch.Alloc(paddedCount);
+   for (int i=0; i<paddedCount; ++i)
+   {
+      if (i < count)
+      {
+         int partial = mAudible[i];
+         cosine[i] = mCos[partial];
+         sine[i] = mSin[partial];
+         rotCos[i] = cosf(mPhaseInc[partial]);
+         rotSin[i] = sinf(mPhaseInc[partial]);
+         amp[i] = mAmp[partial];
+      }
+      else
+      {
+         cosine[i] = 1;
+         sine[i] = 0;
+         rotCos[i] = 1;
+         rotSin[i] = 0;
+         amp[i] = 0;
+      }
+   }
+
+   //a lane of partials at a time, its state held in locals across the whole block
+   float* laneSums = scratch.Alloc(bufferSize * kLanes);
+   Clear(laneSums, bufferSize * kLanes);
+   float* envelope = nullptr;
+   float* laneEnvelope = nullptr;
+   if (mEnvelopes)
+   {
+      envelope = scratch.Alloc(bufferSize);
+      laneEnvelope = scratch.Alloc(bufferSize * kLanes);
+   }
+   for (int j=0; j<paddedCount; j+=kLanes)
+   {
+      float c[kLanes], s[kLanes], rc[kLanes], rs[kLanes], a[kLanes];
+      for (int k=0; k<kLanes; ++k)
+      {
+         c[k] = cosine[j+k];
+         s[k] = sine[j+k];
+         rc[k] = rotCos[j+k];
+         rs[k] = rotSin[j+k];
+         a[k] = amp[j+k];
+      }
+      if (mEnvelopes)
+      {
+         //interleaved the same way as laneSums, so the lane's amplitudes read straight across
+         for (int k=0; k<kLanes; ++k)
+         {
+            if (j+k < count)
+               mEnvelopes[mAudible[j+k]].RenderBlock(mEnvelopeTime, envelope, bufferSize);
+            else
+               Clear(envelope, bufferSize);
+            for (int i=0; i<bufferSize; ++i)
+               laneEnvelope[i * kLanes + k] = envelope[i] * a[k];
+         }
+         for (int i=0; i<bufferSize; ++i)
+         {
+            float* sum = laneSums + i * kLanes;
+            const float* e = laneEnvelope + i * kLanes;
+            for (int k=0; k<kLanes; ++k)
+            {
+               sum[k] += s[k] * e[k];
+               float nextCos = c[k] * rc[k] - s[k] * rs[k];
+               s[k] = c[k] * rs[k] + s[k] * rc[k];
+               c[k] = nextCos;
+            }
+         }
+      }
+      else
+      {
+         for (int i=0; i<bufferSize; ++i)
+         {
+            float* sum = laneSums + i * kLanes;
+            for (int k=0; k<kLanes; ++k)
+            {
+               sum[k] += s[k] * a[k];
+               float nextCos = c[k] * rc[k] - s[k] * rs[k];
+               s[k] = c[k] * rs[k] + s[k] * rc[k];
+               c[k] = nextCos;
+            }
+         }
+      }
+      for (int k=0; k<kLanes; ++k)
+      {
+         cosine[j+k] = c[k];
+         sine[j+k] = s[k];
+      }
+   }
+   for (int i=0; i<bufferSize; ++i)
+   {
+      float total = 0;
+      for (int k=0; k<kLanes; ++k)
+         total += laneSums[i * kLanes + k];
+      out[i] += total;
+   }
+
+   //repeated rotation slowly drifts off the unit circle, pull it back in once a block
+   for (int i=0; i<count; ++i)
+   {
+      float gain = 1.5f - .5f * (cosine[i] * cosine[i] + sine[i] * sine[i]);
+      mCos[mAudible[i]] = cosine[i] * gain;
+      mSin[mAudible[i]] = sine[i] * gain;
+   }
+}
+
+void OscillatorBank::ProcessInverseFFT(float* out, int bufferSize)
+{
+   for (int i=0; i<bufferSize; ++i)
+   {
+      if (mHopCounter == 0)
+         SynthesizeFrame(mEnvelopeTime + i * gInvSampleRateMs);
+      mHopCounter = (mHopCounter + 1) % kHopSize;
+
+      out[i] += mOverlapAdd[mOverlapAddPos];
+      mOverlapAdd[mOverlapAddPos] = 0;
+      mOverlapAddPos = (mOverlapAddPos + 1) % kFrameSize;
+   }
+}
+
+void OscillatorBank::SynthesizeFrame(double envelopeTime)
+{
+   const WindowSpectrum& window = GetWindowSpectrum();
+   const int numBins = kFrameSize/2 + 1;
+   Clear(mSpectrumRe, numBins);
+   Clear(mSpectrumIm, numBins);
+
+   int count = GatherAudiblePartials();
+   for (int i=0; i<count; ++i)
+   {
+      int partial = mAudible[i];
+      float bin = mPhaseInc[partial] / TWO_PI * kFrameSize;
+      //the frame is heard GetLatencyMs() from now, along with everything else in it
+      float amp = mAmp[partial];
+      if (mEnvelopes)
+         amp *= mEnvelopes[partial].Value(envelopeTime);
+
+      //amp*sin(wn+phase) is amp*cos(wn+phase-pi/2), whose positive frequency half is amp/2*e^(i(phase-pi/2))
+      //spread over the window's main lobe around the partial's bin
+      float re = .5f * amp * mSin[partial];
+      float im = -.5f * amp * mCos[partial];
+      int first = MAX(0, (int)ceilf(bin - kLobeBins));
+      int last = MIN(numBins - 1, (int)floorf(bin + kLobeBins));
+      for (int k=first; k<=last; ++k)
+      {
+         float w = window.Lookup(k - bin);
+         mSpectrumRe[k] += re * w;
+         mSpectrumIm[k] += im * w;
+      }
+      //the negative frequency half is the conjugate, and reaches up into the lowest bins
+      for (int k=0; k<kLobeBins - bin; ++k)
+      {
+         float w = window.Lookup(k + bin);
+         mSpectrumRe[k] += re * w;
+         mSpectrumIm[k] -= im * w;
+      }
+
+      //on to the next frame's center, staying on the unit circle
+      float step = mPhaseInc[partial] * kHopSize;
+      float nextCos = mCos[partial] * cosf(step) - mSin[partial] * sinf(step);
+      float nextSin = mCos[partial] * sinf(step) + mSin[partial] * cosf(step);
+      float gain = 1.5f - .5f * (nextCos * nextCos + nextSin * nextSin);
+      mCos[partial] = nextCos * gain;
+      mSin[partial] = nextSin * gain;
+   }
+   mSpectrumIm[0] = 0;
+   mSpectrumIm[numBins-1] = 0;
+
+   mPlan->RealInverse(mSpectrumRe, mSpectrumIm, mFrame, mFFTScratch);
+
+   //the frame is zero phase, so its center is at index 0. it starts playing now and is centered half a frame from now
+   for (int i=0; i<kFrameSize; ++i)
+      mOverlapAdd[(mOverlapAddPos + i) % kFrameSize] += mFrame[(i + kFrameSize/2) % kFrameSize] * kOverlapGain;
+}
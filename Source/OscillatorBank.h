@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    OscillatorBank.h
+    Created: 18 Oct 2026 11:52:40pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+
+class FFTPlan;
+class ADSR;
+
+//a bank of sine partials for additive synthesis. partial state is kept in structure-of-arrays form, so a
+//block can step a whole lane of partials with each instruction. every partial is a recursive quadrature
+//oscillator (a rotating cos/sin pair), so there's no table lookup or phase wrapping per sample.
+//
+//for very high partial counts the bank can instead build each frame's spectrum and inverse fft it,
+//overlap-adding the frames. that costs a few bins per partial per hop instead of a multiply per partial
+//per sample, but the output comes out GetLatencyMs() late and amplitudes only update once per hop.
+class OscillatorBank
+{
+public:
+   OscillatorBank(int maxPartials);
+   ~OscillatorBank();
+
+   enum Mode
+   {
+      kMode_Oscillators,
+      kMode_InverseFFT
+   };
+
+   void SetMode(Mode mode);
+   Mode GetMode() const { return mMode; }
+   double GetLatencyMs() const;
+
+   int GetMaxPartials() const { return mMaxPartials; }
+   void SetNumPartials(int numPartials) { mNumPartials = MIN(numPartials, mMaxPartials); }
+   //phaseInc in radians per sample, see GetPhaseInc(). partials at or above the nyquist limit are skipped.
+   void SetPartial(int idx, float phaseInc, float amp) { mPhaseInc[idx] = phaseInc; mAmp[idx] = amp; }
+   //optional per partial envelopes (envelopes[idx] scales partial idx), with time being the envelope time of
+   //the next block's first sample. they're rendered a lane at a time alongside the oscillators, or looked up
+   //at each frame in inverse fft mode. nullptr for steady amplitudes.
+   void SetEnvelopes(const ::ADSR* envelopes, double time) { mEnvelopes = envelopes; mEnvelopeTime = time; }
+   //phase of the partial's next output sample in radians, or of the next frame's center in inverse fft mode
+   void SetPhase(int idx, float phase);
+   void ResetPhases();
+
+   //adds bufferSize samples of the sum of the partials into out
+   void Process(float* out, int bufferSize);
+
+   static const int kLanes = 8;   //partials stepped together, padded so every block is whole lanes
+
+private:
+   void ProcessOscillators(float* out, int bufferSize);
+   void ProcessInverseFFT(float* out, int bufferSize);
+   void SynthesizeFrame(double envelopeTime);
+   int GatherAudiblePartials();
+
+   int mMaxPartials;
+   int mNumPartials;
+   Mode mMode;
+
+   //per partial. the phase lives in mCos/mSin: the oscillators rotate them a sample at a time,
+   //the inverse fft a hop at a time
+   float* mPhaseInc;
+   float* mAmp;
+   float* mCos;
+   float* mSin;
+   int* mAudible;   //partials under nyquist this block
+   const ::ADSR* mEnvelopes;
+   double mEnvelopeTime;
+
+   //inverse fft mode
+   const FFTPlan* mPlan;
+   float* mSpectrumRe;
+   float* mSpectrumIm;
+   float* mFrame;
+   float* mFFTScratch;
+   float* mOverlapAdd;   //ring of one frame's length, read out as it's summed
+   int mOverlapAddPos;
+   int mHopCounter;
+};
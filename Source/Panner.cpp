@@ -44,11 +44,12 @@ void Panner::Process(double time)
    SyncBuffers(2);
    mWidenerBuffer.SetNumChannels(2);
    
+   ScratchArena::Scope scratch;
    float* secondChannel;
    if (GetBuffer()->NumActiveChannels() == 1)   //panning mono input
    {
-      BufferCopy(gWorkBuffer, GetBuffer()->GetChannel(0), GetBuffer()->BufferSize());
-      secondChannel = gWorkBuffer;
+      secondChannel = scratch.Alloc(GetBuffer()->BufferSize());
+      BufferCopy(secondChannel, GetBuffer()->GetChannel(0), GetBuffer()->BufferSize());
    }
    else
    {
@@ -52,6 +52,7 @@ public:
    IClickable* GetTarget() const { return mTarget; }
    ConnectionType GetConnectionType() const;
    bool IsDragging() const { return mDragging; }
+   PatchCablePos GetPatchCablePos();
    
    void Grab();
    bool IsValidTarget(IClickable* target) const;
@@ -65,7 +66,6 @@ protected:
    void OnClicked(int x, int y, bool right) override;
 private:
    void SetTarget(IClickable* target);
-   PatchCablePos GetPatchCablePos();
    bool IsOverStart(int x, int y);
    bool IsOverEnd(int x, int y);
    ofVec2f FindClosestSide(int x, int y, int w, int h, ofVec2f start, ofVec2f startDirection, ofVec2f& endDirection);
@@ -10,13 +10,13 @@
 #include "SynthGlobals.h"
 #include "Profiler.h"
 
-void PeakTracker::Process(float* buffer, int bufferSize)
+void PeakTracker::Process(const float* buffer, int bufferSize, float* peaks)
 {
    PROFILER(PeakTracker);
 
+   float scalar = GetDecayScalar();
    for (int j=0; j<bufferSize; ++j)
    {
-      float scalar = powf( 0.5f, 1.0f/(mDecayTime * gSampleRate));
       float input = fabsf(buffer[j]);
       
       if ( input >= mPeak )
@@ -33,5 +33,8 @@ void PeakTracker::Process(float* buffer, int bufferSize)
          if(mPeak < FLT_EPSILON)
             mPeak = 0.0;
       }
+
+      if (peaks)
+         peaks[j] = mPeak;
    }
 }
@@ -10,22 +10,60 @@
 #define __modularSynth__PeakTracker__
 
 #include <iostream>
+#include "SynthGlobals.h"
 
 class PeakTracker
 {
 public:
    PeakTracker() : mPeak(0), mDecayTime(.01f), mLimit(-1) {}
    
-   void Process(float* buffer, int bufferSize);
+   void Process(const float* buffer, int bufferSize) { Process(buffer, bufferSize, nullptr); }
+   void Process(const float* buffer, int bufferSize, float* peaks);   //also writes the peak after each sample
    float GetPeak() const { return mPeak; }
    void SetDecayTime(float time) { mDecayTime = time; }
    void SetLimit(float limit) { mLimit = limit; }
    void Reset() { mPeak = 0; }
    
+   //runs kCount trackers side by side over a buffer that holds a sample for each of them in turn,
+   //like the output of BiquadFilterBank::FilterLane()
+   template <int kCount>
+   static void ProcessInterleaved(PeakTracker* trackers, const float* buffer, int bufferSize);
+   
 private:
+   float GetDecayScalar() const { return powf( 0.5f, 1.0f/(mDecayTime * gSampleRate)); }
+   
    float mPeak;
    float mDecayTime;
    float mLimit;
 };
 
+template <int kCount>
+void PeakTracker::ProcessInterleaved(PeakTracker* trackers, const float* buffer, int bufferSize)
+{
+   float peak[kCount], scalar[kCount], limit[kCount];
+   for (int k=0; k<kCount; ++k)
+   {
+      peak[k] = trackers[k].mPeak;
+      scalar[k] = trackers[k].GetDecayScalar();
+      limit[k] = trackers[k].mLimit == -1 ? FLT_MAX : trackers[k].mLimit;
+   }
+   
+   //same as Process(), but picking instead of branching, so every tracker can take the same path
+   for (int i=0; i<bufferSize; ++i)
+   {
+      const float* in = buffer + i * kCount;
+      for (int k=0; k<kCount; ++k)
+      {
+         float input = fabsf(in[k]);
+         float decayed = peak[k] * scalar[k];
+         decayed = decayed < FLT_EPSILON ? 0 : decayed;
+         float risen = input < limit[k] ? input : limit[k];
+         peak[k] = input >= peak[k] ? risen : decayed;
+      }
+   }
+   
+   for (int k=0; k<kCount; ++k)
+      trackers[k].mPeak = peak[k];
+}
+
 #endif /* defined(__modularSynth__PeakTracker__) */
@@ -45,16 +45,18 @@ void PitchChorus::Process(double time)
    if (GetTarget())
    {
       Clear(mOutputBuffer, gBufferSize);
+      ScratchArena::Scope scratch;
+      float* shiftBuffer = scratch.Alloc(bufferSize);
       for (int i=0; i<kNumShifters; ++i)
       {
          if (mShifters[i].mOn || mShifters[i].mRamp.Value(time) > 0)
          {
-            BufferCopy(gWorkBuffer, GetBuffer()->GetChannel(0), bufferSize);
-            mShifters[i].mShifter.Process(gWorkBuffer, bufferSize);
+            BufferCopy(shiftBuffer, GetBuffer()->GetChannel(0), bufferSize);
+            mShifters[i].mShifter.Process(shiftBuffer, bufferSize);
             double timeCopy = time;
             for (int j=0; j<bufferSize; ++j)
             {
-               mOutputBuffer[j] += gWorkBuffer[j] * mShifters[i].mRamp.Value(timeCopy);
+               mOutputBuffer[j] += shiftBuffer[j] * mShifters[i].mRamp.Value(timeCopy);
                timeCopy += gInvSampleRateMs;
             }
          }
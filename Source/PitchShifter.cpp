@@ -22,10 +22,8 @@ PitchShifter::PitchShifter(int fftBins)
 , mLatency(0)
 , mOversampling(4)
 {
-   // Generate a window with a single raised cosine from N/4 to 3N/4
-   mWindower = new float[mFFTBins];
-   for (int i=0; i<mFFTBins; ++i)
-      mWindower[i] = -.5*cos(FTWO_PI*i/mFFTBins)+.5;
+   // Single raised cosine from N/4 to 3N/4, shared by every FFT of this size
+   mWindower = mFFT.GetHannWindow();
    mLastPhase = new float[mFFTBins/2+1];
    mSumPhase = new float[mFFTBins/2+1];
    mAnalysisMag = new float[mFFTBins];
@@ -38,7 +36,6 @@ PitchShifter::~PitchShifter()
 {
    delete[] mLastPhase;
    delete[] mSumPhase;
-   delete[] mWindower;
    delete[] mAnalysisMag;
    delete[] mAnalysisFreq;
    delete[] mSynthesisMag;
@@ -33,7 +33,7 @@ private:
    
    float* mLastPhase;
    float* mSumPhase;
-   float* mWindower;
+   const float* mWindower;
    float mRover;
    float* mAnalysisMag;
    float* mAnalysisFreq;
@@ -14,62 +14,133 @@
 #include "SampleVoice.h"
 #include "SynthGlobals.h"
 #include "Profiler.h"
+#include "Transport.h"
+#include "ScratchArena.h"
+#include "ModularSynth.h"
 
 PolyphonyMgr::PolyphonyMgr(IDrawableModule* owner)
-   : mAllowStealing(true)
-   , mLastVoice(-1)
+   : mNumAllocatedVoices(0)
+   , mVoiceType(kVoiceType_FM)
+   , mVoiceParams(nullptr)
+   , mFreeVoices(&VoiceInfo::mStateLinks)
+   , mSoundingVoices(&VoiceInfo::mSoundingLinks)
+   , mReleasedVoices(&VoiceInfo::mStateLinks)
+   , mStealPolicy(kVoiceSteal_Oldest)
+   , mAllowStealing(true)
    , mFadeOutBufferPos(0)
    , mOwner(owner)
-   , mFadeOutBuffer(kVoiceFadeSamples)
-   , mFadeOutWorkBuffer(kVoiceFadeSamples)
+   , mFadeOutBuffer(gBufferSize + kVoiceFadeSamples)   //room to start a fade anywhere in the block
    , mVoiceLimit(kNumVoices)
 {
+   for (int i=0; i<128; ++i)
+      mLastVoiceForPitch[i] = -1;
 }
 
 PolyphonyMgr::~PolyphonyMgr()
 {
-   for (int i=0; i<kNumVoices; ++i)
+   for (int i=0; i<mNumAllocatedVoices; ++i)
       delete mVoices[i].mVoice;
 }
 
 void PolyphonyMgr::Init(VoiceType type, IVoiceParams* params)
 {
-   if (type == kVoiceType_FM)
+   mVoiceType = type;
+   mVoiceParams = params;
+   AllocateVoices(kNumVoices);   //explicit voice indices go up to kNumVoices, so we always have at least that many
+}
+
+//static
+EnumMap PolyphonyMgr::GetVoiceStealMap()
+{
+   EnumMap map;
+   map["oldest"] = kVoiceSteal_Oldest;
+   map["quietest"] = kVoiceSteal_Quietest;
+   map["same pitch"] = kVoiceSteal_SamePitch;
+   return map;
+}
+
+void PolyphonyMgr::AllocateVoices(int numVoices)
+{
+   for (int i=mNumAllocatedVoices; i<numVoices; ++i)
    {
-      for (int i=0; i<kNumVoices; ++i)
-      {
+      if (mVoiceType == kVoiceType_FM)
          mVoices[i].mVoice = new FMVoice(mOwner);
-         mVoices[i].mVoice->SetVoiceParams(params);
-      }
-   }
-   else if (type == kVoiceType_Karplus)
-   {
-      for (int i=0; i<kNumVoices; ++i)
-      {
+      else if (mVoiceType == kVoiceType_Karplus)
          mVoices[i].mVoice = new KarplusStrongVoice(mOwner);
-         mVoices[i].mVoice->SetVoiceParams(params);
-      }
-   }
-   else if (type == kVoiceType_SingleOscillator)
-   {
-      for (int i=0; i<kNumVoices; ++i)
-      {
+      else if (mVoiceType == kVoiceType_SingleOscillator)
          mVoices[i].mVoice = new SingleOscillatorVoice(mOwner);
-         mVoices[i].mVoice->SetVoiceParams(params);
-      }
-   }
-   else if (type == kVoiceType_Sampler)
-   {
-      for (int i=0; i<kNumVoices; ++i)
-      {
+      else if (mVoiceType == kVoiceType_Sampler)
          mVoices[i].mVoice = new SampleVoice(mOwner);
-         mVoices[i].mVoice->SetVoiceParams(params);
-      }
+      else
+         assert(false);  //unsupported voice type
+      mVoices[i].mVoice->SetVoiceParams(mVoiceParams);
+      PushBack(mFreeVoices, i);
    }
+   mNumAllocatedVoices = MAX(mNumAllocatedVoices, numVoices);
+}
+
+void PolyphonyMgr::SetVoiceLimit(int limit)
+{
+   //called from the ui thread when save data is applied, and new voices get linked into the lists the audio thread walks
+   ScopedMutex mutex(TheSynth->GetAudioMutex(), "SetVoiceLimit()");
+   limit = ofClamp(limit, 1, kMaxPolyphony);
+   if (limit > mNumAllocatedVoices)
+      AllocateVoices(limit);
+   mVoiceLimit = limit;
+}
+
+void PolyphonyMgr::PushBack(VoiceList& list, int voiceIdx)
+{
+   VoiceLinks& links = mVoices[voiceIdx].*list.mLinks;
+   links.mPrev = list.mTail;
+   links.mNext = -1;
+   if (list.mTail != -1)
+      (mVoices[list.mTail].*list.mLinks).mNext = voiceIdx;
    else
+      list.mHead = voiceIdx;
+   list.mTail = voiceIdx;
+   ++list.mCount;
+}
+
+void PolyphonyMgr::Remove(VoiceList& list, int voiceIdx)
+{
+   VoiceLinks& links = mVoices[voiceIdx].*list.mLinks;
+   if (links.mPrev != -1)
+      (mVoices[links.mPrev].*list.mLinks).mNext = links.mNext;
+   else
+      list.mHead = links.mNext;
+   if (links.mNext != -1)
+      (mVoices[links.mNext].*list.mLinks).mPrev = links.mPrev;
+   else
+      list.mTail = links.mPrev;
+   links.mPrev = -1;
+   links.mNext = -1;
+   --list.mCount;
+}
+
+int PolyphonyMgr::ChooseVoiceToSteal(int pitch) const
+{
+   if (mStealPolicy == kVoiceSteal_SamePitch)
    {
-      assert(false);  //unsupported voice type
+      int voiceIdx = mLastVoiceForPitch[pitch];
+      if (voiceIdx != -1 && mVoices[voiceIdx].mPitch == pitch)
+         return voiceIdx;
    }
+   
+   if (mStealPolicy != kVoiceSteal_Oldest && mReleasedVoices.mHead != -1)
+      return mReleasedVoices.mHead;  //released the longest ago, so it's the furthest into its release
+   
+   return mSoundingVoices.mHead;
+}
+
+void PolyphonyMgr::FreeVoice(int voiceIdx)
+{
+   Remove(mSoundingVoices, voiceIdx);
+   if (!mVoices[voiceIdx].mNoteOn)
+      Remove(mReleasedVoices, voiceIdx);
+   mVoices[voiceIdx].mPitch = -1;
+   mVoices[voiceIdx].mNoteOn = false;
+   PushBack(mFreeVoices, voiceIdx);  //to the back, so the voices that finished longest ago get reused first
 }
 
 void PolyphonyMgr::Start(double time, int pitch, float amount, int voiceIdx, ModulationParameters modulation)
@@ -94,53 +165,38 @@ void PolyphonyMgr::Start(double time, int pitch, float amount, int voiceIdx, Mod
       }
    }*/
    
-   if (voiceIdx == -1) //need a new voice
-   {
-      for (int i=0; i<mVoiceLimit; ++i)
-      {
-         int check = (i + mLastVoice + 1) % mVoiceLimit;  //try to keep incrementing through list to allow old voices to finish
-         if (mVoices[check].mPitch == -1)
-         {
-            voiceIdx = check;
-            break;
-         }
-      }
-   }
+   int pitchIdx = ofClamp(pitch, 0, 127);
+   
+   if (voiceIdx == -1 && mSoundingVoices.mCount < mVoiceLimit) //need a new voice
+      voiceIdx = mFreeVoices.mHead;
 
    if (voiceIdx == -1)   //all used
    {
       if (mAllowStealing)
-      {
-         double oldest = mVoices[0].mTime;
-         int oldestIndex = 0;
-         for (int i=1; i<mVoiceLimit; ++i)
-         {
-            if (mVoices[i].mTime < oldest)
-            {
-               oldest = mVoices[i].mTime;
-               oldestIndex = i;
-            }
-         }
-         voiceIdx = oldestIndex;
-      }
-      else
-      {
+         voiceIdx = ChooseVoiceToSteal(pitchIdx);
+      if (voiceIdx == -1)
          return;
-      }
    }
    
    IMidiVoice* voice = mVoices[voiceIdx].mVoice;
    assert(voice);
-   if (!voice->IsDone(time) && (!preserveVoice || modulation.pan != voice->GetPan()))
+   //a preserved voice keeps playing, so it must not be rendered here or Process would run it a second time
+   if (!preserveVoice && !voice->IsDone(time))
    {
       //ofLog() << "fading stolen voice " << voiceIdx << " at " << time;
-      mFadeOutWorkBuffer.Clear();
-      voice->Process(time, &mFadeOutWorkBuffer);
-      for (int i=0; i<kVoiceFadeSamples; ++i)
+      //the old note keeps playing right up to the sample the new one starts on, then fades from there
+      int startOffset = Transport::GetBlockSampleOffset(time);
+      int fadeEnd = startOffset + kVoiceFadeSamples;
+      ScratchArena::Scope scratch;
+      ChannelBuffer fadeRender(scratch, fadeEnd);
+      fadeRender.SetNumActiveChannels(mFadeOutBuffer.NumActiveChannels());
+      fadeRender.Clear();
+      voice->Process(gTime, &fadeRender);
+      for (int i=0; i<fadeEnd; ++i)
       {
-         float fade = 1 - (float(i) / kVoiceFadeSamples);
+         float fade = i < startOffset ? 1 : 1 - (float(i - startOffset) / kVoiceFadeSamples);
          for (int ch=0; ch<mFadeOutBuffer.NumActiveChannels(); ++ch)
-            mFadeOutBuffer.GetChannel(ch)[(i+mFadeOutBufferPos) % kVoiceFadeSamples] += mFadeOutWorkBuffer.GetChannel(ch)[i] * fade;
+            mFadeOutBuffer.GetChannel(ch)[(i+mFadeOutBufferPos) % mFadeOutBuffer.BufferSize()] += fadeRender.GetChannel(ch)[i] * fade;
       }
    }
    if (!preserveVoice)
@@ -149,7 +205,19 @@ void PolyphonyMgr::Start(double time, int pitch, float amount, int voiceIdx, Mod
    voice->SetModulators(modulation);
    voice->Start(time, amount);
    voice->SetPan(modulation.pan);
-   mLastVoice = voiceIdx;
+   
+   if (mVoices[voiceIdx].mPitch == -1)
+   {
+      Remove(mFreeVoices, voiceIdx);
+   }
+   else
+   {
+      Remove(mSoundingVoices, voiceIdx);
+      if (!mVoices[voiceIdx].mNoteOn)
+         Remove(mReleasedVoices, voiceIdx);
+   }
+   PushBack(mSoundingVoices, voiceIdx);
+   mLastVoiceForPitch[pitchIdx] = voiceIdx;
    
    mVoices[voiceIdx].mPitch = pitch;
    mVoices[voiceIdx].mTime = time;
@@ -158,23 +226,23 @@ void PolyphonyMgr::Start(double time, int pitch, float amount, int voiceIdx, Mod
 
 void PolyphonyMgr::Stop(double time, int pitch)
 {
-   for (int i=0; i<kNumVoices; ++i)
+   for (int i=mSoundingVoices.mHead; i != -1; i = mVoices[i].mSoundingLinks.mNext)
    {
       if (mVoices[i].mPitch == pitch && mVoices[i].mNoteOn)
       {
          mVoices[i].mVoice->Stop(time);
          mVoices[i].mNoteOn = false;
+         PushBack(mReleasedVoices, i);
       }
    }
 }
 
 void PolyphonyMgr::KillAll()
 {
-   for (int i = 0; i < kNumVoices; ++i)
-   {
+   for (int i=0; i<mNumAllocatedVoices; ++i)
       mVoices[i].mVoice->ClearVoice();
-      mVoices[i].mNoteOn = false;
-   }
+   while (mSoundingVoices.mHead != -1)
+      FreeVoice(mSoundingVoices.mHead);
 }
 
 void PolyphonyMgr::Process(double time, ChannelBuffer* out, int bufferSize)
@@ -182,21 +250,23 @@ void PolyphonyMgr::Process(double time, ChannelBuffer* out, int bufferSize)
    PROFILER(PolyphonyMgr);
    
    mFadeOutBuffer.SetNumActiveChannels(out->NumActiveChannels());
-   mFadeOutWorkBuffer.SetNumActiveChannels(out->NumActiveChannels());
 
-   for (int i=0; i<mVoiceLimit; ++i)
+   //free voices are silent, so the cost here follows the number of notes sounding rather than the pool size
+   for (int i=mSoundingVoices.mHead; i != -1; )
    {
+      int next = mVoices[i].mSoundingLinks.mNext;
       mVoices[i].mVoice->Process(time, out);
       
-      if (mVoices[i].mPitch != -1 && !mVoices[i].mNoteOn && mVoices[i].mVoice->IsDone(time))
-         mVoices[i].mPitch = -1;
+      if (!mVoices[i].mNoteOn && mVoices[i].mVoice->IsDone(time))
+         FreeVoice(i);
+      i = next;
    }
    
    for (int ch=0; ch<out->NumActiveChannels(); ++ch)
    {
       for (int i=0; i<bufferSize; ++i)
       {
-         int fadeOutIdx = (i+mFadeOutBufferPos) % kVoiceFadeSamples;
+         int fadeOutIdx = (i+mFadeOutBufferPos) % mFadeOutBuffer.BufferSize();
          out->GetChannel(ch)[i] += mFadeOutBuffer.GetChannel(ch)[fadeOutIdx];
          mFadeOutBuffer.GetChannel(ch)[fadeOutIdx] = 0;
       }
@@ -210,7 +280,7 @@ void PolyphonyMgr::DrawDebug(float x, float y)
    ofPushMatrix();
    ofPushStyle();
    ofTranslate(x,y);
-   for (int i=0; i<kNumVoices; ++i)
+   for (int i=0; i<mNumAllocatedVoices; ++i)
    {
       if (mVoices[i].mPitch == -1)
          ofSetColor(100, 100, 100);
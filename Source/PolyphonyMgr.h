@@ -15,6 +15,7 @@
 #include "ChannelBuffer.h"
 
 const int kVoiceFadeSamples = 50;
+const int kMaxPolyphony = 128;
 
 class IMidiVoice;
 class IVoiceParams;
@@ -29,14 +30,40 @@ enum VoiceType
    kVoiceType_Sampler
 };
 
+enum VoiceStealPolicy
+{
+   kVoiceSteal_Oldest,
+   kVoiceSteal_Quietest,   //released voices before held ones, they're already fading out
+   kVoiceSteal_SamePitch   //retrigger a voice already playing this pitch, otherwise quietest
+};
+
+struct VoiceLinks
+{
+   VoiceLinks() : mPrev(-1), mNext(-1) {}
+   int mPrev;
+   int mNext;
+};
+
 struct VoiceInfo
 {
-   VoiceInfo() : mPitch(-1), mNoteOn(false) {}
+   VoiceInfo() : mPitch(-1), mVoice(nullptr), mTime(0), mNoteOn(false) {}
    
    float mPitch;
    IMidiVoice* mVoice;
    double mTime;
    bool mNoteOn;
+   VoiceLinks mSoundingLinks;   //sounding voices, oldest first
+   VoiceLinks mStateLinks;      //free or released voices, whichever the voice is
+};
+
+//doubly linked list threaded through the voice array by index, so moving voices around never allocates
+struct VoiceList
+{
+   VoiceList(VoiceLinks VoiceInfo::* links) : mHead(-1), mTail(-1), mCount(0), mLinks(links) {}
+   int mHead;
+   int mTail;
+   int mCount;
+   VoiceLinks VoiceInfo::* mLinks;
 };
 
 class PolyphonyMgr
@@ -47,20 +74,34 @@ public:
    
    void Init(VoiceType type,
              IVoiceParams* mVoiceParams);
+   static EnumMap GetVoiceStealMap();
    
    void Start(double time, int pitch, float amount, int voiceIdx, ModulationParameters modulation);
    void Stop(double time, int pitch);
    void Process(double time, ChannelBuffer* out, int bufferSize);
    void DrawDebug(float x, float y);
-   void SetVoiceLimit(int limit) { mVoiceLimit = limit; }
+   //grows the voice pool if needed, call with the audio mutex held (loading does)
+   void SetVoiceLimit(int limit);
+   void SetStealPolicy(VoiceStealPolicy policy) { mStealPolicy = policy; }
    void KillAll();
 private:
-   VoiceInfo mVoices[kNumVoices];
+   void AllocateVoices(int numVoices);
+   int ChooseVoiceToSteal(int pitch) const;
+   void PushBack(VoiceList& list, int voiceIdx);
+   void Remove(VoiceList& list, int voiceIdx);
+   void FreeVoice(int voiceIdx);
+   
+   VoiceInfo mVoices[kMaxPolyphony];
+   int mNumAllocatedVoices;
+   VoiceType mVoiceType;
+   IVoiceParams* mVoiceParams;
+   VoiceList mFreeVoices;
+   VoiceList mSoundingVoices;
+   VoiceList mReleasedVoices;
+   int mLastVoiceForPitch[128];
+   VoiceStealPolicy mStealPolicy;
    bool mAllowStealing;
-   int mLastVoice;
    ChannelBuffer mFadeOutBuffer;
-   ChannelBuffer mFadeOutWorkBuffer;
-   float mWorkBuffer[2048];
    int mFadeOutBufferPos;
    IDrawableModule* mOwner;
    int mVoiceLimit;
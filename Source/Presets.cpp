@@ -155,11 +155,11 @@ void Presets::SetPreset(int idx)
       mBlendRamps.clear();
    }
    
-   const PresetCollection& coll = mPresetCollection[idx];
-   for (std::vector<Preset>::const_iterator i=coll.mPresets.begin();
+   PresetCollection& coll = mPresetCollection[idx];
+   for (std::vector<Preset>::iterator i=coll.mPresets.begin();
         i != coll.mPresets.end(); ++i)
    {
-      IUIControl* control = TheSynth->FindUIControl(i->mControlPath);
+      IUIControl* control = TheSynth->FindUIControl(i->mControlPath, i->mControlHandle);
       if (control)
       {
          if (mBlendTime == 0 || i->mHasLFO)
@@ -486,6 +486,7 @@ vector<IUIControl*> Presets::ControlsToNotSetDuringLoadState() const
 Presets::Preset::Preset(IUIControl* control)
 {
    mControlPath = control->Path();
+   mControlHandle = IUIControl::kInvalidHandle;
    mValue = control->GetValue();
    
    FloatSlider* slider = dynamic_cast<FloatSlider*>(control);
@@ -72,10 +72,11 @@ private:
    
    struct Preset
    {
-      Preset() {}
-      Preset(string path, float val) : mControlPath(path), mValue(val), mHasLFO(false) {}
+      Preset() : mControlHandle(IUIControl::kInvalidHandle) {}
+      Preset(string path, float val) : mControlPath(path), mControlHandle(IUIControl::kInvalidHandle), mValue(val), mHasLFO(false) {}
       Preset(IUIControl* control);
       string mControlPath;
+      int mControlHandle;   //so recalling a preset doesn't have to search for every control again
       float mValue;
       bool mHasLFO;
       LFOSettings mLFOSettings;
@@ -8,13 +8,18 @@
 
 #include "Profiler.h"
 #include "SynthGlobals.h"
+#include "ModularSynth.h"
+#include "IDrawableModule.h"
 #include <time.h>
+#include <chrono>
 #if BESPOKE_WINDOWS
 #include <intrin.h>
 #endif
 
 Profiler::Cost Profiler::sCosts[];
+std::atomic<int> Profiler::sNumCosts(0);
 bool Profiler::sEnableProfiler = false;
+std::atomic<bool> Profiler::sTracing(false);
 
 namespace {
    static inline uint64_t rdtscp( uint32_t & aux )
@@ -32,61 +37,203 @@ namespace {
       return (rdx << 32) + rax;
 #endif
    }
-}
-
-Profiler::Profiler(const char* name, uint32_t hash)
-: mIndex(-1)
-{
-   if (sEnableProfiler)
+   
+   int64_t NowNanoseconds()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+   }
+   
+   const int kMaxTraceThreads = 16;
+   const int kTraceEventsPerThread = 1 << 15;
+   
+   struct TraceEvent
+   {
+      uint64_t mStart;
+      uint64_t mEnd;
+      const char* mName;   //nullptr for module events
+      IDrawableModule* mModule;
+   };
+   
+   //one per thread that has ever recorded while tracing. only its own thread writes to it,
+   //the oldest events get overwritten once it wraps.
+   struct ThreadTrace
    {
-      for (int i=0; i<PROFILER_MAX_TRACK; ++i)
+      char mThreadName[64];
+      TraceEvent mEvents[kTraceEventsPerThread];
+      std::atomic<uint64_t> mNumWritten;
+   };
+   
+   //allocated by the first StartTrace() and kept for the life of the app, so a thread can hold on to its slot
+   ThreadTrace* sThreadTraces[kMaxTraceThreads];
+   std::atomic<int> sNumThreadTraces(0);
+   thread_local int sThreadTraceSlot = -1;
+   
+   uint64_t sTraceStartTicks = 0;
+   int64_t sTraceStartNanoseconds = 0;
+   
+   std::atomic<int> sNumCallbacks(0);
+   std::atomic<int> sNumDeadlineMisses(0);
+   std::atomic<long> sWorstCallbackNanoseconds(0);
+   
+   juce::SpinLock sRegisterLock;
+   
+   ThreadTrace* GetThreadTrace()
+   {
+      if (sThreadTraceSlot == -1)
       {
-         if (sCosts[i].mHash == hash)
-         {
-            mIndex = i;
-            break;
-         }
-         if (sCosts[i].mName[0] == 0)
+         int slot = sNumThreadTraces.fetch_add(1);
+         if (slot >= kMaxTraceThreads)
          {
-            mIndex = i;
-            sCosts[i].mName = name;
-            sCosts[i].mHash = hash;
-            break;
+            sThreadTraceSlot = -2;  //out of slots, this thread doesn't get traced
+            return nullptr;
          }
+         
+         ThreadTrace* trace = sThreadTraces[slot];
+         juce::Thread* thread = juce::Thread::getCurrentThread();
+         if (thread != nullptr)
+            StringCopy(trace->mThreadName, thread->getThreadName().toRawUTF8(), sizeof(trace->mThreadName));
+         else if (juce::MessageManager::existsAndIsCurrentThread())
+            StringCopy(trace->mThreadName, "ui", sizeof(trace->mThreadName));
+         else
+            StringCopy(trace->mThreadName, "audio callback", sizeof(trace->mThreadName));
+         sThreadTraceSlot = slot;
       }
       
+      if (sThreadTraceSlot < 0)
+         return nullptr;
+      return sThreadTraces[sThreadTraceSlot];
+   }
+   
+   string EscapeJson(const string& str)
+   {
+      string escaped;
+      for (char c : str)
+      {
+         if (c == '"' || c == '\\')
+            escaped += '\\';
+         if ((unsigned char)c >= ' ')
+            escaped += c;
+      }
+      return escaped;
+   }
+}
+
+Profiler::Profiler(const char* name, int index)
+: mIndex(index)
+{
+   if ((sEnableProfiler || IsTracing()) && mIndex != -1)
+   {
       uint32_t aux;
       mTimerStart = rdtscp(aux);
-
-      //struct timespec t;
-      //clock_gettime(CLOCK_MONOTONIC, &t);
-      //mTimerStart = t.tv_sec * 1000000000 + t.tv_nsec;
+   }
+   else
+   {
+      mIndex = -1;
    }
 }
 
 Profiler::~Profiler()
 {
-   if (sEnableProfiler)
+   if (mIndex != -1)
    {
       uint32_t aux;
-      sCosts[mIndex].mFrameCost += rdtscp(aux) - mTimerStart;
-      
-      //struct timespec t;
-      //clock_gettime(CLOCK_MONOTONIC, &t);
-      //unsigned long long timerEnd = t.tv_sec * 1000000000 + t.tv_nsec;
+      uint64_t timerEnd = rdtscp(aux);
+      if (sEnableProfiler)
+         sCosts[mIndex].mFrameCost.fetch_add(timerEnd - mTimerStart, std::memory_order_relaxed);
+      RecordEvent(sCosts[mIndex].mName, nullptr, mTimerStart, timerEnd);
+   }
+}
+
+Profiler::ModuleScope::ModuleScope(IDrawableModule* module)
+: mModule(IsTracing() ? module : nullptr)
+{
+   if (mModule != nullptr)
+   {
+      uint32_t aux;
+      mTimerStart = rdtscp(aux);
+   }
+}
+
+Profiler::ModuleScope::~ModuleScope()
+{
+   if (mModule != nullptr)
+   {
+      uint32_t aux;
+      RecordEvent(nullptr, mModule, mTimerStart, rdtscp(aux));
+   }
+}
+
+Profiler::CallbackScope::CallbackScope()
+: mStartNanoseconds(NowNanoseconds())
+{
+   uint32_t aux;
+   mTimerStart = rdtscp(aux);
+}
+
+Profiler::CallbackScope::~CallbackScope()
+{
+   uint32_t aux;
+   uint64_t timerEnd = rdtscp(aux);
+   long elapsed = long(NowNanoseconds() - mStartNanoseconds);
    
-      //sCosts[mIndex].mFrameCost += timerEnd - mTimerStart;
+   sNumCallbacks.fetch_add(1, std::memory_order_relaxed);
+   long worst = sWorstCallbackNanoseconds.load(std::memory_order_relaxed);
+   while (elapsed > worst && !sWorstCallbackNanoseconds.compare_exchange_weak(worst, elapsed, std::memory_order_relaxed))
+   {
    }
+   
+   bool missed = elapsed > GetSafeFrameLengthNanoseconds();
+   if (missed)
+      sNumDeadlineMisses.fetch_add(1, std::memory_order_relaxed);
+   RecordEvent(missed ? "audio callback (missed deadline)" : "audio callback", nullptr, mTimerStart, timerEnd);
+}
+
+//static
+int Profiler::RegisterScope(const char* name)
+{
+   const juce::SpinLock::ScopedLockType lock(sRegisterLock);
+   
+   int numCosts = sNumCosts.load(std::memory_order_relaxed);
+   for (int i=0; i<numCosts; ++i)
+   {
+      if (strcmp(sCosts[i].mName, name) == 0)
+         return i;
+   }
+   
+   if (numCosts == PROFILER_MAX_TRACK)
+      return -1;
+   
+   sCosts[numCosts].mName = name;
+   sNumCosts.store(numCosts + 1, std::memory_order_release);
+   return numCosts;
+}
+
+//static
+void Profiler::RecordEvent(const char* name, IDrawableModule* module, uint64_t start, uint64_t end)
+{
+   if (!IsTracing())
+      return;
+   
+   ThreadTrace* trace = GetThreadTrace();
+   if (trace == nullptr)
+      return;
+   
+   uint64_t index = trace->mNumWritten.load(std::memory_order_relaxed);
+   TraceEvent& event = trace->mEvents[index % kTraceEventsPerThread];
+   event.mStart = start;
+   event.mEnd = end;
+   event.mName = name;
+   event.mModule = module;
+   trace->mNumWritten.store(index + 1, std::memory_order_release);
 }
 
 //static
 void Profiler::PrintCounters()
 {
    //bool printedBreak = false;
-   for (int i=0; i<PROFILER_MAX_TRACK; ++i)
+   int numCosts = sNumCosts.load(std::memory_order_acquire);
+   for (int i=0; i<numCosts; ++i)
    {
-      if (sCosts[i].mName[0] == 0)
-         break;
       /*if (sCosts[i].mFrameCost > 500)
       {
          if (!printedBreak)
@@ -113,10 +260,17 @@ void Profiler::Draw()
    ofSetColor(0,0,0,140);
    //ofRect(-5,-15,600,sCosts.size()*15+10);
    long entireFrameUs = GetSafeFrameLengthNanoseconds();
-   for (int i=0; i<PROFILER_MAX_TRACK; ++i)
+   
+   int numCallbacks, numMisses;
+   long worstNanoseconds;
+   GetDeadlineStats(numCallbacks, numMisses, worstNanoseconds);
+   ofSetColor(numMisses > 0 ? ofColor(255,0,0) : ofColor(255,255,255));
+   gFont.DrawString("callbacks: "+ofToString(numCallbacks)+"   deadline misses: "+ofToString(numMisses)+"   worst: "+ofToString(worstNanoseconds/1000)+"/"+ofToString(entireFrameUs/1000)+" us", 15, 0, 0);
+   ofTranslate(0, 15);
+   
+   int numCosts = sNumCosts.load(std::memory_order_acquire);
+   for (int i=0; i<numCosts; ++i)
    {
-      if (sCosts[i].mName[0] == 0)
-         break;
       const Cost& cost = sCosts[i];
       long maxCost = cost.MaxCost();
       
@@ -148,8 +302,229 @@ void Profiler::ToggleProfiler()
 {
    sEnableProfiler = !sEnableProfiler;
    
-   for (int i=0; i<PROFILER_MAX_TRACK; ++i)
-      sCosts[i].mName[0] = 0;
+   //call sites keep their registered slots, just start the numbers over
+   int numCosts = sNumCosts.load(std::memory_order_acquire);
+   for (int i=0; i<numCosts; ++i)
+   {
+      sCosts[i].mFrameCost.store(0);
+      bzero(sCosts[i].mHistory, sizeof(sCosts[i].mHistory));
+   }
+   sNumCallbacks.store(0);
+   sNumDeadlineMisses.store(0);
+   sWorstCallbackNanoseconds.store(0);
+}
+
+//static
+void Profiler::GetDeadlineStats(int& numCallbacks, int& numMisses, long& worstNanoseconds)
+{
+   numCallbacks = sNumCallbacks.load(std::memory_order_relaxed);
+   numMisses = sNumDeadlineMisses.load(std::memory_order_relaxed);
+   worstNanoseconds = sWorstCallbackNanoseconds.load(std::memory_order_relaxed);
+}
+
+//static
+void Profiler::StartTrace()
+{
+   sTracing.store(false);
+   
+   if (sThreadTraces[0] == nullptr)
+   {
+      for (int i=0; i<kMaxTraceThreads; ++i)
+         sThreadTraces[i] = new ThreadTrace();
+   }
+   for (int i=0; i<kMaxTraceThreads; ++i)
+      sThreadTraces[i]->mNumWritten.store(0);
+   
+   uint32_t aux;
+   sTraceStartTicks = rdtscp(aux);
+   sTraceStartNanoseconds = NowNanoseconds();
+   
+   sTracing.store(true);
+}
+
+//static
+void Profiler::StopTrace()
+{
+   sTracing.store(false);
+}
+
+namespace
+{
+   struct ExportedEvent
+   {
+      uint64_t mStart;  //ticks since the trace started
+      uint64_t mDuration;
+      int mName;   //into the string table
+      int mDepth;
+      IDrawableModule* mModule;
+   };
+   
+   struct ExportedThread
+   {
+      string mName;
+      vector<ExportedEvent> mEvents;
+   };
+}
+
+//static
+bool Profiler::ExportTrace(const string& path)
+{
+   if (sThreadTraces[0] == nullptr)
+      return false;  //never traced
+   
+   StopTrace();
+   
+   //the rdtscp rate isn't known up front, so measure it against the steady clock over the whole trace
+   uint32_t aux;
+   uint64_t endTicks = rdtscp(aux);
+   int64_t endNanoseconds = NowNanoseconds();
+   double ticksPerMicrosecond = (endTicks - sTraceStartTicks) / MAX(1.0, (endNanoseconds - sTraceStartNanoseconds) / 1000.0);
+   
+   //recorded modules might have been deleted since, only look up the ones that are still around
+   vector<IDrawableModule*> modules;
+   TheSynth->GetAllModules(modules);
+   
+   vector<string> strings;
+   map<string, int> stringIndices;
+   auto intern = [&strings, &stringIndices](const string& str) -> int
+   {
+      auto existing = stringIndices.find(str);
+      if (existing != stringIndices.end())
+         return existing->second;
+      strings.push_back(str);
+      stringIndices[str] = (int)strings.size() - 1;
+      return (int)strings.size() - 1;
+   };
+   
+   vector<ExportedThread> threads;
+   int numThreads = MIN(sNumThreadTraces.load(), kMaxTraceThreads);
+   for (int i=0; i<numThreads; ++i)
+   {
+      const ThreadTrace* trace = sThreadTraces[i];
+      uint64_t numWritten = trace->mNumWritten.load(std::memory_order_acquire);
+      if (numWritten == 0)
+         continue;
+      
+      ExportedThread thread;
+      thread.mName = trace->mThreadName;
+      uint64_t first = numWritten > kTraceEventsPerThread ? numWritten - kTraceEventsPerThread : 0;
+      for (uint64_t j=first; j<numWritten; ++j)
+      {
+         const TraceEvent& event = trace->mEvents[j % kTraceEventsPerThread];
+         if (event.mStart < sTraceStartTicks)
+            continue;   //scope was already open when the trace started
+         
+         ExportedEvent exported;
+         exported.mStart = event.mStart - sTraceStartTicks;
+         exported.mDuration = event.mEnd - event.mStart;
+         exported.mDepth = 0;
+         exported.mModule = nullptr;
+         if (event.mModule != nullptr)
+         {
+            if (VectorContains(event.mModule, modules))
+            {
+               exported.mName = intern(event.mModule->Name());
+               exported.mModule = event.mModule;
+            }
+            else
+            {
+               exported.mName = intern("deleted module");
+            }
+         }
+         else
+         {
+            exported.mName = intern(event.mName);
+         }
+         thread.mEvents.push_back(exported);
+      }
+      
+      //a thread that was still recording while we copied might have lapped us
+      uint64_t numWrittenAfter = trace->mNumWritten.load(std::memory_order_acquire);
+      if (numWrittenAfter > kTraceEventsPerThread && numWrittenAfter - kTraceEventsPerThread > first)
+         thread.mEvents.erase(thread.mEvents.begin(), thread.mEvents.begin() + MIN(thread.mEvents.size(), size_t(numWrittenAfter - kTraceEventsPerThread - first)));
+      
+      //scopes get recorded when they close, so children come before their parents. put them back in
+      //start order and work out the nesting from which scopes are still open.
+      std::stable_sort(thread.mEvents.begin(), thread.mEvents.end(), [](const ExportedEvent& a, const ExportedEvent& b)
+      {
+         if (a.mStart != b.mStart)
+            return a.mStart < b.mStart;
+         return a.mDuration > b.mDuration;
+      });
+      vector<uint64_t> openScopeEnds;
+      for (auto& event : thread.mEvents)
+      {
+         while (!openScopeEnds.empty() && openScopeEnds.back() <= event.mStart)
+            openScopeEnds.pop_back();
+         event.mDepth = (int)openScopeEnds.size();
+         openScopeEnds.push_back(event.mStart + event.mDuration);
+      }
+      
+      threads.push_back(thread);
+   }
+   
+   juce::File file(ofToDataPath(path));
+   file.deleteFile();
+   juce::FileOutputStream stream(file);
+   if (!stream.openedOk())
+      return false;
+   
+   if (file.hasFileExtension("json"))
+   {
+      //chrome trace-event format, timestamps in microseconds
+      stream << "{\"traceEvents\":[\n";
+      bool firstEntry = true;
+      for (int i=0; i<threads.size(); ++i)
+      {
+         stream << (firstEntry ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"" << EscapeJson(threads[i].mName).c_str() << "\"}}";
+         firstEntry = false;
+         for (const auto& event : threads[i].mEvents)
+         {
+            stream << ",\n{\"name\":\"" << EscapeJson(strings[event.mName]).c_str() << "\",\"cat\":\"" << (event.mModule ? "module" : "scope") << "\",\"ph\":\"X\"";
+            stream << ",\"ts\":" << juce::String(event.mStart / ticksPerMicrosecond, 3) << ",\"dur\":" << juce::String(event.mDuration / ticksPerMicrosecond, 3);
+            stream << ",\"pid\":1,\"tid\":" << i;
+            if (event.mModule)
+               stream << ",\"args\":{\"type\":\"" << EscapeJson(event.mModule->GetTypeName()).c_str() << "\"}";
+            stream << "}";
+         }
+      }
+      stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+   }
+   else
+   {
+      //"BSPKTRC1", double ticks per microsecond,
+      //int32 string count, then per string: int32 byte length, utf8 bytes
+      //int32 thread count, then per thread: int32 name string, int32 event count, then per event:
+      //int64 start ticks, int64 duration ticks, int32 name string, int16 nesting depth, int16 flags (1 = module)
+      //all little-endian
+      stream.write("BSPKTRC1", 8);
+      stream.writeDouble(ticksPerMicrosecond);
+      for (const auto& thread : threads)
+         intern(thread.mName);
+      stream.writeInt((int)strings.size());
+      for (const auto& str : strings)
+      {
+         stream.writeInt((int)str.size());
+         stream.write(str.data(), str.size());
+      }
+      stream.writeInt((int)threads.size());
+      for (int i=0; i<threads.size(); ++i)
+      {
+         stream.writeInt(stringIndices[threads[i].mName]);
+         stream.writeInt((int)threads[i].mEvents.size());
+         for (const auto& event : threads[i].mEvents)
+         {
+            stream.writeInt64(event.mStart);
+            stream.writeInt64(event.mDuration);
+            stream.writeInt(event.mName);
+            stream.writeShort((short)MIN(event.mDepth, 32767));
+            stream.writeShort(event.mModule ? 1 : 0);
+         }
+      }
+   }
+   
+   stream.flush();
+   return stream.getStatus().wasOk();
 }
 
 void Profiler::Cost::EndFrame()
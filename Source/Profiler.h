@@ -11,44 +11,81 @@
 
 #include "OpenFrameworksPort.h"
 #include "SynthGlobals.h"
+#include <atomic>
 
-#define PROFILER_HISTORY_LENGTH 500
-#define PROFILER_MAX_TRACK 100
-
-#define PROFILER(profile_id) static uint32_t profile_id ## _hash = JenkinsHash(#profile_id); Profiler profilerScopeHolder(#profile_id, profile_id ## _hash)
+#define PROFILER_HISTORY_LENGTH 500
+#define PROFILER_MAX_TRACK 256
+
+//the scope is looked up once per call site, entering it afterwards is just a couple of timer reads
+#define PROFILER(profile_id) static int profile_id ## _index = Profiler::RegisterScope(#profile_id); Profiler profilerScopeHolder(#profile_id, profile_id ## _index)
+
+class IDrawableModule;
 
 class Profiler
 {
 public:
-   Profiler(const char* name, uint32_t hash);
+   Profiler(const char* name, int index);
    ~Profiler();
-   
+
+   //times one module instance, so traces show which module was slow and not just which code path
+   class ModuleScope
+   {
+   public:
+      ModuleScope(IDrawableModule* module);
+      ~ModuleScope();
+   private:
+      IDrawableModule* mModule;
+      uint64_t mTimerStart;
+   };
+
+   //wraps a whole audio callback and counts the ones that run past GetSafeFrameLengthNanoseconds()
+   class CallbackScope
+   {
+   public:
+      CallbackScope();
+      ~CallbackScope();
+   private:
+      int64_t mStartNanoseconds;
+      uint64_t mTimerStart;
+   };
+
+   static int RegisterScope(const char* name);
    static void PrintCounters();
    static void Draw();
-   
+
    static void ToggleProfiler();
-   
+
+   //recording is lock-free and never allocates on the threads being traced.
+   //a path ending in .json gets chrome trace-event json (chrome://tracing, perfetto), anything else the compact binary format.
+   static void StartTrace();
+   static void StopTrace();
+   static bool IsTracing() { return sTracing.load(std::memory_order_relaxed); }
+   static bool ExportTrace(const string& path);
+   static void GetDeadlineStats(int& numCallbacks, int& numMisses, long& worstNanoseconds);
+
 private:
    static long GetSafeFrameLengthNanoseconds();
-   
+   static void RecordEvent(const char* name, IDrawableModule* module, uint64_t start, uint64_t end);
+
    struct Cost
    {
-      Cost() : mFrameCost(0), mHistoryIdx(0) { bzero(mHistory, sizeof(long)); }
+      Cost() : mName(nullptr), mFrameCost(0), mHistoryIdx(0) { bzero(mHistory, sizeof(mHistory)); }
       void EndFrame();
       unsigned long long MaxCost() const;
-      
-      string mName;
-      uint32_t mHash;
-      unsigned long long mFrameCost;
+
+      const char* mName;
+      std::atomic<unsigned long long> mFrameCost;   //scopes can be entered from several audio worker threads at once
       unsigned long long mHistory[PROFILER_HISTORY_LENGTH];
       int mHistoryIdx;
    };
-   
+
    unsigned long long mTimerStart;
    int mIndex;
-   
+
    static Cost sCosts[PROFILER_MAX_TRACK];
+   static std::atomic<int> sNumCosts;
    static bool sEnableProfiler;
+   static std::atomic<bool> sTracing;
 };
 
 #endif /* defined(__modularSynth__Profiler__) */
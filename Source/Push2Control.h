@@ -53,6 +53,7 @@ private:
    //IDrawableModule
    void DrawModule() override;
    void DrawModuleUnclipped() override;
+   bool ShouldCullWhenOffscreen() override { return false; }   //outlines the module it's displaying
    void PostRender() override;
    bool Enabled() const override { return true; }
    void GetModuleDimensions(float& width, float& height) override { width = mWidth; height = mHeight; }
@@ -13,16 +13,32 @@
 #include "ModularSynth.h"
 #include "Profiler.h"
 #include "ModulationChain.h"
+#include "ScratchArena.h"
 
-namespace
+RazorVoice::RazorVoice()
+: mPitch(-1)
+, mNoteOn(false)
+, mStartTime(0)
+, mBank(NUM_PARTIALS)
+, mPitchBend(nullptr)
+, mModWheel(nullptr)
+, mPressure(nullptr)
 {
-   double sineBuffer[514]={0,0.012268,0.024536,0.036804,0.049042,0.06131,0.073547,0.085785,0.097992,0.1102,0.12241,0.13455,0.1467,0.15884,0.17093,0.18301,0.19507,0.20709,0.21909,0.23105,0.24295,0.25485,0.26669,0.2785,0.29025,0.30197,0.31366,0.32529,0.33685,0.34839,0.35986,0.37128,0.38266,0.39395,0.40521,0.41641,0.42752,0.4386,0.44958,0.46051,0.47137,0.48215,0.49286,0.50351,0.51407,0.52457,0.53497,0.54529,0.55554,0.5657,0.57578,0.58575,0.59567,0.60547,0.6152,0.62482,0.63437,0.6438,0.65314,0.66238,0.67151,0.68057,0.68951,0.69833,0.70706,0.7157,0.72421,0.7326,0.74091,0.74908,0.75717,0.76514,0.77298,0.7807,0.7883,0.79581,0.80316,0.81042,0.81754,0.82455,0.83142,0.8382,0.84482,0.85132,0.8577,0.86392,0.87006,0.87604,0.88187,0.8876,0.89319,0.89862,0.90396,0.90912,0.91415,0.91907,0.92383,0.92847,0.93295,0.93729,0.9415,0.94556,0.94949,0.95325,0.95691,0.96039,0.96375,0.96692,0.97,0.9729,0.97565,0.97827,0.98074,0.98306,0.98523,0.98724,0.98914,0.99084,0.99243,0.99387,0.99515,0.99628,0.99725,0.99808,0.99875,0.99927,0.99966,0.99988,0.99997,0.99988,0.99966,0.99927,0.99875,0.99808,0.99725,0.99628,0.99515,0.99387,0.99243,0.99084,0.98914,0.98724,0.98523,0.98306,0.98074,0.97827,0.97565,0.9729,0.97,0.96692,0.96375,0.96039,0.95691,0.95325,0.94949,0.94556,0.9415,0.93729,0.93295,0.92847,0.92383,0.91907,0.91415,0.90912,0.90396,0.89862,0.89319,0.8876,0.88187,0.87604,0.87006,0.86392,0.8577,0.85132,0.84482,0.8382,0.83142,0.82455,0.81754,0.81042,0.80316,0.79581,0.7883,0.7807,0.77298,0.76514,0.75717,0.74908,0.74091,0.7326,0.72421,0.7157,0.70706,0.69833,0.68951,0.68057,0.67151,0.66238,0.65314,0.6438,0.63437,0.62482,0.6152,0.60547,0.59567,0.58575,0.57578,0.5657,0.55554,0.54529,0.53497,0.52457,0.51407,0.50351,0.49286,0.48215,0.47137,0.46051,0.44958,0.4386,0.42752,0.41641,0.40521,0.39395,0.38266,0.37128,0.35986,0.34839,0.33685,0.32529,0.31366,0.30197,0.29025,0.2785,0.26669,0.25485,0.24295,0.23105,0.21909,0.20709,0.19507,0.18301,0.17093,0.15884,0.1467,0.13455,0.12241,0.1102,0.097992,0.085785,0.073547,0.06131,0.049042,0.036804,0.024536,0.012268,0,-0.012268,-0.024536,-0.036804,-0.049042,-0.06131,-0.073547,-0.085785,-0.097992,-0.1102,-0.12241,-0.13455,-0.1467,-0.15884,-0.17093,-0.18301,-0.19507,-0.20709,-0.21909,-0.23105,-0.24295,-0.25485,-0.26669,-0.2785,-0.29025,-0.30197,-0.31366,-0.32529,-0.33685,-0.34839,-0.35986,-0.37128,-0.38266,-0.39395,-0.40521,-0.41641,-0.42752,-0.4386,-0.44958,-0.46051,-0.47137,-0.48215,-0.49286,-0.50351,-0.51407,-0.52457,-0.53497,-0.54529,-0.55554,-0.5657,-0.57578,-0.58575,-0.59567,-0.60547,-0.6152,-0.62482,-0.63437,-0.6438,-0.65314,-0.66238,-0.67151,-0.68057,-0.68951,-0.69833,-0.70706,-0.7157,-0.72421,-0.7326,-0.74091,-0.74908,-0.75717,-0.76514,-0.77298,-0.7807,-0.7883,-0.79581,-0.80316,-0.81042,-0.81754,-0.82455,-0.83142,-0.8382,-0.84482,-0.85132,-0.8577,-0.86392,-0.87006,-0.87604,-0.88187,-0.8876,-0.89319,-0.89862,-0.90396,-0.90912,-0.91415,-0.91907,-0.92383,-0.92847,-0.93295,-0.93729,-0.9415,-0.94556,-0.94949,-0.95325,-0.95691,-0.96039,-0.96375,-0.96692,-0.97,-0.9729,-0.97565,-0.97827,-0.98074,-0.98306,-0.98523,-0.98724,-0.98914,-0.99084,-0.99243,-0.99387,-0.99515,-0.99628,-0.99725,-0.99808,-0.99875,-0.99927,-0.99966,-0.99988,-0.99997,-0.99988,-0.99966,-0.99927,-0.99875,-0.99808,-0.99725,-0.99628,-0.99515,-0.99387,-0.99243,-0.99084,-0.98914,-0.98724,-0.98523,-0.98306,-0.98074,-0.97827,-0.97565,-0.9729,-0.97,-0.96692,-0.96375,-0.96039,-0.95691,-0.95325,-0.94949,-0.94556,-0.9415,-0.93729,-0.93295,-0.92847,-0.92383,-0.91907,-0.91415,-0.90912,-0.90396,-0.89862,-0.89319,-0.8876,-0.88187,-0.87604,-0.87006,-0.86392,-0.8577,-0.85132,-0.84482,-0.8382,-0.83142,-0.82455,-0.81754,-0.81042,-0.80316,-0.79581,-0.7883,-0.7807,-0.77298,-0.76514,-0.75717,-0.74908,-0.74091,-0.7326,-0.72421,-0.7157,-0.70706,-0.69833,-0.68951,-0.68057,-0.67151,-0.66238,-0.65314,-0.6438,-0.63437,-0.62482,-0.6152,-0.60547,-0.59567,-0.58575,-0.57578,-0.5657,-0.55554,-0.54529,-0.53497,-0.52457,-0.51407,-0.50351,-0.49286,-0.48215,-0.47137,-0.46051,-0.44958,-0.4386,-0.42752,-0.41641,-0.40521,-0.39395,-0.38266,-0.37128,-0.35986,-0.34839,-0.33685,-0.32529,-0.31366,-0.30197,-0.29025,-0.2785,-0.26669,-0.25485,-0.24295,-0.23105,-0.21909,-0.20709,-0.19507,-0.18301,-0.17093,-0.15884,-0.1467,-0.13455,-0.12241,-0.1102,-0.097992,-0.085785,-0.073547,-0.06131,-0.049042,-0.036804,-0.024536,-0.012268,0,0.012268
-   };
+   bzero(mAmp, sizeof(float) * NUM_PARTIALS);
+}
+
+bool RazorVoice::IsDone(double time) const
+{
+   for (int i=0; i<NUM_PARTIALS; ++i)
+   {
+      if (!mAdsr[i].IsDone(time))
+         return false;
+   }
+   return true;
 }
 
 Razor::Razor()
-: mPitch(-1)
-, mVol(.05f)
+: mVol(.05f)
 , mUseNumPartials(NUM_PARTIALS)
 , mNumPartialsSlider(nullptr)
 , mBumpAmpSlider(nullptr)
@@ -53,13 +69,12 @@ Razor::Razor()
 , mHarshnessCutSlider(nullptr)
 , mManualControl(false)
 , mManualControlCheckbox(nullptr)
-, mPitchBend(nullptr)
-, mModWheel(nullptr)
-, mPressure(nullptr)
+, mVizVoice(0)
+, mInverseFFT(false)
+, mInverseFFTCheckbox(nullptr)
 {
    bzero(mAmp, sizeof(float) * NUM_PARTIALS);
    bzero(mPeakHistory, sizeof(float) * (VIZ_WIDTH+1) * RAZOR_HISTORY);
-   bzero(mPhases, sizeof(float) * NUM_PARTIALS);
    
    for (int i=0; i<NUM_PARTIALS; ++i)
       mDetune[i] = 1;
@@ -94,6 +109,7 @@ void Razor::CreateUIControls()
    mNegHarmonicsSlider = new IntSlider(this,"neg harmonics",335,120,160,15,&mNegHarmonics,1,10);
    mHarshnessCutSlider = new FloatSlider(this,"harshness cut",500,120,160,15,&mHarshnessCut,0,20000);
    mManualControlCheckbox = new Checkbox(this,"manual control",4,145,&mManualControl);
+   mInverseFFTCheckbox = new Checkbox(this,"ifft",120,145,&mInverseFFT);
    
    for (int i=0; i<NUM_AMP_SLIDERS; ++i)
    {
@@ -125,32 +141,40 @@ void Razor::Process(double time)
    float* out = GetTarget()->GetBuffer()->GetChannel(0);
    assert(bufferSize == gBufferSize);
 
-   if (!mManualControl)
-      CalcAmp();
-
-   for (int i=0; i<bufferSize; ++i)
+   ScratchArena::Scope scratch;
+   float* write = scratch.Alloc(bufferSize);
+   ::Clear(write, bufferSize);
+   
+   for (int v=0; v<RAZOR_NUM_VOICES; ++v)
    {
-      float freq = TheScale->PitchToFreq(mPitch + (mPitchBend ? mPitchBend->GetValue(i) : 0));
-      
-      int oscNyquistLimitIdx = int(gNyquistLimit/freq);
+      RazorVoice& voice = mVoices[v];
+      voice.mBank.SetMode(mInverseFFT ? OscillatorBank::kMode_InverseFFT : OscillatorBank::kMode_Oscillators);
+      //the fft bank comes out late, so keep it going until its tail has played out
+      if (voice.mPitch == -1 || voice.IsDone(time - voice.mBank.GetLatencyMs()))
+         continue;
       
-      float write = 0;
-      for (int j=0; j<mUseNumPartials && j<oscNyquistLimitIdx; ++j)
+      if (!mManualControl)
       {
-         float phaseInc = 512./(gSampleRate/(freq)) * (j+1) * mDetune[j];
-         mPhases[j] += phaseInc;
-         while (mPhases[j] >= 512) { mPhases[j] -= 512; }
-         
-         float sample = SinSample(mPhases[j]) * mAdsr[j].Value(time) * mAmp[j] * mVol;
-         
-         write += sample;
+         CalcAmp(voice.mPitch, voice.mAmp);
+         if (v == mVizVoice)
+            BufferCopy(mAmp, voice.mAmp, NUM_PARTIALS);
       }
-
-      GetVizBuffer()->Write(write, 0);
-
-      out[i] += write;
+      const float* amps = mManualControl ? mAmp : voice.mAmp;
       
-      time += gInvSampleRateMs;
+      //each partial has its own envelope, which the bank renders into that partial's amplitude.
+      //the pitch is looked up once a block, and the bank drops whatever ends up past nyquist
+      float freq = TheScale->PitchToFreq(voice.mPitch + (voice.mPitchBend ? voice.mPitchBend->GetValue(0) : 0));
+      for (int j=0; j<mUseNumPartials; ++j)
+         voice.mBank.SetPartial(j, GetPhaseInc(freq * (j+1) * mDetune[j]), amps[j] * mVol);
+      voice.mBank.SetNumPartials(mUseNumPartials);
+      voice.mBank.SetEnvelopes(voice.mAdsr, time);
+      voice.mBank.Process(write, bufferSize);
+   }
+   
+   for (int i=0; i<bufferSize; ++i)
+   {
+      GetVizBuffer()->Write(write[i], 0);
+      out[i] += write[i];
    }
 }
 
@@ -163,25 +187,52 @@ void Razor::PlayNote(double time, int pitch, int velocity, int voiceIdx, Modulat
    {      
       float amount = velocity/127.0f;
       
-      mPitch = pitch;
-      for (int i=1; i<=NUM_PARTIALS; ++i)
+      int voiceToPlay = GetVoiceToPlay(time);
+      RazorVoice& voice = mVoices[voiceToPlay];
+      voice.mPitch = pitch;
+      voice.mNoteOn = true;
+      voice.mStartTime = time;
+      for (int i=0; i<NUM_PARTIALS; ++i)
       {
-         mAdsr[i-1].Start(time, amount,
-                          mA,
-                          mD,
-                          mS,
-                          mR);
+         voice.mAdsr[i].Start(time, amount,
+                              mA,
+                              mD,
+                              mS,
+                              mR);
       }
       
-      mPitchBend = modulation.pitchBend;
-      mModWheel = modulation.modWheel;
-      mPressure = modulation.pressure;
+      voice.mPitchBend = modulation.pitchBend;
+      voice.mModWheel = modulation.modWheel;
+      voice.mPressure = modulation.pressure;
+      mVizVoice = voiceToPlay;
    }
-   else if (mPitch == pitch)
+   else
    {
-      for (int i=0; i<NUM_PARTIALS; ++i)
-         mAdsr[i].Stop(time);
+      for (int i=0; i<RAZOR_NUM_VOICES; ++i)
+      {
+         if (mVoices[i].mNoteOn && mVoices[i].mPitch == pitch)
+         {
+            for (int j=0; j<NUM_PARTIALS; ++j)
+               mVoices[i].mAdsr[j].Stop(time);
+            mVoices[i].mNoteOn = false;
+         }
+      }
+   }
+}
+
+int Razor::GetVoiceToPlay(double time) const
+{
+   //a voice that's gone quiet, otherwise steal the oldest
+   int oldest = 0;
+   for (int i=0; i<RAZOR_NUM_VOICES; ++i)
+   {
+      const RazorVoice& voice = mVoices[i];
+      if (voice.mPitch == -1 || voice.IsDone(time - voice.mBank.GetLatencyMs()))
+         return i;
+      if (voice.mStartTime < mVoices[oldest].mStartTime)
+         oldest = i;
    }
+   return oldest;
 }
 
 void Razor::DrawModule()
@@ -212,6 +263,7 @@ void Razor::DrawModule()
       mRSlider->Draw();
       
       mManualControlCheckbox->Draw();
+      mInverseFFTCheckbox->Draw();
       for (int i=0; i<NUM_AMP_SLIDERS; ++i)
       {
          mAmpSliders[i]->Draw();
@@ -226,7 +278,8 @@ void Razor::DrawViz()
    ofPushStyle();
 
    int zeroHeight = 240;
-   float baseFreq = TheScale->PitchToFreq(mPitch);
+   const RazorVoice& voice = mVoices[mVizVoice];
+   float baseFreq = TheScale->PitchToFreq(voice.mPitch);
    int oscNyquistLimitIdx = int(gNyquistLimit/baseFreq);
 
    for (int i=1; i<RAZOR_HISTORY-1; ++i)
@@ -257,7 +310,7 @@ void Razor::DrawViz()
    bzero(mPeakHistory[mHistoryPtr], sizeof(float) * VIZ_WIDTH);
    for (int i=1; i<=mUseNumPartials && i<=oscNyquistLimitIdx; ++i)
    {
-      float height = mAdsr[i-1].Value(gTime)*mAmp[i-1];
+      float height = voice.mAdsr[i-1].Value(gTime - voice.mBank.GetLatencyMs())*mAmp[i-1];
       int intHeight = int(height*100.0f);
       if (intHeight == 0)
       {
@@ -284,13 +337,6 @@ void Razor::DrawViz()
    ofPopStyle();
 }
 
-float Razor::SinSample(float phase)
-{
-   int intPhase = int(phase) % 512;
-   float remainder = phase - int(phase);
-   return ((1-remainder) * sineBuffer[intPhase] + remainder * sineBuffer[1+intPhase]);
-}
-
 bool IsPrime(int n)
 {
    if (n==1) return true;
@@ -318,12 +364,12 @@ bool IsPow2(int n)
    return false;
 }
 
-void Razor::CalcAmp()
+void Razor::CalcAmp(int pitch, float* amps)
 {
-   float baseFreq = TheScale->PitchToFreq(mPitch);
+   float baseFreq = TheScale->PitchToFreq(pitch);
    int oscNyquistLimitIdx = int(gNyquistLimit/baseFreq);
 
-   bzero(mAmp, sizeof(float)*NUM_PARTIALS);
+   bzero(amps, sizeof(float)*NUM_PARTIALS);
    for (int i=1; i<=mUseNumPartials && i<=oscNyquistLimitIdx; ++i)
    {
       if ((mHarmonicSelector == 0 && IsPrime(i)) ||
@@ -333,24 +379,24 @@ void Razor::CalcAmp()
       {
          float freq = baseFreq * i;
 
-         mAmp[i-1] = 1.0f/powf(i,mPowFalloff);
+         amps[i-1] = 1.0f/powf(i,mPowFalloff);
 
          for (int j=0; j<NUM_BUMPS; ++j)
          {
             float freqDist = fabs(mBumps[j].mFreq - freq);
             float dist = PI/2 - freqDist*mBumps[j].mDecay;
             float bumpAmt = mBumps[j].mAmt * (MIN(1,(tanh(dist)+1)/2));// * ofRandom(1);
-            mAmp[i-1] += bumpAmt;
+            amps[i-1] += bumpAmt;
          }
 
          if (mNegHarmonics > 0 && i%mNegHarmonics == 1)
-            mAmp[i-1] *= -1;
+            amps[i-1] *= -1;
 
          if (mHarshnessCut > 0)
          {
             float cutPoint = gNyquistLimit - mHarshnessCut;
             if (freq > cutPoint)
-               mAmp[i-1] *= 1 - ((freq - cutPoint) / mHarshnessCut);
+               amps[i-1] *= 1 - ((freq - cutPoint) / mHarshnessCut);
          }
       }
    }
@@ -380,7 +426,8 @@ void Razor::IntSliderUpdated(IntSlider* slider, int oldVal)
 {
    if (slider == mNumPartialsSlider)
    {
-      bzero(mPhases, sizeof(float) * NUM_PARTIALS);
+      for (int i=0; i<RAZOR_NUM_VOICES; ++i)
+         mVoices[i].mBank.ResetPhases();
    }
 }
 
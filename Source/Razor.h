@@ -17,12 +17,14 @@
 #include "Checkbox.h"
 #include "Slider.h"
 #include "ClickButton.h"
+#include "OscillatorBank.h"
 
 #define NUM_PARTIALS 320
 #define VIZ_WIDTH 1000
 #define RAZOR_HISTORY 100
 #define NUM_BUMPS 3
 #define NUM_AMP_SLIDERS 16
+#define RAZOR_NUM_VOICES 8
 
 struct RazorBump
 {
@@ -31,6 +33,22 @@ struct RazorBump
    float mDecay;
 };
 
+struct RazorVoice
+{
+   RazorVoice();
+   bool IsDone(double time) const;
+   
+   int mPitch;
+   bool mNoteOn;
+   double mStartTime;
+   ::ADSR mAdsr[NUM_PARTIALS];
+   OscillatorBank mBank;
+   float mAmp[NUM_PARTIALS];
+   ModulationChain* mPitchBend;
+   ModulationChain* mModWheel;
+   ModulationChain* mPressure;
+};
+
 class Razor : public IAudioSource, public INoteReceiver, public IDrawableModule, public IFloatSliderListener, public IIntSliderListener, public IButtonListener
 {
 public:
@@ -59,8 +77,8 @@ public:
    
    
 private:
-   float SinSample(float phase); //phase 0-512
-   void CalcAmp();
+   int GetVoiceToPlay(double time) const;
+   void CalcAmp(int pitch, float* amps);
    void DrawViz();
 
    //IDrawableModule
@@ -69,13 +87,13 @@ private:
    void GetModuleDimensions(float& w, float& h) override { w = 1020; h = 420; }
 
    float mVol;
-   float mPhase;
-   ::ADSR mAdsr[NUM_PARTIALS];
-   float mAmp[NUM_PARTIALS];
-   float mPhases[NUM_PARTIALS];
+   float mAmp[NUM_PARTIALS];   //what the amp sliders show: the last voice's amplitudes, or the manual ones
    float mDetune[NUM_PARTIALS];
    
-   int mPitch;
+   RazorVoice mVoices[RAZOR_NUM_VOICES];
+   int mVizVoice;
+   bool mInverseFFT;
+   Checkbox* mInverseFFTCheckbox;
    
    int mUseNumPartials;
    IntSlider* mNumPartialsSlider;
@@ -112,10 +130,6 @@ private:
    float mD;
    float mS;
    float mR;
-   
-   ModulationChain* mPitchBend;
-   ModulationChain* mModWheel;
-   ModulationChain* mPressure;
 
    float mPeakHistory[RAZOR_HISTORY][VIZ_WIDTH+1];
    int mHistoryPtr;
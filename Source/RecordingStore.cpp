@@ -0,0 +1,627 @@
+/*
+  ==============================================================================
+
+    RecordingStore.cpp
+    Created: 18 Oct 2026 10:41:17pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "RecordingStore.h"
+#include "SynthGlobals.h"
+#include <algorithm>
+
+RecordingChannel::Slot::Slot()
+: mData(nullptr)
+, mDiskOffset(-1)
+, mVersion(0)
+, mSpilledVersion(0)
+, mGeneration(0)
+, mSpillPending(false)
+, mLoadPending(false)
+, mNeedsMerge(false)
+, mOverlayStart(0)
+, mOverlayEnd(0)
+{
+   for (int i=0; i<kPeaksPerChunk; ++i)
+      mPeaks[i] = 0;
+}
+
+RecordingChannel::RecordingChannel(RecordingStore* store, int id)
+: mStore(store)
+, mId(id)
+, mNumPages(0)
+, mNumSlotsUsed(0)
+, mWroteThisBlock(false)
+, mWritingSlot(-1)
+, mDroppedSamples(0)
+{
+   for (int i=0; i<kMaxPages; ++i)
+      mPages[i].store(nullptr);
+   mResidentSlots.reserve(kMaxResidentSlots);
+}
+
+RecordingChannel::~RecordingChannel()
+{
+   for (int i=0; i<mNumPages; ++i)
+      delete[] mPages[i].load();
+}
+
+RecordingChannel::Slot* RecordingChannel::GetSlot(int slotIdx) const
+{
+   if (slotIdx < 0)
+      return nullptr;
+   int page = slotIdx / kSlotsPerPage;
+   if (page >= kMaxPages)
+      return nullptr;
+   Slot* slots = mPages[page].load(std::memory_order_acquire);
+   if (slots == nullptr)
+      return nullptr;
+   return &slots[slotIdx % kSlotsPerPage];
+}
+
+void RecordingChannel::EnsureSlots(int numSlots)
+{
+   int numPages = MIN((numSlots + kSlotsPerPage - 1) / kSlotsPerPage, kMaxPages);
+   for (; mNumPages < numPages; ++mNumPages)
+      mPages[mNumPages].store(new Slot[kSlotsPerPage], std::memory_order_release);
+}
+
+float RecordingChannel::Read(int pos) const
+{
+   const Slot* slot = GetSlot(pos / kChunkSize);
+   if (slot == nullptr || slot->mData == nullptr)
+      return 0;
+   int index = pos % kChunkSize;
+   if (slot->mNeedsMerge && (index < slot->mOverlayStart || index >= slot->mOverlayEnd))
+      return 0;
+   return slot->mData[index];
+}
+
+void RecordingChannel::Write(int pos, float value)
+{
+   int slotIdx = pos / kChunkSize;
+   Slot* slot = GetSlot(slotIdx);
+   if (slot == nullptr)
+   {
+      ++mDroppedSamples;
+      return;
+   }
+
+   int index = pos % kChunkSize;
+   if (slot->mData == nullptr)
+   {
+      float* chunk = nullptr;
+      if (mResidentSlots.size() < mResidentSlots.capacity())
+         chunk = mStore->PopFreeChunk();
+      if (chunk == nullptr)
+      {
+         ++mDroppedSamples;
+         return;
+      }
+      slot->mData = chunk;
+      mResidentSlots.push_back(slotIdx);
+      if (slot->mDiskOffset >= 0)
+      {
+         //older material on disk that hasn't made it back in yet. record over it now, fill in around it when it arrives.
+         slot->mNeedsMerge = true;
+         slot->mOverlayStart = index;
+         slot->mOverlayEnd = index;
+      }
+   }
+
+   slot->mData[index] = value;
+   ++slot->mVersion;
+   if (slot->mNeedsMerge)
+   {
+      slot->mOverlayStart = MIN(slot->mOverlayStart, index);
+      slot->mOverlayEnd = MAX(slot->mOverlayEnd, index + 1);
+   }
+
+   float mag = fabsf(value);
+   float& peak = slot->mPeaks[index / kSamplesPerPeak];
+   if (index % kSamplesPerPeak == 0 || mag > peak)
+      peak = mag;
+
+   mWroteThisBlock = true;
+   mWritingSlot = slotIdx;
+   if (slotIdx >= mNumSlotsUsed)
+      mNumSlotsUsed = slotIdx + 1;
+}
+
+void RecordingChannel::Update(int playhead)
+{
+   int playSlot = playhead / kChunkSize;
+   int writingSlot = mWroteThisBlock ? mWritingSlot : -1;
+   mWroteThisBlock = false;
+
+   for (size_t i=0; i<mResidentSlots.size(); )
+   {
+      int slotIdx = mResidentSlots[i];
+      Slot* slot = GetSlot(slotIdx);
+      bool busy = slot->mSpillPending || slot->mNeedsMerge || slotIdx == writingSlot;
+      if (!busy && slot->IsDirty())
+      {
+         RecordingStore::Request spill = { RecordingStore::kRequest_Spill, mId, slotIdx, slot->mVersion, slot->mData, -1 };
+         if (mStore->PostRequest(spill))
+            slot->mSpillPending = true;
+      }
+      else if (!busy && (slotIdx < playSlot - 1 || slotIdx > playSlot + kPrefetchChunks))
+      {
+         //safely on disk and out of the way
+         mStore->Recycle(slot->mData);
+         slot->mData = nullptr;
+         mResidentSlots[i] = mResidentSlots.back();
+         mResidentSlots.pop_back();
+         continue;
+      }
+      ++i;
+   }
+
+   for (int slotIdx = playSlot; slotIdx <= playSlot + kPrefetchChunks; ++slotIdx)
+   {
+      Slot* slot = GetSlot(slotIdx);
+      if (slot && slot->mDiskOffset >= 0 && !slot->mLoadPending && (slot->mData == nullptr || slot->mNeedsMerge))
+      {
+         RecordingStore::Request load = { RecordingStore::kRequest_Load, mId, slotIdx, slot->mGeneration, nullptr, slot->mDiskOffset };
+         if (mStore->PostRequest(load))
+            slot->mLoadPending = true;
+      }
+   }
+}
+
+void RecordingChannel::OnSpilled(int slotIdx, int version, float* chunk, int64_t offset)
+{
+   Slot* slot = GetSlot(slotIdx);
+   if (slot != nullptr)
+      slot->mSpillPending = false;
+
+   if (slot == nullptr || slot->mData != chunk)
+   {
+      //the main thread let go of it while it was being written
+      mStore->Recycle(chunk);
+      return;
+   }
+
+   if (offset >= 0 && slot->mVersion == version)
+   {
+      slot->mDiskOffset = offset;
+      slot->mSpilledVersion = version;
+   }
+}
+
+void RecordingChannel::OnLoaded(int slotIdx, int generation, float* chunk)
+{
+   Slot* slot = GetSlot(slotIdx);
+   if (slot != nullptr)
+      slot->mLoadPending = false;
+
+   if (chunk == nullptr)
+      return;  //no free chunk or the read failed, it'll get asked for again
+
+   if (slot != nullptr && slot->mGeneration == generation)
+   {
+      if (slot->mData == nullptr)
+      {
+         if (mResidentSlots.size() < mResidentSlots.capacity())
+         {
+            slot->mData = chunk;
+            mResidentSlots.push_back(slotIdx);
+            return;
+         }
+      }
+      else if (slot->mNeedsMerge)
+      {
+         BufferCopy(slot->mData, chunk, slot->mOverlayStart);
+         BufferCopy(slot->mData + slot->mOverlayEnd, chunk + slot->mOverlayEnd, kChunkSize - slot->mOverlayEnd);
+         slot->mNeedsMerge = false;
+         ++slot->mVersion;
+         ComputePeaks(slot, slot->mData);
+      }
+   }
+
+   mStore->Recycle(chunk);
+}
+
+void RecordingChannel::DropResident(int slotIdx)
+{
+   Slot* slot = GetSlot(slotIdx);
+   if (slot == nullptr || slot->mData == nullptr)
+      return;
+
+   if (!slot->mSpillPending)   //otherwise OnSpilled() sees it's been let go and recycles it
+      mStore->Recycle(slot->mData);
+   slot->mData = nullptr;
+   slot->mNeedsMerge = false;
+   RemoveFromVector(slotIdx, mResidentSlots);
+}
+
+void RecordingChannel::ReadChunk(int slotIdx, float* out)
+{
+   Slot* slot = GetSlot(slotIdx);
+   if (slot == nullptr)
+   {
+      Clear(out, kChunkSize);
+      return;
+   }
+
+   if (slot->mData != nullptr && !slot->mNeedsMerge)
+   {
+      BufferCopy(out, slot->mData, kChunkSize);
+      return;
+   }
+
+   if (slot->mDiskOffset < 0 || !mStore->ReadFromFile(slot->mDiskOffset, out))
+      Clear(out, kChunkSize);
+   if (slot->mData != nullptr)
+      BufferCopy(out + slot->mOverlayStart, slot->mData + slot->mOverlayStart, slot->mOverlayEnd - slot->mOverlayStart);
+}
+
+void RecordingChannel::ReplaceChunk(int slotIdx, const float* data)
+{
+   EnsureSlots(slotIdx + 1);
+   Slot* slot = GetSlot(slotIdx);
+   if (slot == nullptr)
+      return;
+
+   int64_t offset = mStore->AppendToFile(data);
+   if (offset < 0)
+      return;
+
+   DropResident(slotIdx);
+   slot->mDiskOffset = offset;
+   ++slot->mGeneration;
+   ++slot->mVersion;
+   slot->mSpilledVersion = slot->mVersion;
+   ComputePeaks(slot, data);
+   if (slotIdx >= mNumSlotsUsed)
+      mNumSlotsUsed = slotIdx + 1;
+}
+
+void RecordingChannel::FlushChunk(int slotIdx)
+{
+   Slot* slot = GetSlot(slotIdx);
+   if (slot == nullptr || slot->mData == nullptr || (!slot->IsDirty() && !slot->mNeedsMerge))
+      return;
+
+   vector<float> data(kChunkSize);
+   ReadChunk(slotIdx, data.data());
+   int64_t offset = mStore->AppendToFile(data.data());
+   if (offset < 0)
+      return;
+
+   if (slot->mNeedsMerge)
+   {
+      BufferCopy(slot->mData, data.data(), kChunkSize);
+      slot->mNeedsMerge = false;   //the load that was coming for it gets recycled when it shows up
+   }
+   slot->mDiskOffset = offset;
+   slot->mSpilledVersion = slot->mVersion;
+}
+
+void RecordingChannel::Read(int start, int length, float* out)
+{
+   vector<float> chunk(kChunkSize);
+   while (length > 0)
+   {
+      int slotIdx = start / kChunkSize;
+      int index = start % kChunkSize;
+      int count = MIN(length, kChunkSize - index);
+      if (count == kChunkSize)
+      {
+         ReadChunk(slotIdx, out);
+      }
+      else
+      {
+         ReadChunk(slotIdx, chunk.data());
+         BufferCopy(out, chunk.data() + index, count);
+      }
+      start += count;
+      out += count;
+      length -= count;
+   }
+}
+
+void RecordingChannel::Write(int start, int length, const float* data)
+{
+   vector<float> chunk(kChunkSize);
+   while (length > 0)
+   {
+      int slotIdx = start / kChunkSize;
+      int index = start % kChunkSize;
+      int count = MIN(length, kChunkSize - index);
+      if (count == kChunkSize)
+      {
+         ReplaceChunk(slotIdx, data);
+      }
+      else
+      {
+         ReadChunk(slotIdx, chunk.data());
+         BufferCopy(chunk.data() + index, data, count);
+         ReplaceChunk(slotIdx, chunk.data());
+      }
+      start += count;
+      data += count;
+      length -= count;
+   }
+}
+
+void RecordingChannel::TakeSnapshot(Snapshot& snapshot)
+{
+   vector<int> resident = mResidentSlots;
+   for (int slotIdx : resident)
+      FlushChunk(slotIdx);
+
+   snapshot.mOffsets.resize(mNumSlotsUsed);
+   snapshot.mPeaks.resize(mNumSlotsUsed * kPeaksPerChunk);
+   for (int i=0; i<mNumSlotsUsed; ++i)
+   {
+      const Slot* slot = GetSlot(i);
+      snapshot.mOffsets[i] = slot->mDiskOffset;
+      std::copy(slot->mPeaks, slot->mPeaks + kPeaksPerChunk, snapshot.mPeaks.begin() + i * kPeaksPerChunk);
+   }
+}
+
+void RecordingChannel::RestoreSnapshot(const Snapshot& snapshot)
+{
+   int numSlots = (int)snapshot.mOffsets.size();
+   EnsureSlots(numSlots);
+   for (int i=0; i<MAX(numSlots, mNumSlotsUsed); ++i)
+   {
+      Slot* slot = GetSlot(i);
+      DropResident(i);
+      ++slot->mGeneration;
+      ++slot->mVersion;
+      slot->mSpilledVersion = slot->mVersion;
+      if (i < numSlots)
+      {
+         slot->mDiskOffset = snapshot.mOffsets[i];
+         std::copy(snapshot.mPeaks.begin() + i * kPeaksPerChunk, snapshot.mPeaks.begin() + (i + 1) * kPeaksPerChunk, slot->mPeaks);
+      }
+      else
+      {
+         slot->mDiskOffset = -1;
+         std::fill(slot->mPeaks, slot->mPeaks + kPeaksPerChunk, 0);
+      }
+   }
+   mNumSlotsUsed = MAX(numSlots, mNumSlotsUsed);
+}
+
+float RecordingChannel::GetPeak(int start, int end) const
+{
+   float peak = 0;
+   for (int bin = MAX(0, start) / kSamplesPerPeak; bin * kSamplesPerPeak < end; ++bin)
+   {
+      const Slot* slot = GetSlot(bin / kPeaksPerChunk);
+      if (slot == nullptr)
+         break;
+      peak = MAX(peak, slot->mPeaks[bin % kPeaksPerChunk]);
+   }
+   return peak;
+}
+
+//static
+void RecordingChannel::ComputePeaks(Slot* slot, const float* data)
+{
+   for (int bin = 0; bin < kPeaksPerChunk; ++bin)
+   {
+      float peak = 0;
+      for (int i = bin * kSamplesPerPeak; i < (bin + 1) * kSamplesPerPeak; ++i)
+         peak = MAX(peak, fabsf(data[i]));
+      slot->mPeaks[bin] = peak;
+   }
+}
+
+RecordingStore::RecordingStore()
+: juce::Thread("multitrack disk")
+, mNextChannelId(0)
+, mLength(0)
+, mFreeChunks(kMaxChunks)
+, mNumFreeChunks(0)
+, mRequests(kMaxChunks * 2)
+, mReplies(kMaxChunks * 2)
+, mSpillFileLength(0)
+{
+   ResetFile();
+   startThread(4);
+}
+
+RecordingStore::~RecordingStore()
+{
+   signalThreadShouldExit();
+   mWorkEvent.signal();
+   stopThread(5000);
+
+   for (auto* channel : mChannels)
+      delete channel;
+   for (auto* chunk : mAllChunks)
+      delete[] chunk;
+
+   mSpillWriter.reset();
+   mSpillFile.deleteFile();
+}
+
+RecordingChannel* RecordingStore::CreateChannel()
+{
+   RecordingChannel* channel = new RecordingChannel(this, mNextChannelId++);
+   channel->EnsureSlots(mLength / RecordingChannel::kChunkSize + 2);
+   mChannels.push_back(channel);
+   return channel;
+}
+
+void RecordingStore::DeleteChannel(RecordingChannel* channel)
+{
+   vector<int> resident = channel->mResidentSlots;
+   for (int slotIdx : resident)
+      channel->DropResident(slotIdx);
+   RemoveFromVector(channel, mChannels, K(fail));
+   delete channel;
+}
+
+void RecordingStore::DeleteAllChannels()
+{
+   while (!mChannels.empty())
+      DeleteChannel(mChannels.back());
+   ResetFile();
+}
+
+RecordingChannel* RecordingStore::GetChannel(int id) const
+{
+   for (auto* channel : mChannels)
+   {
+      if (channel->mId == id)
+         return channel;
+   }
+   return nullptr;
+}
+
+void RecordingStore::Poll(int length)
+{
+   mLength = length;
+   for (auto* channel : mChannels)
+   {
+      channel->EnsureSlots(length / RecordingChannel::kChunkSize + 2);
+      int dropped = channel->mDroppedSamples.exchange(0);
+      if (dropped > 0)
+         ofLog() << "multitrack recorder dropped " << dropped << " samples, out of buffer space";
+   }
+
+   //enough for every channel to record and prefetch without having to wait on the disk thread
+   int wanted = (int)mChannels.size() * (RecordingChannel::kPrefetchChunks + 3) + 8;
+   while (mNumFreeChunks < wanted && (int)mAllChunks.size() < kMaxChunks)
+   {
+      float* chunk = new float[RecordingChannel::kChunkSize];
+      Clear(chunk, RecordingChannel::kChunkSize);
+      mAllChunks.push_back(chunk);
+      mFreeChunks.Push(chunk);
+      ++mNumFreeChunks;
+   }
+}
+
+void RecordingStore::Update(int playhead)
+{
+   Request reply;
+   while (mReplies.Pop(reply))
+   {
+      RecordingChannel* channel = GetChannel(reply.mChannelId);
+      if (channel == nullptr)
+      {
+         if (reply.mChunk != nullptr)
+            Recycle(reply.mChunk);
+      }
+      else if (reply.mType == kRequest_Spill)
+      {
+         channel->OnSpilled(reply.mSlot, reply.mVersion, reply.mChunk, reply.mOffset);
+      }
+      else if (reply.mType == kRequest_Load)
+      {
+         channel->OnLoaded(reply.mSlot, reply.mVersion, reply.mChunk);
+      }
+   }
+
+   for (auto* channel : mChannels)
+      channel->Update(playhead);
+}
+
+float* RecordingStore::PopFreeChunk()
+{
+   float* chunk;
+   if (!mFreeChunks.Pop(chunk))
+      return nullptr;
+   --mNumFreeChunks;
+   return chunk;
+}
+
+void RecordingStore::Recycle(float* chunk)
+{
+   Request recycle = { kRequest_Recycle, -1, -1, 0, chunk, -1 };
+   if (!PostRequest(recycle))
+   {
+      //disk thread is swamped, clear it here rather than lose it
+      Clear(chunk, RecordingChannel::kChunkSize);
+      mFreeChunks.Push(chunk);
+      ++mNumFreeChunks;
+   }
+}
+
+bool RecordingStore::PostRequest(const Request& request)
+{
+   return mRequests.Push(request);
+}
+
+void RecordingStore::run()
+{
+   while (!threadShouldExit())
+   {
+      mWorkEvent.wait(10);
+
+      Request request;
+      while (!threadShouldExit() && mRequests.Pop(request))
+      {
+         if (request.mType == kRequest_Recycle)
+         {
+            Clear(request.mChunk, RecordingChannel::kChunkSize);
+            mFreeChunks.Push(request.mChunk);
+            ++mNumFreeChunks;
+            continue;
+         }
+
+         if (request.mType == kRequest_Spill)
+         {
+            request.mOffset = AppendToFile(request.mChunk);
+         }
+         else if (request.mType == kRequest_Load)
+         {
+            request.mChunk = PopFreeChunk();
+            if (request.mChunk != nullptr && !ReadFromFile(request.mOffset, request.mChunk))
+            {
+               Clear(request.mChunk, RecordingChannel::kChunkSize);
+               mFreeChunks.Push(request.mChunk);
+               ++mNumFreeChunks;
+               request.mChunk = nullptr;
+            }
+         }
+
+         while (!mReplies.Push(request) && !threadShouldExit())
+            wait(1);
+      }
+   }
+}
+
+int64_t RecordingStore::AppendToFile(const float* data)
+{
+   const juce::ScopedLock lock(mFileLock);
+   if (mSpillWriter == nullptr || !mSpillWriter->write(data, kChunkBytes))
+      return -1;
+   mSpillWriter->flush();   //so reads see it
+   int64_t offset = mSpillFileLength;
+   mSpillFileLength += kChunkBytes;
+   return offset;
+}
+
+bool RecordingStore::ReadFromFile(int64_t offset, float* out)
+{
+   const juce::ScopedLock lock(mFileLock);
+   juce::FileInputStream stream(mSpillFile);
+   if (!stream.openedOk() || !stream.setPosition(offset))
+      return false;
+   return stream.read(out, kChunkBytes) == kChunkBytes;
+}
+
+void RecordingStore::ResetFile()
+{
+   const juce::ScopedLock lock(mFileLock);
+   mSpillWriter.reset();
+   if (mSpillFile.existsAsFile())
+      mSpillFile.deleteFile();
+
+   mSpillFile = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("bespoke_multitrack", ".raw");
+   mSpillWriter.reset(new juce::FileOutputStream(mSpillFile));
+   if (mSpillWriter->failedToOpen())
+   {
+      ofLog() << "couldn't create multitrack recording file " << mSpillFile.getFullPathName().toStdString();
+      mSpillWriter.reset();
+   }
+   mSpillFileLength = 0;
+}
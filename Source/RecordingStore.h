@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+    RecordingStore.h
+    Created: 18 Oct 2026 10:41:17pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include "MPMCRingQueue.h"
+#include <atomic>
+#include <climits>
+#include <memory>
+
+class RecordingStore;
+
+//one mono track of a long recording, cut into fixed size chunks. only the chunks near the playhead
+//are kept in memory, the rest live in the store's spill file and get streamed back in ahead of playback.
+//
+//threading: the audio thread calls Read()/Write(). everything marked "main thread" has to be called with
+//the audio thread locked out, since it rearranges chunks the audio thread might be using.
+class RecordingChannel
+{
+public:
+   static const int kChunkSize = 1 << 16;
+   static const int kSamplesPerPeak = 1024;
+   static const int kPeaksPerChunk = kChunkSize / kSamplesPerPeak;
+
+   //audio thread. reads 0 for anything that isn't in memory yet.
+   float Read(int pos) const;
+   void Write(int pos, float value);
+
+   //main thread. these go to disk for whatever isn't resident, so they block.
+   void Read(int start, int length, float* out);
+   void Write(int start, int length, const float* data);
+
+   //main thread, for undo. captures where every chunk's data currently lives, flushing what's only in memory.
+   //the spill file is only ever appended to, so whatever a snapshot points at stays put.
+   struct Snapshot
+   {
+      vector<int64_t> mOffsets;
+      vector<float> mPeaks;
+   };
+   void TakeSnapshot(Snapshot& snapshot);
+   void RestoreSnapshot(const Snapshot& snapshot);
+
+   //ui thread, for drawing. loudest sample in the range, from the peak summaries.
+   float GetPeak(int start, int end) const;
+
+private:
+   friend class RecordingStore;
+
+   RecordingChannel(RecordingStore* store, int id);
+   ~RecordingChannel();
+
+   struct Slot
+   {
+      Slot();
+      bool IsDirty() const { return mVersion != mSpilledVersion; }
+
+      float* mData;                //resident samples, or nullptr
+      int64_t mDiskOffset;         //last copy in the spill file, -1 if there isn't one
+      int mVersion;                //bumped on every write
+      int mSpilledVersion;         //which version mDiskOffset holds
+      int mGeneration;             //bumped when the main thread swaps the contents out from under a pending load
+      bool mSpillPending;
+      bool mLoadPending;
+      //written to before the disk copy made it back in. [mOverlayStart,mOverlayEnd) is new, the rest comes from disk.
+      bool mNeedsMerge;
+      int mOverlayStart;
+      int mOverlayEnd;
+      float mPeaks[kPeaksPerChunk];
+   };
+
+   static const int kSlotsPerPage = 256;
+   static const int kMaxPages = (INT_MAX / kChunkSize) / kSlotsPerPage + 1;
+   static const int kMaxResidentSlots = 256;
+   static const int kPrefetchChunks = 2;
+
+   Slot* GetSlot(int slotIdx) const;
+   void EnsureSlots(int numSlots);
+   void Update(int playhead);
+   void OnSpilled(int slotIdx, int version, float* chunk, int64_t offset);
+   void OnLoaded(int slotIdx, int generation, float* chunk);
+   void DropResident(int slotIdx);
+   void ReadChunk(int slotIdx, float* out);
+   void ReplaceChunk(int slotIdx, const float* data);
+   void FlushChunk(int slotIdx);
+   static void ComputePeaks(Slot* slot, const float* data);
+
+   RecordingStore* mStore;
+   int mId;
+   std::atomic<Slot*> mPages[kMaxPages];
+   int mNumPages;
+   int mNumSlotsUsed;
+   vector<int> mResidentSlots;   //capacity reserved up front, the audio thread adds to it
+   bool mWroteThisBlock;
+   int mWritingSlot;
+   std::atomic<int> mDroppedSamples;   //pool ran dry, or we got ahead of the main thread
+};
+
+//owns the chunk pool, the spill file and the thread that moves chunks between the two.
+//chunks come out of a pool that the main thread tops up, so recording never allocates on the audio thread,
+//and a recording's length is bounded by the disk instead of by memory.
+class RecordingStore : public juce::Thread
+{
+public:
+   RecordingStore();
+   ~RecordingStore();
+
+   //main thread, audio thread locked out
+   RecordingChannel* CreateChannel();
+   void DeleteChannel(RecordingChannel* channel);
+   void DeleteAllChannels();   //and start a fresh spill file
+
+   //main thread. makes room for recordings up to length samples long, and keeps the pool stocked.
+   void Poll(int length);
+
+   //audio thread, at the start of every block. picks up finished disk work, evicts chunks that have
+   //been written out and queues up loads for what's about to play.
+   void Update(int playhead);
+
+   void run() override;
+
+private:
+   friend class RecordingChannel;
+
+   enum RequestType
+   {
+      kRequest_Spill,
+      kRequest_Load,
+      kRequest_Recycle
+   };
+
+   struct Request
+   {
+      RequestType mType;
+      int mChannelId;
+      int mSlot;
+      int mVersion;   //spills: the slot's version. loads: its generation.
+      float* mChunk;
+      int64_t mOffset;
+   };
+
+   static const int kMaxChunks = 2048;
+   static const int kChunkBytes = RecordingChannel::kChunkSize * sizeof(float);
+
+   RecordingChannel* GetChannel(int id) const;
+   float* PopFreeChunk();
+   void Recycle(float* chunk);
+   bool PostRequest(const Request& request);
+   int64_t AppendToFile(const float* data);
+   bool ReadFromFile(int64_t offset, float* out);
+   void ResetFile();
+
+   vector<RecordingChannel*> mChannels;
+   int mNextChannelId;
+   int mLength;
+
+   //the main thread, the audio thread and the disk thread all hand chunks back and take them out,
+   //so these need the multi-producer queue rather than LockFreeRingQueue
+   MPMCRingQueue<float*> mFreeChunks;   //always zeroed
+   std::atomic<int> mNumFreeChunks;
+   vector<float*> mAllChunks;
+
+   MPMCRingQueue<Request> mRequests;
+   MPMCRingQueue<Request> mReplies;
+   juce::WaitableEvent mWorkEvent;
+
+   juce::CriticalSection mFileLock;
+   juce::File mSpillFile;
+   std::unique_ptr<juce::FileOutputStream> mSpillWriter;
+   int64_t mSpillFileLength;
+};
@@ -11,6 +11,12 @@
 #include "FileStream.h"
 #include "ModularSynth.h"
 #include "ChannelBuffer.h"
+#include "ScratchArena.h"
+
+namespace
+{
+   const int kReadChunkSize = 44100 * 10;
+}
 
 Sample::Sample()
 : mData(0)
@@ -30,6 +36,7 @@ Sample::Sample()
 
 Sample::~Sample()
 {
+   delete mReader;
 }
 
 bool Sample::Read(const char* path, bool mono, ReadType readType)
@@ -41,6 +48,32 @@ bool Sample::Read(const char* path, bool mono, ReadType readType)
    
    File file(ofToDataPath(path));
    delete mReader;
+   mReader = nullptr;
+   StopStreaming();
+   
+   //offline, nothing would ever run the async load's timer, and a stream can't keep up with faster than realtime
+   if (TheSynth->IsRenderingOffline())
+      readType = ReadType::Sync;
+   
+   if (readType == ReadType::Stream)
+   {
+      SampleStream* stream = SampleStream::Open(file, mono ? 1 : ChannelBuffer::kMaxNumChannels);
+      if (stream != nullptr)
+      {
+         mNumSamples = stream->GetLength();
+         mOffset = mNumSamples;
+         mSampleRateRatio = float(stream->GetSampleRate()) / gSampleRate;
+         mData.Resize(1);   //stays empty until something needs all of it
+         mData.SetNumActiveChannels(stream->GetNumChannels());
+         mData.Clear();
+         mStream.reset(stream);
+         return true;
+      }
+      
+      TheSynth->LogEvent("failed to load sample " + file.getFullPathName().toStdString(), kLogEventType_Error);
+      return false;
+   }
+   
    mReader = TheSynth->GetGlobalManagers()->mAudioFormatManager.createReaderFor(file);
    
    if (mReader != nullptr)
@@ -56,13 +89,9 @@ bool Sample::Read(const char* path, bool mono, ReadType readType)
       mOffset = mNumSamples;
       mSampleRateRatio = float(mReader->sampleRate) / gSampleRate;
       
-      mReadBuffer = make_unique<AudioSampleBuffer>();
-      mReadBuffer->setSize(mReader->numChannels, mNumSamples);
-      
       if (readType == ReadType::Sync)
       {
-         mReader->read(mReadBuffer.get(), 0, mNumSamples, 0, true, true);
-         FinishRead();
+         ReadIntoData(0, mNumSamples);
       }
       else if (readType == ReadType::Async)
       {
@@ -80,37 +109,97 @@ bool Sample::Read(const char* path, bool mono, ReadType readType)
    return false;
 }
 
-void Sample::FinishRead()
+//reads from mReader straight into mData, so we never hold a second copy of the whole file
+void Sample::ReadIntoData(int startSample, int numSamples)
 {
-   if (mData.NumActiveChannels() == 1 && mReadBuffer->getNumChannels() > 1)
+   int readerChannels = mReader->numChannels;
+   if (mData.NumActiveChannels() == 1 && readerChannels > 1)
    {
-      BufferCopy(mData.GetChannel(0), mReadBuffer->getReadPointer(0), mReadBuffer->getNumSamples());  //put first channel in
-      for (int ch = 1; ch < mReadBuffer->getNumChannels(); ++ch)
-         Add(mData.GetChannel(0), mReadBuffer->getReadPointer(ch), mReadBuffer->getNumSamples()); //add the other channels
-      Mult(mData.GetChannel(0), 1.0f / mReadBuffer->getNumChannels(), mReadBuffer->getNumSamples());   //normalize volume
+      AudioSampleBuffer chunk(readerChannels, MIN(numSamples, kReadChunkSize));
+      for (int done = 0; done < numSamples; )
+      {
+         int length = MIN(kReadChunkSize, numSamples - done);
+         float* dest = mData.GetChannel(0) + startSample + done;
+         mReader->read(&chunk, 0, length, startSample + done, true, true);
+         BufferCopy(dest, chunk.getReadPointer(0), length);  //put first channel in
+         for (int ch = 1; ch < readerChannels; ++ch)
+            Add(dest, chunk.getReadPointer(ch), length); //add the other channels
+         Mult(dest, 1.0f / readerChannels, length);   //normalize volume
+         done += length;
+      }
    }
    else
    {
-      for (int ch = 0; ch < mReadBuffer->getNumChannels(); ++ch)
-         BufferCopy(mData.GetChannel(ch), mReadBuffer->getReadPointer(ch), mReadBuffer->getNumSamples());
+      float* channels[ChannelBuffer::kMaxNumChannels];
+      for (int ch = 0; ch < mData.NumActiveChannels(); ++ch)
+         channels[ch] = mData.GetChannel(ch);
+      AudioSampleBuffer dest(channels, mData.NumActiveChannels(), mData.BufferSize());
+      mReader->read(&dest, startSample, numSamples, startSample, true, true);
    }
 }
 
+void Sample::LoadFully()
+{
+   //read the whole thing into memory and stop streaming, for anything that needs random access to it
+   if (mStream == nullptr)
+      return;
+   int numChannels = mStream->GetNumChannels();
+   
+   delete mReader;
+   mReader = TheSynth->GetGlobalManagers()->mAudioFormatManager.createReaderFor(File(ofToDataPath(mReadPath)));
+   
+   mData.Resize(mNumSamples);
+   mData.SetNumActiveChannels(numChannels);
+   mData.Clear();
+   if (mReader != nullptr)
+      ReadIntoData(0, mNumSamples);
+   else
+      TheSynth->LogEvent("failed to load sample " + string(mReadPath), kLogEventType_Error);
+   
+   StopStreaming();
+}
+
+void Sample::Draw(float width, float height, float start, float end, float pos, float vol /*=1*/, ofColor color /*=ofColor::black*/)
+{
+   if (mStream == nullptr)
+   {
+      DrawAudioBuffer(width, height, &mData, start, end, pos, vol, color);
+      return;
+   }
+
+   //draw from the stream's overview, one peak per kOverviewDecimation frames
+   const juce::AudioSampleBuffer& overview = mStream->GetOverview();
+   const float decimation = SampleStream::kOverviewDecimation;
+   int numChannels = overview.getNumChannels();
+   ofPushMatrix();
+   for (int ch = 0; ch < numChannels; ++ch)
+   {
+      DrawAudioBuffer(width, height / numChannels, overview.getReadPointer(ch), start / decimation, MIN(end / decimation, overview.getNumSamples()), pos == -1 ? -1 : pos / decimation, vol, color);
+      ofTranslate(0, height / numChannels);
+   }
+   ofPopMatrix();
+}
+
+void Sample::StopStreaming()
+{
+   unique_ptr<SampleStream> stream;
+   LockDataMutex(true);
+   stream = std::move(mStream);   //the audio thread might be reading from it, so take it away first
+   LockDataMutex(false);
+}
+
 //juce::Timer
 void Sample::timerCallback()
 {
-   int samplesToRead = 44100 * 10;
+   int samplesToRead = kReadChunkSize;
    if (samplesToRead > mSamplesLeftToRead)
       samplesToRead = mSamplesLeftToRead;
    int startSample = mNumSamples - mSamplesLeftToRead;
-   mReader->read(mReadBuffer.get(), startSample, samplesToRead, startSample, true, true);
+   ReadIntoData(startSample, samplesToRead);
    mSamplesLeftToRead -= samplesToRead;
 
    if (mSamplesLeftToRead <= 0)
-   {
-      FinishRead();
       stopTimer();
-   }
 }
 
 void Sample::Create(int length)
@@ -133,6 +222,7 @@ void Sample::Create(ChannelBuffer* data)
 
 void Sample::Setup(int length)
 {
+   StopStreaming();
    mNumSamples = length;
    mRate = 1;
    mOffset = length;
@@ -145,6 +235,7 @@ void Sample::Setup(int length)
 bool Sample::Write(const char* path /*=nullptr*/)
 {
    const char* writeTo = path ? path : mReadPath;
+   LoadFully();
    WriteDataToFile(writeTo, &mData, mNumSamples);
    return true;
 }
@@ -186,6 +277,8 @@ void Sample::Play(double startTime, float rate /*=1*/, int offset /*=0*/, int st
       SetStopPoint(stopPoint);
    else
       ClearStopPoint();
+   if (mStream)
+      mStream->SetPlayPosition(offset);   //get the disk reads going before the audio thread asks
    mPlayMutex.unlock();
 }
 
@@ -208,6 +301,14 @@ bool Sample::ConsumeData(double time, ChannelBuffer* out, int size, bool replace
    }
    
    LockDataMutex(true);
+   if (mStream)
+   {
+      ConsumeStreamedData(time, out, size, replace, end);
+      LockDataMutex(false);
+      mPlayMutex.unlock();
+      return true;
+   }
+   
    for (int i=0; i<size; ++i)
    {
       if (time < mStartTime)
@@ -244,6 +345,83 @@ bool Sample::ConsumeData(double time, ChannelBuffer* out, int size, bool replace
    return true;
 }
 
+//same as the loop in ConsumeData, but first pulls the frames this block covers out of the stream
+void Sample::ConsumeStreamedData(double time, ChannelBuffer* out, int size, bool replace, float end)
+{
+   double step = mRate * mSampleRateRatio;
+   double lastOffset = mOffset + step * size;
+   int windowStart = (int)floor(MIN(mOffset, lastOffset));
+   int windowLength = (int)ceil(MAX(mOffset, lastOffset)) - windowStart + 2;
+   windowLength = MIN(windowLength, kMaxStreamWindow);
+   
+   ScratchArena::Scope scratch;
+   ChannelBuffer window(scratch, windowLength);
+   window.SetNumActiveChannels(mStream->GetNumChannels());
+   ReadStreamedFrames(windowStart, &window);
+   
+   for (int i=0; i<size; ++i)
+   {
+      if (time < mStartTime)
+      {
+         if (replace)
+         {
+            for (int ch=0; ch<out->NumActiveChannels(); ++ch)
+               out->GetChannel(ch)[i] = 0;
+         }
+      }
+      else
+      {
+         double windowPos = ofClamp(mOffset - windowStart, 0, windowLength - 2);
+         int pos = int(windowPos);
+         float a = windowPos - pos;
+         
+         for (int ch=0; ch<out->NumActiveChannels(); ++ch)
+         {
+            const float* data = window.GetChannel(MIN(ch, window.NumActiveChannels()-1));
+            
+            float sample = 0;
+            if (mOffset < end || mLooping)
+               sample = ((1-a)*data[pos] + a*data[pos+1]) * mVolume;
+            
+            if (replace)
+               out->GetChannel(ch)[i] = sample;
+            else
+               out->GetChannel(ch)[i] += sample;
+         }
+         
+         mOffset += step;
+      }
+      time += gInvSampleRateMs;
+   }
+}
+
+bool Sample::ReadStreamedFrames(int start, ChannelBuffer* window)
+{
+   assert(mStream != nullptr);
+   int windowLength = window->BufferSize();
+   
+   //wrap the same way GetInterpolatedSample does, so looping reads across the seam
+   int frame = start % mNumSamples;
+   if (frame < 0)
+      frame += mNumSamples;
+   mStream->SetPlayPosition(frame);
+   bool ready = true;
+   for (int done = 0; done < windowLength; )
+   {
+      int length = MIN(windowLength - done, mNumSamples - frame);
+      float* dest[ChannelBuffer::kMaxNumChannels];
+      for (int ch=0; ch<window->NumActiveChannels(); ++ch)
+         dest[ch] = window->GetChannel(ch) + done;
+      if (!mStream->Read(frame, length, dest))
+         ready = false;
+      done += length;
+      frame = 0;
+   }
+   if (!ready)
+      window->Clear();   //not off the disk yet, play silence rather than wait for it
+   return ready;
+}
+
 void Sample::PadBack(int amount)
 {
    //TODO(Ryan)
@@ -289,8 +467,9 @@ void Sample::ShiftWrap(int numSamplesToShift)
 
 void Sample::CopyFrom(Sample* sample)
 {
+   sample->LoadFully();
    mNumSamples = sample->mNumSamples;
-   mData.CopyFrom(&sample->mData);
+   mData.CopyFrom(sample->Data());
    mNumBars = sample->mNumBars;
    mLooping = sample->mLooping;
    mRate = sample->mRate;
@@ -310,6 +489,7 @@ void Sample::SaveState(FileStreamOut& out)
    out << kSaveStateRev;
    
    out << mNumSamples;
+   LoadFully();
    if (mNumSamples > 0)
       mData.Save(out, mNumSamples);
    out << mNumBars;
@@ -326,6 +506,7 @@ void Sample::LoadState(FileStreamIn& in)
    int rev;
    in >> rev;
    
+   StopStreaming();
    in >> mNumSamples;
    if (mNumSamples > 0)
    {
@@ -11,6 +11,7 @@
 
 #include "OpenFrameworksPort.h"
 #include "ChannelBuffer.h"
+#include "SampleStream.h"
 
 class FileStreamOut;
 class FileStreamIn;
@@ -23,7 +24,8 @@ public:
    enum class ReadType
    {
       Sync,
-      Async
+      Async,
+      Stream   //only the start is loaded, the rest plays from disk until LoadFully() is called
    };
 
    Sample();
@@ -36,7 +38,13 @@ public:
    const char* Name() { return mName; }
    int LengthInSamples() const { return mNumSamples; }
    int NumChannels() const { return mData.NumActiveChannels(); }
-   ChannelBuffer* Data() { return &mData; }
+   ChannelBuffer* Data() { assert(mStream == nullptr); return &mData; }   //call LoadFully() first on streamed samples
+   bool IsStreaming() const { return mStream != nullptr; }
+   //audio thread, streamed samples only. fills window with the frames from start on, wrapping past the end.
+   //returns false and leaves silence if the stream hasn't read them in yet.
+   bool ReadStreamedFrames(int start, ChannelBuffer* window);
+   void LoadFully();
+   void Draw(float width, float height, float start, float end, float pos, float vol = 1, ofColor color = ofColor::black);
    int GetPlayPosition() const { return mOffset; }
    void SetPlayPosition(int sample) { mOffset = sample; }
    float GetSampleRateRatio() const { return mSampleRateRatio; }
@@ -63,9 +71,13 @@ public:
    
    void SaveState(FileStreamOut& out);
    void LoadState(FileStreamIn& in);
+   
+   static const int kMaxStreamWindow = 8192;   //more than this in one block is a rate we don't bother streaming for
 private:
    void Setup(int length);
-   void FinishRead();
+   void ReadIntoData(int startSample, int numSamples);
+   void StopStreaming();
+   void ConsumeStreamedData(double time, ChannelBuffer* out, int size, bool replace, float end);
    //juce::Timer
    void timerCallback();
    
@@ -85,8 +97,8 @@ private:
    float mVolume;
 
    AudioFormatReader* mReader;
-   unique_ptr<AudioSampleBuffer> mReadBuffer;
    int mSamplesLeftToRead;
+   unique_ptr<SampleStream> mStream;
 };
 
 #endif /* defined(__modularSynth__Sample__) */
@@ -41,7 +41,7 @@ void SampleBank::DrawModule()
    {
       ofPushMatrix();
       ofTranslate(5, 22);
-      DrawAudioBuffer(190, 55, mSamples[mSampleIdx].mSample->Data(), 0, mSamples[mSampleIdx].mSample->LengthInSamples(), -1);
+      mSamples[mSampleIdx].mSample->Draw(190, 55, 0, mSamples[mSampleIdx].mSample->LengthInSamples(), -1);
       ofPopMatrix();
    }
 }
@@ -54,6 +54,7 @@ void SampleBank::OnClicked(int x, int y, bool right)
    {
       if (mSampleIdx >= 0 && mSampleIdx < mSamples.size())
       {
+         mSamples[mSampleIdx].mSample->LoadFully();
          TheSynth->GrabSample(mSamples[mSampleIdx].mSample->Data(), false, mSamples[mSampleIdx].mSample->GetNumBars());
       }
    }
@@ -92,7 +93,7 @@ void SampleBank::LoadList(const char* filename)
             string type = tokens[4];
 
             Sample* sample = new Sample();
-            sample->Read(wavFile.c_str());
+            sample->Read(wavFile.c_str(), false, Sample::ReadType::Stream);
 
             SampleInfo info;
             info.mSample = sample;
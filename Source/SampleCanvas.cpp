@@ -57,7 +57,9 @@ void SampleCanvas::Process(double time)
    float* out = GetTarget()->GetBuffer()->GetChannel(0);
    assert(bufferSize == gBufferSize);
    
-   Clear(gWorkBuffer, bufferSize);
+   ScratchArena::Scope scratch;
+   float* mixBuffer = scratch.Alloc(bufferSize);
+   Clear(mixBuffer, bufferSize);
    
    const vector<CanvasElement*>& elements = mCanvas->GetElements();
    for (int elemIdx = 0; elemIdx < elements.size(); ++elemIdx)
@@ -89,12 +91,12 @@ void SampleCanvas::Process(double time)
          
          //TODO(Ryan) multichannel
          if (sample >= 0 && sample < clip->LengthInSamples() * numLoops)
-            gWorkBuffer[i] += GetInterpolatedSample(sample, clip->Data()->GetChannel(0), clip->LengthInSamples());
+            mixBuffer[i] += GetInterpolatedSample(sample, clip->Data()->GetChannel(0), clip->LengthInSamples());
       }
    }
    
-   Add(out, gWorkBuffer, bufferSize);
-   GetVizBuffer()->WriteChunk(gWorkBuffer, bufferSize, 0);
+   Add(out, mixBuffer, bufferSize);
+   GetVizBuffer()->WriteChunk(mixBuffer, bufferSize, 0);
 }
 
 void SampleCanvas::OnClicked(int x, int y, bool right)
@@ -52,11 +52,13 @@ void SampleCapturer::Process(double time)
    if (GetTarget())
    {
       ChannelBuffer* out = GetTarget()->GetBuffer();
-      gWorkChannelBuffer.SetNumActiveChannels(GetBuffer()->NumActiveChannels());
+      ScratchArena::Scope scratch;
+      ChannelBuffer vizBuffer(scratch, bufferSize);
+      vizBuffer.SetNumActiveChannels(GetBuffer()->NumActiveChannels());
       for (int ch = 0; ch < GetBuffer()->NumActiveChannels(); ++ch)
       {
          Add(out->GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
-         BufferCopy(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+         BufferCopy(vizBuffer.GetChannel(ch), GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
       }
 
       for (int i = 0; i < bufferSize; ++i)
@@ -109,7 +111,7 @@ void SampleCapturer::Process(double time)
                for (int ch = 0; ch < GetBuffer()->NumActiveChannels(); ++ch)
                {
                   out->GetChannel(ch)[i] += mSamples[sample].mBuffer.GetChannel(ch)[mSamples[sample].mPlaybackPos];
-                  gWorkChannelBuffer.GetChannel(ch)[i] += mSamples[sample].mBuffer.GetChannel(ch)[mSamples[sample].mPlaybackPos];
+                  vizBuffer.GetChannel(ch)[i] += mSamples[sample].mBuffer.GetChannel(ch)[mSamples[sample].mPlaybackPos];
                }
                ++mSamples[sample].mPlaybackPos;
                if (mSamples[sample].mPlaybackPos >= mSamples[sample].mRecordingLength)
@@ -122,7 +124,7 @@ void SampleCapturer::Process(double time)
       }
 
       for (int ch = 0; ch < GetBuffer()->NumActiveChannels(); ++ch)
-         GetVizBuffer()->WriteChunk(gWorkChannelBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
+         GetVizBuffer()->WriteChunk(vizBuffer.GetChannel(ch), GetBuffer()->BufferSize(), ch);
    }
 
    GetBuffer()->Reset();
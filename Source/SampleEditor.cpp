@@ -111,10 +111,12 @@ void SampleEditor::Process(double time)
       RecalcPos();
    mSample->SetRate(speed);
 
-   gWorkChannelBuffer.SetNumActiveChannels(mSample->NumChannels());
-   if (mSample->ConsumeData(time, &gWorkChannelBuffer, bufferSize, true))
+   ScratchArena::Scope scratch;
+   ChannelBuffer sampleBuffer(scratch, bufferSize);
+   sampleBuffer.SetNumActiveChannels(mSample->NumChannels());
+   if (mSample->ConsumeData(time, &sampleBuffer, bufferSize, true))
    {
-      for (int ch=0; ch<gWorkChannelBuffer.NumActiveChannels(); ++ch)
+      for (int ch=0; ch<sampleBuffer.NumActiveChannels(); ++ch)
       {
          float pitchShift = mPitchShift;
          if (mKeepPitch)
@@ -124,17 +126,17 @@ void SampleEditor::Process(double time)
          if (pitchShift != 1)
          {
             mPitchShifter[ch]->SetRatio(pitchShift);
-            mPitchShifter[ch]->Process(gWorkChannelBuffer.GetChannel(ch), bufferSize);
+            mPitchShifter[ch]->Process(sampleBuffer.GetChannel(ch), bufferSize);
          }
          
-         Mult(gWorkChannelBuffer.GetChannel(ch), volSq, bufferSize);
-         Add(GetTarget()->GetBuffer()->GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), bufferSize);
-         GetVizBuffer()->WriteChunk(gWorkChannelBuffer.GetChannel(ch), bufferSize, ch);
+         Mult(sampleBuffer.GetChannel(ch), volSq, bufferSize);
+         Add(GetTarget()->GetBuffer()->GetChannel(ch), sampleBuffer.GetChannel(ch), bufferSize);
+         GetVizBuffer()->WriteChunk(sampleBuffer.GetChannel(ch), bufferSize, ch);
       }
    }
    else
    {
-      for (int ch=0; ch<gWorkChannelBuffer.NumActiveChannels(); ++ch)
+      for (int ch=0; ch<sampleBuffer.NumActiveChannels(); ++ch)
          GetVizBuffer()->WriteChunk(gZeroBuffer, bufferSize, ch);
    }
 }
@@ -182,6 +184,7 @@ void SampleEditor::UpdateSample()
 {
    const SampleInfo& info = mBank->GetSampleInfo(mSampleIndex);
    mSample = info.mSample;
+   mSample->LoadFully();   //the editor works on the whole sample
    mSample->Reset();
    if (info.mOffset < 0)
       mMeasureEarly = 1;
@@ -243,38 +243,40 @@ void SamplePlayer::Process(double time)
    }
    mSample->SetRate(mPlaySpeed);
    
-   gWorkChannelBuffer.SetNumActiveChannels(mSample->NumChannels());
+   ScratchArena::Scope scratch;
+   ChannelBuffer sampleBuffer(scratch, bufferSize);
+   sampleBuffer.SetNumActiveChannels(mSample->NumChannels());
    mLastOutputSample.SetNumActiveChannels(mSample->NumChannels());
    mSwitchAndRampVal.SetNumActiveChannels(mSample->NumChannels());
 
-   if (mPlay && mSample->ConsumeData(time, &gWorkChannelBuffer, bufferSize, true))
+   if (mPlay && mSample->ConsumeData(time, &sampleBuffer, bufferSize, true))
    {
-      for (int ch = 0; ch < gWorkChannelBuffer.NumActiveChannels(); ++ch)
+      for (int ch = 0; ch < sampleBuffer.NumActiveChannels(); ++ch)
       {
          for (int i = 0; i < bufferSize; ++i)
-            gWorkChannelBuffer.GetChannel(ch)[i] *= volSq * mAdsr.Value(time + i * gInvSampleRateMs);
+            sampleBuffer.GetChannel(ch)[i] *= volSq * mAdsr.Value(time + i * gInvSampleRateMs);
       }
    }
    else
    {
-      gWorkChannelBuffer.Clear();
+      sampleBuffer.Clear();
       mPlay = false;
       mAdsr.Stop(time);
    }
 
-   for (int ch = 0; ch < gWorkChannelBuffer.NumActiveChannels(); ++ch)
+   for (int ch = 0; ch < sampleBuffer.NumActiveChannels(); ++ch)
    {
       for (int i = 0; i < bufferSize; ++i)
       {
-         gWorkChannelBuffer.GetChannel(ch)[i] += mSwitchAndRampVal.GetChannel(ch)[0];
+         sampleBuffer.GetChannel(ch)[i] += mSwitchAndRampVal.GetChannel(ch)[0];
          mSwitchAndRampVal.GetChannel(ch)[0] *= .999f;
          if (mSwitchAndRampVal.GetChannel(ch)[0] < .0001f && mSwitchAndRampVal.GetChannel(ch)[0] > -.0001f)
             mSwitchAndRampVal.GetChannel(ch)[0] = 0;
       }
 
-      Add(GetTarget()->GetBuffer()->GetChannel(ch), gWorkChannelBuffer.GetChannel(ch), bufferSize);
-      GetVizBuffer()->WriteChunk(gWorkChannelBuffer.GetChannel(ch), bufferSize, ch);
-      mLastOutputSample.GetChannel(ch)[0] = gWorkChannelBuffer.GetChannel(ch)[bufferSize-1];
+      Add(GetTarget()->GetBuffer()->GetChannel(ch), sampleBuffer.GetChannel(ch), bufferSize);
+      GetVizBuffer()->WriteChunk(sampleBuffer.GetChannel(ch), bufferSize, ch);
+      mLastOutputSample.GetChannel(ch)[0] = sampleBuffer.GetChannel(ch)[bufferSize-1];
    }
 }
 
@@ -364,7 +366,7 @@ void SamplePlayer::RadioButtonUpdated(RadioButton* radio, int oldVal)
 void SamplePlayer::FilesDropped(vector<string> files, int x, int y)
 {
    Sample* sample = new Sample();
-   sample->Read(files[0].c_str());
+   sample->Read(files[0].c_str(), false, Sample::ReadType::Stream);
    UpdateSample(sample, true);
 }
 
@@ -498,7 +500,7 @@ void SamplePlayer::OnYoutubeDownloadComplete(string filename)
    Sample* sample = new Sample();
    if (juce::File(ofToDataPath(filename)).existsAsFile())
    {
-      sample->Read(ofToDataPath(filename).c_str(), false, Sample::ReadType::Async);
+      sample->Read(ofToDataPath(filename).c_str(), false, Sample::ReadType::Stream);
       UpdateSample(sample, true);
    }
    else
@@ -542,7 +544,7 @@ void SamplePlayer::LoadFile()
 
       Sample* sample = new Sample();
       if (file.existsAsFile())
-         sample->Read(file.getFullPathName().toStdString().c_str());
+         sample->Read(file.getFullPathName().toStdString().c_str(), false, Sample::ReadType::Stream);
       UpdateSample(sample, true);
    }
 }
@@ -732,12 +734,18 @@ void SamplePlayer::DrawModule()
       if (mIsLoadingSample && !mSample->IsSampleLoading())
       {
          mIsLoadingSample = false;
-         mDrawBuffer.Resize(mSample->LengthInSamples());
-         mDrawBuffer.CopyFrom(mSample->Data());
+         if (!mSample->IsStreaming())
+         {
+            mDrawBuffer.Resize(mSample->LengthInSamples());
+            mDrawBuffer.CopyFrom(mSample->Data());
+         }
       }
 
       float sampleWidth = mWidth - 10;
-      DrawAudioBuffer(sampleWidth, mHeight - 65, &mDrawBuffer, GetZoomStartSample(), GetZoomEndSample(), mSample->GetPlayPosition());
+      if (mSample->IsStreaming())
+         mSample->Draw(sampleWidth, mHeight - 65, GetZoomStartSample(), GetZoomEndSample(), mSample->GetPlayPosition());
+      else
+         DrawAudioBuffer(sampleWidth, mHeight - 65, &mDrawBuffer, GetZoomStartSample(), GetZoomEndSample(), mSample->GetPlayPosition());
       
       ofPushStyle();
       ofFill();
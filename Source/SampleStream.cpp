@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    SampleStream.cpp
+    Created: 18 Oct 2026 7:48:12pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "SampleStream.h"
+#include "SynthGlobals.h"
+#include "ModularSynth.h"
+#include "ChannelBuffer.h"
+
+namespace
+{
+   juce::TimeSliceThread& GetStreamingThread()
+   {
+      static juce::TimeSliceThread sThread("sample streaming");
+      if (!sThread.isThreadRunning())
+         sThread.startThread(5);
+      return sThread;
+   }
+}
+
+//static
+SampleStream* SampleStream::Open(const juce::File& file, int numChannels)
+{
+   juce::AudioFormatManager& formats = TheSynth->GetGlobalManagers()->mAudioFormatManager;
+
+   juce::MemoryMappedAudioFormatReader* mappedReader = nullptr;
+   juce::AudioFormat* format = formats.findFormatForFileExtension(file.getFileExtension());
+   if (format != nullptr)
+   {
+      mappedReader = format->createMemoryMappedReader(file);   //only the uncompressed formats give us one
+      if (mappedReader != nullptr && !mappedReader->mapEntireFile())
+      {
+         delete mappedReader;
+         mappedReader = nullptr;
+      }
+   }
+
+   juce::AudioFormatReader* reader = nullptr;
+   if (mappedReader == nullptr)
+   {
+      reader = formats.createReaderFor(file);
+      if (reader == nullptr)
+         return nullptr;
+   }
+
+   return new SampleStream(reader, mappedReader, MIN(numChannels, ChannelBuffer::kMaxNumChannels));
+}
+
+SampleStream::SampleStream(juce::AudioFormatReader* reader, juce::MemoryMappedAudioFormatReader* mappedReader, int numChannels)
+: mReader(reader)
+, mMappedReader(mappedReader)
+, mOverviewFrames(0)
+, mRingStart(0)
+, mRingEnd(0)
+, mGeneration(0)
+, mPlayFrame(0)
+, mNumUnderruns(0)
+{
+   juce::AudioFormatReader* source = mMappedReader ? mMappedReader.get() : mReader.get();
+   mLength = (int)source->lengthInSamples;
+   mNumChannels = MIN(numChannels, (int)source->numChannels);
+   mSampleRate = source->sampleRate;
+   mHeadLength = MIN(mLength, kHeadFrames);
+
+   mFileReadBuffer.setSize(source->numChannels, kChunkFrames);
+   mHead.setSize(mNumChannels, MAX(1, mHeadLength));
+   ReadFromFile(0, mHeadLength, mHead.getArrayOfWritePointers(), mFileReadBuffer);
+   
+   //the head is already in ram, the rest of the overview gets read on the streaming thread so opening doesn't decode the whole file
+   int numPeaks = (mLength + kOverviewDecimation - 1) / kOverviewDecimation;
+   mOverview.setSize(mNumChannels, MAX(1, numPeaks));
+   mOverview.clear();
+   AddToOverview(0, mHeadLength, mHead.getArrayOfReadPointers());
+   mOverviewFrames.store(mHeadLength);
+   if (mHeadLength < mLength)
+      mOverviewReadBuffer.setSize(mNumChannels, kChunkFrames);
+
+   if (mMappedReader != nullptr)
+      mMappedReadBuffer.setSize(source->numChannels, kChunkFrames);
+   else
+      mRing.setSize(mNumChannels, kRingFrames);
+
+   if (mHeadLength < mLength)
+      GetStreamingThread().addTimeSliceClient(this);
+}
+
+SampleStream::~SampleStream()
+{
+   if (mHeadLength < mLength)
+      GetStreamingThread().removeTimeSliceClient(this);   //waits if it's in the middle of filling us
+}
+
+void SampleStream::ReadFromFile(int start, int numFrames, float* const* dest, juce::AudioSampleBuffer& readBuffer)
+{
+   //readBuffer has a channel for each channel in the file and room for kChunkFrames, so reading doesn't allocate
+   juce::AudioFormatReader* source = mMappedReader ? mMappedReader.get() : mReader.get();
+   int fileChannels = readBuffer.getNumChannels();
+
+   for (int done = 0; done < numFrames; )
+   {
+      int chunk = MIN(kChunkFrames, numFrames - done);
+      source->read(&readBuffer, 0, chunk, start + done, true, true);
+      if (mNumChannels == 1 && fileChannels > 1)
+      {
+         BufferCopy(dest[0] + done, readBuffer.getReadPointer(0), chunk);  //put first channel in
+         for (int ch = 1; ch < fileChannels; ++ch)
+            Add(dest[0] + done, readBuffer.getReadPointer(ch), chunk);   //add the other channels
+         Mult(dest[0] + done, 1.0f / fileChannels, chunk);   //normalize volume
+      }
+      else
+      {
+         for (int ch = 0; ch < mNumChannels; ++ch)
+            BufferCopy(dest[ch] + done, readBuffer.getReadPointer(ch), chunk);
+      }
+      done += chunk;
+   }
+}
+
+void SampleStream::AddToOverview(int start, int numFrames, const float* const* data)
+{
+   //start is always a multiple of kOverviewDecimation: 0, kHeadFrames, or a kChunkFrames step past it
+   for (int ch = 0; ch < mNumChannels; ++ch)
+   {
+      float* peaks = mOverview.getWritePointer(ch, start / kOverviewDecimation);
+      for (int i = 0; i < numFrames; ++i)
+         peaks[i / kOverviewDecimation] = MAX(peaks[i / kOverviewDecimation], fabsf(data[ch][i]));
+   }
+}
+
+void SampleStream::BuildOverviewChunk()
+{
+   int start = mOverviewFrames.load();
+   int numFrames = MIN(kChunkFrames, mLength - start);
+   ReadFromFile(start, numFrames, mOverviewReadBuffer.getArrayOfWritePointers(), mFileReadBuffer);
+   AddToOverview(start, numFrames, mOverviewReadBuffer.getArrayOfReadPointers());
+   mOverviewFrames.store(start + numFrames);
+}
+
+bool SampleStream::Read(int start, int numFrames, float* const* dest)
+{
+   assert(start >= 0 && start + numFrames <= mLength);
+
+   int fromHead = MIN(numFrames, MAX(0, mHeadLength - start));
+   for (int ch = 0; ch < mNumChannels; ++ch)
+      BufferCopy(dest[ch], mHead.getReadPointer(ch, MAX(0, MIN(start, mHeadLength - 1))), fromHead);
+   if (fromHead == numFrames)
+      return true;
+
+   float* rest[ChannelBuffer::kMaxNumChannels];
+   for (int ch = 0; ch < mNumChannels; ++ch)
+      rest[ch] = dest[ch] + fromHead;
+
+   bool ready;
+   if (mMappedReader != nullptr)
+      ready = ReadMapped(start + fromHead, numFrames - fromHead, rest);
+   else
+      ready = ReadRing(start + fromHead, numFrames - fromHead, rest);
+
+   if (!ready)
+      mNumUnderruns.fetch_add(1);
+   return ready;
+}
+
+bool SampleStream::ReadMapped(int start, int numFrames, float* const* dest)
+{
+   //the pages are normally already resident, the streaming thread touches them ahead of the playhead
+   ReadFromFile(start, numFrames, dest, mMappedReadBuffer);
+   return true;
+}
+
+bool SampleStream::ReadRing(int start, int numFrames, float* const* dest)
+{
+   int generation = mGeneration.load();
+   if (start < mRingStart.load() || start + numFrames > mRingEnd.load())
+      return false;
+
+   int ringPos = start % kRingFrames;
+   int firstPart = MIN(numFrames, kRingFrames - ringPos);
+   for (int ch = 0; ch < mNumChannels; ++ch)
+   {
+      BufferCopy(dest[ch], mRing.getReadPointer(ch, ringPos), firstPart);
+      if (firstPart < numFrames)
+         BufferCopy(dest[ch] + firstPart, mRing.getReadPointer(ch, 0), numFrames - firstPart);
+   }
+
+   //the streaming thread might have lapped us or seeked while we were copying
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return mGeneration.load() == generation && start >= mRingStart.load();
+}
+
+//juce::TimeSliceClient
+int SampleStream::useTimeSlice()
+{
+   int wait;
+   if (mMappedReader != nullptr)
+   {
+      //fault in the pages the audio thread is about to read, so it doesn't have to
+      int play = mPlayFrame.load();
+      int end = MIN(mLength, play + kRingFrames);
+      for (int frame = MAX(play, mHeadLength); frame < end; frame += 1024)
+         mMappedReader->touchSample(frame);
+      wait = 50;
+   }
+   else
+   {
+      wait = FillRing();
+   }
+
+   //playback comes first, the overview gets a chunk whenever it's far enough ahead
+   if (wait > 0 && !IsOverviewComplete())
+   {
+      BuildOverviewChunk();
+      return 0;
+   }
+   return wait;
+}
+
+int SampleStream::FillRing()
+{
+   int want = MAX(mPlayFrame.load(), mHeadLength);   //anything before the end of the head is already in ram
+   if (want >= mLength)
+      return 20;
+
+   int start = mRingStart.load();
+   int end = mRingEnd.load();
+   if (want < start || want > end)
+   {
+      //playback jumped somewhere we don't have, start over from there
+      mRingStart.store(want);
+      mRingEnd.store(want);
+      mGeneration.fetch_add(1);
+      start = end = want;
+   }
+
+   int limit = MIN(mLength, want + kRingFrames - kGuardFrames);
+   if (end >= limit)
+      return 10;   //far enough ahead
+
+   int numFrames = MIN(kChunkFrames, limit - end);
+   mRingStart.store(MAX(start, end + numFrames - kRingFrames));   //about to overwrite these
+   std::atomic_thread_fence(std::memory_order_release);
+
+   int ringPos = end % kRingFrames;
+   int firstPart = MIN(numFrames, kRingFrames - ringPos);
+   float* dest[ChannelBuffer::kMaxNumChannels];
+   for (int ch = 0; ch < mNumChannels; ++ch)
+      dest[ch] = mRing.getWritePointer(ch, ringPos);
+   ReadFromFile(end, firstPart, dest, mFileReadBuffer);
+   if (firstPart < numFrames)
+   {
+      for (int ch = 0; ch < mNumChannels; ++ch)
+         dest[ch] = mRing.getWritePointer(ch, 0);
+      ReadFromFile(end + firstPart, numFrames - firstPart, dest, mFileReadBuffer);
+   }
+
+   mRingEnd.store(end + numFrames);
+   return 0;
+}
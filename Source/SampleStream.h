@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    SampleStream.h
+    Created: 18 Oct 2026 7:48:12pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include <atomic>
+#include <memory>
+
+//plays a sample file without loading all of it. the first kHeadFrames are kept in ram so playback
+//can start right away. uncompressed wav/aiff are read straight out of memory-mapped file pages,
+//everything else is streamed into a ring buffer by a shared background thread.
+class SampleStream : public juce::TimeSliceClient
+{
+public:
+   //nullptr if the file can't be read. numChannels less than the file's means mixing down to mono.
+   static SampleStream* Open(const juce::File& file, int numChannels);
+   ~SampleStream();
+
+   int GetLength() const { return mLength; }
+   int GetNumChannels() const { return mNumChannels; }
+   double GetSampleRate() const { return mSampleRate; }
+   bool IsMemoryMapped() const { return mMappedReader != nullptr; }
+   int GetNumUnderruns() const { return mNumUnderruns.load(); }
+
+   //peak level of every kOverviewDecimation frames, so the whole sample can be drawn without loading it.
+   //the streaming thread fills it in behind playback, peaks it hasn't got to yet read as zero.
+   const juce::AudioSampleBuffer& GetOverview() const { return mOverview; }
+   bool IsOverviewComplete() const { return mOverviewFrames.load() >= mLength; }
+
+   //tells the background thread where playback is, so it can read ahead from there
+   void SetPlayPosition(int frame) { mPlayFrame.store(frame); }
+
+   //audio thread. copies frames [start, start+numFrames) into dest, one pointer per channel.
+   //never blocks. returns false if part of the range hasn't been read in from disk yet.
+   bool Read(int start, int numFrames, float* const* dest);
+
+   //juce::TimeSliceClient
+   int useTimeSlice() override;
+
+   static const int kHeadFrames = 1 << 15;
+   static const int kOverviewDecimation = 256;
+
+private:
+   SampleStream(juce::AudioFormatReader* reader, juce::MemoryMappedAudioFormatReader* mappedReader, int numChannels);
+   void ReadFromFile(int start, int numFrames, float* const* dest, juce::AudioSampleBuffer& readBuffer);
+   void AddToOverview(int start, int numFrames, const float* const* data);
+   void BuildOverviewChunk();
+   bool ReadMapped(int start, int numFrames, float* const* dest);
+   bool ReadRing(int start, int numFrames, float* const* dest);
+   int FillRing();
+
+   static const int kRingFrames = 1 << 17;
+   static const int kGuardFrames = 1 << 13;   //room the audio thread keeps reading into while the ring refills
+   static const int kChunkFrames = 1 << 13;
+
+   std::unique_ptr<juce::AudioFormatReader> mReader;
+   std::unique_ptr<juce::MemoryMappedAudioFormatReader> mMappedReader;
+   int mLength;
+   int mNumChannels;
+   double mSampleRate;
+   int mHeadLength;
+   juce::AudioSampleBuffer mHead;
+   juce::AudioSampleBuffer mOverview;
+   std::atomic<int> mOverviewFrames;   //how far into the file mOverview covers
+
+   //the ring holds frames [mRingStart, mRingEnd) of the file. only the streaming thread moves them,
+   //and it bumps mGeneration whenever it throws the ring away to seek.
+   juce::AudioSampleBuffer mRing;
+   std::atomic<int> mRingStart;
+   std::atomic<int> mRingEnd;
+   std::atomic<int> mGeneration;
+   std::atomic<int> mPlayFrame;
+   std::atomic<int> mNumUnderruns;
+
+   juce::AudioSampleBuffer mFileReadBuffer;   //streaming thread only
+   juce::AudioSampleBuffer mOverviewReadBuffer;   //streaming thread only
+   juce::AudioSampleBuffer mMappedReadBuffer;   //audio thread only
+};
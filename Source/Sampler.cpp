@@ -220,18 +220,30 @@ void Sampler::GetModuleDimensions(float& width, float& height)
 
 void Sampler::FilesDropped(vector<string> files, int x, int y)
 {
-   Sample sample;
-   sample.Read(files[0].c_str());
-   SampleDropped(x,y,&sample);
+   //the voices only ever play the first MAX_SAMPLER_LENGTH samples, so don't decode any more of the file than that
+   File file(ofToDataPath(files[0]));
+   unique_ptr<AudioFormatReader> reader(TheSynth->GetGlobalManagers()->mAudioFormatManager.createReaderFor(file));
+   if (reader == nullptr)
+   {
+      TheSynth->LogEvent("failed to load sample " + file.getFullPathName().toStdString(), kLogEventType_Error);
+      return;
+   }
+   
+   int numSamples = MIN(MAX_SAMPLER_LENGTH, (int)reader->lengthInSamples);
+   AudioSampleBuffer buffer(reader->numChannels, MAX(1, numSamples));
+   reader->read(&buffer, 0, numSamples, 0, true, true);
+   SetSampleData(buffer.getReadPointer(0), numSamples);
 }
 
 void Sampler::SampleDropped(int x, int y, Sample* sample)
 {
    assert(sample);
    //TODO(Ryan) multichannel
-   const float* data = sample->Data()->GetChannel(0);
-   int numSamples = sample->LengthInSamples();
-   
+   SetSampleData(sample->Data()->GetChannel(0), sample->LengthInSamples());
+}
+
+void Sampler::SetSampleData(const float* data, int numSamples)
+{
    if (numSamples <= 0)
       return;
    
@@ -246,6 +258,9 @@ void Sampler::LoadLayout(const ofxJSONElement& moduleInfo)
 {
    mModuleSaveData.LoadString("target", moduleInfo);
    mModuleSaveData.LoadBool("loop", moduleInfo, false);
+   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kMaxPolyphony);
+   EnumMap voiceStealMap = PolyphonyMgr::GetVoiceStealMap();
+   mModuleSaveData.LoadEnum<VoiceStealPolicy>("voicesteal", moduleInfo, kVoiceSteal_Oldest, nullptr, &voiceStealMap);
    
    SetUpFromSaveData();
 }
@@ -254,6 +269,10 @@ void Sampler::SetUpFromSaveData()
 {
    SetTarget(TheSynth->FindModule(mModuleSaveData.GetString("target")));
    mVoiceParams.mLoop = mModuleSaveData.GetBool("loop");
+   int voiceLimit = mModuleSaveData.GetInt("voicelimit");
+   if (voiceLimit > 0)
+      mPolyMgr.SetVoiceLimit(voiceLimit);
+   mPolyMgr.SetStealPolicy(mModuleSaveData.GetEnum<VoiceStealPolicy>("voicesteal"));
 }
 
 
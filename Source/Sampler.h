@@ -65,6 +65,7 @@ public:
 private:
    void StopRecording();
    float DetectSampleFrequency();
+   void SetSampleData(const float* data, int numSamples);
    
    //IDrawableModule
    void DrawModule() override;
@@ -93,7 +93,9 @@ void SamplerGrid::Process(double time)
    
    int bufferSize = GetBuffer()->BufferSize();
    
-   Clear(gWorkBuffer, gBufferSize);
+   ScratchArena::Scope scratch;
+   float* mixBuffer = scratch.Alloc(gBufferSize);
+   Clear(mixBuffer, gBufferSize);
    
    float volSq = mVolume * mVolume;
    
@@ -105,7 +107,7 @@ void SamplerGrid::Process(double time)
          float rampVal = sample.mRamp.Value(time);
          if (rampVal > 0 && sample.mPlayhead < sample.mSampleEnd)
          {
-            gWorkBuffer[i] += sample.mSampleData[sample.mPlayhead] * rampVal * volSq;
+            mixBuffer[i] += sample.mSampleData[sample.mPlayhead] * rampVal * volSq;
             ++sample.mPlayhead;
             if (sample.mRamp.Target(time) == 1 &&
                 sample.mPlayhead + SAMPLE_RAMP_MS/gInvSampleRateMs >= sample.mSampleEnd)
@@ -124,7 +126,7 @@ void SamplerGrid::Process(double time)
             sample.mHasSample = true;
          if (sample.mPlayhead < MAX_SAMPLER_GRID_LENGTH && sample.mHasSample)
          {
-            sample.mSampleData[sample.mPlayhead] = GetBuffer()->GetChannel(0)[i];// + gWorkBuffer[i];
+            sample.mSampleData[sample.mPlayhead] = GetBuffer()->GetChannel(0)[i];// + mixBuffer[i];
             ++sample.mPlayhead;
             sample.mSampleLength = sample.mPlayhead;
             sample.mSampleStart = 0;
@@ -136,12 +138,12 @@ void SamplerGrid::Process(double time)
    if (mPassthrough)
    {
       for (int i=0; i<gBufferSize; ++i)
-         gWorkBuffer[i] += GetBuffer()->GetChannel(0)[i];
+         mixBuffer[i] += GetBuffer()->GetChannel(0)[i];
    }
    
-   GetVizBuffer()->WriteChunk(gWorkBuffer, bufferSize, 0);
+   GetVizBuffer()->WriteChunk(mixBuffer, bufferSize, 0);
    
-   Add(GetTarget()->GetBuffer()->GetChannel(0), gWorkBuffer, bufferSize);
+   Add(GetTarget()->GetBuffer()->GetChannel(0), mixBuffer, bufferSize);
    
    GetBuffer()->Reset();
 }
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    ScratchArena.cpp
+    Created: 18 Oct 2026 2:41:37pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "ScratchArena.h"
+#include "SynthGlobals.h"
+
+namespace
+{
+   thread_local ScratchArena* sBoundArena = nullptr;
+
+   float* AlignTo64(float* memory)
+   {
+      size_t misalignment = reinterpret_cast<size_t>(memory) % 64;
+      return memory + (misalignment == 0 ? 0 : (64 - misalignment) / sizeof(float));
+   }
+   
+   //what Alloc() hands out after an arena runs out. every thread shares it, so it's only ever a last resort
+   alignas(64) float sFallbackBuffer[ScratchArena::kMaxBlockBuffers * kWorkBufferSize];
+}
+
+const int ScratchArena::kDefaultCapacityFloats = kMaxBlockBuffers * kWorkBufferSize;
+
+ScratchArena::ScratchArena(int capacityFloats)
+: mCapacity(capacityFloats)
+, mUsed(0)
+{
+   mMemory = new float[capacityFloats + kAlignmentFloats];
+   mAligned = AlignTo64(mMemory);
+   Clear(mAligned, capacityFloats);
+}
+
+ScratchArena::~ScratchArena()
+{
+   if (sBoundArena == this)
+      sBoundArena = nullptr;
+   delete[] mMemory;
+}
+
+float* ScratchArena::Alloc(int numFloats)
+{
+   int rounded = (numFloats + kAlignmentFloats - 1) / kAlignmentFloats * kAlignmentFloats;
+   if (mUsed + rounded > mCapacity)
+   {
+      assert(false); //out of scratch memory, the arena needs to be bigger
+      assert(rounded <= kDefaultCapacityFloats);
+      return sFallbackBuffer;
+   }
+   float* ret = mAligned + mUsed;
+   mUsed += rounded;
+   return ret;
+}
+
+//static
+ScratchArena& ScratchArena::Get()
+{
+   if (sBoundArena == nullptr)
+   {
+      //threads the scheduler doesn't know about (UI, midi, scripts) get their own, once
+      static thread_local ScratchArena sFallbackArena(kDefaultCapacityFloats);
+      sBoundArena = &sFallbackArena;
+   }
+   return *sBoundArena;
+}
+
+//static
+void ScratchArena::BindToThisThread(ScratchArena* arena)
+{
+   sBoundArena = arena;
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    ScratchArena.h
+    Created: 18 Oct 2026 2:41:37pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+
+//bump allocator for temporary audio buffers. each audio thread gets its own, so modules running
+//in parallel never share scratch memory. the graph scheduler resets them at the start of every block.
+class ScratchArena
+{
+public:
+   explicit ScratchArena(int capacityFloats);
+   ~ScratchArena();
+
+   //64-byte aligned, contents are undefined. running out is a bug, but rather than write past the end or
+   //touch the heap it hands back a shared fallback buffer, so the audio is garbage until the arena is fixed
+   float* Alloc(int numFloats);
+   void Reset() { mUsed = 0; }
+   int GetUsed() const { return mUsed; }
+
+   //the arena for the calling thread
+   static ScratchArena& Get();
+   static void BindToThisThread(ScratchArena* arena);
+
+   static const int kAlignmentFloats = 64 / sizeof(float);
+   static const int kMaxBlockBuffers = 64;   //single-channel buffers of the largest block size that can be live at once
+   static const int kDefaultCapacityFloats;
+
+   //hands out scratch memory from this thread's arena, and gives it all back when it goes out of scope
+   class Scope
+   {
+   public:
+      Scope() : mArena(ScratchArena::Get()), mMark(mArena.mUsed) {}
+      ~Scope() { mArena.mUsed = mMark; }
+      float* Alloc(int numFloats) { return mArena.Alloc(numFloats); }
+   private:
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+      ScratchArena& mArena;
+      int mMark;
+   };
+
+private:
+   ScratchArena(const ScratchArena&) = delete;
+   ScratchArena& operator=(const ScratchArena&) = delete;
+
+   float* mMemory;
+   float* mAligned;
+   int mCapacity;
+   int mUsed;
+};
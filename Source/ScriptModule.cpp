@@ -26,6 +26,8 @@
 #include "pybind11/embed.h"
 #include "pybind11/stl.h"
 
+#include <map>
+
 namespace py = pybind11;
 
 //static
@@ -39,6 +41,66 @@ ScriptModule* ScriptModule::sPriorExecutedModule = nullptr;
 //static
 double ScriptModule::sMostRecentRunTime = 0;
 
+static bool sPythonInitialized = false;
+
+namespace
+{
+   struct ScriptInputEvent
+   {
+      enum Type
+      {
+         kNote,
+         kPulse,
+         kGridButton
+      };
+      Type type;
+      ScriptModule* script;
+      double time;
+      int a;   //pitch, or grid column
+      int b;   //velocity, or grid row
+      float value;
+   };
+   
+   //fed from the audio thread, midi threads and the ui, drained by the script thread
+   MPMCRingQueue<ScriptInputEvent> sInputQueue(1024);
+   juce::WaitableEvent sScriptThreadWakeEvent;
+   std::atomic<int> sNumScheduledMethodCalls(0);
+   PyThreadState* sMainThreadState = nullptr;
+   
+   class ScriptThread : public juce::Thread
+   {
+   public:
+      ScriptThread() : juce::Thread("script") {}
+      void run() override
+      {
+         while (!threadShouldExit())
+         {
+            sScriptThreadWakeEvent.wait(1);  //wake up regularly anyway, for scheduled calls
+            if (sInputQueue.IsEmpty() && sNumScheduledMethodCalls.load() == 0)
+               continue;
+            
+            py::gil_scoped_acquire gil;
+            ScriptModule::ProcessScriptThreadEvents();
+         }
+      }
+   };
+   std::unique_ptr<ScriptThread> sScriptThread;
+   
+   void PushScriptInput(const ScriptInputEvent& event)
+   {
+      if (sInputQueue.Push(event))
+         sScriptThreadWakeEvent.signal();
+   }
+}
+
+struct ScriptModule::PythonCallables
+{
+   py::object mOnNote;
+   py::object mOnPulse;
+   py::object mOnGridButton;
+   std::map<string, py::object> mCompiledMethodCalls;
+};
+
 ScriptModule::ScriptModule()
 : mCodeEntry(nullptr)
 , mRunButton(nullptr)
@@ -50,19 +112,37 @@ ScriptModule::ScriptModule()
 , mD(0)
 , mNextLineToExecute(-1)
 , mInitExecutePriority(0)
+, mCallables(new PythonCallables())
+, mOutputQueue(256)
 {
    InitializePythonIfNecessary();
    
    Reset();
    
-   mScriptModuleIndex = sScriptModules.size();
-   sScriptModules.push_back(this);
+   {
+      py::gil_scoped_acquire gil;
+      mScriptModuleIndex = sScriptModules.size();
+      sScriptModules.push_back(this);
+   }
    
    Transport::sDoEventLookahead = true;   //scripts require lookahead to be able to schedule on time
+   TheTransport->AddAudioPoller(this);
 }
 
 ScriptModule::~ScriptModule()
 {
+   TheTransport->RemoveAudioPoller(this);
+   
+   if (sPythonInitialized)
+   {
+      py::gil_scoped_acquire gil;   //so the script thread can't be running us
+      sScriptModules[mScriptModuleIndex] = nullptr;
+      mCallables.reset();
+   }
+   else
+   {
+      sScriptModules[mScriptModuleIndex] = nullptr;
+   }
 }
 
 void ScriptModule::CreateUIControls()
@@ -83,12 +163,21 @@ void ScriptModule::CreateUIControls()
    ENDUIBLOCK(mWidth, mHeight);
 }
 
-static bool sPythonInitialized = false;
-
 void ScriptModule::UninitializePython()
 {
    if (sPythonInitialized)
+   {
+      sScriptThread->stopThread(1000);
+      sScriptThread.reset();
+      
+      PyEval_RestoreThread(sMainThreadState);
+      for (auto* script : sScriptModules)
+      {
+         if (script)
+            script->mCallables.reset(new PythonCallables());  //these die with the interpreter
+      }
       py::finalize_interpreter();
+   }
    sPythonInitialized = false;
 }
 
@@ -100,6 +189,11 @@ void ScriptModule::InitializePythonIfNecessary()
       py::exec(GetBootstrapImportString(), py::globals());
       
       CodeEntry::OnPythonInit();
+      
+      //the script thread runs python too, so from here on anything that touches it takes the gil first
+      sMainThreadState = PyEval_SaveThread();
+      sScriptThread.reset(new ScriptThread());
+      sScriptThread->startThread(7);
    }
    sPythonInitialized = true;
 }
@@ -295,43 +389,133 @@ void ScriptModule::Poll()
       }
       sScriptsRequestingInitExecution.clear();
    }
+}
+
+//static
+void ScriptModule::ProcessScriptThreadEvents()
+{
+   ScriptInputEvent event;
+   while (sInputQueue.Pop(event))
+   {
+      if (!VectorContains(event.script, sScriptModules))
+         continue;   //deleted while the event was waiting
+      
+      ScriptModule* script = event.script;
+      if (script->mLastError != "")
+         continue;
+      
+      PythonCallables* callables = script->mCallables.get();
+      if (event.type == ScriptInputEvent::kNote && callables->mOnNote)
+         script->RunPython(event.time, [&]() { callables->mOnNote(event.a, event.b); });
+      else if (event.type == ScriptInputEvent::kPulse && callables->mOnPulse)
+         script->RunPython(event.time, [&]() { callables->mOnPulse(); });
+      else if (event.type == ScriptInputEvent::kGridButton && callables->mOnGridButton)
+         script->RunPython(event.time, [&]() { callables->mOnGridButton(event.a, event.b, event.value); });
+   }
    
-   double time = gTime;
-   
-   for (size_t i=0; i<mScheduledPulseTimes.size(); ++i)
+   //run these early enough that what they play gets to the audio thread before it's due
+   double time = gTime + TheTransport->GetEventLookaheadMs();
+   for (auto* script : sScriptModules)
+   {
+      if (script)
+         script->RunScheduledMethodCalls(time);
+   }
+}
+
+void ScriptModule::RunScheduledMethodCalls(double time)
+{
+   for (size_t i=0; i<mScheduledMethodCall.size(); ++i)
    {
-      if (mScheduledPulseTimes[i] != -1)
+      if (mScheduledMethodCall[i].time != -1 &&
+          time > mScheduledMethodCall[i].time)
       {
-         double runTime = mScheduledPulseTimes[i];
-         mScheduledPulseTimes[i] = -1;
-         if (mLastError == "")
+         double runTime = mScheduledMethodCall[i].time;
+         string method = mScheduledMethodCall[i].method;
+         mMethodCallTracker.AddEvent(mScheduledMethodCall[i].lineNum);
+         mScheduledMethodCall[i].time = -1;
+         --sNumScheduledMethodCalls;
+         
+         if (mCallables->mCompiledMethodCalls.size() > 256)
+            mCallables->mCompiledMethodCalls.clear();
+         py::object& code = mCallables->mCompiledMethodCalls[method];
+         RunPython(runTime, [&]()
          {
-            //if (runTime < time)
-            //   ofLog() << "trying to run script triggered by pulse too late!";
-            RunCode(runTime, "on_pulse()");
-         }
+            if (!code)
+            {
+               string fixedUp = method;
+               FixUpCode(fixedUp);
+               code = py::reinterpret_steal<py::object>(Py_CompileString(fixedUp.c_str(), "<scheduled call>", Py_file_input));
+               if (!code)
+                  throw py::error_already_set();
+            }
+            py::object result = py::reinterpret_steal<py::object>(PyEval_EvalCode(code.ptr(), py::globals().ptr(), py::globals().ptr()));
+            if (!result)
+               throw py::error_already_set();
+         });
       }
    }
-   
-   for (size_t i=0; i<mPendingNoteInput.size(); ++i)
+}
+
+//IAudioPoller
+void ScriptModule::OnTransportAdvanced(float amount)
+{
+   ScriptOutputEvent event;
+   while (mOutputQueue.Pop(event))
    {
-      if (mPendingNoteInput[i].time != -1 &&
-          time + TheTransport->GetEventLookaheadMs() > mPendingNoteInput[i].time)
+      if (event.type == ScriptOutputEvent::kStop)
       {
-         if (mLastError == "")
+         //run through any scheduled note offs, so nothing gets stuck on
+         for (size_t i=0; i<mScheduledNoteOutput.size(); ++i)
          {
-            //if (mPendingNoteInput[i].time < time)
-            //   ofLog() << "trying to run script triggered by note too late!";
-            RunCode(mPendingNoteInput[i].time, "on_note("+ofToString(mPendingNoteInput[i].pitch)+", "+ofToString(mPendingNoteInput[i].velocity)+")");
+            if (mScheduledNoteOutput[i].time != -1 &&
+                mScheduledNoteOutput[i].velocity == 0)
+               PlayNote(gTime, mScheduledNoteOutput[i].pitch, 0, 0, mScheduledNoteOutput[i].noteOutputIndex, mScheduledNoteOutput[i].lineNum);
+            mScheduledNoteOutput[i].time = -1;
+         }
+         for (size_t i=0; i<mScheduledUIControlValue.size(); ++i)
+            mScheduledUIControlValue[i].time = -1;
+      }
+      else if (event.type == ScriptOutputEvent::kNote)
+      {
+         for (size_t i=0; i<mScheduledNoteOutput.size(); ++i)
+         {
+            if (mScheduledNoteOutput[i].time == -1)
+            {
+               mScheduledNoteOutput[i].time = event.time;
+               mScheduledNoteOutput[i].startTime = event.startTime;
+               mScheduledNoteOutput[i].pitch = event.pitch;
+               mScheduledNoteOutput[i].velocity = event.velocity;
+               mScheduledNoteOutput[i].pan = event.pan;
+               mScheduledNoteOutput[i].noteOutputIndex = event.noteOutputIndex;
+               mScheduledNoteOutput[i].lineNum = event.lineNum;
+               break;
+            }
+         }
+      }
+      else if (event.type == ScriptOutputEvent::kUIControl)
+      {
+         for (size_t i=0; i<mScheduledUIControlValue.size(); ++i)
+         {
+            if (mScheduledUIControlValue[i].time == -1)
+            {
+               mScheduledUIControlValue[i].time = event.time;
+               mScheduledUIControlValue[i].startTime = event.startTime;
+               mScheduledUIControlValue[i].control = event.control;
+               mScheduledUIControlValue[i].value = event.value;
+               mScheduledUIControlValue[i].lineNum = event.lineNum;
+               break;
+            }
          }
-         mPendingNoteInput[i].time = -1;
       }
    }
    
+   //everything due before the end of this block goes out now, with its own timestamp
+   double blockEndTime = gTime + gBufferSize * gInvSampleRateMs;
+   
    for (size_t i=0; i<mScheduledUIControlValue.size(); ++i)
    {
       if (mScheduledUIControlValue[i].time != -1 &&
-          time + TheTransport->GetEventLookaheadMs() > mScheduledUIControlValue[i].time)
+          blockEndTime > mScheduledUIControlValue[i].time)
       {
          AdjustUIControl(mScheduledUIControlValue[i].control, mScheduledUIControlValue[i].value, mScheduledUIControlValue[i].lineNum);
          mScheduledUIControlValue[i].time = -1;
@@ -343,7 +527,7 @@ void ScriptModule::Poll()
    {
       if (mScheduledNoteOutput[i].time != -1 &&
           mScheduledNoteOutput[i].velocity == 0 &&
-          time + TheTransport->GetEventLookaheadMs() > mScheduledNoteOutput[i].time)
+          blockEndTime > mScheduledNoteOutput[i].time)
       {
          PlayNote(mScheduledNoteOutput[i].time, mScheduledNoteOutput[i].pitch, mScheduledNoteOutput[i].velocity, mScheduledNoteOutput[i].pan, mScheduledNoteOutput[i].noteOutputIndex, mScheduledNoteOutput[i].lineNum);
          mScheduledNoteOutput[i].time = -1;
@@ -355,23 +539,18 @@ void ScriptModule::Poll()
    {
       if (mScheduledNoteOutput[i].time != -1 &&
           mScheduledNoteOutput[i].velocity != 0 &&
-          time + TheTransport->GetEventLookaheadMs() > mScheduledNoteOutput[i].time)
+          blockEndTime > mScheduledNoteOutput[i].time)
       {
          PlayNote(mScheduledNoteOutput[i].time, mScheduledNoteOutput[i].pitch, mScheduledNoteOutput[i].velocity, mScheduledNoteOutput[i].pan, mScheduledNoteOutput[i].noteOutputIndex, mScheduledNoteOutput[i].lineNum);
          mScheduledNoteOutput[i].time = -1;
       }
    }
-   
-   for (size_t i=0; i<mScheduledMethodCall.size(); ++i)
-   {
-      if (mScheduledMethodCall[i].time != -1 &&
-          time + TheTransport->GetEventLookaheadMs() > mScheduledMethodCall[i].time)
-      {
-         RunCode(mScheduledMethodCall[i].time, mScheduledMethodCall[i].method);
-         mMethodCallTracker.AddEvent(mScheduledMethodCall[i].lineNum);
-         mScheduledMethodCall[i].time = -1;
-      }
-   }
+}
+
+void ScriptModule::QueueOutput(const ScriptOutputEvent& event)
+{
+   if (!mOutputQueue.Push(event))
+      ofLog() << "script output queue is full, dropping event";
 }
 
 //static
@@ -393,7 +572,7 @@ double ScriptModule::GetScheduledTime(double delayMeasureTime)
 
 void ScriptModule::PlayNoteFromScript(float pitch, float velocity, float pan, int noteOutputIndex)
 {
-   PlayNote(sMostRecentRunTime, pitch, velocity, pan, noteOutputIndex, mNextLineToExecute);
+   PlayNoteFromScriptAfterDelay(pitch, velocity, 0, pan, noteOutputIndex);
 }
 
 void ScriptModule::PlayNoteFromScriptAfterDelay(float pitch, float velocity, double delayMeasureTime, float pan, int noteOutputIndex)
@@ -404,34 +583,19 @@ void ScriptModule::PlayNoteFromScriptAfterDelay(float pitch, float velocity, dou
    
    //ofLog() << "ScriptModule::PlayNoteFromScriptAfterDelay() " << velocity << " " << time << " " << sMostRecentRunTime << " " << (time - sMostRecentRunTime);
    
-   if (time <= sMostRecentRunTime)
-   {
-      if (time < gTime)
-         ofLog() << "script is trying to play a note in the past!";
-      PlayNote(time, pitch, velocity, pan, noteOutputIndex, mNextLineToExecute);
-   }
-   else
-   {
-      ScheduleNote(time, pitch, velocity, pan, noteOutputIndex);
-   }
-}
-
-void ScriptModule::ScheduleNote(double time, float pitch, float velocity, float pan, int noteOutputIndex)
-{
-   for (size_t i=0; i<mScheduledNoteOutput.size(); ++i)
-   {
-      if (mScheduledNoteOutput[i].time == -1)
-      {
-         mScheduledNoteOutput[i].time = time;
-         mScheduledNoteOutput[i].startTime = sMostRecentRunTime;
-         mScheduledNoteOutput[i].pitch = pitch;
-         mScheduledNoteOutput[i].velocity = velocity;
-         mScheduledNoteOutput[i].pan = pan;
-         mScheduledNoteOutput[i].noteOutputIndex = noteOutputIndex;
-         mScheduledNoteOutput[i].lineNum = mNextLineToExecute;
-         break;
-      }
-   }
+   if (time < gTime)
+      ofLog() << "script is trying to play a note in the past!";
+   
+   ScriptOutputEvent event {};
+   event.type = ScriptOutputEvent::kNote;
+   event.startTime = sMostRecentRunTime;
+   event.time = time;
+   event.pitch = pitch;
+   event.velocity = velocity;
+   event.pan = pan;
+   event.noteOutputIndex = noteOutputIndex;
+   event.lineNum = mNextLineToExecute;
+   QueueOutput(event);
 }
 
 void ScriptModule::ScheduleMethod(string method, double delayMeasureTime)
@@ -446,6 +610,7 @@ void ScriptModule::ScheduleMethod(string method, double delayMeasureTime)
          mScheduledMethodCall[i].startTime = sMostRecentRunTime;
          mScheduledMethodCall[i].method = method;
          mScheduledMethodCall[i].lineNum = mNextLineToExecute;
+         ++sNumScheduledMethodCalls;
          break;
       }
    }
@@ -453,20 +618,14 @@ void ScriptModule::ScheduleMethod(string method, double delayMeasureTime)
 
 void ScriptModule::ScheduleUIControlValue(IUIControl* control, float value, double delayMeasureTime)
 {
-   for (size_t i=0; i<mScheduledUIControlValue.size(); ++i)
-   {
-      if (mScheduledUIControlValue[i].time == -1)
-      {
-         double time = GetScheduledTime(delayMeasureTime);
-         
-         mScheduledUIControlValue[i].time = time;
-         mScheduledUIControlValue[i].startTime = sMostRecentRunTime;
-         mScheduledUIControlValue[i].control = control;
-         mScheduledUIControlValue[i].value = value;
-         mScheduledUIControlValue[i].lineNum = mNextLineToExecute;
-         break;
-      }
-   }
+   ScriptOutputEvent event {};
+   event.type = ScriptOutputEvent::kUIControl;
+   event.startTime = sMostRecentRunTime;
+   event.time = GetScheduledTime(delayMeasureTime);
+   event.control = control;
+   event.value = value;
+   event.lineNum = mNextLineToExecute;
+   QueueOutput(event);
 }
 
 void ScriptModule::HighlightLine(int lineNum, int scriptModuleIndex)
@@ -497,13 +656,17 @@ void ScriptModule::PrintText(string text)
 
 IUIControl* ScriptModule::GetUIControl(string path)
 {
-   IUIControl* control;
-   if (ofIsStringInString(path, "~"))
-      control = TheSynth->FindUIControl(path);
-   else
-      control = TheSynth->FindUIControl(Path() + "~" + path);
+   if (!ofIsStringInString(path, "~"))
+      path = Path() + "~" + path;
    
-   return control;
+   auto iter = mUIControlHandles.find(path);
+   if (iter == mUIControlHandles.end())
+   {
+      if (mUIControlHandles.size() > 1000)
+         mUIControlHandles.clear();   //script is building paths on the fly, don't grow forever
+      iter = mUIControlHandles.emplace(path, IUIControl::kInvalidHandle).first;
+   }
+   return TheSynth->FindUIControl(path, iter->second);
 }
 
 void ScriptModule::AdjustUIControl(IUIControl* control, float value, int lineNum)
@@ -707,29 +870,35 @@ void ScriptModule::ExecuteBlock(int lineStart, int lineEnd)
 
 void ScriptModule::OnPulse(double time, float velocity, int flags)
 {
-   for (size_t i=0; i<mScheduledPulseTimes.size(); ++i)
-   {
-      if (mScheduledPulseTimes[i] == -1)
-      {
-         mScheduledPulseTimes[i] = time;
-         break;
-      }
-   }
+   ScriptInputEvent event {};
+   event.type = ScriptInputEvent::kPulse;
+   event.script = this;
+   event.time = time;
+   PushScriptInput(event);
+}
+
+void ScriptModule::OnGridButton(int col, int row, float velocity)
+{
+   ScriptInputEvent event {};
+   event.type = ScriptInputEvent::kGridButton;
+   event.script = this;
+   event.time = gTime;
+   event.a = col;
+   event.b = row;
+   event.value = velocity;
+   PushScriptInput(event);
 }
 
 //INoteReceiver
 void ScriptModule::PlayNote(double time, int pitch, int velocity, int voiceIdx /*= -1*/, ModulationParameters modulation /*= ModulationParameters()*/)
 {
-   for (size_t i=0; i<mPendingNoteInput.size(); ++i)
-   {
-      if (mPendingNoteInput[i].time == -1)
-      {
-         mPendingNoteInput[i].time = time;
-         mPendingNoteInput[i].pitch = pitch;
-         mPendingNoteInput[i].velocity = velocity;
-         break;
-      }
-   }
+   ScriptInputEvent event {};
+   event.type = ScriptInputEvent::kNote;
+   event.script = this;
+   event.time = time;
+   event.a = pitch;
+   event.b = velocity;
+   PushScriptInput(event);
 }
 
 string ScriptModule::GetThisName()
@@ -740,6 +909,7 @@ string ScriptModule::GetThisName()
 void ScriptModule::RunScript(double time, int lineStart/*=-1*/, int lineEnd/*=-1*/)
 {
    //should only be called from main thread
+   py::gil_scoped_acquire gil;
    py::exec(GetThisName()+" = scriptmodule.get_me("+ofToString(mScriptModuleIndex)+")", py::globals());
    string code = mCodeEntry->GetText();
    vector<string> lines = ofSplitString(code, "\n");
@@ -781,11 +951,40 @@ void ScriptModule::RunScript(double time, int lineStart/*=-1*/, int lineEnd/*=-1
    mLastRunLiteralCode = code;
    
    RunCode(time, code);
+   RefreshCallables();
+}
+
+void ScriptModule::RefreshCallables()
+{
+   py::dict globals = py::globals();
+   string suffix = "__" + GetMethodPrefix();
+   auto lookUp = [&](string name) -> py::object
+   {
+      name += suffix;
+      if (globals.contains(name))
+         return globals[name.c_str()];
+      return py::object();
+   };
+   
+   mCallables->mOnNote = lookUp("on_note");
+   mCallables->mOnPulse = lookUp("on_pulse");
+   mCallables->mOnGridButton = lookUp("on_grid_button");
+   mCallables->mCompiledMethodCalls.clear();
 }
 
 void ScriptModule::RunCode(double time, string code)
 {
-   //should only be called from main thread
+   RunPython(time, [&]()
+   {
+      FixUpCode(code);
+      py::exec(code, py::globals());
+   });
+}
+
+void ScriptModule::RunPython(double time, std::function<void()> run)
+{
+   //ui thread or script thread
+   py::gil_scoped_acquire gil;
    
    sMostRecentRunTime = time;
    mNextLineToExecute = -1;
@@ -797,9 +996,7 @@ void ScriptModule::RunCode(double time, string code)
       //ofLog() << "****";
       //ofLog() << (string)py::str(mPythonGlobals);
       
-      FixUpCode(code);
-      //ofLog() << code;
-      py::exec(code, py::globals());
+      run();
       
       //ofLog() << "&&&&";
       //ofLog() << (string)py::str(mPythonGlobals);
@@ -972,25 +1169,27 @@ bool ScriptModule::IsNonWhitespace(string line)
 
 void ScriptModule::Stop()
 {
-   //run through any scheduled note offs for this pitch
-   for (size_t i=0; i<mScheduledNoteOutput.size(); ++i)
+   //the audio thread owns the scheduled notes, it plays any pending note offs when it gets this
+   ScriptOutputEvent event {};
+   event.type = ScriptOutputEvent::kStop;
+   QueueOutput(event);
+   
+   py::gil_scoped_acquire gil;
+   for (size_t i=0; i<mScheduledMethodCall.size(); ++i)
    {
-      if (mScheduledNoteOutput[i].time != -1 &&
-          mScheduledNoteOutput[i].velocity == 0)
+      if (mScheduledMethodCall[i].time != -1)
       {
-         PlayNote(gTime, mScheduledNoteOutput[i].pitch, 0, 0, mScheduledNoteOutput[i].noteOutputIndex, mScheduledNoteOutput[i].lineNum);
-         mScheduledNoteOutput[i].time = -1;
+         mScheduledMethodCall[i].time = -1;
+         --sNumScheduledMethodCalls;
       }
    }
    
-   Reset();
+   for (size_t i=0; i<mPrintDisplay.size(); ++i)
+      mPrintDisplay[i].time = -1;
 }
 
 void ScriptModule::Reset()
 {
-   for (size_t i=0; i<mScheduledPulseTimes.size(); ++i)
-      mScheduledPulseTimes[i] = -1;
-   
    for (size_t i=0; i<mScheduledNoteOutput.size(); ++i)
       mScheduledNoteOutput[i].time = -1;
    
@@ -1000,9 +1199,6 @@ void ScriptModule::Reset()
    for (size_t i=0; i<mScheduledUIControlValue.size(); ++i)
       mScheduledUIControlValue[i].time = -1;
    
-   for (size_t i=0; i<mPendingNoteInput.size(); ++i)
-      mPendingNoteInput[i].time = -1;
-   
    for (size_t i=0; i<mPrintDisplay.size(); ++i)
       mPrintDisplay[i].time = -1;
 }
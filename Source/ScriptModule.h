@@ -19,8 +19,13 @@
 #include "Slider.h"
 #include "DropdownList.h"
 #include "ModulationChain.h"
+#include "IAudioPoller.h"
+#include "MPMCRingQueue.h"
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
-class ScriptModule : public IDrawableModule, public IButtonListener, public NoteEffectBase, public IPulseReceiver, public ICodeEntryListener, public IFloatSliderListener, public IDropdownListener
+class ScriptModule : public IDrawableModule, public IButtonListener, public NoteEffectBase, public IPulseReceiver, public ICodeEntryListener, public IFloatSliderListener, public IDropdownListener, public IAudioPoller
 {
 public:
    ScriptModule();
@@ -47,6 +52,10 @@ public:
    void SetNumNoteOutputs(int num);
    
    void RunCode(double time, string code);
+   void OnGridButton(int col, int row, float velocity);
+   
+   //script thread, with the gil held. runs the callbacks for queued input and any scheduled calls that are due.
+   static void ProcessScriptThreadEvents();
    
    void OnPulse(double time, float velocity, int flags) override;
    void ButtonClicked(ClickButton* button) override;
@@ -61,6 +70,9 @@ public:
    //INoteReceiver
    void PlayNote(double time, int pitch, int velocity, int voiceIdx = -1, ModulationParameters modulation = ModulationParameters()) override;
    
+   //IAudioPoller
+   void OnTransportAdvanced(float amount) override;
+   
    bool HasDebugDraw() const override { return true; }
    
    void SaveState(FileStreamOut& out) override;
@@ -79,11 +91,16 @@ public:
    static string GetBootstrapImportString() { return "import bespoke; import module; import scriptmodule; import random; import math"; }
    
 private:
+   struct ScriptOutputEvent;
+   
    void PlayNote(double time, float pitch, float velocity, float pan, int noteOutputIndex, int lineNum);
+   void RunPython(double time, std::function<void()> run);
+   void RefreshCallables();
+   void RunScheduledMethodCalls(double time);
+   void QueueOutput(const ScriptOutputEvent& event);
    void AdjustUIControl(IUIControl* control, float value, int lineNum);
    void RunScript(double time, int lineStart = -1, int lineEnd = -1);
    void FixUpCode(string& code);
-   void ScheduleNote(double time, float pitch, float velocity, float pan, int noteOutputIndex);
    void SendNoteToIndex(int index, double time, int pitch, int velocity, int voiceIdx, ModulationParameters modulation);
    string GetThisName();
    string GetIndentation(string line);
@@ -121,7 +138,6 @@ private:
    
    float mWidth;
    float mHeight;
-   std::array<double, 20> mScheduledPulseTimes;
    static double sMostRecentRunTime;
    string mLastError;
    size_t mScriptModuleIndex;
@@ -129,6 +145,36 @@ private:
    int mNextLineToExecute;
    int mInitExecutePriority;
    
+   //the script's callables, looked up once each time the script runs instead of every time they're called
+   struct PythonCallables;
+   std::unique_ptr<PythonCallables> mCallables;
+   
+   //notes and control changes on their way from the script to the audio thread, which plays them on their timestamps
+   struct ScriptOutputEvent
+   {
+      enum Type
+      {
+         kNote,
+         kUIControl,
+         kStop
+      };
+      Type type;
+      double startTime;
+      double time;
+      float pitch;
+      float velocity;
+      float pan;
+      int noteOutputIndex;
+      IUIControl* control;
+      float value;
+      int lineNum;
+   };
+   MPMCRingQueue<ScriptOutputEvent> mOutputQueue;
+   
+   //script thread. scripts tend to poke the same few controls over and over.
+   std::unordered_map<string, int> mUIControlHandles;
+   
+   //audio thread only
    struct ScheduledNoteOutput
    {
       double startTime;
@@ -141,6 +187,7 @@ private:
    };
    std::array<ScheduledNoteOutput, 200> mScheduledNoteOutput;
    
+   //gil holders only
    struct ScheduledMethodCall
    {
       double startTime;
@@ -150,6 +197,7 @@ private:
    };
    std::array<ScheduledMethodCall, 50> mScheduledMethodCall;
    
+   //audio thread only
    struct ScheduledUIControlValue
    {
       double startTime;
@@ -160,14 +208,6 @@ private:
    };
    std::array<ScheduledUIControlValue, 50> mScheduledUIControlValue;
    
-   struct PendingNoteInput
-   {
-      double time;
-      int pitch;
-      int velocity;
-   };
-   std::array<PendingNoteInput, 50> mPendingNoteInput;
-   
    struct PrintDisplay
    {
       double time;
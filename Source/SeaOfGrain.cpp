@@ -320,33 +320,36 @@ void SeaOfGrain::GrainMPEVoice::Process(float* out, int outLength, float* sample
 {
    if (!mADSR.IsDone(gTime) && sampleLength > 0)
    {
-      double time = gTime;
+      //the grain parameters follow the expression at the start of the block, and the spawn position slides
+      //linearly to where it ends up by the end of it
+      float pressure = mPressure ? mPressure->GetValue(0) : 0;
+      float modwheel = mModWheel ? mModWheel->GetValue(0) : 0;
+      if (pressure > 0)
+      {
+         mGranulator.mGrainOverlap = ofMap(pressure * pressure, 0, 1, 3, MAX_GRAINS);
+         mGranulator.mPosRandomizeMs = ofMap(pressure * pressure, 0, 1, 100, .03f);
+      }
+      mGranulator.mGrainLengthMs = ofMap(modwheel, -1, 1, 150-140, 150+140);
+      
+      double startOffset = GetSampleOffset(mPitchBend ? mPitchBend->GetValue(0) : 0, mPlay);
+      double endOffset = GetSampleOffset(mPitchBend ? mPitchBend->GetValue(outLength-1) : 0, mPlay + .001f * (outLength-1));
+      
+      ScratchArena::Scope scratch;
+      float* grains = scratch.Alloc(outLength);
+      float* adsr = scratch.Alloc(outLength);
+      Clear(grains, outLength);
+      ChannelBuffer temp(sample, sampleLength);
+      mGranulator.ProcessBlock(gTime, &temp, sampleLength, startOffset, outLength > 1 ? (endOffset - startOffset) / (outLength-1) : 0, &grains, outLength);
+      mADSR.RenderBlock(gTime, adsr, outLength);
+      
       for (int i=0; i<outLength; ++i)
       {
-         float pitchBend = mPitchBend ? mPitchBend->GetValue(i) : 0;
-         float pressure = mPressure ? mPressure->GetValue(i) : 0;
-         float modwheel = mModWheel ? mModWheel->GetValue(i) : 0;
-         if (pressure > 0)
-         {
-            mGranulator.mGrainOverlap = ofMap(pressure * pressure, 0, 1, 3, MAX_GRAINS);
-            mGranulator.mPosRandomizeMs = ofMap(pressure * pressure, 0, 1, 100, .03f);
-         }
-         mGranulator.mGrainLengthMs = ofMap(modwheel, -1, 1, 150-140, 150+140);
-         
          float blend = .0005f;
-         mGain = mGain * (1-blend) + pressure * blend;
+         mGain = mGain * (1-blend) + (mPressure ? mPressure->GetValue(i) : 0) * blend;
          
-         ChannelBuffer temp(sample, sampleLength);
-         float outSample[1];
-         outSample[0] = 0;
-         float pos = (mPitch + pitchBend + MIN(.125f, mPlay) - mOwner->mKeyboardBasePitch) / mOwner->mKeyboardNumPitches;
-         mGranulator.Process(time, &temp, sampleLength, ofLerp(mOwner->mDisplayStartSamples, mOwner->mDisplayEndSamples, pos), outSample);
-         outSample[0] *= sqrtf(mGain);
-         outSample[0] *= mADSR.Value(time);
-         out[i] += outSample[0];
-         time += gInvSampleRateMs;
-         mPlay += .001f;
+         out[i] += grains[i] * sqrtf(mGain) * adsr[i];
       }
+      mPlay += .001f * outLength;
    }
    else
    {
@@ -354,6 +357,12 @@ void SeaOfGrain::GrainMPEVoice::Process(float* out, int outLength, float* sample
    }
 }
 
+double SeaOfGrain::GrainMPEVoice::GetSampleOffset(float pitchBend, float play) const
+{
+   float pos = (mPitch + pitchBend + MIN(.125f, play) - mOwner->mKeyboardBasePitch) / mOwner->mKeyboardNumPitches;
+   return ofLerp(mOwner->mDisplayStartSamples, mOwner->mDisplayEndSamples, pos);
+}
+
 void SeaOfGrain::GrainMPEVoice::Draw(float w, float h)
 {
    if (!mADSR.IsDone(gTime))
@@ -392,17 +401,12 @@ void SeaOfGrain::GrainManualVoice::Process(float* out, int outLength, float* sam
 {
    if (mGain > 0 && sampleLength > 0)
    {
-      double time = gTime;
-      for (int i=0; i<outLength; ++i)
-      {
-         ChannelBuffer temp(sample, sampleLength);
-         float outSample[1];
-         outSample[0] = 0;
-         mGranulator.Process(time, &temp, sampleLength, ofLerp(mOwner->mDisplayStartSamples, mOwner->mDisplayEndSamples, mPosition), outSample);
-         outSample[0] *= mGain;
-         out[i] += outSample[0];
-         time += gInvSampleRateMs;
-      }
+      ScratchArena::Scope scratch;
+      float* grains = scratch.Alloc(outLength);
+      Clear(grains, outLength);
+      ChannelBuffer temp(sample, sampleLength);
+      mGranulator.ProcessBlock(gTime, &temp, sampleLength, ofLerp(mOwner->mDisplayStartSamples, mOwner->mDisplayEndSamples, mPosition), 0, &grains, outLength);
+      AddScaled(out, grains, mGain, outLength);
    }
    else
    {
@@ -83,6 +83,7 @@ private:
       GrainMPEVoice();
       void Process(float* out, int outLength, float* sample, int sampleLength);
       void Draw(float w, float h);
+      double GetSampleOffset(float pitchBend, float play) const;
       
       float mPlay;
       float mPitch;
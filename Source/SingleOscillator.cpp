@@ -127,11 +127,11 @@ void SingleOscillator::Process(double time)
    
    mNoteInputBuffer.Process(time);
    
-   ComputeSliders(0);
-   
    int bufferSize = GetTarget()->GetBuffer()->BufferSize();
    assert(bufferSize == gBufferSize);
    
+   ComputeSliderBlocks(bufferSize);
+   
    mWriteBuffer.Clear();
    mPolyMgr.Process(time, &mWriteBuffer, bufferSize);
    
@@ -274,7 +274,9 @@ void SingleOscillator::LoadLayout(const ofxJSONElement& moduleInfo)
    mModuleSaveData.LoadEnum<OscillatorType>("osc", moduleInfo, kOsc_Sin, mOscSelector);
    mModuleSaveData.LoadFloat("detune", moduleInfo, 1, mDetuneSlider);
    mModuleSaveData.LoadBool("pressure_envelope", moduleInfo);
-   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kNumVoices);
+   mModuleSaveData.LoadInt("voicelimit", moduleInfo, -1, -1, kMaxPolyphony);
+   EnumMap voiceStealMap = PolyphonyMgr::GetVoiceStealMap();
+   mModuleSaveData.LoadEnum<VoiceStealPolicy>("voicesteal", moduleInfo, kVoiceSteal_Oldest, nullptr, &voiceStealMap);
 
    SetUpFromSaveData();
 }
@@ -285,6 +287,7 @@ void SingleOscillator::SetUpFromSaveData()
    int voiceLimit = mModuleSaveData.GetInt("voicelimit");
    if (voiceLimit > 0)
       mPolyMgr.SetVoiceLimit(voiceLimit);
+   mPolyMgr.SetStealPolicy(mModuleSaveData.GetEnum<VoiceStealPolicy>("voicesteal"));
 }
 
 
@@ -14,9 +14,25 @@
 #include "ChannelBuffer.h"
 
 SingleOscillatorVoice::SingleOscillatorVoice(IDrawableModule* owner)
-: mUseFilter(false)
+: mSyncPhaseInc(0)
+, mNumUnison(0)
+, mResetControlRamps(true)
+, mOsc(kOsc_Square)
+, mUseFilter(false)
 , mOwner(owner)
 {
+   for (int u=0; u<kMaxUnison; ++u)
+   {
+      mPhase[u] = 0;
+      mSyncPhase[u] = 0;
+      mDetuneFactor[u] = 0;
+      mPhaseInc[u] = 0;
+      mPhaseIncStep[u] = 0;
+      mGainLeft[u] = 0;
+      mGainLeftStep[u] = 0;
+      mGainRight[u] = 0;
+      mGainRightStep[u] = 0;
+   }
 }
 
 SingleOscillatorVoice::~SingleOscillatorVoice()
@@ -28,6 +44,36 @@ bool SingleOscillatorVoice::IsDone(double time)
    return mAdsr.IsDone(time);
 }
 
+namespace
+{
+   //waveforms for the fast path, phase is in (-2pi, 2pi) like Oscillator::Value() sees after its fmod.
+   //no branches or compares, so the per-sample loop vectorizes.
+   struct SinShape
+   {
+      static float Value(float phase, float pulseWidth) { return Oscillator::FastSin(phase); }
+   };
+   
+   struct SawShape
+   {
+      static float Value(float phase, float pulseWidth) { return phase / FTWO_PI * 2 - 1; }
+   };
+   
+   struct NegSawShape
+   {
+      static float Value(float phase, float pulseWidth) { return 1 - phase / FTWO_PI * 2; }
+   };
+   
+   struct SquareShape
+   {
+      static float Value(float phase, float pulseWidth) { return copysignf(1.0f, FTWO_PI * pulseWidth - phase); }
+   };
+   
+   struct TriShape
+   {
+      static float Value(float phase, float pulseWidth) { return fabsf(phase / FTWO_PI - .5f) * 4 - 1; }
+   };
+}
+
 bool SingleOscillatorVoice::Process(double time, ChannelBuffer* out)
 {
    PROFILER(SingleOscillatorVoice);
@@ -35,89 +81,48 @@ bool SingleOscillatorVoice::Process(double time, ChannelBuffer* out)
    if (IsDone(time))
       return false;
    
-   for (int u=0; u<mVoiceParams->mUnison && u<kMaxUnison; ++u)
-      mOscData[u].mOsc.SetType(mVoiceParams->mOscType);
+   mOsc.SetType(mVoiceParams->mOscType);
    
    bool mono = (out->NumActiveChannels() == 1);
-      
-   float syncPhaseInc = GetPhaseInc(mVoiceParams->mSyncFreq);
-   for (int pos=0; pos<out->BufferSize(); ++pos)
+   int bufferSize = out->BufferSize();
+   
+   ScratchArena::Scope scratch;
+   float* adsr = scratch.Alloc(bufferSize);
+   mAdsr.RenderBlock(time, adsr, bufferSize);
+   
+   for (int blockStart=0; blockStart<bufferSize; blockStart += kControlBlockSize)
    {
-      //PROFILER(SingleOscillatorVoice_CalcSample);
+      int blockSize = MIN(kControlBlockSize, bufferSize - blockStart);
       
-      {
-         //PROFILER(SingleOscillatorVoice_ComputeSliders);
-         if (mOwner)
-            mOwner->ComputeSliders(pos);
-      }
+      UpdateControls(blockStart, blockSize, mono);
       
-      float adsrVal = mAdsr.Value(time);
-      float pitch = GetPitch(pos);
-      float freq = TheScale->PitchToFreq(pitch) * mVoiceParams->mMult;
-      float vol = mVoiceParams->mVol * .4f / mVoiceParams->mUnison;
+      float left[kControlBlockSize];
+      float right[kControlBlockSize];
+      ::Clear(left, blockSize);
+      ::Clear(right, blockSize);
       
-      float summedLeft = 0;
-      float summedRight = 0;
-      for (int u=0; u<mVoiceParams->mUnison && u<kMaxUnison; ++u)
+      if (CanRenderFast())
       {
-         mOscData[u].mOsc.SetPulseWidth(mVoiceParams->mPulseWidth);
-         mOscData[u].mOsc.SetShuffle(mVoiceParams->mShuffle);
-         
-         float detune = ((mVoiceParams->mDetune - 1) * mOscData[u].mDetuneFactor) + 1;
-         float phaseInc = GetPhaseInc(freq * detune);
-         
-         {
-            //PROFILER(SingleOscillatorVoice_UpdatePhase);
-            mOscData[u].mPhase += phaseInc;
-            if (mOscData[u].mPhase == INFINITY)
-            {
-               ofLog() << "Infinite phase. phaseInc:" + ofToString(phaseInc) + " detune:" + ofToString(mVoiceParams->mDetune) + " freq:" + ofToString(freq) + " pitch:" + ofToString(pitch) + " getpitch:" + ofToString(GetPitch(pos));
-            }
-            else
-            {
-               while (mOscData[u].mPhase > FTWO_PI*2)
-               {
-                  mOscData[u].mPhase -= FTWO_PI*2;
-                  mOscData[u].mSyncPhase = 0;
-               }
-            }
-            mOscData[u].mSyncPhase += syncPhaseInc;
-         }
-         
-         float sample;
-         
-         {
-            //PROFILER(SingleOscillatorVoice_GetOscValue);
-            if (mVoiceParams->mSync)
-               sample = mOscData[u].mOsc.Value(mOscData[u].mSyncPhase) * adsrVal * vol;
-            else
-               sample = mOscData[u].mOsc.Value(mOscData[u].mPhase + mVoiceParams->mPhaseOffset) * adsrVal * vol;
-         }
-         
-         if (u >= 2)
-            sample *= 1 - (mOscData[u].mDetuneFactor * .5f);
-         
-         if (mono)
-         {
-            summedLeft += sample;
-         }
-         else
+         switch (mOsc.GetType())
          {
-            //PROFILER(SingleOscillatorVoice_pan);
-            float unisonPan;
-            if (mVoiceParams->mUnison == 1)
-               unisonPan = 0;
-            else if (u == 0)
-               unisonPan = -1;
-            else if (u == 1)
-               unisonPan = 1;
-            else
-               unisonPan = mOscData[u].mDetuneFactor;
-            float pan = GetPan() + unisonPan * mVoiceParams->mUnisonWidth;
-            summedLeft += sample * GetLeftPanGain(pan);
-            summedRight += sample * GetRightPanGain(pan);
+            case kOsc_Sin: RenderUnisonFast<SinShape>(blockSize, left, right, mono); break;
+            case kOsc_Saw: RenderUnisonFast<SawShape>(blockSize, left, right, mono); break;
+            case kOsc_NegSaw: RenderUnisonFast<NegSawShape>(blockSize, left, right, mono); break;
+            case kOsc_Square: RenderUnisonFast<SquareShape>(blockSize, left, right, mono); break;
+            case kOsc_Tri: RenderUnisonFast<TriShape>(blockSize, left, right, mono); break;
+            default: assert(false); break;
          }
       }
+      else
+      {
+         RenderUnisonGeneric(blockSize, left, right);
+      }
+      
+      for (int i=0; i<blockSize; ++i)
+      {
+         left[i] *= adsr[blockStart + i];
+         right[i] *= adsr[blockStart + i];
+      }
       
       if (mUseFilter)
       {
@@ -126,35 +131,183 @@ bool SingleOscillatorVoice::Process(double time, ChannelBuffer* out)
          float q = mVoiceParams->mFilterQ;
          if (f != mFilterLeft.mF || q != mFilterLeft.mQ)
             mFilterLeft.SetFilterParams(f, q);
-         summedLeft = mFilterLeft.Filter(summedLeft);
+         for (int i=0; i<blockSize; ++i)
+            left[i] = mFilterLeft.Filter(left[i]);
          if (!mono)
          {
             mFilterRight.CopyCoeffFrom(mFilterLeft);
-            summedRight = mFilterRight.Filter(summedRight);
+            for (int i=0; i<blockSize; ++i)
+               right[i] = mFilterRight.Filter(right[i]);
          }
       }
       
+      Add(out->GetChannel(0) + blockStart, left, blockSize);
+      if (!mono)
+         Add(out->GetChannel(1) + blockStart, right, blockSize);
+      
+      time += blockSize * gInvSampleRateMs;
+   }
+   
+   return true;
+}
+
+void SingleOscillatorVoice::UpdateControls(int pos, int blockSize, bool mono)
+{
+   if (mOwner)
+      mOwner->ApplySliderBlockValues(pos);   //the owner computed the whole block before running its voices
+   
+   mOsc.SetPulseWidth(mVoiceParams->mPulseWidth);
+   mOsc.SetShuffle(mVoiceParams->mShuffle);
+   mSyncPhaseInc = GetPhaseInc(mVoiceParams->mSyncFreq);
+   
+   int numUnison = MIN(mVoiceParams->mUnison, kMaxUnison);
+   bool resetRamps = mResetControlRamps || numUnison != mNumUnison;
+   mResetControlRamps = false;
+   mNumUnison = numUnison;
+   
+   float pitch = GetPitch(pos);
+   float freq = TheScale->PitchToFreq(pitch) * mVoiceParams->mMult;
+   float vol = mVoiceParams->mVol * .4f / mVoiceParams->mUnison;
+   float invBlockSize = 1.0f / blockSize;
+   
+   for (int u=0; u<numUnison; ++u)
+   {
+      if (mPhase[u] == INFINITY)
+         ofLog() << "Infinite phase. detune:" + ofToString(mVoiceParams->mDetune) + " freq:" + ofToString(freq) + " pitch:" + ofToString(pitch);
+      
+      float detune = ((mVoiceParams->mDetune - 1) * mDetuneFactor[u]) + 1;
+      float phaseInc = GetPhaseInc(freq * detune);
+      
+      float gain = vol;
+      if (u >= 2)
+         gain *= 1 - (mDetuneFactor[u] * .5f);
+      
+      float gainLeft = gain;
+      float gainRight = 0;
+      if (!mono)
+      {
+         float unisonPan;
+         if (mVoiceParams->mUnison == 1)
+            unisonPan = 0;
+         else if (u == 0)
+            unisonPan = -1;
+         else if (u == 1)
+            unisonPan = 1;
+         else
+            unisonPan = mDetuneFactor[u];
+         float pan = GetPan() + unisonPan * mVoiceParams->mUnisonWidth;
+         gainLeft = gain * GetLeftPanGain(pan);
+         gainRight = gain * GetRightPanGain(pan);
+      }
+      
+      if (resetRamps)
+      {
+         mPhaseInc[u] = phaseInc;
+         mGainLeft[u] = gainLeft;
+         mGainRight[u] = gainRight;
+      }
+      mPhaseIncStep[u] = (phaseInc - mPhaseInc[u]) * invBlockSize;
+      mGainLeftStep[u] = (gainLeft - mGainLeft[u]) * invBlockSize;
+      mGainRightStep[u] = (gainRight - mGainRight[u]) * invBlockSize;
+   }
+}
+
+bool SingleOscillatorVoice::CanRenderFast() const
+{
+   //anything that needs per-sample state or warps the phase goes through Oscillator::Value()
+   OscillatorType type = mOsc.GetType();
+   if (type == kOsc_Random || type == kOsc_Drunk)
+      return false;
+   if (mVoiceParams->mSync || mOsc.GetShuffle() > 0 || mOsc.GetSoften() != 0)
+      return false;
+   if (type != kOsc_Square && mOsc.GetPulseWidth() != .5f)
+      return false;
+   return true;
+}
+
+template<class Shape>
+void SingleOscillatorVoice::RenderUnisonFast(int blockSize, float* left, float* right, bool mono)
+{
+   const float kInvTwoPi = 1 / FTWO_PI;
+   float phaseOffset = mVoiceParams->mPhaseOffset;
+   float pulseWidth = mOsc.GetPulseWidth();
+   
+   for (int u=0; u<mNumUnison; ++u)
+   {
+      //the phase after n samples has a closed form, so the samples don't depend on each other
+      float startPhase = mPhase[u] + phaseOffset;
+      float inc = mPhaseInc[u];
+      float incStep = mPhaseIncStep[u];
+      float gainLeft = mGainLeft[u];
+      float gainLeftStep = mGainLeftStep[u];
+      float gainRight = mGainRight[u];
+      float gainRightStep = mGainRightStep[u];
+      
+      for (int i=0; i<blockSize; ++i)
+      {
+         float n = float(i + 1);
+         float phase = startPhase + inc * n + incStep * n * (n + 1) * .5f;
+         phase -= FTWO_PI * int(phase * kInvTwoPi);
+         float sample = Shape::Value(phase, pulseWidth);
+         left[i] += sample * (gainLeft + gainLeftStep * n);
+         if (!mono)
+            right[i] += sample * (gainRight + gainRightStep * n);
+      }
+      
+      float n = float(blockSize);
+      float phase = mPhase[u] + inc * n + incStep * n * (n + 1) * .5f;
+      if (phase != INFINITY)
       {
-         //PROFILER(SingleOscillatorVoice_output);
-         if (mono)
+         while (phase > FTWO_PI*2)
+            phase -= FTWO_PI*2;
+      }
+      mPhase[u] = phase;
+      mPhaseInc[u] = inc + incStep * n;
+      mGainLeft[u] = gainLeft + gainLeftStep * n;
+      mGainRight[u] = gainRight + gainRightStep * n;
+   }
+}
+
+void SingleOscillatorVoice::RenderUnisonGeneric(int blockSize, float* left, float* right)
+{
+   bool sync = mVoiceParams->mSync;
+   float phaseOffset = mVoiceParams->mPhaseOffset;
+   
+   for (int i=0; i<blockSize; ++i)
+   {
+      for (int u=0; u<mNumUnison; ++u)
+      {
+         mPhaseInc[u] += mPhaseIncStep[u];
+         mGainLeft[u] += mGainLeftStep[u];
+         mGainRight[u] += mGainRightStep[u];
+         
+         mPhase[u] += mPhaseInc[u];
+         if (mPhase[u] != INFINITY)
          {
-            out->GetChannel(0)[pos] += summedLeft;
+            while (mPhase[u] > FTWO_PI*2)
+            {
+               mPhase[u] -= FTWO_PI*2;
+               mSyncPhase[u] = 0;
+            }
          }
+         mSyncPhase[u] += mSyncPhaseInc;
+         
+         float sample;
+         if (sync)
+            sample = mOsc.Value(mSyncPhase[u]);
          else
-         {
-            out->GetChannel(0)[pos] += summedLeft;
-            out->GetChannel(1)[pos] += summedRight;
-         }
+            sample = mOsc.Value(mPhase[u] + phaseOffset);
+         
+         left[i] += sample * mGainLeft[u];
+         right[i] += sample * mGainRight[u];
       }
-      time += gInvSampleRateMs;
    }
-   
-   return true;
 }
 
 void SingleOscillatorVoice::Start(double time, float target)
 {
    mAdsr.Start(time, target, mVoiceParams->mAdsr);
+   mResetControlRamps = true;
    
    if (mVoiceParams->mFilterCutoff != SINGLEOSCILLATOR_NO_CUTOFF)
    {
@@ -181,15 +334,15 @@ void SingleOscillatorVoice::ClearVoice()
    mFilterAdsr.Clear();
    for (int u=0; u<kMaxUnison; ++u)
    {
-      mOscData[u].mPhase = 0;
-      mOscData[u].mSyncPhase = 0;
+      mPhase[u] = 0;
+      mSyncPhase[u] = 0;
    }
    
    //set this up so it's different with each fresh voice, but doesn't reset when voice is retriggered
-   mOscData[0].mDetuneFactor = 1;
-   mOscData[1].mDetuneFactor = 0;
+   mDetuneFactor[0] = 1;
+   mDetuneFactor[1] = 0;
    for (int u=2; u<kMaxUnison; ++u)
-      mOscData[u].mDetuneFactor = ofRandom(-1,1);
+      mDetuneFactor[u] = ofRandom(-1,1);
 }
 
 void SingleOscillatorVoice::SetVoiceParams(IVoiceParams* params)
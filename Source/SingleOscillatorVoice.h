@@ -56,16 +56,29 @@ public:
    bool IsDone(double time) override;
    
    static const int kMaxUnison = 8;
+   static const int kControlBlockSize = 16;  //sliders, pitch and the filter are updated once per this many samples
 private:
-   struct OscData
-   {
-      OscData() : mPhase(0), mSyncPhase(0), mOsc(kOsc_Square), mDetuneFactor(0) {}
-      float mPhase;
-      float mSyncPhase;
-      Oscillator mOsc;
-      float mDetuneFactor;
-   };
-   OscData mOscData[kMaxUnison];
+   void UpdateControls(int pos, int blockSize, bool mono);
+   bool CanRenderFast() const;
+   template<class Shape> void RenderUnisonFast(int blockSize, float* left, float* right, bool mono);
+   void RenderUnisonGeneric(int blockSize, float* left, float* right);
+   
+   //the unison voices, laid out as parallel arrays so a whole control block renders in one tight loop.
+   //phase increments and gains ramp linearly from one control block to the next.
+   float mPhase[kMaxUnison];
+   float mSyncPhase[kMaxUnison];
+   float mDetuneFactor[kMaxUnison];
+   float mPhaseInc[kMaxUnison];
+   float mPhaseIncStep[kMaxUnison];
+   float mGainLeft[kMaxUnison];
+   float mGainLeftStep[kMaxUnison];
+   float mGainRight[kMaxUnison];
+   float mGainRightStep[kMaxUnison];
+   float mSyncPhaseInc;
+   int mNumUnison;
+   bool mResetControlRamps;
+   Oscillator mOsc;
+   
    ::ADSR mAdsr;
    OscillatorVoiceParams* mVoiceParams;
    
@@ -48,6 +48,7 @@ FloatSlider::FloatSlider(IFloatSliderListener* owner, const char* label, int x,
 , mComputeHasBeenCalledOnce(false)
 , mLastComputeTime(0)
 , mLastComputeSamplesIn(0)
+, mBlockModulated(false)
 , mLastDisplayedValue(FLT_MAX)
 , mFloatEntry(nullptr)
 , mAllowMinMaxAdjustment(true)
@@ -91,12 +92,16 @@ FloatSliderLFOControl* FloatSlider::AcquireLFO()
 
 void FloatSlider::SetLFO(FloatSliderLFOControl* lfo)
 {
+   if (lfo != nullptr)
+      AllocateModulationBuffer();
    mLFOControl = lfo;
    mModulator = lfo;
 }
 
 void FloatSlider::SetModulator(IModulator* modulator)
 {
+   if (modulator != nullptr)
+      AllocateModulationBuffer();
    mModulator = modulator;
    mLFOControl = nullptr;
 }
@@ -380,6 +385,7 @@ void FloatSlider::SmoothUpdated()
 {
    if (mSmooth > 0 && !mIsSmoothing)
    {
+      AllocateModulationBuffer();
       TheTransport->AddAudioPoller(this);
       mSmoothTarget = *mVar;
    }
@@ -580,6 +586,33 @@ void FloatSlider::Compute(int samplesIn /*= 0*/)
    }
 }
 
+void FloatSlider::ComputeBlock(int bufferSize)
+{
+   mComputeHasBeenCalledOnce = true;
+   
+   bool modulated = (mModulator && mModulator->Active()) || mIsSmoothing;
+   mBlockModulated = modulated && bufferSize <= (int)mModulationBuffer.size();
+   if (!mBlockModulated)
+   {
+      if (modulated)
+         Compute(0); //no buffer to fill, so settle for a value per block
+      return;
+   }
+   
+   for (int i=0; i<bufferSize; ++i)
+   {
+      Compute(i);
+      mModulationBuffer[i] = *mVar;
+   }
+}
+
+void FloatSlider::AllocateModulationBuffer()
+{
+   //on the ui thread, before the slider starts counting as modulated, so the audio thread never has to
+   if (mModulationBuffer.empty())
+      mModulationBuffer.resize(kWorkBufferSize);
+}
+
 float* FloatSlider::GetModifyValue()
 {
    if (!TheSynth->IsLoadingModule() && mModulator && mModulator->Active() && mModulator->CanAdjustRange())
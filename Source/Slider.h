@@ -39,6 +39,12 @@ public:
    bool IsMouseDown() const override { return mMouseDown; }
    void SetExtents(float min, float max) { mMin = min; mMax = max; }
    void Compute(int samplesIn = 0);
+   //once per block. if the slider is modulated or smoothing, runs Compute() for each sample of the block and keeps
+   //the values, so per-sample code can read them instead of calling Compute() itself. does nothing otherwise.
+   void ComputeBlock(int bufferSize);
+   bool IsBlockModulated() const { return mBlockModulated; }
+   const float* GetBlockValues() const { return mModulationBuffer.data(); }
+   void ApplyBlockValue(int samplesIn) { *mVar = mModulationBuffer[samplesIn]; }
    void DisplayLFOControl();
    void DisableLFO();
    FloatSliderLFOControl* GetLFO() { return mLFOControl; }
@@ -100,6 +106,7 @@ private:
    float ValToPos(float val, bool ignoreSmooth) const;
    bool AdjustSmooth() const;
    void SmoothUpdated();
+   void AllocateModulationBuffer();
    
    int mWidth;
    int mHeight;
@@ -133,6 +140,8 @@ private:
    bool mComputeHasBeenCalledOnce;
    double mLastComputeTime;
    int mLastComputeSamplesIn;
+   vector<float> mModulationBuffer;   //only allocated once the slider gets modulated or smoothed
+   bool mBlockModulated;
    
    float mLastDisplayedValue;
    
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    SnapshotPublisher.h
+    Created: 18 Oct 2026 4:12:05pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include "LockFreeQueue.h"
+#include <atomic>
+
+//hands immutable snapshots from the ui thread to the audio thread without either side taking a lock.
+//the audio thread only ever picks up the newest one, and gives the ones it's done with back through
+//a ring queue so they get deleted on the ui thread. the audio thread never blocks or frees memory.
+template<typename T>
+class SnapshotPublisher
+{
+public:
+   SnapshotPublisher() : mPending(nullptr), mCurrent(nullptr), mRetired(kRetiredCapacity), mOwnerThread(nullptr) {}
+   ~SnapshotPublisher()
+   {
+      Reclaim();
+      delete mPending.load();
+      delete mCurrent;
+   }
+
+   //ui thread. takes ownership of the snapshot
+   void Publish(T* snapshot)
+   {
+      //only one thread may ever publish, Reclaim() is the single consumer of mRetired
+      if (mOwnerThread == nullptr)
+         mOwnerThread = juce::Thread::getCurrentThreadId();
+      assert(mOwnerThread == juce::Thread::getCurrentThreadId());
+      Reclaim();
+      T* superseded = mPending.exchange(snapshot, std::memory_order_acq_rel);
+      delete superseded;   //the audio thread never picked this one up, nobody else has seen it
+   }
+
+   //ui thread. frees the snapshots the audio thread has moved on from
+   void Reclaim()
+   {
+      T* retired;
+      while (mRetired.consume(retired))
+         delete retired;
+   }
+
+   //audio thread. returns the newest published snapshot, or nullptr if nothing has been published yet
+   T* Acquire()
+   {
+      if (mPending.load(std::memory_order_relaxed) != nullptr)
+      {
+         T* next = mPending.exchange(nullptr, std::memory_order_acq_rel);
+         if (next != nullptr)
+         {
+            if (mCurrent != nullptr)
+               mRetired.produce(mCurrent);   //can't fill up, every Publish() reclaims first
+            mCurrent = next;
+         }
+      }
+      return mCurrent;
+   }
+
+private:
+   SnapshotPublisher(const SnapshotPublisher&) = delete;
+   SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+   static const int kRetiredCapacity = 16;
+
+   std::atomic<T*> mPending;
+   T* mCurrent;
+   LockFreeRingQueue<T*> mRetired;
+   juce::Thread::ThreadID mOwnerThread;
+};
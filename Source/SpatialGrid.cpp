@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    SpatialGrid.cpp
+    Created: 18 Oct 2026 9:47:05pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "SpatialGrid.h"
+#include <algorithm>
+
+SpatialGrid::SpatialGrid(float cellSize)
+: mCellSize(cellSize)
+, mNumOccupiedCells(0)
+{
+}
+
+void SpatialGrid::Clear()
+{
+   //keep the buckets around, this gets rebuilt every frame
+   if (mCells.size() > 4096)
+      mCells.clear();
+   for (auto& cell : mCells)
+      cell.second.clear();
+   mNumOccupiedCells = 0;
+}
+
+void SpatialGrid::GetCellRange(const ofRectangle& rect, int& minX, int& minY, int& maxX, int& maxY) const
+{
+   minX = (int)floorf(rect.getMinX() / mCellSize);
+   minY = (int)floorf(rect.getMinY() / mCellSize);
+   maxX = (int)floorf(rect.getMaxX() / mCellSize);
+   maxY = (int)floorf(rect.getMaxY() / mCellSize);
+}
+
+void SpatialGrid::Insert(int id, const ofRectangle& rect)
+{
+   int minX, minY, maxX, maxY;
+   GetCellRange(rect, minX, minY, maxX, maxY);
+   for (int cellY = minY; cellY <= maxY; ++cellY)
+   {
+      for (int cellX = minX; cellX <= maxX; ++cellX)
+      {
+         vector<int>& cell = mCells[GetKey(cellX, cellY)];
+         if (cell.empty())
+            ++mNumOccupiedCells;
+         cell.push_back(id);
+      }
+   }
+}
+
+void SpatialGrid::Query(const ofRectangle& rect, vector<int>& ids) const
+{
+   ids.clear();
+
+   int minX, minY, maxX, maxY;
+   GetCellRange(rect, minX, minY, maxX, maxY);
+   int64_t numQueryCells = int64_t(maxX - minX + 1) * (maxY - minY + 1);
+   if (numQueryCells > mNumOccupiedCells)
+   {
+      //zoomed way out, cheaper to walk what's there than every cell in the rect
+      for (const auto& cell : mCells)
+      {
+         int cellX = int32_t(uint32_t(cell.first >> 32));
+         int cellY = int32_t(uint32_t(cell.first));
+         if (cellX >= minX && cellX <= maxX && cellY >= minY && cellY <= maxY)
+            ids.insert(ids.end(), cell.second.begin(), cell.second.end());
+      }
+   }
+   else
+   {
+      for (int cellY = minY; cellY <= maxY; ++cellY)
+      {
+         for (int cellX = minX; cellX <= maxX; ++cellX)
+         {
+            auto cell = mCells.find(GetKey(cellX, cellY));
+            if (cell != mCells.end())
+               ids.insert(ids.end(), cell->second.begin(), cell->second.end());
+         }
+      }
+   }
+
+   std::sort(ids.begin(), ids.end());
+   ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+void SpatialGrid::Query(float x, float y, vector<int>& ids) const
+{
+   ids.clear();
+   auto cell = mCells.find(GetKey((int)floorf(x / mCellSize), (int)floorf(y / mCellSize)));
+   if (cell != mCells.end())
+   {
+      ids = cell->second;   //already ascending, since ids are inserted in order
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+   }
+}
@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    SpatialGrid.h
+    Created: 18 Oct 2026 9:47:05pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include <unordered_map>
+
+//buckets rectangles into square cells, so asking what's under a point or inside the viewport
+//only looks at the few cells involved instead of every item
+class SpatialGrid
+{
+public:
+   SpatialGrid(float cellSize);
+
+   void Clear();
+   //insert in ascending id order. an id can be inserted more than once.
+   void Insert(int id, const ofRectangle& rect);
+   //ids of everything whose rect touches the query, ascending and without duplicates
+   void Query(const ofRectangle& rect, vector<int>& ids) const;
+   void Query(float x, float y, vector<int>& ids) const;
+
+private:
+   void GetCellRange(const ofRectangle& rect, int& minX, int& minY, int& maxX, int& maxY) const;
+   static uint64_t GetKey(int cellX, int cellY) { return (uint64_t(uint32_t(cellX)) << 32) | uint32_t(cellY); }
+
+   float mCellSize;
+   std::unordered_map<uint64_t, vector<int> > mCells;
+   int mNumOccupiedCells;
+};
@@ -26,10 +26,8 @@ SpectralDisplay::SpectralDisplay()
 , mFFTData(kNumFFTBins, kNumFFTBins/2+1)
 , mRollingInputBuffer(kNumFFTBins)
 {
-   // Generate a window with a single raised cosine from N/4 to 3N/4
-   mWindower = new float[kNumFFTBins];
-   for (int i=0; i<kNumFFTBins; ++i)
-      mWindower[i] = -.5f*cos(FTWO_PI*i/kNumFFTBins)+.5f;
+   // Single raised cosine from N/4 to 3N/4, shared by every FFT of this size
+   mWindower = mFFT.GetHannWindow();
    mSmoother = new float[kNumFFTBins/2+1-kBinIgnore];
    for (int i=0; i<kNumFFTBins/2+1-kBinIgnore; ++i)
       mSmoother[i] = 0;
@@ -42,7 +40,6 @@ void SpectralDisplay::CreateUIControls()
 
 SpectralDisplay::~SpectralDisplay()
 {
-   delete[] mWindower;
    delete[] mSmoother;
 }
 
@@ -57,21 +54,24 @@ void SpectralDisplay::Process(double time)
    
    SyncBuffers();
    
+   ScratchArena::Scope scratch;
+   float* monoBuffer = scratch.Alloc(GetBuffer()->BufferSize());
+   Clear(monoBuffer, GetBuffer()->BufferSize());
    if (GetTarget())
    {
       ChannelBuffer* out = GetTarget()->GetBuffer();
       for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
       {
          if (ch == 0)
-            BufferCopy(gWorkBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+            BufferCopy(monoBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
          else
-            Add(gWorkBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+            Add(monoBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
          Add(out->GetChannel(ch), GetBuffer()->GetChannel(ch), out->BufferSize());
          GetVizBuffer()->WriteChunk(GetBuffer()->GetChannel(ch),GetBuffer()->BufferSize(), ch);
       }
    }
    
-   mRollingInputBuffer.WriteChunk(gWorkBuffer, GetBuffer()->BufferSize(), 0);
+   mRollingInputBuffer.WriteChunk(monoBuffer, GetBuffer()->BufferSize(), 0);
    
    //copy rolling input buffer into working buffer and window it
    mRollingInputBuffer.ReadChunk(mFFTData.mTimeDomain, kNumFFTBins, 0, 0);
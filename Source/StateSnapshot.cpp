@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    StateSnapshot.cpp
+    Created: 18 Oct 2026 9:12:40pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#include "StateSnapshot.h"
+
+StateSnapshot::StateSnapshot()
+: mCurrentSegment(64 * 1024)
+{
+}
+
+void StateSnapshot::Append(const void* data, size_t size)
+{
+   if (size >= kLargeWriteBytes)
+   {
+      CloseCurrentSegment();
+      mSegments.push_back(std::make_shared<juce::MemoryBlock>(data, size));
+   }
+   else
+   {
+      mCurrentSegment.write(data, size);
+   }
+}
+
+void StateSnapshot::CloseCurrentSegment()
+{
+   if (mCurrentSegment.getDataSize() == 0)
+      return;
+   mSegments.push_back(std::make_shared<juce::MemoryBlock>(mCurrentSegment.getData(), mCurrentSegment.getDataSize()));
+   mCurrentSegment.reset();
+}
+
+size_t StateSnapshot::GetSize() const
+{
+   size_t size = mCurrentSegment.getDataSize();
+   for (const auto& segment : mSegments)
+      size += segment->getSize();
+   return size;
+}
+
+bool StateSnapshot::WriteTo(juce::OutputStream& stream) const
+{
+   for (const auto& segment : mSegments)
+   {
+      if (!stream.write(segment->getData(), segment->getSize()))
+         return false;
+   }
+   return stream.write(mCurrentSegment.getData(), mCurrentSegment.getDataSize());
+}
+
+StateSnapshotWriter::StateSnapshotWriter()
+: juce::Thread("state writer")
+, mIdleEvent(true)
+{
+   mIdleEvent.signal();
+   startThread(3);
+}
+
+StateSnapshotWriter::~StateSnapshotWriter()
+{
+   WaitUntilIdle();  //don't lose a save that's still queued on the way out
+   signalThreadShouldExit();
+   mWorkEvent.signal();
+   stopThread(5000);
+}
+
+void StateSnapshotWriter::Enqueue(std::shared_ptr<const StateSnapshot> snapshot, string path)
+{
+   const juce::ScopedLock lock(mQueueLock);
+   PendingWrite write;
+   write.mSnapshot = snapshot;
+   write.mPath = path;
+   mQueue.push_back(write);
+   mIdleEvent.reset();
+   mWorkEvent.signal();
+}
+
+void StateSnapshotWriter::WaitUntilIdle()
+{
+   mIdleEvent.wait();
+}
+
+void StateSnapshotWriter::run()
+{
+   while (!threadShouldExit())
+   {
+      mWorkEvent.wait(500);
+      
+      while (true)
+      {
+         PendingWrite write;
+         {
+            const juce::ScopedLock lock(mQueueLock);
+            if (mQueue.empty())
+            {
+               mIdleEvent.signal();
+               break;
+            }
+            write = mQueue.front();
+            mQueue.pop_front();
+         }
+         
+         //write next to the target and swap it in at the end, so a crash mid-save never leaves a half-written file
+         juce::File target(write.mPath);
+         target.getParentDirectory().createDirectory();
+         juce::TemporaryFile temp(target);
+         bool ok;
+         {
+            juce::FileOutputStream stream(temp.getFile());
+            ok = stream.openedOk() && write.mSnapshot->WriteTo(stream);
+            stream.flush();
+         }
+         if (!ok || !temp.overwriteTargetFileWithTemporary())
+            ofLog() << "couldn't write state to " << write.mPath;
+      }
+   }
+}
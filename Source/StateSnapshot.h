@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    StateSnapshot.h
+    Created: 18 Oct 2026 9:12:40pm
+    Author:  Ryan Challinor
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "OpenFrameworksPort.h"
+#include <deque>
+#include <memory>
+
+//everything one SaveState() pass wrote, captured into memory so the audio thread only has to wait for the
+//modules to serialize, not for the disk. immutable once captured, and ref-counted so it can outlive the save call.
+class StateSnapshot
+{
+public:
+   StateSnapshot();
+   
+   void Append(const void* data, size_t size);
+   size_t GetSize() const;
+   bool WriteTo(juce::OutputStream& stream) const;
+   
+private:
+   void CloseCurrentSegment();
+   
+   //big buffers get a segment of their own, so capturing them is one memcpy with no regrowing
+   static const size_t kLargeWriteBytes = 64 * 1024;
+   
+   vector<std::shared_ptr<const juce::MemoryBlock> > mSegments;
+   juce::MemoryOutputStream mCurrentSegment;
+};
+
+//writes snapshots to disk on a background thread, in the order they were queued
+class StateSnapshotWriter : public juce::Thread
+{
+public:
+   StateSnapshotWriter();
+   ~StateSnapshotWriter();
+   
+   void Enqueue(std::shared_ptr<const StateSnapshot> snapshot, string path);
+   //blocks until everything queued so far is on disk, for anything that's about to read the files back
+   void WaitUntilIdle();
+   
+   void run() override;
+   
+private:
+   struct PendingWrite
+   {
+      std::shared_ptr<const StateSnapshot> mSnapshot;
+      string mPath;
+   };
+   
+   juce::CriticalSection mQueueLock;
+   std::deque<PendingWrite> mQueue;
+   juce::WaitableEvent mWorkEvent;
+   juce::WaitableEvent mIdleEvent;
+};
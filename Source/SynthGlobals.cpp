@@ -21,6 +21,10 @@
 #include "ChannelBuffer.h"
 #include "IPulseReceiver.h"
 #include "exprtk/exprtk.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #ifdef JUCE_MAC
 #import <execinfo.h>
@@ -46,8 +50,6 @@ RetinaTrueTypeFont gFontFixedWidth;
 float gModuleDrawAlpha = 255;
 float gNullBuffer[kWorkBufferSize];
 float gZeroBuffer[kWorkBufferSize];
-float gWorkBuffer[kWorkBufferSize];
-ChannelBuffer gWorkChannelBuffer(kWorkBufferSize);
 IDrawableModule* gHoveredModule = nullptr;
 IUIControl* gHoveredUIControl = nullptr;
 IUIControl* gHotBindUIControl[10];
@@ -104,7 +106,8 @@ void DrawAudioBuffer(float width, float height, ChannelBuffer* buffer, float sta
       int numChannels = buffer->NumActiveChannels();
       for (int i=0; i<numChannels; ++i)
       {
-         DrawAudioBuffer(width, height/numChannels, buffer->GetChannel(i), start, MIN(end, buffer->BufferSize()), pos, vol, color);
+         const float* data = buffer->IsChannelAllocated(i) ? buffer->GetChannel(i) : nullptr;   //don't allocate just to draw silence
+         DrawAudioBuffer(width, height/numChannels, data, start, MIN(end, buffer->BufferSize()), pos, vol, color);
          ofTranslate(0, height/numChannels);
       }
    }
@@ -212,6 +215,18 @@ void Mult(float* buff1, const float* buff2, int bufferSize)
 #endif
 }
 
+void AddScaled(float* buff1, const float* buff2, float scale, int bufferSize)
+{
+#ifdef USE_VECTOR_OPS
+   FloatVectorOperations::addWithMultiply(buff1, buff2, scale, bufferSize);
+#else
+   for (int i=0; i<bufferSize; ++i)
+   {
+      buff1[i] += buff2[i] * scale;
+   }
+#endif
+}
+
 void Clear(float* buffer, int bufferSize)
 {
 #ifdef USE_VECTOR_OPS
@@ -390,6 +405,50 @@ float GetInterpolatedSample(double offset, ChannelBuffer* buffer, int bufferSize
           (channelBlend - channelA) * GetInterpolatedSample(offset, buffer->GetChannel(channelB), bufferSize);
 }
 
+//count samples starting at offset and stepping by increment, same as calling GetInterpolatedSample() for each
+void GetInterpolatedSamples(double offset, float increment, const float* buffer, int bufferSize, float* output, int count)
+{
+   FloatWrap(offset, bufferSize);
+   int i = 0;
+   while (i < count)
+   {
+      //go in runs that can't step off either end of the buffer, so the inner loop doesn't have to wrap
+      double run = count - i;
+      if (offset >= bufferSize - 1)
+         run = 0;
+      else if (increment > 0)
+         run = MIN(run, floor((bufferSize - 1 - offset) / increment));
+      else if (increment < 0)
+         run = MIN(run, floor(offset / -increment));
+      
+      int runLength = int(run);
+      if (runLength > 0)
+      {
+         //positions relative to the lowest one in the run fit in a float, which keeps the loop narrow
+         int base = int(MIN(offset, offset + (runLength-1) * (double)increment));
+         const float* in = buffer + base;
+         float start = float(offset - base);
+         float* out = output + i;
+         for (int j=0; j<runLength; ++j)
+         {
+            float pos = start + j * increment;
+            int index = int(pos);
+            float a = pos - index;
+            out[j] = in[index] + a * (in[index+1] - in[index]);
+         }
+         offset += runLength * (double)increment;
+         i += runLength;
+      }
+      else
+      {
+         output[i] = GetInterpolatedSample(offset, buffer, bufferSize);
+         offset += increment;
+         ++i;
+      }
+      FloatWrap(offset, bufferSize);
+   }
+}
+
 void WriteInterpolatedSample(double offset, float* buffer, int bufferSize, float sample)
 {
    FloatWrap(offset, bufferSize);
@@ -1317,14 +1376,24 @@ void DrawFallbackText(const char* text, float posX, float posY)
    }
 }
 
-bool EvaluateExpression(string expressionStr, float currentValue, float& output)
+namespace
 {
-   exprtk::symbol_table<float> symbolTable;
-   exprtk::expression<float> expression;
-   symbolTable.add_variable("current_value",currentValue);
-   symbolTable.add_constants();
-   expression.register_symbol_table(symbolTable);
+   //compiling is far more expensive than evaluating, so each distinct expression text only gets parsed once
+   struct CompiledExpression
+   {
+      float mCurrentValue;
+      exprtk::symbol_table<float> mSymbolTable;
+      exprtk::expression<float> mExpression;
+      bool mValid;
+   };
    
+   const int kMaxCachedExpressions = 256;
+   std::mutex sExpressionCacheMutex;
+   std::unordered_map<string, std::unique_ptr<CompiledExpression> > sExpressionCache;
+}
+
+bool EvaluateExpression(string expressionStr, float currentValue, float& output)
+{
    juce::String input = expressionStr;
    if (input.startsWith("+="))
       input = input.replace("+=", "current_value+");
@@ -1335,11 +1404,30 @@ bool EvaluateExpression(string expressionStr, float currentValue, float& output)
    if (input.startsWith("-="))
       input = input.replace("-=", "current_value-");
    
-   exprtk::parser<float> parser;
-   bool expressionValid = parser.compile(input.toStdString(), expression);
-   if (expressionValid)
+   std::lock_guard<std::mutex> lock(sExpressionCacheMutex);
+   
+   string key = input.toStdString();
+   auto cached = sExpressionCache.find(key);
+   if (cached == sExpressionCache.end())
+   {
+      if (sExpressionCache.size() >= kMaxCachedExpressions)
+         sExpressionCache.clear();  //typed-in expressions rarely repeat once this many have gone by
+      
+      CompiledExpression* compiled = new CompiledExpression();
+      compiled->mCurrentValue = 0;
+      compiled->mSymbolTable.add_variable("current_value",compiled->mCurrentValue);
+      compiled->mSymbolTable.add_constants();
+      compiled->mExpression.register_symbol_table(compiled->mSymbolTable);
+      exprtk::parser<float> parser;
+      compiled->mValid = parser.compile(key, compiled->mExpression);
+      cached = sExpressionCache.insert(std::make_pair(key, std::unique_ptr<CompiledExpression>(compiled))).first;
+   }
+   
+   CompiledExpression* compiled = cached->second.get();
+   if (compiled->mValid)
    {
-      output = expression.value();
+      compiled->mCurrentValue = currentValue;
+      output = compiled->mExpression.value();
       return true;
    }
    return false;
@@ -1353,6 +1441,29 @@ ofLog::~ofLog()
       TheSynth->LogEvent(output, kLogEventType_Verbose);
 }
 
+namespace
+{
+   //plain flag check when it's off, so it can stay compiled in
+   std::atomic<bool> sCountAllocations(false);
+   std::atomic<uint64_t> sAllocationCount(0);
+   
+   inline void CountAllocation()
+   {
+      if (sCountAllocations.load(std::memory_order_relaxed))
+         sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+   }
+}
+
+void SetAllocationCountingEnabled(bool enabled)
+{
+   sCountAllocations.store(enabled);
+}
+
+uint64_t GetAllocationCount()
+{
+   return sAllocationCount.load();
+}
+
 #ifdef BESPOKE_DEBUG_ALLOCATIONS
 FILE* logAllocationsFile;
 
@@ -1502,12 +1613,14 @@ void DumpUnfreedMemory()
 #undef new
 void* operator new(std::size_t size) throw(std::bad_alloc)
 {
+   CountAllocation();
    void *ptr = (void*)malloc(size);
    //AddTrack((uint32)ptr, size, "<unknown>", 0);
    return(ptr);
 }
 void* operator new(std::size_t size, const char *file, int line) throw(std::bad_alloc)
 {
+   CountAllocation();
    void *ptr = (void*)malloc(size);
    AddTrack((uint32)ptr, size, file, line);
    return(ptr);
@@ -1519,12 +1632,14 @@ void operator delete(void* p) throw()
 }
 void* operator new[](std::size_t size) throw(std::bad_alloc)
 {
+   CountAllocation();
    void *ptr = (void*)malloc(size);
    //AddTrack((uint32)ptr, size, "<unknown>", 0);
    return(ptr);
 }
 void* operator new[](std::size_t size, const char *file, int line) throw(std::bad_alloc)
 {
+   CountAllocation();
    void* ptr = (void*)malloc(size);
    AddTrack((uint32)ptr, size, file, line);
    return(ptr);
@@ -1543,4 +1658,32 @@ void DumpUnfreedMemory()
 {
    ofLog() << "This only works with BESPOKE_DEBUG_ALLOCATIONS defined";
 };
+
+//replaced only to count allocations, see SetAllocationCountingEnabled()
+#undef new
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+   CountAllocation();
+   void* ptr = malloc(size > 0 ? size : 1);
+   if (ptr == nullptr)
+      throw std::bad_alloc();
+   return ptr;
+}
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+{
+   CountAllocation();
+   void* ptr = malloc(size > 0 ? size : 1);
+   if (ptr == nullptr)
+      throw std::bad_alloc();
+   return ptr;
+}
+void operator delete[](void* p) throw()
+{
+   free(p);
+}
+#define new DEBUG_NEW
 #endif
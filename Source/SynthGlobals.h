@@ -88,8 +88,6 @@ extern RetinaTrueTypeFont gFontFixedWidth;
 extern float gModuleDrawAlpha;
 extern float gNullBuffer[4096];
 extern float gZeroBuffer[4096];
-extern float gWorkBuffer[4096];  //scratch buffer for doing work in
-extern ChannelBuffer gWorkChannelBuffer;
 extern IDrawableModule* gHoveredModule;
 extern IUIControl* gHoveredUIControl;
 extern IUIControl* gHotBindUIControl[10];
@@ -150,6 +148,7 @@ void Add(float* buff1, const float* buff2, int bufferSize);
 void Subtract(float* buff1, const float* buff2, int bufferSize);
 void Mult(float* buff, float val, int bufferSize);
 void Mult(float* buff1, const float* buff2, int bufferSize);
+void AddScaled(float* buff1, const float* buff2, float scale, int bufferSize);
 void Clear(float* buffer, int bufferSize);
 void BufferCopy(float* dst, const float* src, int bufferSize);
 string NoteName(int pitch, bool flat=false, bool includeOctave = false);
@@ -165,6 +164,7 @@ float GetStringWidth(string text, float size = 15);
 void AssertIfDenormal(float input);
 float GetInterpolatedSample(double offset, const float* buffer, int bufferSize);
 float GetInterpolatedSample(double offset, ChannelBuffer* buffer, int bufferSize, float channelBlend);
+void GetInterpolatedSamples(double offset, float increment, const float* buffer, int bufferSize, float* output, int count);
 void WriteInterpolatedSample(double offset, float* buffer, int bufferSize, float sample);
 string GetRomanNumeralForDegree(int degree);
 void UpdateTarget(IDrawableModule* module);
@@ -183,6 +183,9 @@ string GetUniqueName(string name, vector<IDrawableModule*> existing);
 string GetUniqueName(string name, vector<string> existing);
 void SetMemoryTrackingEnabled(bool enabled);
 void DumpUnfreedMemory();
+//counts operator new calls from every thread while enabled
+void SetAllocationCountingEnabled(bool enabled);
+uint64_t GetAllocationCount();
 float DistSqToLine(ofVec2f point, ofVec2f a, ofVec2f b);
 uint32_t JenkinsHash(const char* key);
 void LoadStateValidate(bool assertion);
@@ -40,6 +40,15 @@ Transport::Transport()
 , mTempoSlider(nullptr)
 , mLoopStartMeasure(-1)
 , mLoopEndMeasure(-1)
+, mListenerChanges(4096)
+, mMeasureTimeAfterAdvance(0)
+, mScheduledTempo(0)
+, mScheduledSwing(0)
+, mScheduledSwingInterval(0)
+, mScheduledTimeSigTop(0)
+, mScheduledTimeSigBottom(0)
+, mScheduledLookaheadMs(0)
+, mScheduledJumpMs(0)
 {
    assert(TheTransport == nullptr);
    TheTransport = this;
@@ -112,20 +121,26 @@ void Transport::Advance(double ms)
    
    assert(amount > 0);
    
+   bool measureJumped = mMeasureTime != mMeasureTimeAfterAdvance;  //reset, nudged, or set from the ui since last block
    mMeasureTime += amount;
    
    if (mLoopStartMeasure != -1 && (GetMeasure(gTime) < mLoopStartMeasure || GetMeasure(gTime) >= mLoopEndMeasure))
+   {
       SetMeasure(mLoopStartMeasure);
+      measureJumped = true;
+   }
    
    if (TheChaosEngine)
       TheChaosEngine->AudioUpdate();
 
-   UpdateListeners(ms);
+   UpdateListeners(ms, measureJumped);
+   mMeasureTimeAfterAdvance = mMeasureTime;
 
-   for (list<IAudioPoller*>::iterator i = mAudioPollers.begin(); i != mAudioPollers.end(); ++i)
+   const vector<IAudioPoller*>* pollers = mAudioPollerSnapshots.Acquire();
+   if (pollers)
    {
-      IAudioPoller* poller = *i;
-      poller->OnTransportAdvanced(amount);
+      for (auto* poller : *pollers)
+         poller->OnTransportAdvanced(amount);
    }
 }
 
@@ -246,61 +261,203 @@ void Transport::ButtonClicked(ClickButton *button)
 
 void Transport::AddListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo, bool useEventLookahead)
 {
-   //try to update first in case we already point to this
-   if (!UpdateListener(listener, interval, offsetInfo))
-      mListeners.push_front(TransportListenerInfo(listener, interval, offsetInfo, useEventLookahead));
+   ListenerChange change;
+   change.mType = ListenerChange::kAddListener;
+   change.mListener = listener;
+   change.mInterval = interval;
+   change.mOffsetInfo = offsetInfo;
+   change.mUseEventLookahead = useEventLookahead;
+   QueueChange(change);
+}
+
+void Transport::UpdateListener(ITimeListener* listener, NoteInterval interval)
+{
+   ListenerChange change;
+   change.mType = ListenerChange::kUpdateInterval;
+   change.mListener = listener;
+   change.mInterval = interval;
+   QueueChange(change);
 }
 
-bool Transport::UpdateListener(ITimeListener* listener, NoteInterval interval)
+void Transport::UpdateListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo)
 {
-   for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end(); ++i)
+   ListenerChange change;
+   change.mType = ListenerChange::kUpdateListener;
+   change.mListener = listener;
+   change.mInterval = interval;
+   change.mOffsetInfo = offsetInfo;
+   QueueChange(change);
+}
+
+void Transport::RemoveListener(ITimeListener* listener)
+{
+   ListenerChange change;
+   change.mType = ListenerChange::kRemoveListener;
+   change.mListener = listener;
+   QueueChange(change);
+}
+
+bool Transport::ListenerGroup::Matches(const TransportListenerInfo& info) const
+{
+   return mInterval == info.mInterval &&
+          mOffsetInfo.mOffset == info.mOffsetInfo.mOffset &&
+          mOffsetInfo.mOffsetIsInMs == info.mOffsetInfo.mOffsetIsInMs &&
+          mUseEventLookahead == info.mUseEventLookahead;
+}
+
+void Transport::PublishListeners()
+{
+   ListenerSchedule* schedule = new ListenerSchedule();
+   for (const auto& info : mListeners)
    {
-      TransportListenerInfo& info = *i;
-      if (info.mListener == listener)
+      if (info.mInterval == kInterval_None || info.mInterval == kInterval_Free)
+         continue;
+      
+      ListenerGroup* group = nullptr;
+      for (auto& existing : schedule->mGroups)
       {
-         info.mInterval = interval;
-         return true;
+         if (existing.Matches(info))
+         {
+            group = &existing;
+            break;
+         }
       }
+      if (group == nullptr)
+      {
+         schedule->mGroups.push_back(ListenerGroup(info));
+         group = &schedule->mGroups.back();
+      }
+      group->mListeners.push_back(info.mListener);
    }
-   return false;
+   schedule->mDueEvents.reserve(schedule->mGroups.size());
+   mListenerSnapshots.Publish(schedule);
 }
 
-bool Transport::UpdateListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo)
+void Transport::AddAudioPoller(IAudioPoller* poller)
 {
-   for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end(); ++i)
+   ListenerChange change;
+   change.mType = ListenerChange::kAddAudioPoller;
+   change.mPoller = poller;
+   QueueChange(change);
+}
+
+void Transport::RemoveAudioPoller(IAudioPoller* poller)
+{
+   ListenerChange change;
+   change.mType = ListenerChange::kRemoveAudioPoller;
+   change.mPoller = poller;
+   QueueChange(change);
+}
+
+void Transport::QueueChange(const ListenerChange& change)
+{
+   while (!mListenerChanges.Push(change))
    {
-      TransportListenerInfo& info = *i;
-      if (info.mListener == listener)
+      //the ui thread can make room by applying what's there. anywhere else we can't wait for it
+      if (!juce::MessageManager::existsAndIsCurrentThread())
       {
-         info.mInterval = interval;
-         info.mOffsetInfo = offsetInfo;
-         return true;
+         assert(false);
+         return;
       }
+      PublishChanges();
    }
-   return false;
 }
 
-void Transport::RemoveListener(ITimeListener* listener)
+//ui thread. anything that frees listeners or pollers has to call this under the audio mutex before
+//letting it go, or the audio thread keeps calling into them from the old snapshot
+void Transport::PublishChanges()
 {
-   for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end();)
+   bool listenersChanged = false;
+   bool pollersChanged = false;
+   ListenerChange change;
+   while (mListenerChanges.Pop(change))
+      ApplyChange(change, listenersChanged, pollersChanged);
+   
+   if (listenersChanged)
+      PublishListeners();
+   if (pollersChanged)
+      PublishAudioPollers();
+}
+
+TransportListenerInfo* Transport::FindListener(ITimeListener* listener)
+{
+   for (auto& info : mListeners)
    {
-      TransportListenerInfo& info = *i;
       if (info.mListener == listener)
-         i = mListeners.erase(i);
-      else
-         ++i;
+         return &info;
    }
+   return nullptr;
 }
 
-void Transport::AddAudioPoller(IAudioPoller* poller)
+void Transport::ApplyChange(const ListenerChange& change, bool& listenersChanged, bool& pollersChanged)
 {
-   if (!ListContains(poller, mAudioPollers))
-      mAudioPollers.push_front(poller);
+   switch (change.mType)
+   {
+      case ListenerChange::kAddListener:
+      {
+         //update in place in case we already point to this
+         TransportListenerInfo* info = FindListener(change.mListener);
+         if (info != nullptr)
+         {
+            info->mInterval = change.mInterval;
+            info->mOffsetInfo = change.mOffsetInfo;
+         }
+         else
+         {
+            mListeners.push_front(TransportListenerInfo(change.mListener, change.mInterval, change.mOffsetInfo, change.mUseEventLookahead));
+         }
+         listenersChanged = true;
+         break;
+      }
+      case ListenerChange::kUpdateInterval:
+      case ListenerChange::kUpdateListener:
+      {
+         TransportListenerInfo* info = FindListener(change.mListener);
+         if (info != nullptr)
+         {
+            info->mInterval = change.mInterval;
+            if (change.mType == ListenerChange::kUpdateListener)
+               info->mOffsetInfo = change.mOffsetInfo;
+            listenersChanged = true;
+         }
+         break;
+      }
+      case ListenerChange::kRemoveListener:
+      {
+         for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end();)
+         {
+            if (i->mListener == change.mListener)
+            {
+               i = mListeners.erase(i);
+               listenersChanged = true;
+            }
+            else
+            {
+               ++i;
+            }
+         }
+         break;
+      }
+      case ListenerChange::kAddAudioPoller:
+         if (!ListContains(change.mPoller, mAudioPollers))
+         {
+            mAudioPollers.push_front(change.mPoller);
+            pollersChanged = true;
+         }
+         break;
+      case ListenerChange::kRemoveAudioPoller:
+         if (ListContains(change.mPoller, mAudioPollers))
+         {
+            mAudioPollers.remove(change.mPoller);
+            pollersChanged = true;
+         }
+         break;
+   }
 }
 
-void Transport::RemoveAudioPoller(IAudioPoller* poller)
+void Transport::PublishAudioPollers()
 {
-   mAudioPollers.remove(poller);
+   mAudioPollerSnapshots.Publish(new vector<IAudioPoller*>(mAudioPollers.begin(), mAudioPollers.end()));
 }
 
 int Transport::GetQuantized(double time, NoteInterval interval, double* remainderMs /*=nullptr*/)
@@ -453,55 +610,112 @@ double Transport::GetMeasureFraction(NoteInterval interval)
    }
 }
 
-void Transport::UpdateListeners(double jumpMs)
+bool Transport::HasScheduleChanged(double jumpMs)
 {
-   for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end(); ++i)
+   bool changed = mTempo != mScheduledTempo ||
+                  mSwing != mScheduledSwing ||
+                  mSwingInterval != mScheduledSwingInterval ||
+                  mTimeSigTop != mScheduledTimeSigTop ||
+                  mTimeSigBottom != mScheduledTimeSigBottom ||
+                  GetEventLookaheadMs() != mScheduledLookaheadMs ||
+                  jumpMs != mScheduledJumpMs;
+   mScheduledTempo = mTempo;
+   mScheduledSwing = mSwing;
+   mScheduledSwingInterval = mSwingInterval;
+   mScheduledTimeSigTop = mTimeSigTop;
+   mScheduledTimeSigBottom = mTimeSigBottom;
+   mScheduledLookaheadMs = GetEventLookaheadMs();
+   mScheduledJumpMs = jumpMs;
+   return changed;
+}
+
+void Transport::UpdateListeners(double jumpMs, bool measureJumped)
+{
+   ListenerSchedule* schedule = mListenerSnapshots.Acquire();
+   if (schedule == nullptr)
+      return;
+   
+   //anything that moves where the ticks land makes the cached check times meaningless
+   bool recheckAll = HasScheduleChanged(jumpMs) || measureJumped;
+   
+   vector<DueEvent>& dueEvents = schedule->mDueEvents;
+   dueEvents.clear();
+   for (auto& group : schedule->mGroups)
    {
-      const TransportListenerInfo& info = *i;
-      if (info.mInterval != kInterval_None &&
-          info.mInterval != kInterval_Free)
+      if (gTime < group.mNextCheckTime && !recheckAll)
+         continue;
+      
+      double offsetMs;
+      if (group.mOffsetInfo.mOffsetIsInMs)
+         offsetMs = group.mOffsetInfo.mOffset;
+      else
+         offsetMs = group.mOffsetInfo.mOffset*MsPerBar();
+      
+      double lookaheadMs = jumpMs;
+      if (group.mUseEventLookahead)
+         lookaheadMs = MAX(lookaheadMs, GetEventLookaheadMs());
+      
+      double checkTime = gTime + lookaheadMs;
+      
+      double remainderMs;
+      int oldStep = GetQuantized(checkTime + offsetMs - jumpMs, group.mInterval);
+      int newStep = GetQuantized(checkTime + offsetMs, group.mInterval, &remainderMs);
+      if (oldStep != newStep)
       {
-         double offsetMs;
-         if (info.mOffsetInfo.mOffsetIsInMs)
-            offsetMs = info.mOffsetInfo.mOffset;
-         else
-            offsetMs = info.mOffsetInfo.mOffset*MsPerBar();
-         
-         double lookaheadMs = jumpMs;
-         if (info.mUseEventLookahead)
-            lookaheadMs = MAX(lookaheadMs, GetEventLookaheadMs());
-         
-         double checkTime = gTime + lookaheadMs;
-         
-         double remainderMs;
-         int oldStep = GetQuantized(checkTime + offsetMs - jumpMs, info.mInterval);
-         int newStep = GetQuantized(checkTime + offsetMs, info.mInterval, &remainderMs);
-         if (oldStep != newStep)
+         double time = checkTime - remainderMs + .0001;  //TODO(Ryan) investigate this fudge number. I would think that subtracting remainderMs from checkTime would give me a number that gives me the same GetQuantized() result with a zero remainder, but sometimes it is just short of the correct quantization
+         /*ofLog() << oldStep << " " << newStep << " " << remainderMs << " " << jumpMs << " " << checkTime << " " << time << " " << GetQuantized(checkTime, info.mInterval) << " " << GetQuantized(time, info.mInterval);
+         if (GetQuantized(checkTime + offsetMs, info.mInterval) != GetQuantized(time + offsetMs, info.mInterval))
          {
-            double time = checkTime - remainderMs + .0001;  //TODO(Ryan) investigate this fudge number. I would think that subtracting remainderMs from checkTime would give me a number that gives me the same GetQuantized() result with a zero remainder, but sometimes it is just short of the correct quantization
-            /*ofLog() << oldStep << " " << newStep << " " << remainderMs << " " << jumpMs << " " << checkTime << " " << time << " " << GetQuantized(checkTime, info.mInterval) << " " << GetQuantized(time, info.mInterval);
-            if (GetQuantized(checkTime + offsetMs, info.mInterval) != GetQuantized(time + offsetMs, info.mInterval))
-            {
-               double aboveRemainderMs;
-               GetQuantized(checkTime + offsetMs, info.mInterval, &aboveRemainderMs);
-               double remainderShouldBeZeroMs;
-               GetQuantized(time + offsetMs, info.mInterval, &remainderShouldBeZeroMs);
-               ofLog() << remainderShouldBeZeroMs;
-            }*/
-            //assert(GetQuantized(checkTime + offsetMs, info.mInterval) == GetQuantized(time + offsetMs, info.mInterval));
-            info.mListener->OnTimeEvent(time);
-         }
+            double aboveRemainderMs;
+            GetQuantized(checkTime + offsetMs, info.mInterval, &aboveRemainderMs);
+            double remainderShouldBeZeroMs;
+            GetQuantized(time + offsetMs, info.mInterval, &remainderShouldBeZeroMs);
+            ofLog() << remainderShouldBeZeroMs;
+         }*/
+         //assert(GetQuantized(checkTime + offsetMs, info.mInterval) == GetQuantized(time + offsetMs, info.mInterval));
+         DueEvent event;
+         event.mTime = time;
+         event.mGroup = &group;
+         dueEvents.push_back(event);
       }
+      
+      //for subdivisions without swing we know how far into the step we are, so we can skip ahead to the block
+      //before the next one. keep a block of slack for the rounding the fudge above is working around.
+      if (mSwing == .5f && GetMeasureFraction(group.mInterval) < 1)
+         group.mNextCheckTime = gTime + GetDuration(group.mInterval) - remainderMs - jumpMs;
+      else
+         group.mNextCheckTime = gTime;
+   }
+   
+   //fire in time order, so listeners on different intervals see the block's events in the order they happen
+   for (int i=1; i<(int)dueEvents.size(); ++i)
+   {
+      DueEvent event = dueEvents[i];
+      int j = i;
+      for (; j>0 && dueEvents[j-1].mTime > event.mTime; --j)
+         dueEvents[j] = dueEvents[j-1];
+      dueEvents[j] = event;
+   }
+   for (const auto& event : dueEvents)
+   {
+      for (auto* listener : event.mGroup->mListeners)
+         listener->OnTimeEvent(event.mTime);
    }
 }
 
 void Transport::OnDrumEvent(NoteInterval drumEvent)
 {
-   for (list<TransportListenerInfo>::iterator i = mListeners.begin(); i != mListeners.end(); ++i)
+   ListenerSchedule* schedule = mListenerSnapshots.Acquire();
+   if (schedule == nullptr)
+      return;
+   
+   for (const auto& group : schedule->mGroups)
    {
-      const TransportListenerInfo& info = *i;
-      if (info.mInterval == drumEvent)
-         info.mListener->OnTimeEvent(0); //TODO(Ryan) calc sample offset
+      if (group.mInterval == drumEvent)
+      {
+         for (auto* listener : group.mListeners)
+            listener->OnTimeEvent(0); //TODO(Ryan) calc sample offset
+      }
    }
 }
 
@@ -16,11 +16,15 @@
 #include "DropdownList.h"
 #include "Checkbox.h"
 #include "IAudioPoller.h"
+#include "SnapshotPublisher.h"
+#include "MPMCRingQueue.h"
 
 class ITimeListener
 {
 public:
    virtual ~ITimeListener() {}
+   //time is exact, and falls inside the block about to be processed (or later, with lookahead).
+   //use TheTransport->GetBlockSampleOffset(time) to act on the right sample rather than the start of the block.
    virtual void OnTimeEvent(double time) = 0;
 };
 
@@ -90,10 +94,11 @@ public:
    void Advance(double ms);
    void AddListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo, bool useEventLookahead);
    void RemoveListener(ITimeListener* listener);
-   bool UpdateListener(ITimeListener* listener, NoteInterval interval);
-   bool UpdateListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo);
+   void UpdateListener(ITimeListener* listener, NoteInterval interval);
+   void UpdateListener(ITimeListener* listener, NoteInterval interval, OffsetInfo offsetInfo);
    void AddAudioPoller(IAudioPoller* poller);
    void RemoveAudioPoller(IAudioPoller* poller);
+   void PublishChanges();
    double GetDuration(NoteInterval interval);
    int GetQuantized(double time, NoteInterval interval, double* remainderMs = nullptr);
    double GetMeasurePos(double time) const { return fmod(GetMeasureTime(time), 1); }
@@ -112,6 +117,7 @@ public:
    bool CheckNeedsDraw() override { return true; }
    
    double GetEventLookaheadMs() { return sDoEventLookahead ? sEventEarlyMs : 0; }
+   static int GetBlockSampleOffset(double time) { return (int)ofClamp((time - gTime) / gInvSampleRateMs, 0, gBufferSize - 1); }
    
    //IDrawableModule
    void Init() override;
@@ -132,7 +138,60 @@ public:
    static double sEventEarlyMs;
    
 private:
-   void UpdateListeners(double jumpMs);
+   //listeners that tick at the same times, so the quantization math is done once for all of them
+   struct ListenerGroup
+   {
+      ListenerGroup(const TransportListenerInfo& info)
+      : mInterval(info.mInterval), mOffsetInfo(info.mOffsetInfo), mUseEventLookahead(info.mUseEventLookahead), mNextCheckTime(0) {}
+      bool Matches(const TransportListenerInfo& info) const;
+      
+      NoteInterval mInterval;
+      OffsetInfo mOffsetInfo;
+      bool mUseEventLookahead;
+      vector<ITimeListener*> mListeners;
+      double mNextCheckTime;  //gTime before which this group can't tick, so it isn't looked at until then
+   };
+   
+   struct DueEvent
+   {
+      double mTime;
+      const ListenerGroup* mGroup;
+   };
+   
+   struct ListenerSchedule
+   {
+      vector<ListenerGroup> mGroups;
+      vector<DueEvent> mDueEvents;   //reserved up front, so firing events never allocates
+   };
+   
+   struct ListenerChange
+   {
+      enum Type
+      {
+         kAddListener,
+         kUpdateInterval,
+         kUpdateListener,
+         kRemoveListener,
+         kAddAudioPoller,
+         kRemoveAudioPoller
+      };
+      
+      ListenerChange() : mType(kAddListener), mListener(nullptr), mPoller(nullptr), mInterval(kInterval_None), mOffsetInfo(0, false), mUseEventLookahead(false) {}
+      Type mType;
+      ITimeListener* mListener;
+      IAudioPoller* mPoller;
+      NoteInterval mInterval;
+      OffsetInfo mOffsetInfo;
+      bool mUseEventLookahead;
+   };
+   
+   void UpdateListeners(double jumpMs, bool measureJumped);
+   void QueueChange(const ListenerChange& change);
+   void ApplyChange(const ListenerChange& change, bool& listenersChanged, bool& pollersChanged);
+   TransportListenerInfo* FindListener(ITimeListener* listener);
+   void PublishListeners();
+   bool HasScheduleChanged(double jumpMs);
+   void PublishAudioPollers();
    double Swing(double measurePos);
    double SwingBeat(double pos);
    void Nudge(double amount);
@@ -165,8 +224,22 @@ private:
    int mLoopStartMeasure;
    int mLoopEndMeasure;
 
+   //listeners and pollers get added and removed from the audio thread too (slider, dropdown and midi cc
+   //callbacks), so those paths only queue the change. PublishChanges() applies them to mListeners and
+   //mAudioPollers, which only the ui thread touches, and builds the snapshots from there.
+   MPMCRingQueue<ListenerChange> mListenerChanges;
    list<TransportListenerInfo> mListeners;
+   SnapshotPublisher<ListenerSchedule> mListenerSnapshots;   //mListeners grouped for the audio thread
+   double mMeasureTimeAfterAdvance;
+   float mScheduledTempo;
+   float mScheduledSwing;
+   int mScheduledSwingInterval;
+   int mScheduledTimeSigTop;
+   int mScheduledTimeSigBottom;
+   double mScheduledLookaheadMs;
+   double mScheduledJumpMs;
    list<IAudioPoller*> mAudioPollers;
+   SnapshotPublisher< vector<IAudioPoller*> > mAudioPollerSnapshots;   //what Advance() iterates on the audio thread
 };
 
 extern Transport* TheTransport;
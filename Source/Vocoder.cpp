@@ -39,10 +39,8 @@ Vocoder::Vocoder()
 , mCut(1)
 , mCutSlider(nullptr)
 {
-   // Generate a window with a single raised cosine from N/4 to 3N/4
-   mWindower = new float[VOCODER_WINDOW_SIZE];
-   for (int i=0; i<VOCODER_WINDOW_SIZE; ++i)
-      mWindower[i] = -.5*cos(FTWO_PI*i/VOCODER_WINDOW_SIZE)+.5;
+   // Single raised cosine from N/4 to 3N/4, shared by every FFT of this size
+   mWindower = mFFT.GetHannWindow();
 
    mCarrierInputBuffer = new float[GetBuffer()->BufferSize()];
    Clear(mCarrierInputBuffer, GetBuffer()->BufferSize());
@@ -69,7 +67,6 @@ void Vocoder::CreateUIControls()
 
 Vocoder::~Vocoder()
 {
-   delete[] mWindower;
    delete[] mCarrierInputBuffer;
 }
 
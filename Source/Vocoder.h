@@ -56,7 +56,7 @@ private:
 
    FFTData mFFTData;
    
-   float* mWindower;
+   const float* mWindower;
 
    
 
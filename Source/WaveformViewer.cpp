@@ -64,22 +64,25 @@ void WaveformViewer::Process(double time)
    SyncBuffers();
    
    int bufferSize = GetBuffer()->BufferSize();
+   ScratchArena::Scope scratch;
+   float* monoBuffer = scratch.Alloc(GetBuffer()->BufferSize());
+   Clear(monoBuffer, GetBuffer()->BufferSize());
    if (GetTarget())
    {
       ChannelBuffer* out = GetTarget()->GetBuffer();
       for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
       {
          if (ch == 0)
-            BufferCopy(gWorkBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+            BufferCopy(monoBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
          else
-            Add(gWorkBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
+            Add(monoBuffer, GetBuffer()->GetChannel(ch), GetBuffer()->BufferSize());
          Add(out->GetChannel(ch), GetBuffer()->GetChannel(ch), out->BufferSize());
          GetVizBuffer()->WriteChunk(GetBuffer()->GetChannel(ch),GetBuffer()->BufferSize(), ch);
       }
    }
    
    for (int i=0; i<bufferSize; ++i)
-      mAudioView[(i+mBufferVizOffset[!mDoubleBufferFlip]) % BUFFER_VIZ_SIZE][!mDoubleBufferFlip] = gWorkBuffer[i];
+      mAudioView[(i+mBufferVizOffset[!mDoubleBufferFlip]) % BUFFER_VIZ_SIZE][!mDoubleBufferFlip] = monoBuffer[i];
       
    GetBuffer()->Reset();
    
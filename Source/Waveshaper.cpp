@@ -18,6 +18,8 @@ const int kGraphWidth = 100;
 const int kGraphHeight = 100;
 const int kGraphX = 115;
 const int kGraphY = 18;
+const int kTransferTableSize = 2049;
+const float kTransferTableRange = 4;   //x outside of [-4,4] gets evaluated directly
 }
 
 Waveshaper::Waveshaper()
@@ -35,8 +37,12 @@ Waveshaper::Waveshaper()
 , mE(0)
 , mESlider(nullptr)
 , mExpressionValid(false)
+, mUsesHistory(false)
+, mTransferTableDirty(true)
 {
    strcpy(mEntryString, "x");
+   mTransferTable.resize(kTransferTableSize);
+   bzero(mTransferTableParams, sizeof(mTransferTableParams));
 }
 
 void Waveshaper::CreateUIControls()
@@ -102,16 +108,50 @@ void Waveshaper::Process(double time)
    if (GetTarget())
    {
       int bufferSize = GetBuffer()->BufferSize();
+      ComputeSliderBlocks(bufferSize);
+      
+      //a-e have to hold still for the whole block for the table to be valid
+      bool useTable = mExpressionValid && !mUsesHistory &&
+                      !mASlider->IsBlockModulated() && !mBSlider->IsBlockModulated() && !mCSlider->IsBlockModulated() &&
+                      !mDSlider->IsBlockModulated() && !mESlider->IsBlockModulated();
+      if (useTable)
+         UpdateTransferTable();
+      const float* rescale = mRescaleSlider->IsBlockModulated() ? mRescaleSlider->GetBlockValues() : nullptr;
       
       ChannelBuffer* out = GetTarget()->GetBuffer();
       for (int ch=0; ch<GetBuffer()->NumActiveChannels(); ++ch)
       {
          float* buffer = GetBuffer()->GetChannel(ch);
-         if (mExpressionValid)
+         if (useTable)
          {
+            BiquadState& state = mBiquadState[ch];
             for (int i=0; i<bufferSize; ++i)
             {
-               ComputeSliders(i);
+               float scale = rescale ? rescale[i] : mRescale;
+               float input = buffer[i] * scale;
+               
+               if (input > max)
+                  max = input;
+               if (input < min)
+                  min = input;
+               
+               buffer[i] = LookUpTransfer(input) / scale;
+               
+               //nothing reads the history, but keep it current in case the expression changes to one that does
+               state.mHistPre2 = state.mHistPre1;
+               state.mHistPre1 = input;
+            }
+            for (int i=MAX(0, bufferSize-2); i<bufferSize; ++i)
+            {
+               state.mHistPost2 = state.mHistPost1;
+               state.mHistPost1 = ofClamp(buffer[i], -1, 1);
+            }
+         }
+         else if (mExpressionValid)
+         {
+            for (int i=0; i<bufferSize; ++i)
+            {
+               ApplySliderBlockValues(i);
                mExpressionInput = buffer[i] * mRescale;
                
                mHistPre1 = mBiquadState[ch].mHistPre1;
@@ -144,12 +184,60 @@ void Waveshaper::Process(double time)
    GetBuffer()->Reset();
 }
 
+void Waveshaper::UpdateTransferTable()
+{
+   if (!mTransferTableDirty &&
+       mTransferTableParams[0] == mA && mTransferTableParams[1] == mB && mTransferTableParams[2] == mC &&
+       mTransferTableParams[3] == mD && mTransferTableParams[4] == mE)
+      return;
+   
+   for (int i=0; i<kTransferTableSize; ++i)
+   {
+      mExpressionInput = ofMap(i, 0, kTransferTableSize - 1, -kTransferTableRange, kTransferTableRange);
+      mTransferTable[i] = mExpression.value();
+   }
+   
+   mTransferTableParams[0] = mA;
+   mTransferTableParams[1] = mB;
+   mTransferTableParams[2] = mC;
+   mTransferTableParams[3] = mD;
+   mTransferTableParams[4] = mE;
+   mTransferTableDirty = false;
+}
+
+float Waveshaper::LookUpTransfer(float x)
+{
+   float pos = (x + kTransferTableRange) * ((kTransferTableSize - 1) / (kTransferTableRange * 2));
+   if (pos >= 0 && pos < kTransferTableSize - 1)
+   {
+      int index = (int)pos;
+      float a = pos - index;
+      return mTransferTable[index] + (mTransferTable[index+1] - mTransferTable[index]) * a;
+   }
+   
+   mExpressionInput = x;
+   return mExpression.value();
+}
+
 void Waveshaper::TextEntryComplete(TextEntry* entry)
 {
    exprtk::parser<float> parser;
    mExpressionValid = parser.compile(mEntryString, mExpression);
    if (mExpressionValid)
+   {
       parser.compile(mEntryString, mExpressionDraw);
+      
+      vector<string> variables;
+      exprtk::collect_variables(mEntryString, variables);
+      mUsesHistory = false;
+      for (const auto& variable : variables)
+      {
+         juce::String name = juce::String(variable).toLowerCase();
+         if (name == "x1" || name == "x2" || name == "y1" || name == "y2" || name == "t")
+            mUsesHistory = true;
+      }
+   }
+   mTransferTableDirty = true;
 }
 
 void Waveshaper::DrawModule()
@@ -46,6 +46,9 @@ private:
    void GetModuleDimensions(float& w, float& h) override;
    bool Enabled() const override { return mEnabled; }
    
+   void UpdateTransferTable();
+   float LookUpTransfer(float x);
+   
    float mRescale;
    FloatSlider* mRescaleSlider;
    float mA;
@@ -77,6 +80,13 @@ private:
    float mSmoothMax;
    float mSmoothMin;
    
+   //expressions that only depend on x and a-e are sampled into a table, so a block costs a lookup per sample
+   //instead of walking the expression tree
+   bool mUsesHistory;
+   bool mTransferTableDirty;
+   vector<float> mTransferTable;
+   float mTransferTableParams[5];
+   
    struct BiquadState
    {
       BiquadState()
@@ -21,6 +21,8 @@ public:
 			void	setfeedback(float val);
 			float	getfeedback();
 private:
+	friend class revmodel;
+
 	float	feedback;
 	float	filterstore;
 	float	damp1;
@@ -5,6 +5,7 @@
 // This code is public domain
 
 #include "revmodel.hpp"
+#include <math.h>
 
 revmodel::revmodel()
 {
@@ -50,6 +51,10 @@ revmodel::revmodel()
 	setwidth(initialwidth);
 	setmode(initialmode);
 
+	linepeak = 0;
+	quietsamples = 0;
+	idle = false;
+
 	// Buffer will be full of rubbish - so we MUST mute them
 	mute();
 }
@@ -74,73 +79,219 @@ void revmodel::mute()
 
 void revmodel::processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
 {
-	float outL,outR,input;
+	processblock(inputL,inputR,outputL,outputR,numsamples,skip,false);
+}
 
-	while(numsamples-- > 0)
-	{
-		outL = outR = 0;
-		input = (*inputL + *inputR) * gain;
+void revmodel::processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
+{
+	processblock(inputL,inputR,outputL,outputR,numsamples,skip,true);
+}
+
+// Block processing
+//
+// The sixteen combs share their feedback and damping and don't depend on each
+// other, so each sample steps all of them together, left and right, straight
+// down their delay lines up to the first wraparound, with no calls or index
+// checks per sample.  The allpasses keep nothing outside their delay lines, so
+// each one can run straight down a stretch on its own.
+//
+// Only the combs are watched for the tail: with the combs quiet, the allpasses
+// (with their feedback of 0.5) empty out well inside the time it takes the
+// longest comb to go round twice.
+//
+// Denormals are left to the audio thread's flush-to-zero mode.
 
-		// Accumulate comb filters in parallel
+void revmodel::processblock(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, bool mix)
+{
+	float input[chunksize];
+	float outL[chunksize];
+	float outR[chunksize];
+
+	while(numsamples > 0)
+	{
+		int n = numsamples < chunksize ? (int)numsamples : chunksize;
 		int i;
-		for(i=0; i<numcombs; i++)
+
+		float inputpeak = 0;
+		for(i=0; i<n; i++)
 		{
-			outL += combL[i].process(input);
-			outR += combR[i].process(input);
+			input[i] = (inputL[i*skip] + inputR[i*skip]) * gain;
+			float level = fabsf(input[i]);
+			inputpeak = level > inputpeak ? level : inputpeak;
 		}
 
-		// Feed through allpasses in series
-		for(i=0; i<numallpasses; i++)
+		if (idle && inputpeak < tailthreshold)
 		{
-			outL = allpassL[i].process(outL);
-			outR = allpassR[i].process(outR);
+			// The tail has died away and nothing is coming in, so only the dry signal is left
+			for(i=0; i<n; i++)
+			{
+				outL[i] = 0;
+				outR[i] = 0;
+			}
+		}
+		else
+		{
+			idle = false;
+			linepeak = inputpeak;
+
+			// Accumulate comb filters in parallel
+			processcombs(input,outL,outR,n);
+
+			// Feed through allpasses in series
+			processallpasses(allpassL,outL,n);
+			processallpasses(allpassR,outR,n);
+
+			// Once everything in the delay lines has been written under the threshold,
+			// they can be cleared and left alone until there's input again
+			if (linepeak < tailthreshold)
+				quietsamples += n;
+			else
+				quietsamples = 0;
+			if (quietsamples > combtuningR8*2)
+			{
+				mute();
+				for(i=0; i<numcombs; i++)
+				{
+					combL[i].filterstore = 0;
+					combR[i].filterstore = 0;
+				}
+				idle = true;
+			}
 		}
 
-		// Calculate output REPLACING anything already there
-		*outputL = outL*wet1 + outR*wet2 + *inputL*dry;
-		*outputR = outR*wet1 + outL*wet2 + *inputR*dry;
+		for(i=0; i<n; i++)
+		{
+			float wetL = outL[i]*wet1 + outR[i]*wet2 + inputL[i*skip]*dry;
+			float wetR = outR[i]*wet1 + outL[i]*wet2 + inputR[i*skip]*dry;
+			if (mix)
+			{
+				outputL[i*skip] += wetL;
+				outputR[i*skip] += wetR;
+			}
+			else
+			{
+				outputL[i*skip] = wetL;
+				outputR[i*skip] = wetR;
+			}
+		}
 
-		// Increment sample pointers, allowing for interleave (if any)
-		inputL += skip;
-		inputR += skip;
-		outputL += skip;
-		outputR += skip;
+		inputL += n*skip;
+		inputR += n*skip;
+		outputL += n*skip;
+		outputR += n*skip;
+		numsamples -= n;
 	}
 }
 
-void revmodel::processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
+void revmodel::processcombs(const float *input, float *outputL, float *outputR, int numsamples)
 {
-	float outL,outR,input;
+	comb *lanes[numlanes];
+	for(int k=0; k<numcombs; k++)
+	{
+		lanes[k] = &combL[k];
+		lanes[numcombs+k] = &combR[k];
+	}
+
+	// update() gives every comb the same settings
+	const float feedback = combL[0].feedback;
+	const float damp1 = combL[0].damp1;
+	const float damp2 = combL[0].damp2;
 
-	while(numsamples-- > 0)
+	float store[numlanes];
+	float peak[numlanes];
+	for(int k=0; k<numlanes; k++)
 	{
-		outL = outR = 0;
-		input = (*inputL + *inputR) * gain;
+		store[k] = lanes[k]->filterstore;
+		peak[k] = 0;
+	}
 
-		int i;
-		// Accumulate comb filters in parallel
-		for(i=0; i<numcombs; i++)
+	while(numsamples > 0)
+	{
+		// Up to the first comb that wraps around
+		int n = numsamples;
+		for(int k=0; k<numlanes; k++)
 		{
-			outL += combL[i].process(input);
-			outR += combR[i].process(input);
+			int remaining = lanes[k]->bufsize - lanes[k]->bufidx;
+			n = remaining < n ? remaining : n;
 		}
 
-		// Feed through allpasses in series
-		for(i=0; i<numallpasses; i++)
+		float *line[numlanes];
+		for(int k=0; k<numlanes; k++)
+			line[k] = lanes[k]->buffer + lanes[k]->bufidx;
+
+		// The sixteen filters don't depend on each other, so stepping them side by
+		// side keeps them all in flight at once
+		for(int i=0; i<n; i++)
 		{
-			outL = allpassL[i].process(outL);
-			outR = allpassR[i].process(outR);
+			const float in = input[i];
+			float sumL = 0;
+			float sumR = 0;
+			for(int k=0; k<numlanes; k++)
+			{
+				float output = line[k][i];
+				store[k] = output*damp2 + store[k]*damp1;
+				float value = in + store[k]*feedback;
+				line[k][i] = value;
+				float level = fabsf(value);
+				peak[k] = level > peak[k] ? level : peak[k];
+				if (k < numcombs)
+					sumL += output;
+				else
+					sumR += output;
+			}
+			outputL[i] = sumL;
+			outputR[i] = sumR;
 		}
 
-		// Calculate output MIXING with anything already there
-		*outputL += outL*wet1 + outR*wet2 + *inputL*dry;
-		*outputR += outR*wet1 + outL*wet2 + *inputR*dry;
+		for(int k=0; k<numlanes; k++)
+		{
+			lanes[k]->bufidx += n;
+			if (lanes[k]->bufidx >= lanes[k]->bufsize)
+				lanes[k]->bufidx = 0;
+		}
 
-		// Increment sample pointers, allowing for interleave (if any)
-		inputL += skip;
-		inputR += skip;
-		outputL += skip;
-		outputR += skip;
+		input += n;
+		outputL += n;
+		outputR += n;
+		numsamples -= n;
+	}
+
+	for(int k=0; k<numlanes; k++)
+	{
+		lanes[k]->filterstore = store[k];
+		linepeak = peak[k] > linepeak ? peak[k] : linepeak;
+	}
+}
+
+void revmodel::processallpasses(allpass *allpasses, float *buffer, int numsamples)
+{
+	for(int j=0; j<numallpasses; j++)
+	{
+		allpass &a = allpasses[j];
+		const float feedback = a.feedback;
+		int i = 0;
+		while(i < numsamples)
+		{
+			// Up to where the delay line wraps around
+			int n = numsamples - i;
+			int remaining = a.bufsize - a.bufidx;
+			n = remaining < n ? remaining : n;
+
+			float *line = a.buffer + a.bufidx;
+			float *samples = buffer + i;
+			for(int s=0; s<n; s++)
+			{
+				float bufout = line[s];
+				float input = samples[s];
+				line[s] = input + bufout*feedback;
+				samples[s] = -input + bufout;
+			}
+
+			a.bufidx += n;
+			if (a.bufidx >= a.bufsize)
+				a.bufidx = 0;
+			i += n;
+		}
 	}
 }
 
@@ -32,6 +32,14 @@ public:
 			float	getmode();
 			void	update();
 private:
+			void	processblock(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, bool mix);
+			void	processcombs(const float *input, float *outputL, float *outputR, int numsamples);
+			void	processallpasses(allpass *allpasses, float *buffer, int numsamples);
+
+	// Samples per pass of the block processing, and how many combs step together
+	static const int	chunksize = 128;
+	static const int	numlanes = numcombs*2;
+
 	float	gain;
 	float	roomsize,roomsize1;
 	float	damp,damp1;
@@ -40,6 +48,11 @@ private:
 	float	width;
 	float	mode;
 
+	// Tail tracking, so an idle reverb can be skipped
+	float	linepeak;		// loudest sample written into a comb this block
+	int		quietsamples;	// how long every delay line has been under tailthreshold
+	bool	idle;			// delay lines are muted, and stay that way while the input is silent
+
 	// The following are all declared inline 
 	// to remove the need for dynamic allocation
 	// with its subsequent error-checking messiness
@@ -24,6 +24,7 @@ const float initialwidth	= 1.0f;
 const float initialmode		= 0.0f;
 const float freezemode		= 1.0f;
 const int	stereospread	= 23;
+const float	tailthreshold	= 1e-7f;	// -140dB in every delay line keeps the summed tail under -120dB
 
 // These values assume 44.1KHz sample rate
 // they will probably be OK for 48KHz sample rate